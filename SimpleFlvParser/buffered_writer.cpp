@@ -0,0 +1,103 @@
+#include "buffered_writer.h"
+#include <string.h>
+
+BufferedWriter::BufferedWriter(FILE* file, size_t capacity)
+	: file_(file), buffer_(capacity > 64 ? capacity : 64)
+{
+
+}
+
+BufferedWriter::~BufferedWriter()
+{
+	Flush();
+}
+
+void BufferedWriter::SetFile(FILE* file)
+{
+	Flush();
+	file_ = file;
+}
+
+void BufferedWriter::Flush()
+{
+	if (memory_)
+		return;
+	if (size_ > 0 && file_ && fwrite(buffer_.data(), 1, size_, file_) != size_)
+		error_ = true;
+	size_ = 0;
+}
+
+char* BufferedWriter::Reserve(size_t size)
+{
+	if (size_ + size > buffer_.size())
+	{
+		if (memory_)
+			buffer_.resize(size_ + size > buffer_.size() * 2 ? size_ + size : buffer_.size() * 2);
+		else
+			Flush();
+	}
+	char* pos = buffer_.data() + size_;
+	size_ += size;
+	return pos;
+}
+
+void BufferedWriter::Write(const char* data, size_t size)
+{
+	if (size > buffer_.size() / 2 && !memory_)
+	{
+		//too big to be worth copying
+		Flush();
+		if (file_ && fwrite(data, 1, size, file_) != size)
+			error_ = true;
+		return;
+	}
+	memcpy(Reserve(size), data, size);
+}
+
+void BufferedWriter::Char(char c)
+{
+	*Reserve(1) = c;
+}
+
+void BufferedWriter::Fill(char c, int count)
+{
+	while (count > 0)
+	{
+		int size = count < (int)buffer_.size() / 2 ? count : (int)buffer_.size() / 2;
+		memset(Reserve(size), c, size);
+		count -= size;
+	}
+}
+
+void BufferedWriter::Str(const char* str)
+{
+	if (str)
+		Write(str, strlen(str));
+}
+
+void BufferedWriter::Str(const char* str, int width)
+{
+	size_t length = str ? strlen(str) : 0;
+	Fill(' ', width - (int)length);
+	Write(str, length);
+}
+
+void BufferedWriter::Int(int64_t value, int width)
+{
+	//the digits are generated from the lowest one
+	char digits[24];
+	int count = 0;
+	uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+	do
+	{
+		digits[count++] = (char)('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude);
+	if (value < 0)
+		digits[count++] = '-';
+
+	Fill(' ', width - count);
+	char* pos = Reserve(count);
+	for (int i = count - 1; i >= 0; i--)
+		*pos++ = digits[i];
+}
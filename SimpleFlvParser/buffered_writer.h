@@ -0,0 +1,44 @@
+#ifndef _SFP_BUFFERED_WRITER_H_
+#define _SFP_BUFFERED_WRITER_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+
+//Formats the text into a large buffer which is written to the file in big blocks,
+//the numbers are formatted by hand, so nothing goes through stdio or is allocated per row.
+//The file is not owned, the buffer is flushed when it's full, on Flush() and on destruction.
+class BufferedWriter
+{
+public:
+	explicit BufferedWriter(FILE* file = NULL, size_t capacity = 1024 * 1024);
+	~BufferedWriter();
+	void SetFile(FILE* file); //flush into the old file first
+	bool IsGood() const { return file_ != NULL && !error_; }
+
+	//No file, the buffer grows instead of being flushed, e.g. to build a json string in place.
+	void KeepInMemory() { SetFile(NULL); memory_ = true; }
+	const char* Data() const { return buffer_.data(); }
+	size_t Size() const { return size_; }
+	void Clear() { size_ = 0; }
+
+	void Write(const char* data, size_t size);
+	void Char(char c);
+	void Fill(char c, int count); //nothing if count <= 0
+	void Str(const char* str);
+	void Str(const char* str, int width); //right aligned, same as %*s
+	void Int(int64_t value, int width = 0); //right aligned, same as %*d
+	void Flush();
+
+private:
+	char* Reserve(size_t size); //room for size more bytes, flush or grow first if they don't fit
+
+private:
+	FILE* file_ = NULL;
+	std::vector<char> buffer_;
+	size_t size_ = 0;
+	bool error_ = false;
+	bool memory_ = false;
+};
+
+#endif //_SFP_BUFFERED_WRITER_H_
@@ -0,0 +1,64 @@
+#ifndef _SFP_COLUMNAR_FORMAT_H_
+#define _SFP_COLUMNAR_FORMAT_H_
+
+#include <stdint.h>
+
+//The columnar file written by ColumnarOutput and mapped by ColumnarReader, in the byte order of the host:
+//	[column 0 values][column 1 values]...   each one is a plain array, starting at a multiple of COLUMNAR_ALIGN
+//	[dictionaries]                          the strings of the dictionary columns, each one ends with '\0'
+//	[ColumnarColumnDesc x column_count]     the schema
+//	[ColumnarTrailer]                       the last bytes of the file
+//So scanning a column is a sequential read of one int array.
+
+#define COLUMNAR_MAGIC   "SFPCOL\r\n"
+#define COLUMNAR_VERSION 1
+#define COLUMNAR_ALIGN   64
+
+enum ColumnarType
+{
+	ColumnarInt8 = 1,
+	ColumnarUInt8,
+	ColumnarInt16,
+	ColumnarUInt16,
+	ColumnarInt32,
+	ColumnarUInt32,
+	ColumnarInt64,
+	ColumnarUInt64,
+	ColumnarDict16, //uint16 index into the strings of the column's dictionary
+};
+
+inline int ColumnarTypeWidth(int type)
+{
+	switch (type)
+	{
+	case ColumnarInt8: case ColumnarUInt8: return 1;
+	case ColumnarInt16: case ColumnarUInt16: case ColumnarDict16: return 2;
+	case ColumnarInt32: case ColumnarUInt32: return 4;
+	case ColumnarInt64: case ColumnarUInt64: return 8;
+	default: return 0;
+	}
+}
+
+#pragma pack(push, 1)
+struct ColumnarColumnDesc
+{
+	char     table[16];   //"tags" or "nalus"
+	char     name[32];
+	uint32_t type;        //ColumnarType
+	uint32_t dict_count;  //how many strings in the dictionary, 0 if it's not a dictionary column
+	uint64_t offset;      //of the values
+	uint64_t rows;
+	uint64_t dict_offset; //of the first dictionary string
+	uint64_t dict_size;   //bytes of all the dictionary strings
+};
+
+struct ColumnarTrailer
+{
+	uint64_t schema_offset; //of the first ColumnarColumnDesc
+	uint32_t column_count;
+	uint32_t version;
+	char     magic[8];
+};
+#pragma pack(pop)
+
+#endif //_SFP_COLUMNAR_FORMAT_H_
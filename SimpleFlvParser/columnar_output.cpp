@@ -0,0 +1,316 @@
+#include "columnar_output.h"
+#include "flv_file_internal.h"
+#include "buffered_writer.h"
+
+#include <string.h>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <io.h>
+#pragma warning(disable: 4996)
+#define access _access
+#else
+#include <unistd.h>
+#endif
+
+struct ColumnarSchema
+{
+	const char*  name;
+	ColumnarType type;
+};
+
+enum TagColumn
+{
+	TagFileIndex, TagSerial, TagOffset, TagSize, TagPreviousSize, TagDts, TagPts, TagDtsDiff,
+	TagType, TagSubType, TagFormat, TagFrameType, TagFormatName, TagColumnCount
+};
+
+static const ColumnarSchema TAG_SCHEMA[TagColumnCount] = {
+	{ "file_index", ColumnarInt32 },
+	{ "serial", ColumnarInt32 },
+	{ "offset", ColumnarUInt64 },
+	{ "tag_size", ColumnarUInt32 },
+	{ "previous_tag_size", ColumnarUInt32 },
+	{ "dts", ColumnarUInt32 },
+	{ "pts", ColumnarUInt32 },
+	{ "dts_diff", ColumnarInt32 },
+	{ "tag_type", ColumnarUInt8 },
+	{ "sub_type", ColumnarInt8 },      //-1 if none
+	{ "format", ColumnarInt16 },       //the first byte of the tag data, -1 if none
+	{ "frame_type", ColumnarInt8 },    //of the video tags, -1 for the others
+	{ "format_name", ColumnarDict16 },
+};
+
+enum NaluColumn
+{
+	NaluFileIndex, NaluTagSerial, NaluOffset, NaluSize, NaluCodec, NaluRefIdc, NaluType, NaluSliceType,
+	NaluFirstMbInSlice, NaluPpsId, NaluFrameNum, NaluFieldPicFlag, NaluPocLsb, NaluQpDelta, NaluTypeName, NaluColumnCount
+};
+
+static const ColumnarSchema NALU_SCHEMA[NaluColumnCount] = {
+	{ "file_index", ColumnarInt32 },
+	{ "tag_serial", ColumnarInt32 },
+	{ "offset", ColumnarUInt64 },
+	{ "nalu_size", ColumnarUInt32 },
+	{ "codec_id", ColumnarUInt8 },
+	{ "nal_ref_idc", ColumnarUInt8 },
+	{ "nal_unit_type", ColumnarInt8 },  //-1 if unknown
+	{ "slice_type", ColumnarInt8 },     //-1 if not a slice
+	{ "first_mb_in_slice", ColumnarInt32 },
+	{ "pic_parameter_set_id", ColumnarInt32 },
+	{ "frame_num", ColumnarInt32 },
+	{ "field_pic_flag", ColumnarInt8 },
+	{ "pic_order_cnt_lsb", ColumnarInt32 },
+	{ "slice_qp_delta", ColumnarInt8 },
+	{ "nal_unit_type_name", ColumnarDict16 },
+};
+
+//The values of one column, staged in a temporary file until the output is finished.
+class ColumnarOutput::Column
+{
+public:
+	Column(const char* table, const ColumnarSchema& schema)
+		: table_(table), schema_(schema), writer_(NULL, 64 * 1024)
+	{
+		file_ = tmpfile();
+		writer_.SetFile(file_);
+	}
+
+	~Column()
+	{
+		if (file_)
+			fclose(file_);
+	}
+
+	bool IsGood() const { return file_ != NULL; }
+	const char* Table() const { return table_; }
+	const ColumnarSchema& Schema() const { return schema_; }
+	uint64_t Rows() const { return rows_; }
+	const std::vector<std::string>& Dictionary() const { return strings_; }
+
+	void Put(int64_t value)
+	{
+		switch (schema_.type)
+		{
+		case ColumnarInt8: Raw((int8_t)value); break;
+		case ColumnarUInt8: Raw((uint8_t)value); break;
+		case ColumnarInt16: Raw((int16_t)value); break;
+		case ColumnarUInt16: case ColumnarDict16: Raw((uint16_t)value); break;
+		case ColumnarInt32: Raw((int32_t)value); break;
+		case ColumnarUInt32: Raw((uint32_t)value); break;
+		case ColumnarInt64: Raw((int64_t)value); break;
+		case ColumnarUInt64: Raw((uint64_t)value); break;
+		}
+		rows_++;
+	}
+
+	//the strings come from static tables, so they are looked up by the pointer first
+	void Put(const char* str)
+	{
+		if (!str)
+			str = "";
+		auto iter = by_pointer_.find(str);
+		if (iter == by_pointer_.end())
+		{
+			auto found = by_string_.find(str);
+			if (found == by_string_.end())
+			{
+				if (strings_.size() >= 0xFFFF)
+					found = by_string_.find(strings_.back()); //full, they all become the last one
+				else
+				{
+					found = by_string_.insert(std::make_pair(std::string(str), (uint16_t)strings_.size())).first;
+					strings_.push_back(str);
+				}
+			}
+			iter = by_pointer_.insert(std::make_pair(str, found->second)).first;
+		}
+		Put((int64_t)iter->second);
+	}
+
+	//append the staged values to the output
+	bool CopyTo(BufferedWriter& out)
+	{
+		writer_.Flush();
+		if (!writer_.IsGood())
+			return false;
+		char buff[64 * 1024];
+		size_t read_size = 0;
+		rewind(file_);
+		while ((read_size = fread(buff, 1, sizeof(buff), file_)) > 0)
+			out.Write(buff, read_size);
+		return true;
+	}
+
+private:
+	template<typename T> void Raw(T value) { writer_.Write((const char*)&value, sizeof(value)); }
+
+private:
+	const char* table_;
+	ColumnarSchema schema_;
+	FILE* file_ = NULL;
+	BufferedWriter writer_;
+	uint64_t rows_ = 0;
+	std::unordered_map<const char*, uint16_t> by_pointer_;
+	std::unordered_map<std::string, uint16_t> by_string_;
+	std::vector<std::string> strings_;
+};
+
+ColumnarOutput::ColumnarOutput(const std::string& col_path)
+{
+	if (access(col_path.c_str(), 0) == 0) //file already exists
+		remove(col_path.c_str()); //delete the file
+	if (access(col_path.c_str(), 0) == 0)
+	{
+		printf("Columnar file %s already exists and is occupied now.\n", col_path.c_str());
+		return;
+	}
+
+	AddColumns("tags", TAG_SCHEMA, TagColumnCount, tag_columns_);
+	AddColumns("nalus", NALU_SCHEMA, NaluColumnCount, nalu_columns_);
+	for (auto& column : tag_columns_)
+		if (!column->IsGood())
+			return;
+	for (auto& column : nalu_columns_)
+		if (!column->IsGood())
+			return;
+
+	col_file_ = fopen(col_path.c_str(), "wb");
+	if (!col_file_)
+		printf("Create columnar file %s error.\n", col_path.c_str());
+}
+
+ColumnarOutput::~ColumnarOutput()
+{
+	if (col_file_)
+	{
+		Finish();
+		fclose(col_file_);
+		col_file_ = NULL;
+	}
+}
+
+void ColumnarOutput::AddColumns(const char* table, const ColumnarSchema* schema, int count, std::vector<std::unique_ptr<Column> >& columns)
+{
+	for (int i = 0; i < count; i++)
+		columns.push_back(std::unique_ptr<Column>(new Column(table, schema[i])));
+}
+
+void ColumnarOutput::FlvHeaderOutput(FlvHeaderInterface* header)
+{
+	if (header == NULL)
+		return;
+	file_index_++; //a new file begins
+}
+
+void ColumnarOutput::FlvTagOutput(FlvTagInterface* tag)
+{
+	if (tag == NULL || !col_file_)
+		return;
+
+	std::unique_ptr<Column>* c = tag_columns_.data();
+	int format = tag->FormatId();
+	bool is_video = tag->TagTypeId() == FlvTagTypeVideo;
+	c[TagFileIndex]->Put(file_index_ < 0 ? 0 : file_index_);
+	c[TagSerial]->Put(tag->Serial());
+	c[TagOffset]->Put((int64_t)tag->Offset());
+	c[TagSize]->Put(tag->TagSize());
+	c[TagPreviousSize]->Put(tag->PreviousTagSize());
+	c[TagDts]->Put(tag->Dts());
+	c[TagPts]->Put(tag->Pts());
+	c[TagDtsDiff]->Put(tag->DtsDiff());
+	c[TagType]->Put(tag->TagTypeId());
+	c[TagSubType]->Put(tag->SubTypeId());
+	c[TagFormat]->Put(format);
+	c[TagFrameType]->Put(is_video && format >= 0 ? format >> 4 : -1);
+	c[TagFormatName]->Put(tag->FormatName());
+}
+
+void ColumnarOutput::NaluOutput(NaluInterface* nalu)
+{
+	if (nalu == NULL || !col_file_)
+		return;
+
+	std::unique_ptr<Column>* c = nalu_columns_.data();
+	c[NaluFileIndex]->Put(file_index_ < 0 ? 0 : file_index_);
+	c[NaluTagSerial]->Put(nalu->TagSerialBelong());
+	c[NaluOffset]->Put((int64_t)nalu->Offset());
+	c[NaluSize]->Put(nalu->NaluSize());
+	c[NaluCodec]->Put(nalu->CodecId());
+	c[NaluRefIdc]->Put(nalu->NalRefIdc());
+	c[NaluType]->Put(nalu->NalUnitTypeId());
+	c[NaluSliceType]->Put(nalu->SliceTypeId());
+	c[NaluFirstMbInSlice]->Put(nalu->FirstMbInSlice());
+	c[NaluPpsId]->Put(nalu->PicParameterSetId());
+	c[NaluFrameNum]->Put(nalu->FrameNum());
+	c[NaluFieldPicFlag]->Put(nalu->FieldPicFlag());
+	c[NaluPocLsb]->Put(nalu->PicOrderCntLsb());
+	c[NaluQpDelta]->Put(nalu->SliceQpDelta());
+	c[NaluTypeName]->Put(nalu->NalUnitTypeName());
+}
+
+void ColumnarOutput::Finish()
+{
+	std::vector<Column*> columns;
+	for (auto& column : tag_columns_)
+		columns.push_back(column.get());
+	for (auto& column : nalu_columns_)
+		columns.push_back(column.get());
+
+	BufferedWriter out(col_file_);
+	uint64_t offset = 0;
+	std::vector<ColumnarColumnDesc> descs(columns.size());
+	bool good = true;
+
+	//the values, every column starts aligned so the arrays can be used in place
+	for (size_t i = 0; i < columns.size(); i++)
+	{
+		Column* column = columns[i];
+		ColumnarColumnDesc& desc = descs[i];
+		memset(&desc, 0, sizeof(desc));
+		strncpy(desc.table, column->Table(), sizeof(desc.table) - 1);
+		strncpy(desc.name, column->Schema().name, sizeof(desc.name) - 1);
+		desc.type = column->Schema().type;
+		desc.rows = column->Rows();
+
+		int padding = (int)((COLUMNAR_ALIGN - offset % COLUMNAR_ALIGN) % COLUMNAR_ALIGN);
+		out.Fill('\0', padding);
+		offset += padding;
+		desc.offset = offset;
+		good = column->CopyTo(out) && good;
+		offset += desc.rows * ColumnarTypeWidth(desc.type);
+	}
+
+	//the dictionaries
+	for (size_t i = 0; i < columns.size(); i++)
+	{
+		const std::vector<std::string>& strings = columns[i]->Dictionary();
+		if (descs[i].type != ColumnarDict16)
+			continue;
+		descs[i].dict_offset = offset;
+		descs[i].dict_count = (uint32_t)strings.size();
+		for (const std::string& str : strings)
+		{
+			out.Write(str.c_str(), str.size() + 1);
+			descs[i].dict_size += str.size() + 1;
+		}
+		offset += descs[i].dict_size;
+	}
+
+	//the schema
+	int padding = (int)((8 - offset % 8) % 8);
+	out.Fill('\0', padding);
+	offset += padding;
+	ColumnarTrailer trailer;
+	memset(&trailer, 0, sizeof(trailer));
+	trailer.schema_offset = offset;
+	trailer.column_count = (uint32_t)descs.size();
+	trailer.version = COLUMNAR_VERSION;
+	memcpy(trailer.magic, COLUMNAR_MAGIC, sizeof(trailer.magic));
+	out.Write((const char*)descs.data(), descs.size() * sizeof(ColumnarColumnDesc));
+	out.Write((const char*)&trailer, sizeof(trailer));
+	out.Flush();
+
+	if (!good || !out.IsGood())
+		printf("Write columnar file error.\n");
+}
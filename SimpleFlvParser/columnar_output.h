@@ -0,0 +1,40 @@
+#ifndef _SFP_COLUMNAR_OUTPUT_H_
+#define _SFP_COLUMNAR_OUTPUT_H_
+
+#include "output_interface.h"
+#include "input_interface.h"
+#include "columnar_format.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <memory>
+
+struct ColumnarSchema;
+
+//Fixed width column arrays of the tags and nalus in one file, see columnar_format.h, read them with ColumnarReader.
+//Each column is staged in its own temporary file while the rows arrive, they are copied one after another
+//into the output with the schema when it's closed.
+class ColumnarOutput : public FlvOutputInterface
+{
+public:
+	ColumnarOutput(const std::string& col_path);
+	~ColumnarOutput();
+
+	virtual void FlvHeaderOutput(FlvHeaderInterface* header) override;
+	virtual void FlvTagOutput(FlvTagInterface* tag) override;
+	virtual void NaluOutput(NaluInterface* nalu) override;
+	virtual bool IsGood() override { return col_file_ != NULL; }
+
+private:
+	class Column;
+	void AddColumns(const char* table, const ColumnarSchema* schema, int count, std::vector<std::unique_ptr<Column> >& columns);
+	void Finish(); //copy the columns into the output, then the dictionaries and the schema
+
+private:
+	FILE* col_file_ = NULL;
+	std::vector<std::unique_ptr<Column> > tag_columns_;
+	std::vector<std::unique_ptr<Column> > nalu_columns_;
+	int file_index_ = -1; //the input files are told apart by their headers
+};
+
+#endif //_SFP_COLUMNAR_OUTPUT_H_
@@ -0,0 +1,157 @@
+#include "columnar_reader.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+ColumnarReader::ColumnarReader(const std::string& col_path)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(col_path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	LARGE_INTEGER size;
+	if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		printf("Open columnar file %s error.\n", col_path.c_str());
+		if (file != INVALID_HANDLE_VALUE)
+			CloseHandle(file);
+		return;
+	}
+	file_ = file;
+	mapping_ = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping_)
+		data_ = (const uint8_t*)MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+	size_ = (uint64_t)size.QuadPart;
+#else
+	int fd = open(col_path.c_str(), O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		printf("Open columnar file %s error.\n", col_path.c_str());
+		if (fd >= 0)
+			close(fd);
+		return;
+	}
+	void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd); //the mapping keeps the file
+	if (data != MAP_FAILED)
+	{
+		data_ = (const uint8_t*)data;
+		madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL); //the columns are scanned from the start to the end
+	}
+	size_ = (uint64_t)st.st_size;
+#endif
+
+	if (!data_)
+		printf("Map columnar file %s error.\n", col_path.c_str());
+	else if (!Load())
+	{
+		printf("%s is not a valid columnar file.\n", col_path.c_str());
+		Unmap();
+	}
+}
+
+ColumnarReader::~ColumnarReader()
+{
+	Unmap();
+}
+
+void ColumnarReader::Unmap()
+{
+#ifdef _WIN32
+	if (data_)
+		UnmapViewOfFile(data_);
+	if (mapping_)
+		CloseHandle(mapping_);
+	if (file_)
+		CloseHandle(file_);
+	mapping_ = NULL;
+	file_ = NULL;
+#else
+	if (data_)
+		munmap((void*)data_, (size_t)size_);
+#endif
+	data_ = NULL;
+	columns_.clear();
+}
+
+bool ColumnarReader::Load()
+{
+	if (size_ < sizeof(ColumnarTrailer))
+		return false;
+	ColumnarTrailer trailer;
+	memcpy(&trailer, data_ + size_ - sizeof(trailer), sizeof(trailer));
+	if (memcmp(trailer.magic, COLUMNAR_MAGIC, sizeof(trailer.magic)) != 0 || trailer.version != COLUMNAR_VERSION)
+		return false;
+	uint64_t schema_end = size_ - sizeof(trailer);
+	if (trailer.schema_offset > schema_end || (schema_end - trailer.schema_offset) / sizeof(ColumnarColumnDesc) < trailer.column_count)
+		return false;
+
+	for (uint32_t i = 0; i < trailer.column_count; i++)
+	{
+		ColumnarColumnDesc desc;
+		memcpy(&desc, data_ + trailer.schema_offset + i * sizeof(desc), sizeof(desc));
+		int width = ColumnarTypeWidth(desc.type);
+		if (width == 0 || desc.offset > trailer.schema_offset || (trailer.schema_offset - desc.offset) / width < desc.rows
+			|| desc.dict_offset > trailer.schema_offset || trailer.schema_offset - desc.dict_offset < desc.dict_size)
+			return false;
+
+		ColumnarColumn column;
+		column.table.assign(desc.table, strnlen(desc.table, sizeof(desc.table)));
+		column.name.assign(desc.name, strnlen(desc.name, sizeof(desc.name)));
+		column.type = desc.type;
+		column.rows = desc.rows;
+		column.values = data_ + desc.offset;
+
+		//the strings follow each other, each one ends with '\0'
+		const char* str = (const char*)data_ + desc.dict_offset;
+		const char* end = str + desc.dict_size;
+		for (uint32_t j = 0; j < desc.dict_count; j++)
+		{
+			const char* zero = (const char*)memchr(str, '\0', end - str);
+			if (!zero)
+				return false;
+			column.dictionary.push_back(str);
+			str = zero + 1;
+		}
+		columns_.push_back(std::move(column));
+	}
+	return true;
+}
+
+const ColumnarColumn* ColumnarReader::Find(const char* table, const char* name) const
+{
+	for (const ColumnarColumn& column : columns_)
+	{
+		if (column.table == table && column.name == name)
+			return &column;
+	}
+	return NULL;
+}
+
+uint64_t ColumnarReader::Rows(const char* table) const
+{
+	for (const ColumnarColumn& column : columns_)
+	{
+		if (column.table == table)
+			return column.rows;
+	}
+	return 0;
+}
+
+const char* ColumnarReader::String(const ColumnarColumn* column, uint64_t row) const
+{
+	if (!column || column->type != ColumnarDict16 || row >= column->rows)
+		return NULL;
+	uint16_t index = ((const uint16_t*)column->values)[row];
+	if (index >= column->dictionary.size())
+		return NULL;
+	return column->dictionary[index];
+}
@@ -0,0 +1,62 @@
+#ifndef _SFP_COLUMNAR_READER_H_
+#define _SFP_COLUMNAR_READER_H_
+
+#include "columnar_format.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//One column of a columnar file, the values point into the mapped file.
+struct ColumnarColumn
+{
+	std::string table;
+	std::string name;
+	int         type = 0;     //ColumnarType
+	uint64_t    rows = 0;
+	const void* values = NULL;
+	std::vector<const char*> dictionary; //the strings of a ColumnarDict16 column, indexed by its values
+};
+
+//Maps a file written by ColumnarOutput, nothing is copied, the columns are plain arrays in the mapping.
+//It only depends on columnar_format.h, so it can be built into other programs alone:
+//	ColumnarReader reader("a.col");
+//	const uint32_t* dts = reader.Values<uint32_t>("tags", "dts");
+//	for (uint64_t i = 0; i < reader.Rows("tags"); i++) ...
+class ColumnarReader
+{
+public:
+	ColumnarReader(const std::string& col_path);
+	~ColumnarReader();
+
+	bool IsGood() const { return data_ != NULL; }
+	const std::vector<ColumnarColumn>& Columns() const { return columns_; }
+	const ColumnarColumn* Find(const char* table, const char* name) const; //NULL if there is no such column
+	uint64_t Rows(const char* table) const; //all the columns of a table have the same rows
+
+	//the values of a column, NULL if there is no such column or T is not as wide as its type
+	template<typename T> const T* Values(const char* table, const char* name) const
+	{
+		const ColumnarColumn* column = Find(table, name);
+		if (!column || ColumnarTypeWidth(column->type) != (int)sizeof(T))
+			return NULL;
+		return (const T*)column->values;
+	}
+
+	//the string of a row of a dictionary column, NULL if it's not one or out of range
+	const char* String(const ColumnarColumn* column, uint64_t row) const;
+
+private:
+	bool Load(); //check the trailer and the schema
+	void Unmap();
+
+private:
+	const uint8_t* data_ = NULL;
+	uint64_t size_ = 0;
+#ifdef _WIN32
+	void* file_ = NULL;
+	void* mapping_ = NULL;
+#endif
+	std::vector<ColumnarColumn> columns_;
+};
+
+#endif //_SFP_COLUMNAR_READER_H_
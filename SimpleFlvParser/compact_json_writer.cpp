@@ -0,0 +1,135 @@
+#include "compact_json_writer.h"
+#include "json/writer.h"
+
+#include <string.h>
+#include <cmath>
+
+void CompactJsonWriter::BeforeValue()
+{
+	if (after_key_)
+		after_key_ = false;
+	else if (depth_ > 0 && !first_[depth_])
+		out_.Char(',');
+	first_[depth_] = false;
+}
+
+void CompactJsonWriter::StartObject()
+{
+	BeforeValue();
+	out_.Char('{');
+	if (depth_ + 1 < MAX_DEPTH)
+		first_[++depth_] = true;
+}
+
+void CompactJsonWriter::EndObject()
+{
+	out_.Char('}');
+	if (depth_ > 0)
+		depth_--;
+}
+
+void CompactJsonWriter::StartArray()
+{
+	BeforeValue();
+	out_.Char('[');
+	if (depth_ + 1 < MAX_DEPTH)
+		first_[++depth_] = true;
+}
+
+void CompactJsonWriter::EndArray()
+{
+	out_.Char(']');
+	if (depth_ > 0)
+		depth_--;
+}
+
+void CompactJsonWriter::Key(const char* key)
+{
+	BeforeValue();
+	Quoted(key, key ? strlen(key) : 0);
+	out_.Char(':');
+	after_key_ = true;
+}
+
+void CompactJsonWriter::String(const char* str)
+{
+	String(str, str ? strlen(str) : 0);
+}
+
+void CompactJsonWriter::String(const char* str, size_t size)
+{
+	BeforeValue();
+	Quoted(str, size);
+}
+
+void CompactJsonWriter::Quoted(const char* str, size_t size)
+{
+	static const char hex[] = "0123456789abcdef";
+	out_.Char('"');
+	//copy the runs which need no escaping at once
+	const char* run = str;
+	const char* end = str + size;
+	for (const char* p = str; p < end; p++)
+	{
+		unsigned char c = (unsigned char)*p;
+		if (c >= 0x20 && c != '"' && c != '\\')
+			continue;
+		out_.Write(run, p - run);
+		run = p + 1;
+		switch (c)
+		{
+		case '"': out_.Write("\\\"", 2); break;
+		case '\\': out_.Write("\\\\", 2); break;
+		case '\b': out_.Write("\\b", 2); break;
+		case '\f': out_.Write("\\f", 2); break;
+		case '\n': out_.Write("\\n", 2); break;
+		case '\r': out_.Write("\\r", 2); break;
+		case '\t': out_.Write("\\t", 2); break;
+		default:
+			out_.Write("\\u00", 4);
+			out_.Char(hex[c >> 4]);
+			out_.Char(hex[c & 0xf]);
+			break;
+		}
+	}
+	out_.Write(run, end - run);
+	out_.Char('"');
+}
+
+void CompactJsonWriter::Int(int64_t value)
+{
+	BeforeValue();
+	out_.Int(value);
+}
+
+void CompactJsonWriter::Double(double value)
+{
+	BeforeValue();
+	if (!std::isfinite(value))
+		out_.Write("null", 4);
+	else
+		out_.Str(Json::valueToString(value).c_str());
+}
+
+void CompactJsonWriter::Bool(bool value)
+{
+	BeforeValue();
+	if (value)
+		out_.Write("true", 4);
+	else
+		out_.Write("false", 5);
+}
+
+void CompactJsonWriter::Null()
+{
+	BeforeValue();
+	out_.Write("null", 4);
+}
+
+void CompactJsonWriter::EndLine()
+{
+	out_.Char('\n');
+	depth_ = 0;
+	first_[0] = true;
+	after_key_ = false;
+}
@@ -0,0 +1,41 @@
+#ifndef _SFP_COMPACT_JSON_WRITER_H_
+#define _SFP_COMPACT_JSON_WRITER_H_
+
+#include "buffered_writer.h"
+#include <stdint.h>
+#include <string>
+
+//Streams compact json straight into a BufferedWriter, there is no tree in between.
+//The commas are added automatically, the caller only has to keep the objects and arrays balanced.
+class CompactJsonWriter
+{
+public:
+	explicit CompactJsonWriter(BufferedWriter& out) : out_(out) {}
+
+	void StartObject();
+	void EndObject();
+	void StartArray();
+	void EndArray();
+	void Key(const char* key); //escaped like a string, the keys of the metadata come from the file
+	void String(const char* str);
+	void String(const char* str, size_t size);
+	void Int(int64_t value);
+	void Double(double value); //same as jsoncpp, but null if it's not finite, json has no nan or inf
+	void Bool(bool value);
+	void Null();
+
+	void EndLine(); //finish a top level value, one per line
+
+private:
+	void BeforeValue();
+	void Quoted(const char* str, size_t size); //escaped and in quotes
+
+private:
+	BufferedWriter& out_;
+	static const int MAX_DEPTH = 64;
+	bool first_[MAX_DEPTH] = { true }; //no value is written yet in the object or array at each depth
+	int depth_ = 0;
+	bool after_key_ = false;
+};
+
+#endif //_SFP_COMPACT_JSON_WRITER_H_
@@ -0,0 +1,232 @@
+#include "csv_output.h"
+#include "syntax_visitor.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#pragma warning(disable: 4996)
+#endif
+
+enum CsvColumn
+{
+	//both
+	CsvType, CsvSerial, CsvOffset,
+	//tags
+	CsvPreviousTagSize, CsvTagType, CsvStreamId, CsvTagSize, CsvPts, CsvDts, CsvDtsDiff, CsvSubType, CsvFormat,
+	CsvTagTypeId, CsvSubTypeId, CsvFormatId,
+	//nalus
+	CsvTagSerial, CsvNaluSize, CsvNalRefIdc, CsvNalUnitType, CsvFirstMbInSlice, CsvSliceType, CsvPicParameterSetId,
+	CsvFrameNum, CsvFieldPicFlag, CsvPicOrderCntLsb, CsvSliceQpDelta, CsvCodecId, CsvNalUnitTypeId, CsvSliceTypeId,
+	//both, not in the default columns since it's by far the most expensive one
+	CsvExtraInfo,
+	CsvColumnCount
+};
+
+//the same names as the db columns
+static const char* CSV_COLUMN_NAMES[CsvColumnCount] = {
+	"type", "serial", "offset",
+	"previous_tag_size", "tag_type", "stream_id", "tag_size", "pts", "dts", "dts_diff", "sub_type", "format",
+	"tag_type_id", "sub_type_id", "format_id",
+	"tag_serial", "nalu_size", "nal_ref_idc", "nal_unit_type", "first_mb_in_slice", "slice_type", "pic_parameter_set_id",
+	"frame_num", "field_pic_flag", "pic_order_cnt_lsb", "slice_qp_delta", "codec_id", "nal_unit_type_id", "slice_type_id",
+	"extra_info",
+};
+
+CsvOutput::CsvOutput(const std::string& csv_path, const std::vector<int>& columns)
+	: info_buffer_(NULL, 4096), info_json_(info_buffer_), columns_(columns)
+{
+	info_buffer_.KeepInMemory();
+	if (columns_.empty())
+		ParseColumns("", columns_);
+
+	//binary, so the lines end with \n on every platform
+	csv_file_ = fopen(csv_path.c_str(), "wb");
+	if (!csv_file_)
+	{
+		printf("Create csv file %s error.\n", csv_path.c_str());
+		return;
+	}
+	out_.SetFile(csv_file_);
+
+	for (size_t i = 0; i < columns_.size(); i++)
+	{
+		if (i > 0)
+			out_.Char(',');
+		out_.Str(CSV_COLUMN_NAMES[columns_[i]]);
+	}
+	out_.Char('\n');
+}
+
+CsvOutput::~CsvOutput()
+{
+	if (csv_file_)
+	{
+		out_.Flush();
+		fclose(csv_file_);
+		csv_file_ = NULL;
+	}
+}
+
+bool CsvOutput::ParseColumns(const std::string& names, std::vector<int>& columns)
+{
+	columns.clear();
+	if (names.empty())
+	{
+		for (int i = 0; i < CsvColumnCount; i++)
+			if (i != CsvExtraInfo)
+				columns.push_back(i);
+		return true;
+	}
+
+	size_t begin = 0;
+	while (begin <= names.size())
+	{
+		size_t end = names.find(',', begin);
+		if (end == std::string::npos)
+			end = names.size();
+		std::string name = names.substr(begin, end - begin);
+		int column = 0;
+		while (column < CsvColumnCount && name != CSV_COLUMN_NAMES[column])
+			column++;
+		if (column == CsvColumnCount)
+		{
+			printf("Unknown csv column: %s\n", name.c_str());
+			return false;
+		}
+		columns.push_back(column);
+		begin = end + 1;
+	}
+	return true;
+}
+
+std::string CsvOutput::ColumnNames()
+{
+	std::string names;
+	for (int i = 0; i < CsvColumnCount; i++)
+	{
+		if (i > 0)
+			names += ",";
+		names += CSV_COLUMN_NAMES[i];
+	}
+	return names;
+}
+
+void CsvOutput::Field(const char* str)
+{
+	Field(str, str ? strlen(str) : 0);
+}
+
+void CsvOutput::Field(const char* str, size_t size)
+{
+	bool quote = false;
+	for (size_t i = 0; i < size && !quote; i++)
+		quote = str[i] == ',' || str[i] == '"' || str[i] == '\n' || str[i] == '\r';
+	if (!quote)
+	{
+		out_.Write(str, size);
+		return;
+	}
+
+	//the quotes inside are doubled
+	out_.Char('"');
+	const char* run = str;
+	for (const char* p = str; p < str + size; p++)
+	{
+		if (*p != '"')
+			continue;
+		out_.Write(run, p + 1 - run);
+		out_.Char('"');
+		run = p + 1;
+	}
+	out_.Write(run, str + size - run);
+	out_.Char('"');
+}
+
+bool CsvOutput::ExtraInfo(FlvTagInterface* tag, NaluInterface* nalu)
+{
+	info_buffer_.Clear();
+	CompactJsonVisitor visitor(info_json_);
+	return tag ? tag->VisitExtraInfo(visitor, NULL) : nalu->VisitExtraInfo(visitor, NULL);
+}
+
+void CsvOutput::FlvHeaderOutput(FlvHeaderInterface* header)
+{
+	if (header == NULL)
+		return;
+	nalu_serial_ = 0; //a new file begins
+}
+
+void CsvOutput::FlvTagOutput(FlvTagInterface* tag)
+{
+	if (tag == NULL || !csv_file_)
+		return;
+
+	for (size_t i = 0; i < columns_.size(); i++)
+	{
+		if (i > 0)
+			out_.Char(',');
+		switch (columns_[i])
+		{
+		case CsvType: out_.Str("tag"); break;
+		case CsvSerial: out_.Int(tag->Serial()); break;
+		case CsvOffset: out_.Int((int64_t)tag->Offset()); break;
+		case CsvPreviousTagSize: out_.Int(tag->PreviousTagSize()); break;
+		case CsvTagType: Field(tag->TagTypeName()); break;
+		case CsvStreamId: out_.Int(tag->StreamId()); break;
+		case CsvTagSize: out_.Int(tag->TagSize()); break;
+		case CsvPts: out_.Int(tag->Pts()); break;
+		case CsvDts: out_.Int(tag->Dts()); break;
+		case CsvDtsDiff: out_.Int(tag->DtsDiff()); break;
+		case CsvSubType: Field(tag->SubTypeName()); break;
+		case CsvFormat: Field(tag->FormatName()); break;
+		case CsvTagTypeId: out_.Int(tag->TagTypeId()); break;
+		case CsvSubTypeId: out_.Int(tag->SubTypeId()); break;
+		case CsvFormatId: out_.Int(tag->FormatId()); break;
+		case CsvExtraInfo:
+			if (ExtraInfo(tag, NULL))
+				Field(info_buffer_.Data(), info_buffer_.Size());
+			break;
+		default: break; //a nalu column
+		}
+	}
+	out_.Char('\n');
+}
+
+void CsvOutput::NaluOutput(NaluInterface* nalu)
+{
+	if (nalu == NULL || !csv_file_)
+		return;
+
+	nalu_serial_++;
+	for (size_t i = 0; i < columns_.size(); i++)
+	{
+		if (i > 0)
+			out_.Char(',');
+		switch (columns_[i])
+		{
+		case CsvType: out_.Str("nalu"); break;
+		case CsvSerial: out_.Int(nalu_serial_); break;
+		case CsvOffset: out_.Int((int64_t)nalu->Offset()); break;
+		case CsvTagSerial: out_.Int(nalu->TagSerialBelong()); break;
+		case CsvNaluSize: out_.Int(nalu->NaluSize()); break;
+		case CsvNalRefIdc: out_.Int(nalu->NalRefIdc()); break;
+		case CsvNalUnitType: Field(nalu->NalUnitTypeName()); break;
+		case CsvFirstMbInSlice: out_.Int(nalu->FirstMbInSlice()); break;
+		case CsvSliceType: Field(nalu->SliceTypeName()); break;
+		case CsvPicParameterSetId: out_.Int(nalu->PicParameterSetId()); break;
+		case CsvFrameNum: out_.Int(nalu->FrameNum()); break;
+		case CsvFieldPicFlag: out_.Int(nalu->FieldPicFlag()); break;
+		case CsvPicOrderCntLsb: out_.Int(nalu->PicOrderCntLsb()); break;
+		case CsvSliceQpDelta: out_.Int(nalu->SliceQpDelta()); break;
+		case CsvCodecId: out_.Int(nalu->CodecId()); break;
+		case CsvNalUnitTypeId: out_.Int(nalu->NalUnitTypeId()); break;
+		case CsvSliceTypeId: out_.Int(nalu->SliceTypeId()); break;
+		case CsvExtraInfo:
+			if (ExtraInfo(NULL, nalu))
+				Field(info_buffer_.Data(), info_buffer_.Size());
+			break;
+		default: break; //a tag column
+		}
+	}
+	out_.Char('\n');
+}
@@ -0,0 +1,43 @@
+#ifndef _SFP_CSV_OUTPUT_H_
+#define _SFP_CSV_OUTPUT_H_
+
+#include "output_interface.h"
+#include "input_interface.h"
+#include "buffered_writer.h"
+#include "compact_json_writer.h"
+#include <string>
+#include <vector>
+
+//Comma separated rows of the tags and nalus in the order they are parsed, "type" tells them apart.
+//Only the selected columns are asked from the parsed objects, so e.g. the extra_info json is never built
+//unless it's selected. The columns which don't apply to a row are left empty.
+class CsvOutput : public FlvOutputInterface
+{
+public:
+	CsvOutput(const std::string& csv_path, const std::vector<int>& columns);
+	~CsvOutput();
+
+	//"serial,dts,extra_info" into the column ids, false if a name is unknown, empty means the default columns
+	static bool ParseColumns(const std::string& names, std::vector<int>& columns);
+	static std::string ColumnNames(); //all of them, for the help
+
+	virtual void FlvHeaderOutput(FlvHeaderInterface* header) override;
+	virtual void FlvTagOutput(FlvTagInterface* tag) override;
+	virtual void NaluOutput(NaluInterface* nalu) override;
+	virtual bool IsGood() override { return csv_file_ != NULL; }
+
+private:
+	void Field(const char* str); //quoted if needed
+	void Field(const char* str, size_t size);
+	bool ExtraInfo(FlvTagInterface* tag, NaluInterface* nalu); //compact json into info_buffer_
+
+private:
+	FILE* csv_file_ = NULL;
+	BufferedWriter out_;
+	BufferedWriter info_buffer_;
+	CompactJsonWriter info_json_;
+	std::vector<int> columns_;
+	int nalu_serial_ = 0;
+};
+
+#endif //_SFP_CSV_OUTPUT_H_
@@ -0,0 +1,137 @@
+#include "db_extract.h"
+#include "sqlite3.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <vector>
+
+#ifdef _WIN32
+#pragma warning(disable: 4996)
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static const char *SQL_STAT_QUERY_TAG_LOCATION = \
+	"SELECT f.path, t.file_offset, t.tag_size, f.size, f.mtime FROM flv_tags t JOIN files f ON f.id = t.file_id \
+	WHERE t.serial = ?1 AND (?2 IS NULL OR f.path IN (?2, ?3))";
+
+static const char *SQL_STAT_QUERY_NALU_LOCATION = \
+	"SELECT f.path, n.file_offset, n.nalu_size, f.size, f.mtime FROM nal_units n JOIN files f ON f.id = n.file_id \
+	WHERE n.serial = ?1 AND (?2 IS NULL OR f.path IN (?2, ?3))";
+
+//read size bytes at offset, without touching the rest of the file
+static bool ReadAt(const std::string& path, uint64_t offset, std::vector<uint8_t>& data)
+{
+#ifdef _WIN32
+	FILE* file = fopen(path.c_str(), "rb");
+	if (!file)
+		return false;
+	bool ok = _fseeki64(file, (__int64)offset, SEEK_SET) == 0 && fread(data.data(), 1, data.size(), file) == data.size();
+	fclose(file);
+	return ok;
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	size_t done = 0;
+	while (done < data.size())
+	{
+		ssize_t ret = pread(fd, data.data() + done, data.size() - done, (off_t)(offset + done));
+		if (ret <= 0)
+			break;
+		done += (size_t)ret;
+	}
+	close(fd);
+	return done == data.size();
+#endif
+}
+
+bool ExtractFromDB(const std::string& db_path, const std::string& input_file, bool is_tag, int serial, const std::string& output_path)
+{
+	sqlite3* db = NULL;
+	if (sqlite3_open_v2(db_path.c_str(), &db, SQLITE_OPEN_READONLY, NULL) != SQLITE_OK)
+	{
+		printf("Open database %s failed.\n", db_path.c_str());
+		sqlite3_close(db);
+		return false;
+	}
+
+	sqlite3_stmt* stmt = NULL;
+	if (sqlite3_prepare_v2(db, is_tag ? SQL_STAT_QUERY_TAG_LOCATION : SQL_STAT_QUERY_NALU_LOCATION, -1, &stmt, NULL) != SQLITE_OK)
+	{
+		printf("Query %s error: %s\n", db_path.c_str(), sqlite3_errmsg(db));
+		sqlite3_close(db);
+		return false;
+	}
+	sqlite3_bind_int(stmt, 1, serial);
+	//the files are stored by their full paths, the dbs written before that have the paths as they were given
+	std::string full_path = FullFilePath(input_file);
+	if (!input_file.empty())
+	{
+		sqlite3_bind_text(stmt, 2, input_file.c_str(), (int)input_file.size(), SQLITE_STATIC);
+		sqlite3_bind_text(stmt, 3, full_path.c_str(), (int)full_path.size(), SQLITE_STATIC);
+	}
+
+	int rows = 0;
+	std::string path;
+	uint64_t offset = 0;
+	uint64_t stored_size = 0;
+	int64_t stored_mtime = 0;
+	std::vector<uint8_t> data;
+	while (sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		if (++rows > 1)
+			break;
+		path = (const char*)sqlite3_column_text(stmt, 0);
+		offset = (uint64_t)sqlite3_column_int64(stmt, 1);
+		data.resize((size_t)sqlite3_column_int64(stmt, 2));
+		stored_size = (uint64_t)sqlite3_column_int64(stmt, 3);
+		stored_mtime = sqlite3_column_int64(stmt, 4);
+	}
+	sqlite3_finalize(stmt);
+	sqlite3_close(db);
+
+	const char* what = is_tag ? "tag" : "nalu";
+	if (rows == 0)
+	{
+		printf("No %s %d in %s.\n", what, serial, db_path.c_str());
+		return false;
+	}
+	else if (rows > 1)
+	{
+		printf("More than one file in %s has %s %d, choose one with -i.\n", db_path.c_str(), what, serial);
+		return false;
+	}
+
+	//the offsets are only right for the file as it was ingested
+	uint64_t size = 0;
+	int64_t mtime = 0;
+	if (!GetFileSizeAndMtime(path, size, mtime))
+	{
+		printf("%s is not found.\n", path.c_str());
+		return false;
+	}
+	if (size != stored_size || mtime != stored_mtime || offset + data.size() > size)
+	{
+		printf("%s is changed since it was stored in %s, ingest it again.\n", path.c_str(), db_path.c_str());
+		return false;
+	}
+
+	if (!ReadAt(path, offset, data))
+	{
+		printf("Read %d bytes at %llu of %s failed.\n", (int)data.size(), (unsigned long long)offset, path.c_str());
+		return false;
+	}
+
+	FILE* output = fopen(output_path.c_str(), "wb");
+	if (!output)
+	{
+		printf("Open %s failed.\n", output_path.c_str());
+		return false;
+	}
+	bool ok = fwrite(data.data(), 1, data.size(), output) == data.size();
+	fclose(output);
+	return ok;
+}
@@ -0,0 +1,11 @@
+#ifndef _SFP_DB_EXTRACT_H_
+#define _SFP_DB_EXTRACT_H_
+
+#include <string>
+
+//Copy the bytes of a single tag or nalu out of the input file, using the offset and size stored in the db,
+//so nothing needs to be parsed again.
+//input_file picks the file when the db holds more than one, it can be empty otherwise.
+bool ExtractFromDB(const std::string& db_path, const std::string& input_file, bool is_tag, int serial, const std::string& output_path);
+
+#endif //_SFP_DB_EXTRACT_H_
@@ -1,57 +1,76 @@
 #include "db_output.h"
+#include "flv_file_internal.h"
+#include "utils.h"
 #include "sqlite3.h"
+#include "syntax_visitor.h"
 #include <assert.h>
+#include <string.h>
+#include <vector>
+#include <iterator>
+#include <algorithm>
 
 #ifdef _WIN32
 #include <io.h>
 #include <process.h>
 #pragma warning(disable: 4996)
-#define sprintf sprintf_s
 #define access _access
 #else
 #include <unistd.h>
 #endif
 
+static const char *SQL_STAT_CREATE_FILES_TABLE = \
+	"CREATE TABLE IF NOT EXISTS files (\
+		id INTEGER PRIMARY KEY,\
+		path TEXT UNIQUE,\
+		size INTEGER,\
+		mtime INTEGER,\
+		video_codec TEXT,\
+		audio_codec TEXT,\
+		tag_count INTEGER,\
+		nalu_count INTEGER,\
+		complete BOOLEAN DEFAULT 0)"; //set after the last row of the file is written
+
 static const char *SQL_STAT_CREATE_FLV_HEADER_TABLE = \
 	"CREATE TABLE IF NOT EXISTS flv_header (\
+		file_id INTEGER REFERENCES files(id),\
 		have_video BOOLEAN,\
 		have_audio BOOLEAN,\
 		version INTEGER,\
 		header_size INTEGER)";
 
-static const char *SQL_STAT_INSERT_FLV_HEADER_FMT = \
-	"INSERT INTO flv_header(have_video, have_audio, version, header_size) \
-	VALUES( %d , %d , %d , %d )\0";
+static const char *SQL_STAT_INSERT_FLV_HEADER = \
+	"INSERT INTO flv_header(file_id, have_video, have_audio, version, header_size) \
+	VALUES( ? , ? , ? , ? , ? )";
 
 static const char *SQL_STAT_CREATE_FLV_TAGS_TABLE = \
 	"CREATE TABLE IF NOT EXISTS flv_tags(\
-		serial INTEGER PRIMARY KEY, \
+		file_id INTEGER REFERENCES files(id), \
+		serial INTEGER, \
 		previous_tag_size INTEGER, \
 		tag_type TEXT, \
 		stream_id INTEGER, \
 		tag_size INTEGER, \
+		file_offset INTEGER, \
 		pts INTEGER, \
 		dts INTEGER, \
 		dts_diff INTEGER, \
 		sub_type TEXT, \
 		format TEXT, \
-		extra_info VARCHAR(2000))";
-
-static const char *SQL_STAT_INSERT = \
-	"INSERT INTO flv_tags(serial, previous_tag_size, tag_type, stream_id, tag_size, \
-	pts, dts, dts_diff, sub_type, format, extra_info) \
-	VALUES( ? , ? , ? , ? , ? , ? , ? , ? , ? , ? , ? )";
+		extra_info VARCHAR(2000), \
+		PRIMARY KEY(file_id, serial))";
 
-static const char *SQL_STAT_INSERT_FLV_TAG_FMT = \
-	"INSERT INTO flv_tags(serial, previous_tag_size, tag_type, stream_id, tag_size, \
+static const char *SQL_STAT_INSERT_FLV_TAG = \
+	"INSERT INTO flv_tags(file_id, serial, previous_tag_size, tag_type, stream_id, tag_size, file_offset, \
 	pts, dts, dts_diff, sub_type, format, extra_info) \
-	VALUES( %d , %d , '%s' , %d , %d , %d , %d , %d , '%s' , '%s' , '%s' )\0";
+	VALUES( ? , ? , ? , ? , ? , ? , ? , ? , ? , ? , ? , ? , ? )";
 
 static const char *SQL_STAT_CREATE_NALU_TABLE = \
 	"CREATE TABLE IF NOT EXISTS nal_units (\
-		serial INTEGER PRIMARY KEY,\
+		file_id INTEGER REFERENCES files(id),\
+		serial INTEGER,\
 		tag_serial_belong INTEGER,\
 		nalu_size INTEGER,\
+		file_offset INTEGER,\
 		nal_ref_idc INTEGER,\
 		nal_unit_type TEXT,\
 		first_mb_in_slice INTEGER,\
@@ -61,137 +80,1209 @@ static const char *SQL_STAT_CREATE_NALU_TABLE = \
 		field_pic_flag INTEGER,\
 		pic_order_cnt_lsb INTEGER,\
 		slice_qp_delta INTEGER,\
-		extra_info VARCHAR(2000))";
+		extra_info VARCHAR(2000),\
+		PRIMARY KEY(file_id, serial))";
 
-static const char *SQL_STAT_INSERT_NALU_FMT = \
-	"INSERT INTO nal_units(serial, tag_serial_belong, nalu_size, nal_ref_idc, nal_unit_type, \
+static const char *SQL_STAT_INSERT_NALU = \
+	"INSERT INTO nal_units(file_id, serial, tag_serial_belong, nalu_size, file_offset, nal_ref_idc, nal_unit_type, \
 	first_mb_in_slice, slice_type, pic_parameter_set_id, frame_num, field_pic_flag, pic_order_cnt_lsb, slice_qp_delta, extra_info) \
-	VALUES( %d , %d , %d , %d , '%s' , %d , '%s' , %d , %d , %d , %d , %d , '%s' )\0";
+	VALUES( ? , ? , ? , ? , ? , ? , ? , ? , ? , ? , ? , ? , ? , ? , ? )";
+
+//normalized schema, the json is compact and every parameter set or slice header is stored only once
+static const char *SQL_STAT_CREATE_NORMALIZED_NALU_TABLE = \
+	"CREATE TABLE IF NOT EXISTS nal_units (\
+		file_id INTEGER REFERENCES files(id),\
+		serial INTEGER,\
+		tag_serial_belong INTEGER,\
+		nalu_size INTEGER,\
+		file_offset INTEGER,\
+		nal_ref_idc INTEGER,\
+		nal_unit_type TEXT,\
+		first_mb_in_slice INTEGER,\
+		slice_type TEXT,\
+		pic_parameter_set_id INTEGER,\
+		frame_num INTEGER,\
+		field_pic_flag INTEGER,\
+		pic_order_cnt_lsb INTEGER,\
+		slice_qp_delta INTEGER,\
+		parameter_set_id INTEGER REFERENCES parameter_sets(id),\
+		slice_header_id INTEGER REFERENCES slice_headers(id),\
+		extra_info TEXT,\
+		PRIMARY KEY(file_id, serial))";
+
+static const char *SQL_STAT_INSERT_NORMALIZED_NALU = \
+	"INSERT INTO nal_units(file_id, serial, tag_serial_belong, nalu_size, file_offset, nal_ref_idc, nal_unit_type, \
+	first_mb_in_slice, slice_type, pic_parameter_set_id, frame_num, field_pic_flag, pic_order_cnt_lsb, slice_qp_delta, \
+	parameter_set_id, slice_header_id, extra_info) \
+	VALUES( ? , ? , ? , ? , ? , ? , ? , ? , ? , ? , ? , ? , ? , ? , ? , ? , ? )";
+
+static const char *SQL_STAT_CREATE_PARAMETER_SETS_TABLE = \
+	"CREATE TABLE IF NOT EXISTS parameter_sets (\
+		id INTEGER PRIMARY KEY,\
+		hash INTEGER UNIQUE,\
+		codec_id INTEGER,\
+		nal_unit_type TEXT,\
+		info TEXT)";
+
+static const char *SQL_STAT_INSERT_PARAMETER_SET = \
+	"INSERT OR IGNORE INTO parameter_sets(hash, codec_id, nal_unit_type, info) VALUES( ? , ? , ? , ? )";
+
+static const char *SQL_STAT_QUERY_PARAMETER_SET = \
+	"SELECT id, info FROM parameter_sets WHERE hash = ?";
+
+static const char *SQL_STAT_CREATE_SLICE_HEADERS_TABLE = \
+	"CREATE TABLE IF NOT EXISTS slice_headers (\
+		id INTEGER PRIMARY KEY,\
+		hash INTEGER UNIQUE,\
+		info TEXT)";
+
+static const char *SQL_STAT_INSERT_SLICE_HEADER = \
+	"INSERT OR IGNORE INTO slice_headers(hash, info) VALUES( ? , ? )";
+
+static const char *SQL_STAT_QUERY_SLICE_HEADER = \
+	"SELECT id, info FROM slice_headers WHERE hash = ?";
+
+static const char *SQL_STAT_CREATE_SEI_MESSAGES_TABLE = \
+	"CREATE TABLE IF NOT EXISTS sei_messages (\
+		id INTEGER PRIMARY KEY,\
+		file_id INTEGER REFERENCES files(id),\
+		nalu_serial INTEGER,\
+		payload_type INTEGER,\
+		info TEXT)";
+
+static const char *SQL_STAT_INSERT_SEI_MESSAGE = \
+	"INSERT INTO sei_messages(file_id, nalu_serial, payload_type, info) VALUES( ? , ? , ? , ? )";
+
+//aggregates
+static const char *SQL_STAT_CREATE_PER_SECOND_TABLE = \
+	"CREATE TABLE IF NOT EXISTS per_second (\
+		file_id INTEGER REFERENCES files(id),\
+		second INTEGER,\
+		video_bytes INTEGER,\
+		audio_bytes INTEGER,\
+		video_frames INTEGER,\
+		audio_frames INTEGER,\
+		PRIMARY KEY(file_id, second))";
+
+//the second where a resumed file continued may have been stored already
+static const char *SQL_STAT_INSERT_PER_SECOND = \
+	"INSERT INTO per_second(file_id, second, video_bytes, audio_bytes, video_frames, audio_frames) \
+	VALUES( ? , ? , ? , ? , ? , ? ) ON CONFLICT(file_id, second) DO UPDATE SET \
+	video_bytes = video_bytes + excluded.video_bytes, audio_bytes = audio_bytes + excluded.audio_bytes, \
+	video_frames = video_frames + excluded.video_frames, audio_frames = audio_frames + excluded.audio_frames";
+
+static const char *SQL_STAT_CREATE_GOPS_TABLE = \
+	"CREATE TABLE IF NOT EXISTS gops (\
+		file_id INTEGER REFERENCES files(id),\
+		serial INTEGER,\
+		start_dts INTEGER,\
+		frames INTEGER,\
+		duration INTEGER,\
+		bytes INTEGER,\
+		idr_size INTEGER,\
+		PRIMARY KEY(file_id, serial))";
+
+static const char *SQL_STAT_INSERT_GOP = \
+	"INSERT OR REPLACE INTO gops(file_id, serial, start_dts, frames, duration, bytes, idr_size) \
+	VALUES( ? , ? , ? , ? , ? , ? , ? )";
+
+static const char *SQL_STAT_CREATE_FILE_SUMMARY_TABLE = \
+	"CREATE TABLE IF NOT EXISTS file_summary (\
+		file_id INTEGER PRIMARY KEY REFERENCES files(id),\
+		duration INTEGER,\
+		video_frames INTEGER,\
+		audio_frames INTEGER,\
+		video_bytes INTEGER,\
+		audio_bytes INTEGER,\
+		gop_count INTEGER,\
+		avg_bitrate INTEGER,\
+		peak_bitrate INTEGER,\
+		max_dts_gap INTEGER)"; //duration and gap in ms, bitrates in bits per second
+
+//summed up from the other aggregates, so a resumed file covers the rows stored before too
+static const char *SQL_STAT_INSERT_FILE_SUMMARY = \
+	"INSERT OR REPLACE INTO file_summary(file_id, duration, video_frames, audio_frames, video_bytes, audio_bytes, \
+	gop_count, avg_bitrate, peak_bitrate, max_dts_gap) \
+	SELECT ?1, ?2, ifnull(sum(video_frames), 0), ifnull(sum(audio_frames), 0), ifnull(sum(video_bytes), 0), ifnull(sum(audio_bytes), 0), \
+	(SELECT count(*) FROM gops WHERE file_id = ?1), \
+	CASE WHEN ?2 > 0 THEN (sum(video_bytes) + sum(audio_bytes)) * 8 * 1000 / ?2 END, \
+	ifnull(max(video_bytes + audio_bytes), 0) * 8, ?3 FROM per_second WHERE file_id = ?1";
+
+static const char *SQL_STAT_CREATE_INGEST_STATE_TABLE = \
+	"CREATE TABLE IF NOT EXISTS ingest_state (\
+		file_id INTEGER PRIMARY KEY REFERENCES files(id),\
+		end_offset INTEGER,\
+		last_tag_size INTEGER,\
+		last_tag_serial INTEGER,\
+		last_nalu_serial INTEGER,\
+		video_config_offset INTEGER,\
+		audio_config_offset INTEGER,\
+		last_video_offset INTEGER,\
+		last_audio_offset INTEGER,\
+		first_dts INTEGER,\
+		last_dts INTEGER,\
+		last_video_dts INTEGER,\
+		last_audio_dts INTEGER,\
+		max_dts_gap INTEGER)"; //where the ingest of a file stopped, see DBIngestState
+
+static const char *SQL_STAT_INSERT_INGEST_STATE = \
+	"INSERT OR REPLACE INTO ingest_state(file_id, end_offset, last_tag_size, last_tag_serial, last_nalu_serial, \
+	video_config_offset, audio_config_offset, last_video_offset, last_audio_offset, \
+	first_dts, last_dts, last_video_dts, last_audio_dts, max_dts_gap) \
+	VALUES( ? , ? , ? , ? , ? , ? , ? , ? , ? , ? , ? , ? , ? , ? )";
+
+static const char *SQL_STAT_QUERY_INGEST_STATE = \
+	"SELECT end_offset, last_tag_size, last_tag_serial, last_nalu_serial, \
+	video_config_offset, audio_config_offset, last_video_offset, last_audio_offset, \
+	first_dts, last_dts, last_video_dts, last_audio_dts, max_dts_gap FROM ingest_state WHERE file_id = ?";
+
+static const char *SQL_STAT_QUERY_LAST_GOP = \
+	"SELECT serial, start_dts, frames, duration, bytes, idr_size FROM gops WHERE file_id = ? ORDER BY serial DESC LIMIT 1";
+
+static const char *SQL_STAT_BULK_PRAGMAS[] = {
+	"PRAGMA page_size = 65536", //must be set before any table is created
+	"PRAGMA journal_mode = OFF",
+	"PRAGMA synchronous = OFF",
+	"PRAGMA cache_size = -262144", //in KiB
+	"PRAGMA temp_store = MEMORY",
+	"PRAGMA locking_mode = EXCLUSIVE" };
+
+//the rows are looked up per file, so the indexes lead with file_id, the single column ones of older dbs are replaced
+static const char *SQL_STAT_CREATE_INDEXES[] = {
+	"DROP INDEX IF EXISTS flv_tags_dts",
+	"DROP INDEX IF EXISTS flv_tags_tag_type",
+	"DROP INDEX IF EXISTS nal_units_nal_unit_type",
+	"DROP INDEX IF EXISTS nal_units_tag_serial_belong",
+	"CREATE INDEX IF NOT EXISTS flv_tags_file_dts ON flv_tags(file_id, dts)",
+	"CREATE INDEX IF NOT EXISTS flv_tags_file_tag_type ON flv_tags(file_id, tag_type)",
+	"CREATE INDEX IF NOT EXISTS nal_units_file_nal_unit_type ON nal_units(file_id, nal_unit_type)",
+	"CREATE INDEX IF NOT EXISTS nal_units_file_tag_serial_belong ON nal_units(file_id, tag_serial_belong)" };
+
+static const char *SQL_STAT_CREATE_NORMALIZED_INDEXES[] = {
+	"CREATE INDEX IF NOT EXISTS sei_messages_nalu_serial ON sei_messages(file_id, nalu_serial)" };
+
+static const char *SQL_STAT_QUERY_FILE = \
+	"SELECT id, size, mtime, complete FROM files WHERE path = ?";
 
-DBOutput::DBOutput(const std::string& db_path)
+static const char *SQL_STAT_INSERT_FILE = \
+	"INSERT INTO files(id, path, size, mtime) VALUES( ? , ? , ? , ? )";
+
+static const char *SQL_STAT_UPDATE_FILE = \
+	"UPDATE files SET size = ?, mtime = ?, complete = 0 WHERE id = ?";
+
+static const char *SQL_STAT_DELETE_FILE_ROWS[] = {
+	"DELETE FROM flv_header WHERE file_id = ?",
+	"DELETE FROM flv_tags WHERE file_id = ?",
+	"DELETE FROM nal_units WHERE file_id = ?",
+	"DELETE FROM per_second WHERE file_id = ?",
+	"DELETE FROM gops WHERE file_id = ?",
+	"DELETE FROM file_summary WHERE file_id = ?",
+	"DELETE FROM ingest_state WHERE file_id = ?",
+	"DELETE FROM sei_messages WHERE file_id = ?" };
+
+static const char *SQL_STAT_UPDATE_FILE_SUMMARY = \
+	"UPDATE files SET video_codec = ifnull(?, video_codec), audio_codec = ifnull(?, audio_codec), tag_count = ?, \
+	nalu_count = ?, complete = 1 WHERE id = ?";
+
+//the shards use the same file ids as the main db, so most of the rows are copied as they are,
+//only the ids of the deduplicated parameter sets and slice headers are mapped to the ones in the main db.
+//%s is the schema name of the attached shard
+static const char *SQL_STAT_MERGE_SHARD[] = {
+	"INSERT OR REPLACE INTO main.files SELECT * FROM %s.files",
+	"INSERT INTO main.flv_header SELECT * FROM %s.flv_header",
+	"INSERT INTO main.flv_tags SELECT * FROM %s.flv_tags",
+	"INSERT INTO main.per_second SELECT * FROM %s.per_second",
+	"INSERT INTO main.gops SELECT * FROM %s.gops",
+	"INSERT INTO main.file_summary SELECT * FROM %s.file_summary",
+	"INSERT INTO main.ingest_state SELECT * FROM %s.ingest_state" };
+
+static const char *SQL_STAT_MERGE_NORMALIZED_SHARD[] = {
+	"INSERT OR IGNORE INTO main.parameter_sets(hash, codec_id, nal_unit_type, info) \
+	SELECT hash, codec_id, nal_unit_type, info FROM %s.parameter_sets",
+	"INSERT OR IGNORE INTO main.slice_headers(hash, info) SELECT hash, info FROM %s.slice_headers",
+	//a different json with the same hash in the main db can't be stored once, it is kept in the nalu row
+	"UPDATE %s.nal_units SET extra_info = (SELECT s.info FROM %s.parameter_sets s WHERE s.id = %s.nal_units.parameter_set_id), \
+	parameter_set_id = NULL WHERE parameter_set_id IN (SELECT s.id FROM %s.parameter_sets s \
+	JOIN main.parameter_sets m ON m.hash = s.hash WHERE m.info <> s.info)",
+	"UPDATE %s.nal_units SET extra_info = (SELECT s.info FROM %s.slice_headers s WHERE s.id = %s.nal_units.slice_header_id), \
+	slice_header_id = NULL WHERE slice_header_id IN (SELECT s.id FROM %s.slice_headers s \
+	JOIN main.slice_headers m ON m.hash = s.hash WHERE m.info <> s.info)",
+	"UPDATE %s.nal_units SET parameter_set_id = (SELECT m.id FROM main.parameter_sets m \
+	JOIN %s.parameter_sets s ON m.hash = s.hash WHERE s.id = %s.nal_units.parameter_set_id) \
+	WHERE parameter_set_id IS NOT NULL",
+	"UPDATE %s.nal_units SET slice_header_id = (SELECT m.id FROM main.slice_headers m \
+	JOIN %s.slice_headers s ON m.hash = s.hash WHERE s.id = %s.nal_units.slice_header_id) \
+	WHERE slice_header_id IS NOT NULL",
+	"INSERT INTO main.sei_messages(file_id, nalu_serial, payload_type, info) \
+	SELECT file_id, nalu_serial, payload_type, info FROM %s.sei_messages" };
+
+static const char *SQL_STAT_MERGE_NALUS = \
+	"INSERT INTO main.nal_units SELECT * FROM %s.nal_units";
+
+#define MAX_ATTACHED_DB 10 //SQLITE_MAX_ATTACHED by default
+
+//64 bit FNV-1a
+static uint64_t HashString(const std::string& str)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (unsigned char c : str)
+	{
+		hash ^= c;
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+//Writes the compact json of the normalized tables and notes where the messages of "seis" are.
+class NormalizedJsonVisitor : public CompactJsonVisitor
 {
-	if (access(db_path.c_str(), 0) == 0) //file already exists
+public:
+	NormalizedJsonVisitor(CompactJsonWriter& writer, const BufferedWriter& buffer, std::vector<DBRecord::Sei>& seis)
+		: CompactJsonVisitor(writer), buffer_(buffer), seis_(seis) {}
+
+	void BeginObject(const char* key) override
+	{
+		CompactJsonVisitor::BeginObject(key);
+		if (++depth_ == 3 && in_seis_)
+		{
+			DBRecord::Sei sei = { 0, (uint32_t)buffer_.Size() - 1, 0 };
+			seis_.push_back(sei);
+		}
+	}
+	void EndObject() override
+	{
+		CompactJsonVisitor::EndObject();
+		if (depth_-- == 3 && in_seis_)
+			seis_.back().size = (uint32_t)buffer_.Size() - seis_.back().offset;
+	}
+	void BeginArray(const char* key) override
+	{
+		CompactJsonVisitor::BeginArray(key);
+		if (++depth_ == 2)
+			in_seis_ = key && strcmp(key, "seis") == 0;
+	}
+	void EndArray() override
+	{
+		CompactJsonVisitor::EndArray();
+		if (depth_-- == 2)
+			in_seis_ = false;
+	}
+	void Int(const char* key, int64_t value) override
+	{
+		CompactJsonVisitor::Int(key, value);
+		if (depth_ == 3 && in_seis_ && strcmp(key, "payloadType") == 0)
+			seis_.back().payload_type = (int)value;
+	}
+
+private:
+	const BufferedWriter& buffer_;
+	std::vector<DBRecord::Sei>& seis_;
+	int depth_ = 0; //the open objects and arrays
+	bool in_seis_ = false;
+};
+
+static void BindTextOrNull(sqlite3_stmt* stmt, int index, const std::string& text)
+{
+	if (text.empty())
+		sqlite3_bind_null(stmt, index);
+	else
+		sqlite3_bind_text(stmt, index, text.c_str(), (int)text.size(), SQLITE_TRANSIENT);
+}
+
+void DBFileStats::Add(const DBRecord& record)
+{
+	int64_t dts = record.tag.dts;
+	if (first_dts < 0)
+		first_dts = dts;
+	last_dts = std::max(last_dts, dts);
+
+	if (record.tag.tag_type_id == FlvTagTypeVideo)
+	{
+		Second& second = seconds[dts / 1000];
+		second.video_bytes += record.tag.tag_size;
+		if (last_video_dts >= 0)
+			max_dts_gap = std::max(max_dts_gap, dts - last_video_dts);
+		last_video_dts = dts;
+
+		//the sequence header and end are not frames
+		if (record.tag.sub_type_id == VideoTagTypeAVCSequenceHeader || record.tag.sub_type_id == VideoTagTypeAVCSequenceEnd)
+			return;
+		second.video_frames++;
+		if (record.tag.format_id >= 0 && (record.tag.format_id >> 4) == FlvVideoFrameTypeKeyFrame)
+		{
+			gops.push_back(Gop());
+			gops.back().start_dts = dts;
+			gops.back().idr_size = record.tag.tag_size;
+		}
+		if (!gops.empty()) //the frames before the first key frame don't belong to any gop
+		{
+			Gop& gop = gops.back();
+			gop.last_dts = dts;
+			gop.frames++;
+			gop.bytes += record.tag.tag_size;
+		}
+	}
+	else if (record.tag.tag_type_id == FlvTagTypeAudio)
+	{
+		Second& second = seconds[dts / 1000];
+		second.audio_bytes += record.tag.tag_size;
+		if (last_audio_dts >= 0)
+			max_dts_gap = std::max(max_dts_gap, dts - last_audio_dts);
+		last_audio_dts = dts;
+		if (record.tag.sub_type_id != AudioTagTypeAACConfig)
+			second.audio_frames++;
+	}
+}
+
+void DBIngestState::Add(const DBRecord& record)
+{
+	end_offset = record.tag.offset + record.tag.tag_size;
+	last_tag_size = record.tag.tag_size;
+	last_tag_serial = record.tag.serial;
+	if (record.tag.tag_type_id == FlvTagTypeVideo)
+	{
+		last_video_offset = (int64_t)record.tag.offset;
+		if (record.tag.sub_type_id == VideoTagTypeAVCSequenceHeader)
+			video_config_offset = (int64_t)record.tag.offset;
+	}
+	else if (record.tag.tag_type_id == FlvTagTypeAudio)
+	{
+		last_audio_offset = (int64_t)record.tag.offset;
+		if (record.tag.sub_type_id == AudioTagTypeAACConfig)
+			audio_config_offset = (int64_t)record.tag.offset;
+	}
+}
+
+void DBIngestState::GetResumePoint(FlvResumePoint& point) const
+{
+	point.end_offset = end_offset;
+	point.last_tag_size = last_tag_size;
+	point.last_tag_serial = last_tag_serial;
+	point.state_tags.clear();
+	for (int64_t offset : { video_config_offset, audio_config_offset, last_video_offset, last_audio_offset })
+	{
+		if (offset >= 0)
+			point.state_tags.push_back((uint64_t)offset);
+	}
+	//in the file order, so the last tags come after the sequence headers
+	std::sort(point.state_tags.begin(), point.state_tags.end());
+	point.state_tags.erase(std::unique(point.state_tags.begin(), point.state_tags.end()), point.state_tags.end());
+}
+
+DBOutput::DBOutput(const std::string& db_path, const DBOutputOptions& options)
+	: options_(options), compact_buffer_(NULL, 4096), compact_json_(compact_buffer_)
+{
+	compact_buffer_.KeepInMemory();
+	if (options_.rows_per_transaction <= 0)
+		options_.rows_per_transaction = 1;
+	if (options_.resume)
+		options_.append = true;
+
+	if (!options_.append && access(db_path.c_str(), 0) == 0) //file already exists
 		remove(db_path.c_str()); //delete the file
-	if (access(db_path.c_str(), 0) == 0)
+	if (!options_.append && access(db_path.c_str(), 0) == 0)
 	{
 		printf("Database file %s already exists and is occupied now.\n", db_path.c_str());
 		return;
 	}
+	created_ = access(db_path.c_str(), 0) != 0;
 
-	int ret = sqlite3_open_v2(db_path.c_str(), &db_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX, NULL);
+	//no mutex in the connection: the parsing thread and the writer thread never use it at the same time,
+	//the parsing thread only touches it after Flush() has waited for the writer thread to go idle
+	int ret = sqlite3_open_v2(db_path.c_str(), &db_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, NULL);
 	if (ret != SQLITE_OK)
 	{
 		db_ = NULL;
 		return;
 	}
 
-	const char *create_table_sql[] = { SQL_STAT_CREATE_FLV_HEADER_TABLE, SQL_STAT_CREATE_FLV_TAGS_TABLE, SQL_STAT_CREATE_NALU_TABLE };
-	for (int i = 0; i < 3; i++)
+	if (options_.bulk)
+	{
+		for (const char* sql : SQL_STAT_BULK_PRAGMAS)
+			Exec(sql);
+	}
+
+	std::vector<const char*> create_table_sql = { SQL_STAT_CREATE_FILES_TABLE, SQL_STAT_CREATE_FLV_HEADER_TABLE, SQL_STAT_CREATE_FLV_TAGS_TABLE,
+		SQL_STAT_CREATE_PER_SECOND_TABLE, SQL_STAT_CREATE_GOPS_TABLE, SQL_STAT_CREATE_FILE_SUMMARY_TABLE, SQL_STAT_CREATE_INGEST_STATE_TABLE };
+	if (options_.normalized)
+	{
+		create_table_sql.push_back(SQL_STAT_CREATE_PARAMETER_SETS_TABLE);
+		create_table_sql.push_back(SQL_STAT_CREATE_SLICE_HEADERS_TABLE);
+		create_table_sql.push_back(SQL_STAT_CREATE_NORMALIZED_NALU_TABLE);
+		create_table_sql.push_back(SQL_STAT_CREATE_SEI_MESSAGES_TABLE);
+	}
+	else
+	{
+		create_table_sql.push_back(SQL_STAT_CREATE_NALU_TABLE);
+	}
+	for (size_t i = 0; i < create_table_sql.size(); i++)
 	{
 		ret = sqlite3_exec(db_, create_table_sql[i], NULL, NULL, NULL);
 		if (ret != SQLITE_OK)
 		{
 			printf("Execute sentence '%s' error\n", create_table_sql[i]);
-			sqlite3_close(db_);
-			db_ = NULL;
+			Close();
 			return;
 		}
 	}
+
+	bool prepared = Prepare(SQL_STAT_INSERT_FLV_HEADER, &header_stmt_) && Prepare(SQL_STAT_INSERT_FLV_TAG, &tag_stmt_);
+	if (options_.normalized)
+		prepared = prepared && Prepare(SQL_STAT_INSERT_NORMALIZED_NALU, &nalu_stmt_)
+			&& Prepare(SQL_STAT_INSERT_PARAMETER_SET, &parameter_set_stmt_)
+			&& Prepare(SQL_STAT_INSERT_SLICE_HEADER, &slice_header_stmt_)
+			&& Prepare(SQL_STAT_INSERT_SEI_MESSAGE, &sei_stmt_)
+			&& Prepare(SQL_STAT_QUERY_PARAMETER_SET, &parameter_set_query_stmt_)
+			&& Prepare(SQL_STAT_QUERY_SLICE_HEADER, &slice_header_query_stmt_);
+	else
+		prepared = prepared && Prepare(SQL_STAT_INSERT_NALU, &nalu_stmt_);
+	if (!prepared)
+	{
+		Close();
+		return;
+	}
+
+	Exec("BEGIN");
+
+	if (options_.async)
+	{
+		if (options_.queue_size == 0)
+			options_.queue_size = 1;
+		writer_ = std::thread(&DBOutput::WriterThread, this);
+	}
 }
 
 DBOutput::~DBOutput()
 {
+	if (writer_.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+		not_empty_.notify_one();
+		writer_.join();
+	}
+
 	if (db_)
 	{
-		sqlite3_close(db_);
-		db_ = NULL;
+		EndFile();
+		Finish();
 	}
+	Close();
 }
 
-void DBOutput::FlvHeaderOutput(const std::shared_ptr<FlvHeaderInterface>& header)
+int64_t DBOutput::RegisterFile(const std::string& file_path, FlvResumePoint* resume, const DBFileVersion* version)
 {
-	static char buff[100] = { 0 };
-	sprintf(
-		buff, SQL_STAT_INSERT_FLV_HEADER_FMT,
-		header->HaveVideo(),
-		header->HaveAudio(),
-		header->Version(),
-		header->HeaderSize());
+	if (!db_)
+		return 0;
 
-	int ret = sqlite3_exec(db_, buff, NULL, NULL, NULL);
-	if (ret != SQLITE_OK)
-		assert(false);
+	const std::string path = FullFilePath(file_path);
+
+	uint64_t size = 0;
+	int64_t mtime = 0;
+	if (version)
+	{
+		size = version->size;
+		mtime = version->mtime;
+	}
+	else
+		GetFileSizeAndMtime(path, size, mtime);
+
+	int64_t file_id = 0;
+	bool unchanged = false;
+	bool grown = false;
+	sqlite3_stmt* stmt = NULL;
+	if (Prepare(SQL_STAT_QUERY_FILE, &stmt))
+	{
+		sqlite3_bind_text(stmt, 1, path.c_str(), (int)path.size(), SQLITE_STATIC);
+		if (sqlite3_step(stmt) == SQLITE_ROW)
+		{
+			file_id = sqlite3_column_int64(stmt, 0);
+			bool complete = sqlite3_column_int(stmt, 3) != 0;
+			unchanged = (uint64_t)sqlite3_column_int64(stmt, 1) == size && sqlite3_column_int64(stmt, 2) == mtime && complete;
+			grown = (uint64_t)sqlite3_column_int64(stmt, 1) <= size && complete;
+		}
+		sqlite3_finalize(stmt);
+	}
+	if (unchanged)
+		return 0;
+
+	if (file_id)
+	{
+		//a file being recorded only grows, the rows stored before are kept and the new tags are added after them,
+		//otherwise the file is changed or was not completely ingested, replace its rows
+		bool resumed = grown && options_.resume && resume && LoadIngestState(file_id, *resume);
+		if (!resumed)
+			DeleteFileRows(file_id);
+		if (Prepare(SQL_STAT_UPDATE_FILE, &stmt))
+		{
+			sqlite3_bind_int64(stmt, 1, (sqlite3_int64)size);
+			sqlite3_bind_int64(stmt, 2, mtime);
+			sqlite3_bind_int64(stmt, 3, file_id);
+			Step(stmt);
+			sqlite3_finalize(stmt);
+		}
+	}
+	else if (Prepare(SQL_STAT_INSERT_FILE, &stmt))
+	{
+		sqlite3_bind_null(stmt, 1);
+		sqlite3_bind_text(stmt, 2, path.c_str(), (int)path.size(), SQLITE_STATIC);
+		sqlite3_bind_int64(stmt, 3, (sqlite3_int64)size);
+		sqlite3_bind_int64(stmt, 4, mtime);
+		Step(stmt);
+		sqlite3_finalize(stmt);
+		file_id = sqlite3_last_insert_rowid(db_);
+	}
+	return file_id;
 }
 
-void DBOutput::FlvTagOutput(const std::shared_ptr<FlvTagInterface>& tag)
+bool DBOutput::LoadIngestState(int64_t file_id, FlvResumePoint& resume)
 {
-	if (tag == NULL)
+	sqlite3_stmt* stmt = NULL;
+	if (!Prepare(SQL_STAT_QUERY_INGEST_STATE, &stmt))
+		return false;
+	sqlite3_bind_int64(stmt, 1, file_id);
+	bool found = sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_int64(stmt, 0) > 0; //nothing to resume if no tag was stored
+	if (found)
+	{
+		ingest_.end_offset = (uint64_t)sqlite3_column_int64(stmt, 0);
+		ingest_.last_tag_size = (uint32_t)sqlite3_column_int64(stmt, 1);
+		ingest_.last_tag_serial = sqlite3_column_int(stmt, 2);
+		nalu_serial = sqlite3_column_int(stmt, 3);
+		ingest_.video_config_offset = sqlite3_column_int64(stmt, 4);
+		ingest_.audio_config_offset = sqlite3_column_int64(stmt, 5);
+		ingest_.last_video_offset = sqlite3_column_int64(stmt, 6);
+		ingest_.last_audio_offset = sqlite3_column_int64(stmt, 7);
+		stats_.first_dts = sqlite3_column_int64(stmt, 8);
+		stats_.last_dts = sqlite3_column_int64(stmt, 9);
+		stats_.last_video_dts = sqlite3_column_int64(stmt, 10);
+		stats_.last_audio_dts = sqlite3_column_int64(stmt, 11);
+		stats_.max_dts_gap = sqlite3_column_int64(stmt, 12);
+		tag_count_ = ingest_.last_tag_serial; //the serials have no gap
+		ingest_.GetResumePoint(resume);
+	}
+	sqlite3_finalize(stmt);
+	if (!found)
+		return false;
+
+	//the frames before the first key frame of the new tags belong to the last gop stored
+	if (Prepare(SQL_STAT_QUERY_LAST_GOP, &stmt))
+	{
+		sqlite3_bind_int64(stmt, 1, file_id);
+		if (sqlite3_step(stmt) == SQLITE_ROW)
+		{
+			DBFileStats::Gop gop;
+			stats_.first_gop_serial = sqlite3_column_int(stmt, 0);
+			gop.start_dts = sqlite3_column_int64(stmt, 1);
+			gop.frames = sqlite3_column_int(stmt, 2);
+			gop.last_dts = gop.start_dts + sqlite3_column_int64(stmt, 3);
+			gop.bytes = sqlite3_column_int64(stmt, 4);
+			gop.idr_size = (uint32_t)sqlite3_column_int64(stmt, 5);
+			stats_.gops.push_back(gop);
+		}
+		sqlite3_finalize(stmt);
+	}
+	return true;
+}
+
+void DBOutput::DeleteFileRows(int64_t file_id)
+{
+	sqlite3_stmt* stmt = NULL;
+	for (const char* sql : SQL_STAT_DELETE_FILE_ROWS)
+	{
+		if (!options_.normalized && strstr(sql, "sei_messages"))
+			continue;
+		if (Prepare(sql, &stmt))
+		{
+			sqlite3_bind_int64(stmt, 1, file_id);
+			Step(stmt);
+			sqlite3_finalize(stmt);
+		}
+	}
+}
+
+bool DBOutput::BeginFile(const std::string& file_path, int64_t file_id, FlvResumePoint* resume, const DBFileVersion* version)
+{
+	if (!db_)
+		return false;
+
+	const std::string path = FullFilePath(file_path);
+
+	//the connection is used by this thread only when the writer thread is idle
+	Flush();
+	EndFile();
+
+	//reset before registering, which restores the state of a resumed file
+	nalu_serial = 0;
+	tag_count_ = 0;
+	video_codec_id_ = -1;
+	audio_format_id_ = -1;
+	stats_ = DBFileStats();
+	ingest_ = DBIngestState();
+	if (resume)
+		*resume = FlvResumePoint();
+
+	if (file_id == 0)
+	{
+		file_id = RegisterFile(path, resume, version);
+		if (file_id == 0)
+			return false;
+	}
+	else
+	{
+		uint64_t size = 0;
+		int64_t mtime = 0;
+		if (version)
+		{
+			size = version->size;
+			mtime = version->mtime;
+		}
+		else
+			GetFileSizeAndMtime(path, size, mtime);
+
+		sqlite3_stmt* stmt = NULL;
+		if (!Prepare(SQL_STAT_INSERT_FILE, &stmt))
+			return false;
+		sqlite3_bind_int64(stmt, 1, file_id);
+		sqlite3_bind_text(stmt, 2, path.c_str(), (int)path.size(), SQLITE_STATIC);
+		sqlite3_bind_int64(stmt, 3, (sqlite3_int64)size);
+		sqlite3_bind_int64(stmt, 4, mtime);
+		Step(stmt);
+		sqlite3_finalize(stmt);
+	}
+
+	file_id_ = file_id;
+	return true;
+}
+
+void DBOutput::RestartFile()
+{
+	if (!file_id_)
 		return;
 
-	//sqlite3_stmt* stmt = NULL;
-	//int length = strlen(SQL_STAT_INSERT) + 1;
-	//std::string str;
-	//sqlite3_prepare_v2(db_, SQL_STAT_INSERT, length, &stmt, NULL);
-	//sqlite3_bind_int(stmt, 1, tag->Serial());
-	//sqlite3_bind_int(stmt, 2, tag->PreviousTagSize());
-	//str = tag->TagType();
-	//int ret1 = sqlite3_bind_text(stmt, 3, str.c_str(), str.size(), SQLITE_STATIC);
-	//sqlite3_bind_int(stmt, 4, tag->StreamId());
-	//sqlite3_bind_int(stmt, 5, tag->TagSize());
-	//sqlite3_bind_int(stmt, 6, tag->Pts());
-	//sqlite3_bind_int(stmt, 7, tag->Dts());
-	//str = tag->SubType();
-	//sqlite3_bind_text(stmt, 8, str.c_str(), str.size(), SQLITE_STATIC);
-	//str = tag->Format();
-	//sqlite3_bind_text(stmt, 9, str.c_str(), str.size(), SQLITE_STATIC);
-	//str = tag->ExtraInfo();
-	//sqlite3_bind_text(stmt, 10, str.c_str(), str.size(), SQLITE_STATIC);
-
-	//int ret = sqlite3_step(stmt);
-	//if (!(ret == SQLITE_OK || ret == SQLITE_ROW || ret == SQLITE_DONE))
-	//	assert(false);
-
-	//sqlite3_finalize(stmt);
-
-	static char buff[10240] = {0};
-	sprintf(buff, SQL_STAT_INSERT_FLV_TAG_FMT, 
-		tag->Serial(),
-		tag->PreviousTagSize(),
-		tag->TagType().c_str(),
-		tag->StreamId(),
-		tag->TagSize(),
-		tag->Pts(),
-		tag->Dts(),
-		tag->DtsDiff(),
-		tag->SubType().c_str(),
-		tag->Format().c_str(),
-		tag->ExtraInfo().c_str());
-
-	int ret = sqlite3_exec(db_, buff, NULL, NULL, NULL);
-	if (ret != SQLITE_OK)
+	Flush();
+	DeleteFileRows(file_id_);
+	nalu_serial = 0;
+	tag_count_ = 0;
+	video_codec_id_ = -1;
+	audio_format_id_ = -1;
+	stats_ = DBFileStats();
+	ingest_ = DBIngestState();
+}
+
+bool DBOutput::MergeShards(const std::vector<std::string>& shard_paths)
+{
+	if (!db_)
+		return false;
+	if (shard_paths.size() > MAX_ATTACHED_DB)
+	{
+		printf("Too many shards to merge: %d, at most %d.\n", (int)shard_paths.size(), MAX_ATTACHED_DB);
+		return false;
+	}
+
+	Flush();
+	EndFile();
+	Exec("COMMIT"); //a db can't be attached inside a transaction
+	pending_rows_ = 0;
+
+	bool ok = true;
+	std::vector<std::string> schemas;
+	for (size_t i = 0; i < shard_paths.size() && ok; i++)
+	{
+		std::string schema = "shard" + std::to_string(i);
+		char* sql = sqlite3_mprintf("ATTACH DATABASE %Q AS %s", shard_paths[i].c_str(), schema.c_str());
+		if (sqlite3_exec(db_, sql, NULL, NULL, NULL) == SQLITE_OK)
+			schemas.push_back(schema);
+		else
+		{
+			printf("Attach shard %s error: %s\n", shard_paths[i].c_str(), sqlite3_errmsg(db_));
+			ok = false;
+		}
+		sqlite3_free(sql);
+	}
+
+	std::vector<const char*> merge_sql(std::begin(SQL_STAT_MERGE_SHARD), std::end(SQL_STAT_MERGE_SHARD));
+	if (options_.normalized)
+		merge_sql.insert(merge_sql.end(), std::begin(SQL_STAT_MERGE_NORMALIZED_SHARD), std::end(SQL_STAT_MERGE_NORMALIZED_SHARD));
+	merge_sql.push_back(SQL_STAT_MERGE_NALUS);
+
+	//all the shards are merged in one transaction, so the db never has half of them
+	Exec("BEGIN");
+	for (size_t i = 0; i < schemas.size() && ok; i++)
+	{
+		const char* schema = schemas[i].c_str();
+		for (size_t j = 0; j < merge_sql.size() && ok; j++)
+		{
+			char* sql = sqlite3_mprintf(merge_sql[j], schema, schema, schema, schema);
+			if (sqlite3_exec(db_, sql, NULL, NULL, NULL) != SQLITE_OK)
+			{
+				printf("Merge shard %s error: %s\n", shard_paths[i].c_str(), sqlite3_errmsg(db_));
+				ok = false;
+			}
+			sqlite3_free(sql);
+		}
+	}
+	Exec(ok ? "COMMIT" : "ROLLBACK");
+
+	for (const std::string& schema : schemas)
+		Exec(("DETACH DATABASE " + schema).c_str());
+	Exec("BEGIN");
+	return ok;
+}
+
+void DBOutput::EndFile()
+{
+	if (!file_id_)
+		return;
+
+	sqlite3_stmt* stmt = NULL;
+	if (Prepare(SQL_STAT_UPDATE_FILE_SUMMARY, &stmt))
+	{
+		if (video_codec_id_ >= 0)
+			sqlite3_bind_text(stmt, 1, GetFlvVideoCodecIDString((FlvVideoCodecID)video_codec_id_), -1, SQLITE_STATIC);
+		if (audio_format_id_ >= 0)
+			sqlite3_bind_text(stmt, 2, GetAudioFormatString((AudioFormat)audio_format_id_), -1, SQLITE_STATIC);
+		sqlite3_bind_int(stmt, 3, tag_count_);
+		sqlite3_bind_int(stmt, 4, nalu_serial);
+		sqlite3_bind_int64(stmt, 5, file_id_);
+		Step(stmt);
+		sqlite3_finalize(stmt);
+	}
+	WriteStats();
+	WriteIngestState();
+	file_id_ = 0;
+}
+
+void DBOutput::WriteStats()
+{
+	sqlite3_stmt* stmt = NULL;
+	if (Prepare(SQL_STAT_INSERT_PER_SECOND, &stmt))
+	{
+		for (auto& it : stats_.seconds)
+		{
+			const DBFileStats::Second& second = it.second;
+			sqlite3_bind_int64(stmt, 1, file_id_);
+			sqlite3_bind_int64(stmt, 2, it.first);
+			sqlite3_bind_int64(stmt, 3, second.video_bytes);
+			sqlite3_bind_int64(stmt, 4, second.audio_bytes);
+			sqlite3_bind_int(stmt, 5, second.video_frames);
+			sqlite3_bind_int(stmt, 6, second.audio_frames);
+			Step(stmt);
+		}
+		sqlite3_finalize(stmt);
+	}
+
+	if (Prepare(SQL_STAT_INSERT_GOP, &stmt))
+	{
+		for (size_t i = 0; i < stats_.gops.size(); i++)
+		{
+			const DBFileStats::Gop& gop = stats_.gops[i];
+			sqlite3_bind_int64(stmt, 1, file_id_);
+			sqlite3_bind_int(stmt, 2, stats_.first_gop_serial + (int)i);
+			sqlite3_bind_int64(stmt, 3, gop.start_dts);
+			sqlite3_bind_int(stmt, 4, gop.frames);
+			sqlite3_bind_int64(stmt, 5, gop.last_dts - gop.start_dts);
+			sqlite3_bind_int64(stmt, 6, gop.bytes);
+			sqlite3_bind_int64(stmt, 7, gop.idr_size);
+			Step(stmt);
+		}
+		sqlite3_finalize(stmt);
+	}
+
+	if (Prepare(SQL_STAT_INSERT_FILE_SUMMARY, &stmt))
+	{
+		int64_t duration = stats_.first_dts >= 0 ? stats_.last_dts - stats_.first_dts : 0;
+		sqlite3_bind_int64(stmt, 1, file_id_);
+		sqlite3_bind_int64(stmt, 2, duration);
+		sqlite3_bind_int64(stmt, 3, stats_.max_dts_gap);
+		Step(stmt);
+		sqlite3_finalize(stmt);
+	}
+}
+
+void DBOutput::WriteIngestState()
+{
+	sqlite3_stmt* stmt = NULL;
+	if (!Prepare(SQL_STAT_INSERT_INGEST_STATE, &stmt))
+		return;
+	sqlite3_bind_int64(stmt, 1, file_id_);
+	sqlite3_bind_int64(stmt, 2, (sqlite3_int64)ingest_.end_offset);
+	sqlite3_bind_int64(stmt, 3, ingest_.last_tag_size);
+	sqlite3_bind_int(stmt, 4, ingest_.last_tag_serial);
+	sqlite3_bind_int(stmt, 5, nalu_serial);
+	sqlite3_bind_int64(stmt, 6, ingest_.video_config_offset);
+	sqlite3_bind_int64(stmt, 7, ingest_.audio_config_offset);
+	sqlite3_bind_int64(stmt, 8, ingest_.last_video_offset);
+	sqlite3_bind_int64(stmt, 9, ingest_.last_audio_offset);
+	sqlite3_bind_int64(stmt, 10, stats_.first_dts);
+	sqlite3_bind_int64(stmt, 11, stats_.last_dts);
+	sqlite3_bind_int64(stmt, 12, stats_.last_video_dts);
+	sqlite3_bind_int64(stmt, 13, stats_.last_audio_dts);
+	sqlite3_bind_int64(stmt, 14, stats_.max_dts_gap);
+	Step(stmt);
+	sqlite3_finalize(stmt);
+}
+
+void DBOutput::Flush()
+{
+	if (!writer_.joinable())
+		return;
+	std::unique_lock<std::mutex> lock(mutex_);
+	idle_.wait(lock, [this] { return queue_.empty() && !writing_; });
+}
+
+bool DBOutput::Prepare(const char* sql, sqlite3_stmt** stmt)
+{
+	if (sqlite3_prepare_v2(db_, sql, -1, stmt, NULL) != SQLITE_OK)
+	{
+		printf("Prepare sentence '%s' error: %s\n", sql, sqlite3_errmsg(db_));
+		return false;
+	}
+	return true;
+}
+
+void DBOutput::Step(sqlite3_stmt* stmt)
+{
+	int ret = sqlite3_step(stmt);
+	if (ret != SQLITE_DONE)
+	{
+		printf("Insert error: %s\n", sqlite3_errmsg(db_));
 		assert(false);
+	}
+	sqlite3_reset(stmt);
+
+	//commit every N rows, so that a single transaction won't grow without limit
+	if (++pending_rows_ >= options_.rows_per_transaction)
+	{
+		Exec("COMMIT");
+		Exec("BEGIN");
+		pending_rows_ = 0;
+	}
 }
 
-void DBOutput::NaluOutput(const std::shared_ptr<NaluInterface>& nalu)
-{
-	static char buff[10240] = { 0 };
-	sprintf(
-		buff, SQL_STAT_INSERT_NALU_FMT,
-		++nalu_serial,
-		nalu->TagSerialBelong(),
-		nalu->NaluSize(),
-		nalu->NalRefIdc(),
-		nalu->NalUnitType().c_str(),
-		nalu->FirstMbInSlice(),
-		nalu->SliceType().c_str(),
-		nalu->PicParameterSetId(),
-		nalu->FrameNum(),
-		nalu->FieldPicFlag(),
-		nalu->PicOrderCntLsb(),
-		nalu->SliceQpDelta(),
-		nalu->ExtraInfo().c_str());
-
-	int ret = sqlite3_exec(db_, buff, NULL, NULL, NULL);
+void DBOutput::Exec(const char* sql)
+{
+	int ret = sqlite3_exec(db_, sql, NULL, NULL, NULL);
 	if (ret != SQLITE_OK)
+	{
+		printf("Execute sentence '%s' error: %s\n", sql, sqlite3_errmsg(db_));
 		assert(false);
+	}
+}
+
+void DBOutput::Finish()
+{
+	Exec("COMMIT");
+	if (!options_.build_indexes)
+		return;
+
+	//building the indexes once is much cheaper than updating them on every insert
+	Exec("BEGIN");
+	for (const char* sql : SQL_STAT_CREATE_INDEXES)
+		Exec(sql);
+	if (options_.normalized)
+	{
+		for (const char* sql : SQL_STAT_CREATE_NORMALIZED_INDEXES)
+			Exec(sql);
+	}
+	Exec("COMMIT");
+
+	//a full ANALYZE reads all the files ingested before, on append only the statistics which are off are updated
+	Exec(created_ ? "ANALYZE" : "PRAGMA optimize");
+}
+
+void DBOutput::Close()
+{
+	sqlite3_finalize(header_stmt_);
+	sqlite3_finalize(tag_stmt_);
+	sqlite3_finalize(nalu_stmt_);
+	sqlite3_finalize(parameter_set_stmt_);
+	sqlite3_finalize(slice_header_stmt_);
+	sqlite3_finalize(sei_stmt_);
+	sqlite3_finalize(parameter_set_query_stmt_);
+	sqlite3_finalize(slice_header_query_stmt_);
+	header_stmt_ = tag_stmt_ = nalu_stmt_ = NULL;
+	parameter_set_stmt_ = slice_header_stmt_ = sei_stmt_ = NULL;
+	parameter_set_query_stmt_ = slice_header_query_stmt_ = NULL;
+	if (db_)
+	{
+		sqlite3_close(db_);
+		db_ = NULL;
+	}
+}
+
+void DBOutput::FlvHeaderOutput(FlvHeaderInterface* header)
+{
+	if (header == NULL)
+		return;
+
+	DBRecord record;
+	record.type = DBRecord::Header;
+	record.header.have_video = header->HaveVideo();
+	record.header.have_audio = header->HaveAudio();
+	record.header.version = header->Version();
+	record.header.header_size = header->HeaderSize();
+	Push(std::move(record));
+}
+
+void DBOutput::FlvTagOutput(FlvTagInterface* tag)
+{
+	if (tag == NULL)
+		return;
+
+	DBRecord record;
+	record.type = DBRecord::Tag;
+	record.tag.serial = tag->Serial();
+	record.tag.previous_tag_size = tag->PreviousTagSize();
+	record.tag.tag_type = tag->TagTypeName();
+	record.tag.stream_id = tag->StreamId();
+	record.tag.tag_size = tag->TagSize();
+	record.tag.offset = tag->Offset();
+	record.tag.pts = tag->Pts();
+	record.tag.dts = tag->Dts();
+	record.tag.dts_diff = tag->DtsDiff();
+	record.tag.sub_type = tag->SubTypeName();
+	record.tag.format = tag->FormatName();
+	record.tag.tag_type_id = tag->TagTypeId();
+	record.tag.sub_type_id = tag->SubTypeId();
+	record.tag.format_id = tag->FormatId();
+	if (!options_.normalized)
+		record.extra_info = tag->ExtraInfo();
+	else if (record.tag.tag_type_id != FlvTagTypeVideo) //the video info is all in the nalu tables
+		CompactExtraInfo(tag, NULL, record);
+	Push(std::move(record));
+}
+
+void DBOutput::NaluOutput(NaluInterface* nalu)
+{
+	if (nalu == NULL)
+		return;
+
+	DBRecord record;
+	record.type = DBRecord::Nalu;
+	record.nalu.tag_serial_belong = nalu->TagSerialBelong();
+	record.nalu.nalu_size = nalu->NaluSize();
+	record.nalu.offset = nalu->Offset();
+	record.nalu.nal_ref_idc = nalu->NalRefIdc();
+	record.nalu.nal_unit_type = nalu->NalUnitTypeName();
+	record.nalu.first_mb_in_slice = nalu->FirstMbInSlice();
+	record.nalu.slice_type = nalu->SliceTypeName();
+	record.nalu.pic_parameter_set_id = nalu->PicParameterSetId();
+	record.nalu.frame_num = nalu->FrameNum();
+	record.nalu.field_pic_flag = nalu->FieldPicFlag();
+	record.nalu.pic_order_cnt_lsb = nalu->PicOrderCntLsb();
+	record.nalu.slice_qp_delta = nalu->SliceQpDelta();
+	record.nalu.codec_id = nalu->CodecId();
+	record.nalu.nal_unit_type_id = nalu->NalUnitTypeId();
+	record.nalu.slice_type_id = nalu->SliceTypeId();
+	if (!options_.normalized)
+		record.extra_info = nalu->ExtraInfo();
+	else
+		CompactExtraInfo(NULL, nalu, record);
+	Push(std::move(record));
+}
+
+void DBOutput::CompactExtraInfo(FlvTagInterface* tag, NaluInterface* nalu, DBRecord& record)
+{
+	//straight from the syntax, no styled json to parse and write again
+	compact_buffer_.Clear();
+	NormalizedJsonVisitor visitor(compact_json_, compact_buffer_, record.seis);
+	if (tag ? tag->VisitExtraInfo(visitor, NULL) : nalu->VisitExtraInfo(visitor, NULL))
+		record.extra_info.assign(compact_buffer_.Data(), compact_buffer_.Size());
+}
+
+void DBOutput::Push(DBRecord&& record)
+{
+	if (!writer_.joinable())
+	{
+		Write(record);
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	not_full_.wait(lock, [this] { return queue_.size() < options_.queue_size; }); //backpressure
+	queue_.push_back(std::move(record));
+	lock.unlock();
+	not_empty_.notify_one();
+}
+
+void DBOutput::WriterThread()
+{
+	std::deque<DBRecord> records;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			writing_ = false;
+			if (queue_.empty())
+				idle_.notify_all();
+			not_empty_.wait(lock, [this] { return !queue_.empty() || stopping_; });
+			if (queue_.empty()) //stopping and nothing left
+				break;
+			records.swap(queue_); //take all the queued rows at once, so the parser is blocked as short as possible
+			writing_ = true;
+		}
+		not_full_.notify_one();
+
+		for (const auto& record : records)
+			Write(record);
+		records.clear();
+	}
+}
+
+void DBOutput::Write(const DBRecord& record)
+{
+	switch (record.type)
+	{
+	case DBRecord::Header:
+		sqlite3_bind_int64(header_stmt_, 1, file_id_);
+		sqlite3_bind_int(header_stmt_, 2, record.header.have_video);
+		sqlite3_bind_int(header_stmt_, 3, record.header.have_audio);
+		sqlite3_bind_int(header_stmt_, 4, record.header.version);
+		sqlite3_bind_int(header_stmt_, 5, record.header.header_size);
+		Step(header_stmt_);
+		break;
+	case DBRecord::Tag:
+		sqlite3_bind_int64(tag_stmt_, 1, file_id_);
+		sqlite3_bind_int(tag_stmt_, 2, record.tag.serial);
+		sqlite3_bind_int64(tag_stmt_, 3, record.tag.previous_tag_size);
+		sqlite3_bind_text(tag_stmt_, 4, record.tag.tag_type, -1, SQLITE_STATIC);
+		sqlite3_bind_int64(tag_stmt_, 5, record.tag.stream_id);
+		sqlite3_bind_int64(tag_stmt_, 6, record.tag.tag_size);
+		sqlite3_bind_int64(tag_stmt_, 7, (sqlite3_int64)record.tag.offset);
+		sqlite3_bind_int64(tag_stmt_, 8, record.tag.pts);
+		sqlite3_bind_int64(tag_stmt_, 9, record.tag.dts);
+		sqlite3_bind_int(tag_stmt_, 10, record.tag.dts_diff);
+		sqlite3_bind_text(tag_stmt_, 11, record.tag.sub_type, -1, SQLITE_STATIC);
+		sqlite3_bind_text(tag_stmt_, 12, record.tag.format, -1, SQLITE_STATIC);
+		if (!options_.normalized)
+			sqlite3_bind_text(tag_stmt_, 13, record.extra_info.c_str(), (int)record.extra_info.size(), SQLITE_STATIC);
+		else
+			BindTextOrNull(tag_stmt_, 13, record.extra_info);
+		Step(tag_stmt_);
+		tag_count_++;
+		if (record.tag.tag_type_id == FlvTagTypeAudio && record.tag.format_id >= 0)
+			audio_format_id_ = record.tag.format_id >> 4;
+		stats_.Add(record);
+		ingest_.Add(record);
+		break;
+	case DBRecord::Nalu:
+		video_codec_id_ = record.nalu.codec_id;
+		if (options_.normalized)
+		{
+			WriteNormalizedNalu(record);
+			break;
+		}
+		sqlite3_bind_int64(nalu_stmt_, 1, file_id_);
+		sqlite3_bind_int(nalu_stmt_, 2, ++nalu_serial);
+		sqlite3_bind_int(nalu_stmt_, 3, record.nalu.tag_serial_belong);
+		sqlite3_bind_int64(nalu_stmt_, 4, record.nalu.nalu_size);
+		sqlite3_bind_int64(nalu_stmt_, 5, (sqlite3_int64)record.nalu.offset);
+		sqlite3_bind_int(nalu_stmt_, 6, record.nalu.nal_ref_idc);
+		sqlite3_bind_text(nalu_stmt_, 7, record.nalu.nal_unit_type, -1, SQLITE_STATIC);
+		sqlite3_bind_int(nalu_stmt_, 8, record.nalu.first_mb_in_slice);
+		sqlite3_bind_text(nalu_stmt_, 9, record.nalu.slice_type, -1, SQLITE_STATIC);
+		sqlite3_bind_int(nalu_stmt_, 10, record.nalu.pic_parameter_set_id);
+		sqlite3_bind_int(nalu_stmt_, 11, record.nalu.frame_num);
+		sqlite3_bind_int(nalu_stmt_, 12, record.nalu.field_pic_flag);
+		sqlite3_bind_int(nalu_stmt_, 13, record.nalu.pic_order_cnt_lsb);
+		sqlite3_bind_int(nalu_stmt_, 14, record.nalu.slice_qp_delta);
+		sqlite3_bind_text(nalu_stmt_, 15, record.extra_info.c_str(), (int)record.extra_info.size(), SQLITE_STATIC);
+		Step(nalu_stmt_);
+		break;
+	}
+}
+
+void DBOutput::WriteNormalizedNalu(const DBRecord& record)
+{
+	int type = record.nalu.nal_unit_type_id;
+	bool is_avc = record.nalu.codec_id == FlvVideoCodeIDAVC;
+	bool is_parameter_set = is_avc ? (type == NaluTypeSPS || type == NaluTypePPS)
+		: (type == HevcNaluTypeVPS || type == HevcNaluTypeSPS || type == HevcNaluTypePPS);
+	bool is_sei = is_avc ? type == NaluTypeSEI : (type == HevcNaluTypeSEI || type == HevcNaluTypeSEISuffix);
+	bool is_slice = record.nalu.slice_type_id >= 0;
+
+	const std::string& json = record.extra_info;
+	int64_t parameter_set_id = 0, slice_header_id = 0;
+	if (is_parameter_set && !json.empty())
+		parameter_set_id = InsertOnce(parameter_set_stmt_, parameter_set_query_stmt_, &parameter_set_ids_, json, &record);
+	else if (is_slice && !json.empty())
+		slice_header_id = InsertOnce(slice_header_stmt_, slice_header_query_stmt_, NULL, json, NULL);
+
+	int serial = ++nalu_serial;
+	sqlite3_bind_int64(nalu_stmt_, 1, file_id_);
+	sqlite3_bind_int(nalu_stmt_, 2, serial);
+	sqlite3_bind_int(nalu_stmt_, 3, record.nalu.tag_serial_belong);
+	sqlite3_bind_int64(nalu_stmt_, 4, record.nalu.nalu_size);
+	sqlite3_bind_int64(nalu_stmt_, 5, (sqlite3_int64)record.nalu.offset);
+	sqlite3_bind_int(nalu_stmt_, 6, record.nalu.nal_ref_idc);
+	sqlite3_bind_text(nalu_stmt_, 7, record.nalu.nal_unit_type, -1, SQLITE_STATIC);
+	sqlite3_bind_int(nalu_stmt_, 8, record.nalu.first_mb_in_slice);
+	sqlite3_bind_text(nalu_stmt_, 9, record.nalu.slice_type, -1, SQLITE_STATIC);
+	sqlite3_bind_int(nalu_stmt_, 10, record.nalu.pic_parameter_set_id);
+	sqlite3_bind_int(nalu_stmt_, 11, record.nalu.frame_num);
+	sqlite3_bind_int(nalu_stmt_, 12, record.nalu.field_pic_flag);
+	sqlite3_bind_int(nalu_stmt_, 13, record.nalu.pic_order_cnt_lsb);
+	sqlite3_bind_int(nalu_stmt_, 14, record.nalu.slice_qp_delta);
+	if (parameter_set_id)
+		sqlite3_bind_int64(nalu_stmt_, 15, parameter_set_id);
+	else
+		sqlite3_bind_null(nalu_stmt_, 15);
+	if (slice_header_id)
+		sqlite3_bind_int64(nalu_stmt_, 16, slice_header_id);
+	else
+		sqlite3_bind_null(nalu_stmt_, 16);
+	//whatever is not kept in the other tables
+	BindTextOrNull(nalu_stmt_, 17, (parameter_set_id || slice_header_id || is_sei) ? std::string() : json);
+	Step(nalu_stmt_);
+
+	if (is_sei)
+	{
+		//one row per sei message
+		for (const DBRecord::Sei& sei : record.seis)
+		{
+			sqlite3_bind_int64(sei_stmt_, 1, file_id_);
+			sqlite3_bind_int(sei_stmt_, 2, serial);
+			sqlite3_bind_int(sei_stmt_, 3, sei.payload_type);
+			sqlite3_bind_text(sei_stmt_, 4, json.c_str() + sei.offset, (int)sei.size, SQLITE_STATIC);
+			Step(sei_stmt_);
+		}
+	}
+}
+
+int64_t DBOutput::InsertOnce(sqlite3_stmt* stmt, sqlite3_stmt* query_stmt, std::unordered_map<std::string, int64_t>* ids, const std::string& json, const DBRecord* record)
+{
+	if (ids)
+	{
+		auto iter = ids->find(json);
+		if (iter != ids->end())
+			return iter->second;
+	}
+
+	uint64_t hash = HashString(json);
+	int index = 1;
+	sqlite3_bind_int64(stmt, index++, (sqlite3_int64)hash);
+	if (record) //parameter set
+	{
+		sqlite3_bind_int(stmt, index++, record->nalu.codec_id);
+		sqlite3_bind_text(stmt, index++, record->nalu.nal_unit_type, -1, SQLITE_STATIC);
+	}
+	sqlite3_bind_text(stmt, index++, json.c_str(), (int)json.size(), SQLITE_STATIC);
+	Step(stmt);
+
+	//it may be inserted already by the files ingested before, or another json with the same hash may be there,
+	//then it gets no id and stays in the nalu row
+	int64_t id = 0;
+	sqlite3_bind_int64(query_stmt, 1, (sqlite3_int64)hash);
+	if (sqlite3_step(query_stmt) == SQLITE_ROW)
+	{
+		const char* info = (const char*)sqlite3_column_text(query_stmt, 1);
+		if (info && (size_t)sqlite3_column_bytes(query_stmt, 1) == json.size() && memcmp(info, json.data(), json.size()) == 0)
+			id = sqlite3_column_int64(query_stmt, 0);
+	}
+	sqlite3_reset(query_stmt);
+	if (ids)
+		(*ids)[json] = id;
+	return id;
 }
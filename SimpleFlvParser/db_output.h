@@ -3,24 +3,237 @@
 
 #include "output_interface.h"
 #include "input_interface.h"
+#include "flv_reader.h"
+#include "compact_json_writer.h"
 #include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <map>
 
 struct sqlite3;
+struct sqlite3_stmt;
 
+struct DBOutputOptions
+{
+	int  rows_per_transaction = 10000; //the rows are inserted in transactions which are committed every N rows
+	bool bulk = false; //no journal and no sync while loading, fast but the db is corrupted if the process dies halfway
+	bool async = false; //insert the rows in a writer thread, so parsing and writing overlap
+	size_t queue_size = 4096; //max rows waiting for the writer thread, the parser blocks when it's full
+	bool normalized = false; //store parameter sets, sei messages and slice headers in their own tables as compact json
+	bool append = false; //keep the existing db and add the new files into it
+	bool resume = false; //only add the new tags of the files which have grown since they were stored, instead of storing them again, implies append
+	bool build_indexes = true; //build the secondary indexes and analyze at last, shards which are merged later don't need them
+};
+
+//A row copied out of the parsed objects, so it can be written after they are gone.
+//The names point to static tables, so only extra_info needs to be copied.
+struct DBRecord
+{
+	enum Type { Header, Tag, Nalu };
+	Type type;
+	union
+	{
+		struct
+		{
+			int have_video;
+			int have_audio;
+			int version;
+			int header_size;
+		} header;
+		struct
+		{
+			int         serial;
+			uint32_t    previous_tag_size;
+			const char* tag_type;
+			uint32_t    stream_id;
+			uint32_t    tag_size;
+			uint64_t    offset;
+			uint32_t    pts;
+			uint32_t    dts;
+			int         dts_diff;
+			const char* sub_type;
+			const char* format;
+			int         tag_type_id;
+			int         sub_type_id;
+			int         format_id;
+		} tag;
+		struct
+		{
+			int         tag_serial_belong;
+			uint32_t    nalu_size;
+			uint64_t    offset;
+			int         nal_ref_idc;
+			const char* nal_unit_type;
+			int         first_mb_in_slice;
+			const char* slice_type;
+			int         pic_parameter_set_id;
+			int         frame_num;
+			int         field_pic_flag;
+			int         pic_order_cnt_lsb;
+			int         slice_qp_delta;
+			int         codec_id;
+			int         nal_unit_type_id;
+			int         slice_type_id;
+		} nalu;
+	};
+	std::string extra_info; //styled, or compact in the normalized mode
+
+	//where each sei message is in the compact extra_info, so they are stored one per row without parsing it again
+	struct Sei
+	{
+		int      payload_type;
+		uint32_t offset;
+		uint32_t size;
+	};
+	std::vector<Sei> seis;
+};
+
+//The aggregates of a file, accumulated while its tag rows go by, and stored when the file ends,
+//so the common statistics are lookups instead of GROUP BY over all the tags.
+struct DBFileStats
+{
+	struct Second
+	{
+		int64_t video_bytes = 0;
+		int64_t audio_bytes = 0;
+		int     video_frames = 0;
+		int     audio_frames = 0;
+	};
+	struct Gop
+	{
+		int64_t  start_dts = 0;
+		int64_t  last_dts = 0;
+		int      frames = 0;
+		int64_t  bytes = 0;
+		uint32_t idr_size = 0; //size of the key frame starting the gop
+	};
+
+	std::map<int64_t, Second> seconds; //by dts / 1000
+	std::vector<Gop> gops;
+	int     first_gop_serial = 1; //serial of gops[0], the last gop stored is continued when a file is resumed
+	int64_t first_dts = -1;
+	int64_t last_dts = -1;
+	int64_t last_video_dts = -1;
+	int64_t last_audio_dts = -1;
+	int64_t max_dts_gap = 0; //between two tags of the same type
+
+	void Add(const DBRecord& record);
+};
+
+//What tells if a file is changed since it was stored.
+struct DBFileVersion
+{
+	uint64_t size = 0;
+	int64_t mtime = 0; //in seconds since 1970
+};
+
+//Where the ingest of a file stopped, stored when the file ends, so it can be resumed if the file grows later.
+//The offsets are the ones of the tag headers, -1 if there is no such tag.
+struct DBIngestState
+{
+	uint64_t end_offset = 0; //end of the last tag
+	uint32_t last_tag_size = 0;
+	int      last_tag_serial = 0;
+	int64_t  video_config_offset = -1; //the last sequence header
+	int64_t  audio_config_offset = -1; //the last aac config
+	int64_t  last_video_offset = -1;
+	int64_t  last_audio_offset = -1;
+
+	void Add(const DBRecord& record);
+	void GetResumePoint(FlvResumePoint& point) const;
+};
+
+//Many input files can be stored in one db, every row refers to its file in the files table.
+//The secondary indexes are built after all the rows are inserted, then the db is analyzed.
 class DBOutput : public FlvOutputInterface
 {
 public:
-	DBOutput(const std::string& db_path);
+	DBOutput(const std::string& db_path, const DBOutputOptions& options = DBOutputOptions());
 	~DBOutput();
 
-	virtual void FlvHeaderOutput(const std::shared_ptr<FlvHeaderInterface>& header) override;
-	virtual void FlvTagOutput(const std::shared_ptr<FlvTagInterface>& tag) override;
-	virtual void NaluOutput(const std::shared_ptr<NaluInterface>& nalu) override;
+	//Add the file into the files table by its full path, the old rows of the file are deleted if it's changed since last time.
+	//Return the id of the file, or 0 if it's already in the db completely and unchanged (same size and mtime), so it can be skipped.
+	//In resume mode, if resume is given and the file has grown since it was stored, its rows are kept
+	//and resume is set to where the last ingest stopped, the state of the current file is restored too.
+	//The size and mtime are read from the file unless version is given, e.g. the ones recorded in a trace.
+	int64_t RegisterFile(const std::string& path, FlvResumePoint* resume = NULL, const DBFileVersion* version = NULL);
+
+	//Start a new input file, the following rows belong to it.
+	//The file is registered first if file_id is 0, otherwise it's stored with the given id, e.g. the id in the db which a shard is merged into.
+	//Return false if the file can be skipped. resume.end_offset is 0 unless the file is resumed, see RegisterFile.
+	bool BeginFile(const std::string& path, int64_t file_id = 0, FlvResumePoint* resume = NULL, const DBFileVersion* version = NULL);
+
+	//The current file can't be resumed, delete its rows and store it from the beginning.
+	void RestartFile();
+
+	//Copy all the rows in the shard dbs (written by other DBOutputs with the same options) into this db in one transaction.
+	bool MergeShards(const std::vector<std::string>& shard_paths);
+
+	virtual void FlvHeaderOutput(FlvHeaderInterface* header) override;
+	virtual void FlvTagOutput(FlvTagInterface* tag) override;
+	virtual void NaluOutput(NaluInterface* nalu) override;
 	virtual bool IsGood() override { return db_ != NULL; }
 
+private:
+	bool Prepare(const char* sql, sqlite3_stmt** stmt);
+	void Step(sqlite3_stmt* stmt); //execute a prepared insert and reset it for the next row
+	void Exec(const char* sql);
+	void Finish(); //commit the last rows, then build the indexes
+	void Close();
+	void EndFile(); //update the summary of the current file
+	void WriteStats(); //store the aggregates of the current file
+	void WriteIngestState();
+	bool LoadIngestState(int64_t file_id, FlvResumePoint& resume);
+	void DeleteFileRows(int64_t file_id);
+	void Flush(); //wait until the writer thread has written everything queued
+	void Push(DBRecord&& record); //write the record now, or queue it for the writer thread
+	void Write(const DBRecord& record);
+	void WriteNormalizedNalu(const DBRecord& record);
+	void CompactExtraInfo(FlvTagInterface* tag, NaluInterface* nalu, DBRecord& record); //normalized mode, written by the parsing thread
+	int64_t InsertOnce(sqlite3_stmt* stmt, sqlite3_stmt* query_stmt, std::unordered_map<std::string, int64_t>* ids, const std::string& json, const DBRecord* record);
+	void WriterThread();
+
 private:
 	sqlite3* db_ = NULL;
+	sqlite3_stmt* header_stmt_ = NULL;
+	sqlite3_stmt* tag_stmt_ = NULL;
+	sqlite3_stmt* nalu_stmt_ = NULL;
+	sqlite3_stmt* parameter_set_stmt_ = NULL;
+	sqlite3_stmt* slice_header_stmt_ = NULL;
+	sqlite3_stmt* sei_stmt_ = NULL;
+	sqlite3_stmt* parameter_set_query_stmt_ = NULL;
+	sqlite3_stmt* slice_header_query_stmt_ = NULL;
+	//json -> row id, 0 if it can't be stored once. The parameter sets are few and repeated in every file,
+	//the slice headers are almost all different, they are not kept and always looked up by their hash
+	std::unordered_map<std::string, int64_t> parameter_set_ids_;
+	DBOutputOptions options_;
+	bool created_ = false; //the db file is made by this run
+	BufferedWriter compact_buffer_; //the compact extra_info of the current record
+	CompactJsonWriter compact_json_;
+	int pending_rows_ = 0; //rows inserted since the current transaction began
 	int nalu_serial = 0;
+
+	//the current file
+	int64_t file_id_ = 0;
+	int tag_count_ = 0;
+	int video_codec_id_ = -1;
+	int audio_format_id_ = -1;
+	DBFileStats stats_;
+	DBIngestState ingest_;
+
+	//async mode
+	std::thread writer_;
+	std::mutex mutex_;
+	std::condition_variable not_empty_;
+	std::condition_variable not_full_;
+	std::condition_variable idle_;
+	bool writing_ = false; //the writer thread is writing the rows taken from the queue
+	std::deque<DBRecord> queue_;
+	bool stopping_ = false;
 };
 
 
@@ -9,6 +9,18 @@ public:
 	virtual ~DemuxInterface() {}
 	virtual void OnVideoNaluData(const uint8_t* data, uint32_t size) = 0;
 	virtual void OnAudioAACData(const uint8_t* data, uint32_t size) = 0;
+
+	//a header and the payload after it, the start code and a nalu, or the adts header and an aac frame
+	virtual void OnVideoNaluData(const uint8_t* header, uint32_t header_size, const uint8_t* data, uint32_t size)
+	{
+		OnVideoNaluData(header, header_size);
+		OnVideoNaluData(data, size);
+	}
+	virtual void OnAudioAACData(const uint8_t* header, uint32_t header_size, const uint8_t* data, uint32_t size)
+	{
+		OnAudioAACData(header, header_size);
+		OnAudioAACData(data, size);
+	}
 };
 
 #endif //_SFP_DEMUX_INTERFACE_H_
@@ -1,42 +1,43 @@
 #include "demux_to_file.h"
 
-#ifdef _WIN32
-#pragma warning(disable: 4996)
-#endif
-
-DemuxToFile::DemuxToFile(const std::string& video_file_path, const std::string& audio_file_path)
+DemuxToFile::DemuxToFile(const std::string& video_file_path, const std::string& audio_file_path, bool async)
 {
 	if (!video_file_path.empty())
-		video_file_ = fopen(video_file_path.c_str(), "wb");
+		video_file_.reset(new VectoredWriter(video_file_path, async));
 	if (!audio_file_path.empty())
-		audio_file_ = fopen(audio_file_path.c_str(), "wb");
+		audio_file_.reset(new VectoredWriter(audio_file_path, async));
 }
 
 DemuxToFile::~DemuxToFile()
 {
-	if (video_file_)
-	{
-		fclose(video_file_);
-		video_file_ = NULL;
-	}
-	if (audio_file_)
-	{
-		fclose(audio_file_);
-		audio_file_ = NULL;
-	}
+	video_file_.reset();
+	audio_file_.reset();
 }
 
 void DemuxToFile::OnVideoNaluData(const uint8_t* data, uint32_t size)
 {
 	if (!video_file_)
 		return;
-	fwrite(data, size, 1, video_file_);
+	video_file_->Write(data, size);
 }
 
 void DemuxToFile::OnAudioAACData(const uint8_t* data, uint32_t size)
 {
 	if (!audio_file_)
 		return;
-	fwrite(data, size, 1, audio_file_);
+	audio_file_->Write(data, size);
+}
+
+void DemuxToFile::OnVideoNaluData(const uint8_t* header, uint32_t header_size, const uint8_t* data, uint32_t size)
+{
+	if (!video_file_)
+		return;
+	video_file_->Write(header, header_size, data, size);
 }
 
+void DemuxToFile::OnAudioAACData(const uint8_t* header, uint32_t header_size, const uint8_t* data, uint32_t size)
+{
+	if (!audio_file_)
+		return;
+	audio_file_->Write(header, header_size, data, size);
+}
@@ -2,20 +2,25 @@
 #define _SFP_DEMUX_TO_FILE_H_
 
 #include "demux_interface.h"
+#include "vectored_writer.h"
 #include <string>
+#include <memory>
 
+//The nalus and aac frames are gathered into big vectored writes, with async by a thread of their own.
 class DemuxToFile : public DemuxInterface
 {
 public:
-	DemuxToFile(const std::string& video_file_path, const std::string& audio_file_path = "");
+	DemuxToFile(const std::string& video_file_path, const std::string& audio_file_path = "", bool async = false);
 	~DemuxToFile();
 
 	virtual void OnVideoNaluData(const uint8_t* data, uint32_t size) override;
 	virtual void OnAudioAACData(const uint8_t* data, uint32_t size) override;
+	virtual void OnVideoNaluData(const uint8_t* header, uint32_t header_size, const uint8_t* data, uint32_t size) override;
+	virtual void OnAudioAACData(const uint8_t* header, uint32_t header_size, const uint8_t* data, uint32_t size) override;
 
 private:
-	FILE* video_file_ = NULL;
-	FILE* audio_file_ = NULL;
+	std::unique_ptr<VectoredWriter> video_file_;
+	std::unique_ptr<VectoredWriter> audio_file_;
 };
 
 #endif //_SFP_DEMUX_TO_FILE_H_
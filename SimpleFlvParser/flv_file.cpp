@@ -6,47 +6,27 @@
 #pragma  warning(disable: 4996)
 #endif
 
-FlvFile::FlvFile(const std::string& flv_path, const std::shared_ptr<DemuxInterface>& demux_output)
+FlvFile::FlvFile(const std::string& flv_path, const std::shared_ptr<DemuxInterface>& demux_output, const FlvResumePoint* resume)
 {
-	FILE* flv_file = fopen(flv_path.c_str(), "rb");
-	if (!flv_file)
-	{
-		printf("fopen is failed. \n");
+	reader_.reset(new FlvReader(std::make_shared<FileInputSource>(flv_path), demux_output));
+	if (!reader_->IsGood())
 		return;
-	}
-	fseek(flv_file, 0, SEEK_END);
-	uint32_t file_size = ftell(flv_file);
-	uint8_t* flv_data = new uint8_t[file_size];
-	fseek(flv_file, 0, SEEK_SET);
-	if (file_size != fread(flv_data, sizeof(uint8_t), file_size, flv_file))
+	if (resume)
 	{
-		printf("read file is failed. \n");
-		delete[] flv_data;
-		fclose(flv_file);
-		return;
-	}
-	fclose(flv_file);
-
-	ByteReader reader(flv_data, file_size);
-	flv_header_ = std::make_shared<FlvHeader>(reader);
-	if (!flv_header_ || !flv_header_->IsGood())
-	{
-		delete[] flv_data;
-		return;
+		if (!reader_->Resume(*resume))
+		{
+			printf("%s can't be resumed from offset %llu.\n", flv_path.c_str(), (unsigned long long)resume->end_offset);
+			return;
+		}
+		resumed_ = true;
 	}
 
-	int tag_count = 1;
-	while (reader.RemainingSize())
-	{
-		std::shared_ptr<FlvTag> tag = std::make_shared<FlvTag>(reader, tag_count, demux_output);
-		if (!tag || !tag->IsGood())
-			continue;
-		flv_data_.push_back(tag);
-		tag_count++;
-	}
+	TagView tag;
+	while (reader_->Next(tag))
+		flv_data_.push_back(std::move(tag));
 
+	is_good_ = true;
 	printf("tag count: %lu\n", flv_data_.size());
-	delete[] flv_data;
 }
 
 FlvFile::~FlvFile()
@@ -54,32 +34,39 @@ FlvFile::~FlvFile()
 
 }
 
-void FlvFile::Output(const FlvHeaderCallback& header_cb, const FlvTagCallback& tag_cb, const NaluCallback& nalu_cb)
+bool FlvFile::EndsAt(const FlvResumePoint& resume)
 {
-	if (header_cb)
-		header_cb(flv_header_);
-
-	if (tag_cb)
+	for (auto iter = flv_data_.cbegin(); iter != flv_data_.cend(); iter++)
 	{
-		for (auto iter = flv_data_.cbegin(); iter != flv_data_.cend(); iter++)
-		{
-			std::shared_ptr<FlvTag> tag = *iter;
-			if (!tag || !tag->IsGood())
-				continue;
-			if (tag_cb)
-				tag_cb(tag);
-		}
+		FlvTagInterface* tag = iter->Tag();
+		if (!tag || tag->Serial() != resume.last_tag_serial)
+			continue;
+		return tag->TagSize() == resume.last_tag_size && iter->Offset() + tag->TagSize() == resume.end_offset;
 	}
+	return false;
+}
 
-	if (nalu_cb)
+void FlvFile::Output(const FlvHeaderCallback& header_cb, const FlvTagCallback& tag_cb, const NaluCallback& nalu_cb)
+{
+	if (header_cb && reader_ && !resumed_)
+		header_cb(reader_->Header());
+
+	if (!tag_cb && !nalu_cb)
+		return;
+
+	//walk the tags only once, each tag is followed by its nalus
+	for (auto iter = flv_data_.cbegin(); iter != flv_data_.cend(); iter++)
 	{
-		for (auto iter = flv_data_.cbegin(); iter != flv_data_.cend(); iter++)
+		const TagView& tag = *iter;
+		if (!tag.IsValid())
+			continue;
+		if (tag_cb)
+			tag_cb(tag.Tag());
+		if (nalu_cb)
 		{
-			std::shared_ptr<FlvTag> tag = *iter;
-			if (!tag || !tag->IsGood())
-				continue;
-			NaluList nalu_list = tag->EnumNalus();
-			for (const auto& nalu : nalu_list)
+			NaluIterator nalus = tag.Nalus();
+			NaluInterface* nalu = NULL;
+			while (nalus.Next(nalu))
 				nalu_cb(nalu);
 		}
 	}
@@ -133,6 +120,8 @@ H264File::H264File(const std::string& h264_path) {
 	}
 	fclose(h264_file);
 
+	ParserState state; //of this input only
+	ParserStateScope scope(state);
 	uint8_t* nalu_data = NULL;
 	uint32_t nalu_size = 0;
 	ByteReader reader(h264_data, h264_size);
@@ -141,7 +130,8 @@ H264File::H264File(const std::string& h264_path) {
 		ByteReader naluReader(nalu_data, nalu_size);
 		auto nalu = NaluBase::Create(naluReader, nalu_size, demux_output);
 		if (nalu) {
-			nalu_list_.push_back(nalu);
+			nalu->SetOffset(h264_data, 0);
+			nalu_list_.push_back(std::move(nalu));
 		}
 	}
 
@@ -159,10 +149,10 @@ void H264File::Output(const NaluCallback& nalu_cb) {
 	{
 		for (auto iter = nalu_list_.cbegin(); iter != nalu_list_.cend(); iter++)
 		{
-			auto nalu = *iter;
+			const auto& nalu = *iter;
 			if (!nalu || !nalu->IsGood())
 				continue;
-			nalu_cb(nalu);
+			nalu_cb(nalu.get());
 		}
 	}
 }
@@ -188,6 +178,8 @@ H265File::H265File(const std::string& h265_path) {
 	}
 	fclose(h265_file);
 
+	ParserState state; //of this input only
+	ParserStateScope scope(state);
 	uint8_t* nalu_data = NULL;
 	uint32_t nalu_size = 0;
 	ByteReader reader(h265_data, h265_size);
@@ -196,7 +188,8 @@ H265File::H265File(const std::string& h265_path) {
 		ByteReader naluReader(nalu_data, nalu_size);
 		auto nalu = HevcNaluBase::Create(naluReader, nalu_size, demux_output);
 		if (nalu) {
-			nalu_list_.push_back(nalu);
+			nalu->SetOffset(h265_data, 0);
+			nalu_list_.push_back(std::move(nalu));
 		}
 	}
 
@@ -214,10 +207,10 @@ void H265File::Output(const NaluCallback& nalu_cb) {
 	{
 		for (auto iter = nalu_list_.cbegin(); iter != nalu_list_.cend(); iter++)
 		{
-			auto nalu = *iter;
+			const auto& nalu = *iter;
 			if (!nalu || !nalu->IsGood())
 				continue;
-			nalu_cb(nalu);
+			nalu_cb(nalu.get());
 		}
 	}
 }
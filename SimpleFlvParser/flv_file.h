@@ -3,15 +3,16 @@
 
 #include "input_interface.h"
 #include "demux_interface.h"
+#include "flv_reader.h"
 
 #include <memory>
 #include <string>
 #include <list>
 #include <functional>
 
-typedef std::function<void(const std::shared_ptr<FlvHeaderInterface>&)> FlvHeaderCallback;
-typedef std::function<void(const std::shared_ptr<FlvTagInterface>&)> FlvTagCallback;
-typedef std::function<void(const std::shared_ptr<NaluInterface>&)> NaluCallback;
+typedef std::function<void(FlvHeaderInterface*)> FlvHeaderCallback;
+typedef std::function<void(FlvTagInterface*)> FlvTagCallback;
+typedef std::function<void(NaluInterface*)> NaluCallback;
 
 class FlvHeader;
 class FlvTag;
@@ -21,17 +22,20 @@ class HevcNaluBase;
 class FlvFile
 {
 public:
-	FlvFile(const std::string& flv_path, const std::shared_ptr<DemuxInterface>& demux_output);
+	//only the tags after the resume point are read if it's given, and the header is not output again
+	FlvFile(const std::string& flv_path, const std::shared_ptr<DemuxInterface>& demux_output, const FlvResumePoint* resume = NULL);
 	~FlvFile();
 	bool IsGood() { return is_good_; }
+	bool EndsAt(const FlvResumePoint& resume); //the tags up to the resume point are read and end where it says
 
 public:
 	void Output(const FlvHeaderCallback& header_cb, const FlvTagCallback& tag_cb, const NaluCallback& nalu_cb);
 
 private:
 	bool is_good_ = false;
-	std::shared_ptr<FlvHeader> flv_header_;
-	std::list<std::shared_ptr<FlvTag> > flv_data_;
+	bool resumed_ = false;
+	std::unique_ptr<FlvReader> reader_; //owns the flv header
+	std::list<TagView> flv_data_;
 };
 
 class H264File
@@ -46,7 +50,7 @@ public:
 
 private:
 	bool is_good_ = false;
-	std::list<std::shared_ptr<NaluBase> > nalu_list_;
+	std::list<std::unique_ptr<NaluBase> > nalu_list_;
 };
 
 class H265File
@@ -61,7 +65,7 @@ public:
 
 private:
 	bool is_good_ = false;
-	std::list<std::shared_ptr<HevcNaluBase> > nalu_list_;
+	std::list<std::unique_ptr<HevcNaluBase> > nalu_list_;
 };
 
 #endif
@@ -1,12 +1,7 @@
 #include "flv_file_internal.h"
 #include "utils.h"
-#include "json/reader.h"
+#include "syntax_visitor.h"
 
-#define FLV_HEADER_SIZE           9
-#define PREVIOUS_TAG_SIZE_SIZE    4
-#define FLV_TAG_HEADER_SIZE       11
-#define FLV_VIDEO_TAG_HEADER_SIZE 5
-#define FLV_AUDIO_TAG_HEADER_SIZE 1
 #define STRING_UNKNOWN "Unknown"
 
 extern bool print_sei;
@@ -58,7 +53,7 @@ uint8_t FlvHeader::HeaderSize()
 	return header_size_;
 }
 
-std::string GetFlvTagTypeString(FlvTagType type)
+const char* GetFlvTagTypeString(FlvTagType type)
 {
 	switch (type)
 	{
@@ -73,8 +68,6 @@ std::string GetFlvTagTypeString(FlvTagType type)
 	}
 }
 
-uint32_t FlvTagHeader::LastTagTimestamp = 0;
-
 FlvTagHeader::FlvTagHeader(ByteReader& data)
 {
 	memset(this, 0, sizeof(FlvTagHeader));
@@ -105,15 +98,37 @@ FlvTagHeader::FlvTagHeader(ByteReader& data)
 
 	is_good_ = true;
 
-	if (timestamp_ < LastTagTimestamp)
-		printf("Warning: current timestamp %u is smaller than last timestamp %u.\n", timestamp_, LastTagTimestamp);
-	LastTagTimestamp = timestamp_;
+	ParserState& state = ParserState::Current();
+	if (timestamp_ < state.last_tag_timestamp)
+		printf("Warning: current timestamp %u is smaller than last timestamp %u.\n", timestamp_, state.last_tag_timestamp);
+	state.last_tag_timestamp = timestamp_;
+}
+
+static thread_local ParserState ThreadParserState;
+static thread_local ParserState* ActiveParserState = NULL;
+
+ParserState& ParserState::Current()
+{
+	return ActiveParserState ? *ActiveParserState : ThreadParserState;
 }
 
-uint32_t FlvTag::LastVideoDts = 0;
-uint32_t FlvTag::LastAudioDts = 0;
+ParserStateScope::ParserStateScope(ParserState& state)
+	: previous_(ActiveParserState)
+{
+	ActiveParserState = &state;
+}
 
-FlvTag::FlvTag(ByteReader& data, int tag_serial, const std::shared_ptr<DemuxInterface>& demux_output)
+ParserStateScope::~ParserStateScope()
+{
+	ActiveParserState = previous_;
+}
+
+void ResetParserState()
+{
+	ParserState::Current() = ParserState();
+}
+
+FlvTag::FlvTag(ByteReader& data, int tag_serial, uint64_t offset, const std::shared_ptr<DemuxInterface>& demux_output)
 {
 	if (data.RemainingSize() < PREVIOUS_TAG_SIZE_SIZE + FLV_TAG_HEADER_SIZE)
 	{
@@ -122,8 +137,10 @@ FlvTag::FlvTag(ByteReader& data, int tag_serial, const std::shared_ptr<DemuxInte
 	}
 
 	tag_serial_ = tag_serial;
+	offset_ = offset + PREVIOUS_TAG_SIZE_SIZE;
+	const uint8_t* buffer_start = data.CurrentPos();
 	previous_tag_size_ = (uint32_t)BytesToInt(data.ReadBytes(PREVIOUS_TAG_SIZE_SIZE), PREVIOUS_TAG_SIZE_SIZE);
-	tag_header_ = std::make_shared<FlvTagHeader>(data);
+	tag_header_.reset(new FlvTagHeader(data));
 	if (!tag_header_ || !tag_header_->is_good_)
 	{
 		if (tag_header_->tag_data_size_ > 0)
@@ -136,15 +153,28 @@ FlvTag::FlvTag(ByteReader& data, int tag_serial, const std::shared_ptr<DemuxInte
 	if (!tag_data_ || !tag_data_->IsGood())
 		return;
 	tag_data_->SetTagSerial(tag_serial_);
+	tag_data_->SetNaluOffsets(buffer_start, offset);
+
+	if (tag_header_->tag_type_ == FlvTagTypeVideo)
+	{
+		ParserState& state = ParserState::Current();
+		dts_diff_ = tag_header_->timestamp_ - state.last_video_dts;
+		state.last_video_dts = tag_header_->timestamp_;
+	}
+	else if (tag_header_->tag_type_ == FlvTagTypeAudio)
+	{
+		ParserState& state = ParserState::Current();
+		dts_diff_ = tag_header_->timestamp_ - state.last_audio_dts;
+		state.last_audio_dts = tag_header_->timestamp_;
+	}
 
 	is_good_ = true;
 }
 
-NaluList FlvTag::EnumNalus()
+void FlvTag::EnumNalus(NaluList& nalus)
 {
 	if (tag_data_)
-		return tag_data_->EnumNalus();
-	return NaluList();
+		tag_data_->EnumNalus(nalus);
 }
 
 int FlvTag::Serial()
@@ -159,9 +189,7 @@ uint32_t FlvTag::PreviousTagSize()
 
 std::string FlvTag::TagType()
 {
-	if (tag_header_)
-		return GetFlvTagTypeString(tag_header_->tag_type_);
-	return "";
+	return TagTypeName();
 }
 
 uint32_t FlvTag::StreamId()
@@ -194,50 +222,82 @@ uint32_t FlvTag::Dts()
 
 int FlvTag::DtsDiff()
 {
-	int32_t diff = 0;
-	if (tag_header_)
-	{
-		if (tag_header_->tag_type_ == FlvTagTypeVideo)
-		{
-			diff = tag_header_->timestamp_ - LastVideoDts;
-			LastVideoDts = tag_header_->timestamp_;
-		}
-		else if (tag_header_->tag_type_ == FlvTagTypeAudio)
-		{
-			diff = tag_header_->timestamp_ - LastAudioDts;
-			LastAudioDts = tag_header_->timestamp_;
-		}
-	}
-	return diff;
+	return dts_diff_;
 }
 
 std::string FlvTag::SubType()
+{
+	return SubTypeName();
+}
+
+std::string FlvTag::Format()
+{
+	return FormatName();
+}
+
+std::string FlvTag::ExtraInfo()
+{
+	JsonValueVisitor visitor;
+	if (!VisitExtraInfo(visitor, NULL))
+		return "";
+	return visitor.Root().toStyledString();
+}
+
+bool FlvTag::VisitExtraInfo(SyntaxVisitor& visitor, const char* key)
 {
 	if (tag_data_)
-		return tag_data_->GetSubTypeString();
+		return tag_data_->VisitExtraInfo(visitor, key);
+	return false;
+}
+
+uint8_t FlvTag::TagTypeId()
+{
+	if (tag_header_)
+		return (uint8_t)tag_header_->tag_type_;
+	return FlvTagTypeUnknown;
+}
+
+const char* FlvTag::TagTypeName()
+{
+	if (tag_header_)
+		return GetFlvTagTypeString(tag_header_->tag_type_);
 	return "";
 }
 
-std::string FlvTag::Format()
+int FlvTag::SubTypeId()
 {
 	if (tag_data_)
-		return tag_data_->GetFormatString();
+		return tag_data_->GetSubTypeId();
+	return -1;
+}
+
+const char* FlvTag::SubTypeName()
+{
+	if (tag_data_)
+		return tag_data_->GetSubTypeName();
 	return "";
 }
 
-std::string FlvTag::ExtraInfo()
+int FlvTag::FormatId()
+{
+	if (tag_data_)
+		return tag_data_->GetFormatId();
+	return -1;
+}
+
+const char* FlvTag::FormatName()
 {
 	if (tag_data_)
-		return tag_data_->GetExtraInfo();
+		return tag_data_->GetFormatName();
 	return "";
 }
 
-std::shared_ptr<FlvTagData> FlvTagData::Create(ByteReader& data, uint32_t tag_data_size, FlvTagType tag_type, const std::shared_ptr<DemuxInterface>& demux_output)
+std::unique_ptr<FlvTagData> FlvTagData::Create(ByteReader& data, uint32_t tag_data_size, FlvTagType tag_type, const std::shared_ptr<DemuxInterface>& demux_output)
 {
 	if (data.RemainingSize() < tag_data_size)
 	{
 		data.ReadBytes(data.RemainingSize());
-		return std::shared_ptr<FlvTagData>(nullptr);
+		return nullptr;
 	}
 
 	ByteReader tag_data(data.ReadBytes(tag_data_size), tag_data_size);
@@ -245,13 +305,13 @@ std::shared_ptr<FlvTagData> FlvTagData::Create(ByteReader& data, uint32_t tag_da
 	switch (tag_type)
 	{
 	case FlvTagTypeAudio:
-		return std::make_shared<FlvTagDataAudio>(tag_data, demux_output);
+		return std::unique_ptr<FlvTagData>(new FlvTagDataAudio(tag_data, demux_output));
 	case FlvTagTypeVideo:
-		return std::make_shared<FlvTagDataVideo>(tag_data, demux_output);
+		return std::unique_ptr<FlvTagData>(new FlvTagDataVideo(tag_data, demux_output));
 	case FlvTagTypeScriptData:
-		return std::make_shared<FlvTagDataScript>(tag_data);
+		return std::unique_ptr<FlvTagData>(new FlvTagDataScript(tag_data));
 	default:
-		return std::shared_ptr<FlvTagData>(nullptr);
+		return nullptr;
 	}
 }
 
@@ -275,16 +335,19 @@ FlvTagDataScript::FlvTagDataScript(ByteReader& data)
 
 	if (print_metadata) 
 	{
-		std::string metadata = GetExtraInfo();
+		std::string metadata = script_data_.toStyledString();
 		printf("metadata:\n%s\n", metadata.c_str());
 	}
 
 	is_good_ = true;
 }
 
-std::string FlvTagDataScript::GetExtraInfo()
+bool FlvTagDataScript::VisitExtraInfo(SyntaxVisitor& visitor, const char* key)
 {
-	return script_data_.toStyledString();
+	if (script_data_.isNull())
+		return false;
+	VisitJsonValue(script_data_, key, visitor);
+	return true;
 }
 
 void FlvTagDataScript::DecodeAMF(const AMFObject* amf, Json::Value& json)
@@ -333,7 +396,7 @@ void FlvTagDataScript::DecodeAMF(const AMFObject* amf, Json::Value& json)
 
 FlvTagDataAudio::FlvTagDataAudio(ByteReader& data, const std::shared_ptr<DemuxInterface>& demux_output)
 {
-	audio_tag_header_ = std::make_shared<AudioTagHeader>(data);
+	audio_tag_header_.reset(new AudioTagHeader(data));
 	if (!audio_tag_header_ || !audio_tag_header_->is_good_)
 		return;
 
@@ -344,29 +407,40 @@ FlvTagDataAudio::FlvTagDataAudio(ByteReader& data, const std::shared_ptr<DemuxIn
 	is_good_ = true;
 }
 
-std::string FlvTagDataAudio::GetSubTypeString()
+int FlvTagDataAudio::GetSubTypeId()
+{
+	if (audio_tag_body_)
+		return audio_tag_body_->GetAudioTagType();
+	return FlvTagData::GetSubTypeId();
+}
+
+const char* FlvTagDataAudio::GetSubTypeName()
 {
 	if (audio_tag_body_)
 		return GetAudioTagTypeString(audio_tag_body_->GetAudioTagType());
-	return FlvTagData::GetSubTypeString();
+	return FlvTagData::GetSubTypeName();
 }
 
-std::string FlvTagDataAudio::GetFormatString()
+int FlvTagDataAudio::GetFormatId()
 {
 	if (audio_tag_header_)
-		return GetAudioFormatString(audio_tag_header_->audio_format_) + " | "
-		+ GetAudioSamplerateString(audio_tag_header_->samplerate_) + " | "
-		+ GetAudioSampleWidthString(audio_tag_header_->sample_width_) + " | "
-		+ GetAudioChannelNumString(audio_tag_header_->channel_num_);
+		return (audio_tag_header_->audio_format_ << 4) | (audio_tag_header_->samplerate_ << 2)
+			| (audio_tag_header_->sample_width_ << 1) | audio_tag_header_->channel_num_;
+	return FlvTagData::GetFormatId();
+}
 
-	return "";
+const char* FlvTagDataAudio::GetFormatName()
+{
+	if (audio_tag_header_)
+		return GetAudioTagFormatString((uint8_t)GetFormatId());
+	return FlvTagData::GetFormatName();
 }
 
-std::string FlvTagDataAudio::GetExtraInfo()
+bool FlvTagDataAudio::VisitExtraInfo(SyntaxVisitor& visitor, const char* key)
 {
 	if (audio_tag_body_)
-		return audio_tag_body_->GetExtraInfo();
-	return "";
+		return audio_tag_body_->VisitExtraInfo(visitor, key);
+	return false;
 }
 
 AudioTagHeader::AudioTagHeader(ByteReader& data)
@@ -434,7 +508,7 @@ AudioTagHeader::AudioTagHeader(ByteReader& data)
 	is_good_ = true;
 }
 
-std::string GetAudioFormatString(AudioFormat fmt)
+const char* GetAudioFormatString(AudioFormat fmt)
 {
 	switch (fmt)
 	{
@@ -471,7 +545,7 @@ std::string GetAudioFormatString(AudioFormat fmt)
 	}
 }
 
-std::string GetAudioSamplerateString(AudioSamplerate samplerate)
+const char* GetAudioSamplerateString(AudioSamplerate samplerate)
 {
 	switch (samplerate)
 	{
@@ -488,7 +562,7 @@ std::string GetAudioSamplerateString(AudioSamplerate samplerate)
 	}
 }
 
-std::string GetAudioSampleWidthString(AudioSampleWidth sample_width)
+const char* GetAudioSampleWidthString(AudioSampleWidth sample_width)
 {
 	switch (sample_width)
 	{
@@ -501,7 +575,7 @@ std::string GetAudioSampleWidthString(AudioSampleWidth sample_width)
 	}
 }
 
-std::string GetAudioChannelNumString(AudioChannelNum channel_num)
+const char* GetAudioChannelNumString(AudioChannelNum channel_num)
 {
 	switch (channel_num)
 	{
@@ -514,7 +588,7 @@ std::string GetAudioChannelNumString(AudioChannelNum channel_num)
 	}
 }
 
-std::string GetAudioTagTypeString(AudioTagType type)
+const char* GetAudioTagTypeString(AudioTagType type)
 {
 	switch (type)
 	{
@@ -527,9 +601,25 @@ std::string GetAudioTagTypeString(AudioTagType type)
 	}
 }
 
-std::shared_ptr<AudioSpecificConfig> AudioTagBody::CurrentAudioConfig = NULL;
+const char* GetAudioTagFormatString(uint8_t sound_flags)
+{
+	//all the 256 combinations are composed once
+	static const std::vector<std::string> format_strings = []() {
+		std::vector<std::string> strings(256);
+		for (int b = 0; b < 256; b++)
+		{
+			strings[b] = std::string(GetAudioFormatString((AudioFormat)(b >> 4))) + " | "
+				+ GetAudioSamplerateString((AudioSamplerate)((b >> 2) & 0x03)) + " | "
+				+ GetAudioSampleWidthString((AudioSampleWidth)((b >> 1) & 0x01)) + " | "
+				+ GetAudioChannelNumString((AudioChannelNum)(b & 0x01));
+		}
+		return strings;
+	}();
+	return format_strings[sound_flags].c_str();
+}
+
 
-std::shared_ptr<AudioTagBody> AudioTagBody::Create(ByteReader& data, AudioFormat audio_format, const std::shared_ptr<DemuxInterface>& demux_output)
+std::unique_ptr<AudioTagBody> AudioTagBody::Create(ByteReader& data, AudioFormat audio_format, const std::shared_ptr<DemuxInterface>& demux_output)
 {
 	switch (audio_format)
 	{
@@ -537,14 +627,14 @@ std::shared_ptr<AudioTagBody> AudioTagBody::Create(ByteReader& data, AudioFormat
 	{
 		uint8_t b = *data.ReadBytes(1);
 		if (b == AudioTagTypeAACConfig)
-			return std::make_shared<AudioTagBodyAACConfig>(data, demux_output);
+			return std::unique_ptr<AudioTagBody>(new AudioTagBodyAACConfig(data, demux_output));
 		else if (b == AudioTagTypeAACData)
-			return std::make_shared<AudioTagBodyAACData>(data, demux_output);
+			return std::unique_ptr<AudioTagBody>(new AudioTagBodyAACData(data, demux_output));
 		else
-			return std::shared_ptr<AudioTagBody>(nullptr);
+			return nullptr;
 	}
 	default:
-		return std::make_shared<AudioTagBodyNonAAC>(data);
+		return std::unique_ptr<AudioTagBody>(new AudioTagBodyNonAAC(data));
 	}
 }
 
@@ -717,19 +807,16 @@ AudioSpecificConfig::AudioSpecificConfig(ByteReader& data)
 	is_good_ = true;
 }
 
-std::string AudioSpecificConfig::Serialize()
+void AudioSpecificConfig::VisitFields(SyntaxVisitor& visitor)
 {
-	Json::Value root, aac_config;
-	aac_config["object_type"] = audioObjectType;
-	aac_config["object_type_name"] = GetMPEG4AudioObjectTypeString((MPEG4AudioObjectType)audioObjectType);
-	aac_config["frequency_index"] = samplingFrequencyIndex;
-	aac_config["frequency"] = GetMPEG4AudioSamplerateString((MPEG4AudioSamplerate)samplingFrequencyIndex);
-	aac_config["channel_configuration"] = channelConfiguration;
-	aac_config["frame_length_flag"] = frameLengthFlag;
-	aac_config["depends_on_core_coder"] = dependsOnCoreCoder;
-	aac_config["extension_flag"] = extensionFlag;
-	root["aac_config"] = aac_config;
-	return root.toStyledString();
+	visitor.Field("object_type", audioObjectType);
+	visitor.Field("object_type_name", GetMPEG4AudioObjectTypeString((MPEG4AudioObjectType)audioObjectType));
+	visitor.Field("frequency_index", samplingFrequencyIndex);
+	visitor.Field("frequency", GetMPEG4AudioSamplerateString((MPEG4AudioSamplerate)samplingFrequencyIndex));
+	visitor.Field("channel_configuration", channelConfiguration);
+	visitor.Field("frame_length_flag", frameLengthFlag);
+	visitor.Field("depends_on_core_coder", dependsOnCoreCoder);
+	visitor.Field("extension_flag", extensionFlag);
 }
 
 AudioTagBodyAACConfig::AudioTagBodyAACConfig(ByteReader& data, const std::shared_ptr<DemuxInterface>& demux_output)
@@ -738,17 +825,22 @@ AudioTagBodyAACConfig::AudioTagBodyAACConfig(ByteReader& data, const std::shared
 	if (!aac_config_ || !aac_config_->is_good_)
 		return;
 
-	CurrentAudioConfig = aac_config_;
+	ParserState::Current().audio_config = aac_config_;
 
 	audio_tag_type_ = AudioTagTypeAACConfig;
 	is_good_ = true;
 }
 
-std::string AudioTagBodyAACConfig::GetExtraInfo()
+bool AudioTagBodyAACConfig::VisitExtraInfo(SyntaxVisitor& visitor, const char* key)
 {
-	if (aac_config_)
-		return aac_config_->Serialize();
-	return "";
+	if (!aac_config_)
+		return false;
+	visitor.BeginObject(key);
+	visitor.BeginObject("aac_config");
+	aac_config_->VisitFields(visitor);
+	visitor.EndObject();
+	visitor.EndObject();
+	return true;
 }
 
 static int GetADTSHeader(uint8_t* buffer, uint16_t aac_size, const std::shared_ptr<AudioSpecificConfig>& audio_config)
@@ -810,9 +902,8 @@ AudioTagBodyAACData::AudioTagBodyAACData(ByteReader& data, const std::shared_ptr
 	if (demux_output)
 	{
 		uint8_t adts_header[20] = {0};
-		int adts_header_len = GetADTSHeader(adts_header, data.RemainingSize(), CurrentAudioConfig);
-		demux_output->OnAudioAACData(adts_header, adts_header_len);
-		demux_output->OnAudioAACData(data.CurrentPos(), data.RemainingSize());
+		int adts_header_len = GetADTSHeader(adts_header, data.RemainingSize(), ParserState::Current().audio_config);
+		demux_output->OnAudioAACData(adts_header, adts_header_len, data.CurrentPos(), data.RemainingSize());
 	}
 
 	audio_tag_type_ = AudioTagTypeAACData;
@@ -827,7 +918,7 @@ AudioTagBodyNonAAC::AudioTagBodyNonAAC(ByteReader& data)
 
 FlvTagDataVideo::FlvTagDataVideo(ByteReader& data, const std::shared_ptr<DemuxInterface>& demux_output)
 {
-	video_tag_header_ = std::make_shared<VideoTagHeader>(data);
+	video_tag_header_.reset(new VideoTagHeader(data));
 	if (!video_tag_header_ || !video_tag_header_->is_good_)
 		return;
 
@@ -844,6 +935,12 @@ void FlvTagDataVideo::SetTagSerial(int tag_serial)
 		video_tag_body_->SetTagSerial(tag_serial);
 }
 
+void FlvTagDataVideo::SetNaluOffsets(const uint8_t* buffer_start, uint64_t buffer_offset)
+{
+	if (video_tag_body_)
+		video_tag_body_->SetNaluOffsets(buffer_start, buffer_offset);
+}
+
 uint32_t FlvTagDataVideo::GetCts()
 {
 	if (video_tag_body_)
@@ -851,36 +948,48 @@ uint32_t FlvTagDataVideo::GetCts()
 	return FlvTagData::GetCts();
 }
 
-std::string FlvTagDataVideo::GetSubTypeString()
+int FlvTagDataVideo::GetSubTypeId()
+{
+	if (video_tag_body_)
+		return video_tag_body_->GetVideoTagType();
+	return FlvTagData::GetSubTypeId();
+}
+
+const char* FlvTagDataVideo::GetSubTypeName()
 {
 	if (video_tag_body_)
 		return GetVideoTagTypeString(video_tag_body_->GetVideoTagType(), video_tag_header_->codec_id_);
-	return FlvTagData::GetSubTypeString();
+	return FlvTagData::GetSubTypeName();
 }
 
-std::string FlvTagDataVideo::GetFormatString()
+int FlvTagDataVideo::GetFormatId()
 {
 	if (video_tag_header_)
-		return GetFlvVideoFrameTypeString(video_tag_header_->frame_type_) + " | "
-		+ GetFlvVideoCodecIDString(video_tag_header_->codec_id_);
-	return "";
+		return (video_tag_header_->frame_type_ << 4) | video_tag_header_->codec_id_;
+	return FlvTagData::GetFormatId();
+}
+
+const char* FlvTagDataVideo::GetFormatName()
+{
+	if (video_tag_header_)
+		return GetVideoTagFormatString((uint8_t)GetFormatId());
+	return FlvTagData::GetFormatName();
 }
 
-std::string FlvTagDataVideo::GetExtraInfo()
+bool FlvTagDataVideo::VisitExtraInfo(SyntaxVisitor& visitor, const char* key)
 {
 	if (video_tag_body_)
-		return video_tag_body_->GetExtraInfo();
-	return "";
+		return video_tag_body_->VisitExtraInfo(visitor, key);
+	return false;
 }
 
-NaluList FlvTagDataVideo::EnumNalus()
+void FlvTagDataVideo::EnumNalus(NaluList& nalus)
 {
 	if (video_tag_body_)
-		return video_tag_body_->EnumNalus();
-	return NaluList();
+		video_tag_body_->EnumNalus(nalus);
 }
 
-std::string GetFlvVideoFrameTypeString(FlvVideoFrameType type)
+const char* GetFlvVideoFrameTypeString(FlvVideoFrameType type)
 {
 	switch (type)
 	{
@@ -899,7 +1008,7 @@ std::string GetFlvVideoFrameTypeString(FlvVideoFrameType type)
 	}
 }
 
-std::string GetFlvVideoCodecIDString(FlvVideoCodecID id)
+const char* GetFlvVideoCodecIDString(FlvVideoCodecID id)
 {
 	switch (id)
 	{
@@ -924,6 +1033,21 @@ std::string GetFlvVideoCodecIDString(FlvVideoCodecID id)
 	}
 }
 
+const char* GetVideoTagFormatString(uint8_t video_flags)
+{
+	//all the 256 combinations are composed once
+	static const std::vector<std::string> format_strings = []() {
+		std::vector<std::string> strings(256);
+		for (int b = 0; b < 256; b++)
+		{
+			strings[b] = std::string(GetFlvVideoFrameTypeString((FlvVideoFrameType)(b >> 4))) + " | "
+				+ GetFlvVideoCodecIDString((FlvVideoCodecID)(b & 0x0f));
+		}
+		return strings;
+	}();
+	return format_strings[video_flags].c_str();
+}
+
 VideoTagHeader::VideoTagHeader(ByteReader& data)
 {
 	memset(this, 0, sizeof(VideoTagHeader));
@@ -961,7 +1085,7 @@ VideoTagHeader::VideoTagHeader(ByteReader& data)
 	is_good_ = true;
 }
 
-std::string GetVideoTagTypeString(VideoTagType type, FlvVideoCodecID codec_id)
+const char* GetVideoTagTypeString(VideoTagType type, FlvVideoCodecID codec_id)
 {
 	if (codec_id != FlvVideoCodeIDAVC && codec_id != FlvVideoCodeIDHEVC)
 		return STRING_UNKNOWN;
@@ -980,7 +1104,7 @@ std::string GetVideoTagTypeString(VideoTagType type, FlvVideoCodecID codec_id)
 	}
 }
 
-std::shared_ptr<VideoTagBody> VideoTagBody::Create(ByteReader& data, FlvVideoCodecID codec_id, const std::shared_ptr<DemuxInterface>& demux_output)
+std::unique_ptr<VideoTagBody> VideoTagBody::Create(ByteReader& data, FlvVideoCodecID codec_id, const std::shared_ptr<DemuxInterface>& demux_output)
 {
 	switch (codec_id)
 	{
@@ -990,13 +1114,13 @@ std::shared_ptr<VideoTagBody> VideoTagBody::Create(ByteReader& data, FlvVideoCod
 		switch (b)
 		{
 		case VideoTagTypeAVCSequenceHeader:
-			return std::make_shared<VideoTagBodySpsPps>(data, demux_output);
+			return std::unique_ptr<VideoTagBody>(new VideoTagBodySpsPps(data, demux_output));
 		case VideoTagTypeAVCNalu:
-			return std::make_shared<VideoTagBodyAVCNalu>(data, demux_output);
+			return std::unique_ptr<VideoTagBody>(new VideoTagBodyAVCNalu(data, demux_output));
 		case VideoTagTypeAVCSequenceEnd:
-			return std::make_shared<VideoTagBodySequenceEnd>(data);
+			return std::unique_ptr<VideoTagBody>(new VideoTagBodySequenceEnd(data));
 		default:
-			return std::shared_ptr<VideoTagBody>(nullptr);
+			return nullptr;
 		}
 	}
 	case FlvVideoCodeIDHEVC:
@@ -1005,21 +1129,21 @@ std::shared_ptr<VideoTagBody> VideoTagBody::Create(ByteReader& data, FlvVideoCod
 		switch (b)
 		{
 		case VideoTagTypeAVCSequenceHeader:
-			return std::make_shared<VideoTagBodyVpsSpsPps>(data, demux_output);
+			return std::unique_ptr<VideoTagBody>(new VideoTagBodyVpsSpsPps(data, demux_output));
 		case VideoTagTypeAVCNalu:
-			return std::make_shared<VideoTagBodyHEVCNalu>(data, demux_output);
+			return std::unique_ptr<VideoTagBody>(new VideoTagBodyHEVCNalu(data, demux_output));
 		case VideoTagTypeAVCSequenceEnd:
-			return std::make_shared<VideoTagBodySequenceEnd>(data);
+			return std::unique_ptr<VideoTagBody>(new VideoTagBodySequenceEnd(data));
 		default:
-			return std::shared_ptr<VideoTagBody>(nullptr);
+			return nullptr;
 		}
 	}
 	default:
-		return std::make_shared<VideoTagBodyNonAVC>(data);
+		return std::unique_ptr<VideoTagBody>(new VideoTagBodyNonAVC(data));
 	}
 }
 
-std::string GetNaluTypeString(NaluType type)
+const char* GetNaluTypeString(NaluType type)
 {
 	switch (type)
 	{
@@ -1064,9 +1188,7 @@ NaluHeader::NaluHeader(uint8_t b)
 	nal_ref_idc_ = (b >> 5) & 0x03;
 }
 
-std::shared_ptr<NaluBase> NaluBase::CurrentSps = std::shared_ptr<NaluBase>(nullptr);
-std::shared_ptr<NaluBase> NaluBase::CurrentPps = std::shared_ptr<NaluBase>(nullptr);
-std::shared_ptr<NaluBase> NaluBase::Create(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output)
+std::unique_ptr<NaluBase> NaluBase::Create(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output)
 {
 	if (data.RemainingSize() < nalu_size || nalu_size <= 1) {
 		printf("data remaining size %d, nalu size %d\n", data.RemainingSize(), nalu_size);
@@ -1077,7 +1199,7 @@ std::shared_ptr<NaluBase> NaluBase::Create(ByteReader& data, uint32_t nalu_size,
 	ByteReader nalu_data(data.CurrentPos(), nalu_size);
 	data.ReadBytes(nalu_size);
 
-	std::shared_ptr<NaluBase> nalu;
+	std::unique_ptr<NaluBase> nalu;
 	uint8_t nalu_header = *nalu_data.ReadBytes(1, false); //just peek 1 byte
 	NaluType nalu_type = (NaluType)(nalu_header & 0x1f);
 	switch (nalu_type)
@@ -1085,21 +1207,27 @@ std::shared_ptr<NaluBase> NaluBase::Create(ByteReader& data, uint32_t nalu_size,
 	case NaluTypeNonIDR:
 	case NaluTypeIDR:
 	case NaluTypeSliceAux:
-		nalu = std::make_shared<NaluSlice>(nalu_data, nalu_size, demux_output);
+		nalu.reset(new NaluSlice(nalu_data, nalu_size, demux_output));
 		break;
 	case NaluTypeSEI:
-		nalu = std::make_shared<NaluSEI>(nalu_data, nalu_size, demux_output);
+		nalu.reset(new NaluSEI(nalu_data, nalu_size, demux_output));
 		break;
 	case NaluTypeSPS:
-		CurrentSps = std::make_shared<NaluSps>(nalu_data, nalu_size, demux_output);
-		nalu = CurrentSps;
+	{
+		NaluSps* sps = new NaluSps(nalu_data, nalu_size, demux_output);
+		ParserState::Current().sps = sps->sps_;
+		nalu.reset(sps);
 		break;
+	}
 	case NaluTypePPS:
-		CurrentPps = std::make_shared<NaluPps>(nalu_data, nalu_size, demux_output);
-		nalu = CurrentPps;
+	{
+		NaluPps* pps = new NaluPps(nalu_data, nalu_size, demux_output);
+		ParserState::Current().pps = pps->pps_;
+		nalu.reset(pps);
 		break;
+	}
 	default:
-		nalu = std::make_shared<NaluBase>(nalu_data, nalu_size, demux_output);
+		nalu.reset(new NaluBase(nalu_data, nalu_size, demux_output));
 		break;
 	}
 
@@ -1115,6 +1243,7 @@ std::shared_ptr<NaluBase> NaluBase::Create(ByteReader& data, uint32_t nalu_size,
 NaluBase::NaluBase(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output)
 {
 	nalu_size_ = nalu_size;
+	data_start_ = data.CurrentPos();
 	if (data.RemainingSize() < nalu_size_)
 	{
 		data.ReadBytes(data.RemainingSize());
@@ -1124,12 +1253,11 @@ NaluBase::NaluBase(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<D
 	if (demux_output)
 	{
 		static const uint8_t start_code[] = { 0x00, 0x00, 0x00, 0x01 };
-		demux_output->OnVideoNaluData(start_code, 4);
-		demux_output->OnVideoNaluData(data.CurrentPos(), nalu_size_);
+		demux_output->OnVideoNaluData(start_code, 4, data.CurrentPos(), nalu_size_);
 	}
 
 	//parse nalu header
-	nalu_header_ = std::make_shared<NaluHeader>(*data.ReadBytes(1, false)); //just peek
+	nalu_header_.reset(new NaluHeader(*data.ReadBytes(1, false))); //just peek
 
 	//allocate memory and transfer nal to rbsp
 	rbsp_size_ = nalu_size_;
@@ -1162,19 +1290,15 @@ void NaluBase::ReleaseRbsp()
 	}
 }
 
-std::string NaluBase::CompleteInfo()
+void NaluBase::VisitCompleteInfo(SyntaxVisitor& visitor)
 {
-	Json::Value json_nalu;
-
-	json_nalu["nal_unit_size"] = nalu_size_;
+	visitor.Field("nal_unit_size", nalu_size_);
 	if (nalu_header_)
 	{
-		json_nalu["forbidden_zero_bit"] = 0;
-		json_nalu["nal_ref_idc"] = nalu_header_->nal_ref_idc_;
-		json_nalu["nal_unit_type"] = GetNaluTypeString(nalu_header_->nal_unit_type_);
+		visitor.Field("forbidden_zero_bit", 0);
+		visitor.Field("nal_ref_idc", nalu_header_->nal_ref_idc_);
+		visitor.Field("nal_unit_type", GetNaluTypeString(nalu_header_->nal_unit_type_));
 	}
-
-	return json_nalu.toStyledString();
 }
 
 int NaluBase::TagSerialBelong()
@@ -1196,9 +1320,7 @@ uint8_t NaluBase::NalRefIdc()
 
 std::string NaluBase::NalUnitType()
 {
-	if (nalu_header_)
-		return GetNaluTypeString(nalu_header_->nal_unit_type_);
-	return "";
+	return NalUnitTypeName();
 }
 
 int8_t NaluBase::FirstMbInSlice()
@@ -1208,7 +1330,7 @@ int8_t NaluBase::FirstMbInSlice()
 
 std::string NaluBase::SliceType()
 {
-	return "";
+	return SliceTypeName();
 }
 
 int NaluBase::PicParameterSetId()
@@ -1237,6 +1359,43 @@ int NaluBase::SliceQpDelta()
 }
 
 std::string NaluBase::ExtraInfo()
+{
+	JsonValueVisitor visitor;
+	if (!VisitExtraInfo(visitor, NULL))
+		return "";
+	return visitor.Root().toStyledString();
+}
+
+bool NaluBase::VisitExtraInfo(SyntaxVisitor& visitor, const char* key)
+{
+	return false;
+}
+
+uint8_t NaluBase::CodecId()
+{
+	return FlvVideoCodeIDAVC;
+}
+
+int NaluBase::NalUnitTypeId()
+{
+	if (nalu_header_)
+		return nalu_header_->nal_unit_type_;
+	return NaluTypeUnknown;
+}
+
+const char* NaluBase::NalUnitTypeName()
+{
+	if (nalu_header_)
+		return GetNaluTypeString(nalu_header_->nal_unit_type_);
+	return "";
+}
+
+int NaluBase::SliceTypeId()
+{
+	return -1;
+}
+
+const char* NaluBase::SliceTypeName()
 {
 	return "";
 }
@@ -1258,21 +1417,20 @@ NaluSps::NaluSps(ByteReader& data, uint32_t nalu_len_size, const std::shared_ptr
 	is_good_ = true;
 }
 
-std::string NaluSps::CompleteInfo()
+void NaluSps::VisitCompleteInfo(SyntaxVisitor& visitor)
 {
-	Json::Value json_nalu;
-	Json::Reader reader;
-	reader.parse(NaluBase::CompleteInfo(), json_nalu);
-	if (sps_)
-		json_nalu["sps"] = sps_to_json(sps_.get());
-	return json_nalu.toStyledString();
+	NaluBase::VisitCompleteInfo(visitor);
+	VisitExtraInfo(visitor, "sps");
 }
 
-std::string NaluSps::ExtraInfo()
+bool NaluSps::VisitExtraInfo(SyntaxVisitor& visitor, const char* key)
 {
-	if (sps_)
-		return sps_to_json(sps_.get()).toStyledString();
-	return "";
+	if (!sps_)
+		return false;
+	visitor.BeginObject(key);
+	visit_sps(sps_.get(), visitor);
+	visitor.EndObject();
+	return true;
 }
 
 NaluPps::NaluPps(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output)
@@ -1292,21 +1450,20 @@ NaluPps::NaluPps(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<Dem
 	is_good_ = true;
 }
 
-std::string NaluPps::CompleteInfo()
+void NaluPps::VisitCompleteInfo(SyntaxVisitor& visitor)
 {
-	Json::Value json_nalu;
-	Json::Reader reader;
-	reader.parse(NaluBase::CompleteInfo(), json_nalu);
-	if (pps_)
-		json_nalu["pps"] = pps_to_json(pps_.get());
-	return json_nalu.toStyledString();
+	NaluBase::VisitCompleteInfo(visitor);
+	VisitExtraInfo(visitor, "pps");
 }
 
-std::string NaluPps::ExtraInfo()
+bool NaluPps::VisitExtraInfo(SyntaxVisitor& visitor, const char* key)
 {
-	if (pps_)
-		return pps_to_json(pps_.get()).toStyledString();
-	return "";
+	if (!pps_)
+		return false;
+	visitor.BeginObject(key);
+	visit_pps(pps_.get(), visitor);
+	visitor.EndObject();
+	return true;
 }
 
 NaluSlice::NaluSlice(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output)
@@ -1320,26 +1477,21 @@ NaluSlice::NaluSlice(ByteReader& data, uint32_t nalu_size, const std::shared_ptr
 		&& nalu_header_->nal_unit_type_ != NaluTypeSliceAux)
 		return;
 
-	slice_header_ = std::make_shared<slice_header_t>();
+	slice_header_.reset(new slice_header_t());
 	memset(slice_header_.get(), 0, sizeof(slice_header_t));
 	BitReader rbsp_data(rbsp_, rbsp_size_);
-	NaluSps* current_sps = (NaluSps*)NaluBase::CurrentSps.get();
-	NaluPps* current_pps = (NaluPps*)NaluBase::CurrentPps.get();
-	if (!current_sps || !current_pps)
+	ParserState& state = ParserState::Current();
+	if (!state.sps || !state.pps)
 		return;
-	read_slice_header_rbsp(slice_header_.get(), rbsp_data, nalu_header_->nal_unit_type_, nalu_header_->nal_ref_idc_, current_sps->sps_.get(), current_pps->pps_.get());
+	read_slice_header_rbsp(slice_header_.get(), rbsp_data, nalu_header_->nal_unit_type_, nalu_header_->nal_ref_idc_, state.sps.get(), state.pps.get());
 	ReleaseRbsp();
 	is_good_ = true;
 }
 
-std::string NaluSlice::CompleteInfo()
+void NaluSlice::VisitCompleteInfo(SyntaxVisitor& visitor)
 {
-	Json::Value json_nalu;
-	Json::Reader reader;
-	reader.parse(NaluBase::CompleteInfo(), json_nalu);
-	if (slice_header_)
-		json_nalu["slice_header"] = slice_header_to_json(slice_header_.get(), nalu_header_->nal_unit_type_, nalu_header_->nal_ref_idc_);
-	return json_nalu.toStyledString();
+	NaluBase::VisitCompleteInfo(visitor);
+	VisitExtraInfo(visitor, "slice_header");
 }
 
 int8_t NaluSlice::FirstMbInSlice()
@@ -1349,11 +1501,18 @@ int8_t NaluSlice::FirstMbInSlice()
 	return NaluBase::FirstMbInSlice();
 }
 
-std::string NaluSlice::SliceType()
+int NaluSlice::SliceTypeId()
+{
+	if (slice_header_)
+		return slice_header_->slice_type;
+	return NaluBase::SliceTypeId();
+}
+
+const char* NaluSlice::SliceTypeName()
 {
 	if (slice_header_)
 		return GetSliceTypeString(slice_header_->slice_type);
-	return NaluBase::SliceType();
+	return NaluBase::SliceTypeName();
 }
 
 int NaluSlice::PicParameterSetId()
@@ -1391,10 +1550,14 @@ int NaluSlice::SliceQpDelta()
 	return NaluBase::SliceQpDelta();
 }
 
-std::string NaluSlice::ExtraInfo()
+bool NaluSlice::VisitExtraInfo(SyntaxVisitor& visitor, const char* key)
 {
-	return slice_header_to_json(slice_header_.get(), nalu_header_->nal_unit_type_, 
-			nalu_header_->nal_ref_idc_).toStyledString();
+	if (!slice_header_)
+		return false;
+	visitor.BeginObject(key);
+	visit_slice_header(slice_header_.get(), nalu_header_->nal_unit_type_, nalu_header_->nal_ref_idc_, visitor);
+	visitor.EndObject();
+	return true;
 }
 
 NaluSEI::NaluSEI(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output)
@@ -1437,16 +1600,25 @@ NaluSEI::~NaluSEI()
 	}
 }
 
-std::string NaluSEI::CompleteInfo()
+void NaluSEI::VisitCompleteInfo(SyntaxVisitor& visitor)
 {
-	return ExtraInfo();
+	//only the seis, same as the extra info
+	if (!seis_ || !sei_num_)
+		visitor.Null("seis");
+	else
+	{
+		visitor.BeginArray("seis");
+		visit_seis(seis_, sei_num_, visitor);
+		visitor.EndArray();
+	}
 }
 
-std::string NaluSEI::ExtraInfo()
+bool NaluSEI::VisitExtraInfo(SyntaxVisitor& visitor, const char* key)
 {
-	Json::Value extra_info;
-	extra_info["seis"] = seis_to_json(seis_, sei_num_);
-	return extra_info.toStyledString();
+	visitor.BeginObject(key);
+	VisitCompleteInfo(visitor);
+	visitor.EndObject();
+	return true;
 }
 
 VideoTagBodyAVCNalu::VideoTagBodyAVCNalu(ByteReader& data, const std::shared_ptr<DemuxInterface>& demux_output)
@@ -1485,12 +1657,12 @@ VideoTagBodyAVCNalu::VideoTagBodyAVCNalu(ByteReader& data, const std::shared_ptr
 			}
 		}
 
-		std::shared_ptr<NaluBase> nalu = NaluBase::Create(data, nalu_size, demux_output);
+		std::unique_ptr<NaluBase> nalu = NaluBase::Create(data, nalu_size, demux_output);
 		if (!nalu || !nalu->IsNoBother())
 			break;
 		else if (!nalu->IsGood())
 			continue;
-		nalu_list_.push_back(nalu);
+		nalu_list_.push_back(std::move(nalu));
 	}
 	if (nalu_list_.empty())
 		return;
@@ -1505,26 +1677,31 @@ void VideoTagBodyAVCNalu::SetTagSerial(int tag_serial)
 		item->SetTagSerialBelong(tag_serial);
 }
 
-NaluList VideoTagBodyAVCNalu::EnumNalus()
+void VideoTagBodyAVCNalu::SetNaluOffsets(const uint8_t* buffer_start, uint64_t buffer_offset)
 {
-	NaluList list(nalu_list_.begin(), nalu_list_.end());
-	return list;
+	for (const auto& item : nalu_list_)
+		item->SetOffset(buffer_start, buffer_offset);
 }
 
-std::string VideoTagBodyAVCNalu::GetExtraInfo()
+void VideoTagBodyAVCNalu::EnumNalus(NaluList& nalus)
 {
-	Json::Value root, nalus, nalu;
-	Json::Reader reader;
+	for (const auto& item : nalu_list_)
+		nalus.push_back(item.get());
+}
 
+bool VideoTagBodyAVCNalu::VisitExtraInfo(SyntaxVisitor& visitor, const char* key)
+{
+	visitor.BeginObject(key);
+	visitor.BeginArray("nalu_list");
 	for (const auto& item : nalu_list_)
 	{
-		nalu.clear();
-		if (reader.parse(item->CompleteInfo(), nalu))
-			nalus.append(nalu);
+		visitor.BeginObject(NULL);
+		item->VisitCompleteInfo(visitor);
+		visitor.EndObject();
 	}
-
-	root["nalu_list"] = nalus;
-	return root.toStyledString();
+	visitor.EndArray();
+	visitor.EndObject();
+	return true;
 }
 
 AVCDecoderConfigurationRecord::AVCDecoderConfigurationRecord(ByteReader& data, const std::shared_ptr<DemuxInterface>& demux_output)
@@ -1567,7 +1744,7 @@ VideoTagBodySpsPps::VideoTagBodySpsPps(ByteReader& data, const std::shared_ptr<D
 	if (data.RemainingSize() < 3)
 		return;
 	cts_ = (uint32_t)BytesToInt(data.ReadBytes(3), 3);
-	avc_config_ = std::make_shared<AVCDecoderConfigurationRecord>(data, demux_output);
+	avc_config_.reset(new AVCDecoderConfigurationRecord(data, demux_output));
 	if (!avc_config_ || !avc_config_->is_good_)
 		return;
 
@@ -1586,37 +1763,51 @@ void VideoTagBodySpsPps::SetTagSerial(int tag_serial)
 	}
 }
 
-NaluList VideoTagBodySpsPps::EnumNalus()
+void VideoTagBodySpsPps::SetNaluOffsets(const uint8_t* buffer_start, uint64_t buffer_offset)
+{
+	if (avc_config_)
+	{
+		if (avc_config_->sps_nal_)
+			avc_config_->sps_nal_->SetOffset(buffer_start, buffer_offset);
+		if (avc_config_->pps_nal_)
+			avc_config_->pps_nal_->SetOffset(buffer_start, buffer_offset);
+	}
+}
+
+void VideoTagBodySpsPps::EnumNalus(NaluList& nalus)
 {
-	NaluList list;
 	if (avc_config_)
 	{
 		if (avc_config_->sps_nal_)
-			list.push_back(avc_config_->sps_nal_);
+			nalus.push_back(avc_config_->sps_nal_.get());
 		if (avc_config_->pps_nal_)
-			list.push_back(avc_config_->pps_nal_);
+			nalus.push_back(avc_config_->pps_nal_.get());
 	}
-	return list;
 }
 
-std::string VideoTagBodySpsPps::GetExtraInfo()
+bool VideoTagBodySpsPps::VisitExtraInfo(SyntaxVisitor& visitor, const char* key)
 {
-	Json::Value extra_info, json_sps, json_pps;
-	Json::Reader reader;
+	if (!avc_config_ || !avc_config_->sps_nal_ || !avc_config_->pps_nal_)
+		return false;
 
-	extra_info["configurationVersion"] = avc_config_->configurationVersion;
-	extra_info["AVCProfileIndication"] = avc_config_->AVCProfileIndication;
-	extra_info["profile_compatibility"] = avc_config_->profile_compatibility;
-	extra_info["AVCLevelIndication"] = avc_config_->AVCLevelIndication;
-	extra_info["lengthSizeMinusOne"] = avc_config_->lengthSizeMinusOne;
-	extra_info["numOfSequenceParameterSets"] = avc_config_->numOfSequenceParameterSets & 0x1F;
-	if (reader.parse(avc_config_->sps_nal_->CompleteInfo(), json_sps))
-		extra_info["nalu_list"].append(json_sps);
-	extra_info["numOfPictureParameterSets"] = avc_config_->numOfPictureParameterSets;
-	if (reader.parse(avc_config_->pps_nal_->CompleteInfo(), json_pps))
-		extra_info["nalu_list"].append(json_pps);
-	
-	return extra_info.toStyledString();
+	visitor.BeginObject(key);
+	visitor.Field("configurationVersion", avc_config_->configurationVersion);
+	visitor.Field("AVCProfileIndication", avc_config_->AVCProfileIndication);
+	visitor.Field("profile_compatibility", avc_config_->profile_compatibility);
+	visitor.Field("AVCLevelIndication", avc_config_->AVCLevelIndication);
+	visitor.Field("lengthSizeMinusOne", avc_config_->lengthSizeMinusOne);
+	visitor.Field("numOfSequenceParameterSets", avc_config_->numOfSequenceParameterSets & 0x1F);
+	visitor.Field("numOfPictureParameterSets", avc_config_->numOfPictureParameterSets);
+	visitor.BeginArray("nalu_list");
+	visitor.BeginObject(NULL);
+	avc_config_->sps_nal_->VisitCompleteInfo(visitor);
+	visitor.EndObject();
+	visitor.BeginObject(NULL);
+	avc_config_->pps_nal_->VisitCompleteInfo(visitor);
+	visitor.EndObject();
+	visitor.EndArray();
+	visitor.EndObject();
+	return true;
 }
 
 VideoTagBodySequenceEnd::VideoTagBodySequenceEnd(ByteReader& data)
@@ -1638,7 +1829,7 @@ VideoTagBodyNonAVC::VideoTagBodyNonAVC(ByteReader& data)
 //////////////////////////////////////////////////////////////////////////
 //HEVC
 
-std::string GetHevcNaluTypeString(HevcNaluType type)
+const char* GetHevcNaluTypeString(HevcNaluType type)
 {
 	switch (type)
 	{
@@ -1783,10 +1974,7 @@ HevcNaluHeader::HevcNaluHeader(uint16_t b)
 	nuh_temporal_id_plus1_ = (b & 0x03);
 }
 
-std::shared_ptr<HevcNaluBase> HevcNaluBase::CurrentVps;
-std::shared_ptr<HevcNaluBase> HevcNaluBase::CurrentSps;
-std::shared_ptr<HevcNaluBase> HevcNaluBase::CurrentPps;
-std::shared_ptr<HevcNaluBase> HevcNaluBase::Create(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output)
+std::unique_ptr<HevcNaluBase> HevcNaluBase::Create(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output)
 {
 	if (data.RemainingSize() < nalu_size || nalu_size <= 2) {
 		printf("data remaining size %d, nalu size %d\n", data.RemainingSize(), nalu_size);
@@ -1797,7 +1985,7 @@ std::shared_ptr<HevcNaluBase> HevcNaluBase::Create(ByteReader& data, uint32_t na
 	ByteReader nalu_data(data.CurrentPos(), nalu_size);
 	data.ReadBytes(nalu_size);
 
-	std::shared_ptr<HevcNaluBase> nalu;
+	std::unique_ptr<HevcNaluBase> nalu;
 	HevcNaluHeader nalu_header((uint16_t)BytesToInt(nalu_data.CurrentPos(), 2)); //just peek 2 bytes
 	switch (nalu_header.nal_unit_type_)
 	{
@@ -1818,26 +2006,35 @@ std::shared_ptr<HevcNaluBase> HevcNaluBase::Create(ByteReader& data, uint32_t na
 	case HevcNaluTypeCodedSliceIDR:
 	case HevcNaluTypeCodedSliceIDRNLP:
 	case HevcNaluTypeCodedSliceCRA:
-		nalu = std::make_shared<HevcNaluSlice>(nalu_data, nalu_size, demux_output);
+		nalu.reset(new HevcNaluSlice(nalu_data, nalu_size, demux_output));
 		break;
 	case HevcNaluTypeVPS:
-		nalu = std::make_shared<HevcNaluVps>(nalu_data, nalu_size, demux_output);
-		CurrentVps = nalu;
+	{
+		HevcNaluVps* vps = new HevcNaluVps(nalu_data, nalu_size, demux_output);
+		ParserState::Current().hevc_vps = vps->vps_;
+		nalu.reset(vps);
 		break;
+	}
 	case HevcNaluTypeSPS:
-		nalu = std::make_shared<HevcNaluSps>(nalu_data, nalu_size, demux_output);
-		CurrentSps = nalu;
+	{
+		HevcNaluSps* sps = new HevcNaluSps(nalu_data, nalu_size, demux_output);
+		ParserState::Current().hevc_sps = sps->sps_;
+		nalu.reset(sps);
 		break;
+	}
 	case HevcNaluTypePPS:
-		nalu = std::make_shared<HevcNaluPps>(nalu_data, nalu_size, demux_output);
-		CurrentPps = nalu;
+	{
+		HevcNaluPps* pps = new HevcNaluPps(nalu_data, nalu_size, demux_output);
+		ParserState::Current().hevc_pps = pps->pps_;
+		nalu.reset(pps);
 		break;
+	}
 	case HevcNaluTypeSEI:
 	case HevcNaluTypeSEISuffix:
-		nalu = std::make_shared<HevcNaluSEI>(nalu_data, nalu_size, demux_output);
+		nalu.reset(new HevcNaluSEI(nalu_data, nalu_size, demux_output));
 		break;
 	default:
-		nalu = std::make_shared<HevcNaluBase>(nalu_data, nalu_size, demux_output);
+		nalu.reset(new HevcNaluBase(nalu_data, nalu_size, demux_output));
 		break;
 	}
 
@@ -1853,6 +2050,7 @@ std::shared_ptr<HevcNaluBase> HevcNaluBase::Create(ByteReader& data, uint32_t na
 HevcNaluBase::HevcNaluBase(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output)
 {
 	nalu_size_ = nalu_size;
+	data_start_ = data.CurrentPos();
 	if (data.RemainingSize() < nalu_size_)
 	{
 		data.ReadBytes(data.RemainingSize());
@@ -1860,7 +2058,7 @@ HevcNaluBase::HevcNaluBase(ByteReader& data, uint32_t nalu_size, const std::shar
 	}
 
 	//parse nalu header
-	nalu_header_ = std::make_shared<HevcNaluHeader>((uint16_t)BytesToInt(data.CurrentPos(), 2));
+	nalu_header_.reset(new HevcNaluHeader((uint16_t)BytesToInt(data.CurrentPos(), 2)));
 
 	if (demux_output)
 	{
@@ -1872,8 +2070,7 @@ HevcNaluBase::HevcNaluBase(ByteReader& data, uint32_t nalu_size, const std::shar
 		// 	PRINT_MEM(type.c_str(), data.CurrentPos(), nalu_size_);
 		// }
 		static const uint8_t start_code[] = { 0x00, 0x00, 0x00, 0x01 };
-		demux_output->OnVideoNaluData(start_code, 4);
-		demux_output->OnVideoNaluData(data.CurrentPos(), nalu_size_);
+		demux_output->OnVideoNaluData(start_code, 4, data.CurrentPos(), nalu_size_);
 	}
 
 	//allocate memory and transfer nal to rbsp
@@ -1909,11 +2106,6 @@ void HevcNaluBase::ReleaseRbsp()
 	}
 }
 
-std::string HevcNaluBase::CompleteInfo()
-{
-	return "";
-}
-
 int HevcNaluBase::TagSerialBelong()
 {
 	return tag_serial_belong_;
@@ -1931,9 +2123,7 @@ uint8_t HevcNaluBase::NalRefIdc()
 
 std::string HevcNaluBase::NalUnitType()
 {
-	if (nalu_header_)
-		return GetHevcNaluTypeString(nalu_header_->nal_unit_type_);
-	return STRING_UNKNOWN;
+	return NalUnitTypeName();
 }
 
 int8_t HevcNaluBase::FirstMbInSlice()
@@ -1943,7 +2133,7 @@ int8_t HevcNaluBase::FirstMbInSlice()
 
 std::string HevcNaluBase::SliceType()
 {
-	return "";
+	return SliceTypeName();
 }
 
 int HevcNaluBase::PicParameterSetId()
@@ -1972,6 +2162,43 @@ int HevcNaluBase::SliceQpDelta()
 }
 
 std::string HevcNaluBase::ExtraInfo()
+{
+	JsonValueVisitor visitor;
+	if (!VisitExtraInfo(visitor, NULL))
+		return "";
+	return visitor.Root().toStyledString();
+}
+
+bool HevcNaluBase::VisitExtraInfo(SyntaxVisitor& visitor, const char* key)
+{
+	return false;
+}
+
+uint8_t HevcNaluBase::CodecId()
+{
+	return FlvVideoCodeIDHEVC;
+}
+
+int HevcNaluBase::NalUnitTypeId()
+{
+	if (nalu_header_)
+		return nalu_header_->nal_unit_type_;
+	return HevcNaluTypeUnknown;
+}
+
+const char* HevcNaluBase::NalUnitTypeName()
+{
+	if (nalu_header_)
+		return GetHevcNaluTypeString(nalu_header_->nal_unit_type_);
+	return STRING_UNKNOWN;
+}
+
+int HevcNaluBase::SliceTypeId()
+{
+	return -1;
+}
+
+const char* HevcNaluBase::SliceTypeName()
 {
 	return "";
 }
@@ -1993,21 +2220,14 @@ HevcNaluVps::HevcNaluVps(ByteReader& data, uint32_t nalu_len_size, const std::sh
 	is_good_ = true;
 }
 
-std::string HevcNaluVps::CompleteInfo()
+bool HevcNaluVps::VisitExtraInfo(SyntaxVisitor& visitor, const char* key)
 {
-	Json::Value json_nalu;
-	Json::Reader reader;
-	reader.parse(HevcNaluBase::CompleteInfo(), json_nalu);
-	if (vps_)
-		json_nalu["vps"] = hevc_vps_to_json(vps_.get());
-	return json_nalu.toStyledString();
-}
-
-std::string HevcNaluVps::ExtraInfo()
-{
-	if (vps_)
-		return hevc_vps_to_json(vps_.get()).toStyledString();
-	return "";
+	if (!vps_)
+		return false;
+	visitor.BeginObject(key);
+	visit_hevc_vps(vps_.get(), visitor);
+	visitor.EndObject();
+	return true;
 }
 
 HevcNaluSps::HevcNaluSps(ByteReader& data, uint32_t nalu_len_size, const std::shared_ptr<DemuxInterface>& demux_output)
@@ -2027,21 +2247,14 @@ HevcNaluSps::HevcNaluSps(ByteReader& data, uint32_t nalu_len_size, const std::sh
 	is_good_ = true;
 }
 
-std::string HevcNaluSps::CompleteInfo()
+bool HevcNaluSps::VisitExtraInfo(SyntaxVisitor& visitor, const char* key)
 {
-	Json::Value json_nalu;
-	Json::Reader reader;
-	reader.parse(HevcNaluBase::CompleteInfo(), json_nalu);
-	if (sps_)
-		json_nalu["sps"] = hevc_sps_to_json(sps_.get());
-	return json_nalu.toStyledString();
-}
-
-std::string HevcNaluSps::ExtraInfo()
-{
-	if (sps_)
-		return hevc_sps_to_json(sps_.get()).toStyledString();
-	return "";
+	if (!sps_)
+		return false;
+	visitor.BeginObject(key);
+	visit_hevc_sps(sps_.get(), visitor);
+	visitor.EndObject();
+	return true;
 }
 
 HevcNaluPps::HevcNaluPps(ByteReader& data, uint32_t nalu_len_size, const std::shared_ptr<DemuxInterface>& demux_output)
@@ -2061,21 +2274,14 @@ HevcNaluPps::HevcNaluPps(ByteReader& data, uint32_t nalu_len_size, const std::sh
 	is_good_ = true;
 }
 
-std::string HevcNaluPps::CompleteInfo()
+bool HevcNaluPps::VisitExtraInfo(SyntaxVisitor& visitor, const char* key)
 {
-	Json::Value json_nalu;
-	Json::Reader reader;
-	reader.parse(HevcNaluBase::CompleteInfo(), json_nalu);
-	if (pps_)
-		json_nalu["pps"] = hevc_pps_to_json(pps_.get());
-	return json_nalu.toStyledString();
-}
-
-std::string HevcNaluPps::ExtraInfo()
-{
-	if (pps_)
-		return hevc_pps_to_json(pps_.get()).toStyledString();
-	return "";
+	if (!pps_)
+		return false;
+	visitor.BeginObject(key);
+	visit_hevc_pps(pps_.get(), visitor);
+	visitor.EndObject();
+	return true;
 }
 
 HevcNaluSEI::HevcNaluSEI(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output)
@@ -2118,16 +2324,19 @@ HevcNaluSEI::~HevcNaluSEI()
 	}
 }
 
-std::string HevcNaluSEI::CompleteInfo()
+bool HevcNaluSEI::VisitExtraInfo(SyntaxVisitor& visitor, const char* key)
 {
-	return ExtraInfo();
-}
-
-std::string HevcNaluSEI::ExtraInfo()
-{
-	Json::Value extra_info;
-	extra_info["seis"] = hevc_seis_to_json(seis_, sei_num_);
-	return extra_info.toStyledString();
+	visitor.BeginObject(key);
+	if (!seis_ || !sei_num_)
+		visitor.Null("seis");
+	else
+	{
+		visitor.BeginArray("seis");
+		visit_hevc_seis(seis_, sei_num_, visitor);
+		visitor.EndArray();
+	}
+	visitor.EndObject();
+	return true;
 }
 
 HevcNaluSlice::HevcNaluSlice(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output)
@@ -2137,16 +2346,17 @@ HevcNaluSlice::HevcNaluSlice(ByteReader& data, uint32_t nalu_size, const std::sh
 		return;
 	is_good_ = false;
 
-	HevcNaluSps* current_sps = (HevcNaluSps*)HevcNaluBase::CurrentSps.get();
-	HevcNaluPps* current_pps = (HevcNaluPps*)HevcNaluBase::CurrentPps.get();
-	if (!current_sps || !current_pps) {
+	ParserState& state = ParserState::Current();
+	if (!state.hevc_sps || !state.hevc_pps) {
 		return;
 	}
 
-	slice_header_ = std::make_shared<hevc_slice_header_t>();
+	sps_ = state.hevc_sps;
+	pps_ = state.hevc_pps;
+	slice_header_.reset(new hevc_slice_header_t());
 	memset(slice_header_.get(), 0, sizeof(hevc_slice_header_t));
 	BitReader rbsp_data(rbsp_, rbsp_size_);
-	hevc_slice_segment_header(slice_header_.get(), rbsp_data, nalu_header_->nal_unit_type_, current_sps->sps_.get(), current_pps->pps_.get());
+	hevc_slice_segment_header(slice_header_.get(), rbsp_data, nalu_header_->nal_unit_type_, sps_.get(), pps_.get());
 	if (slice_header_->first_slice_segment_in_pic_flag == 0)
 	{
 		printf("Warning: multi-slice!\n");
@@ -2155,28 +2365,6 @@ HevcNaluSlice::HevcNaluSlice(ByteReader& data, uint32_t nalu_size, const std::sh
 	is_good_ = true;
 }
 
-std::string HevcNaluSlice::CompleteInfo() 
-{
-	Json::Value json_nalu;
-	Json::Reader reader;
-	reader.parse(HevcNaluBase::CompleteInfo(), json_nalu);
-	Json::Value json_slice_header = SliceHeaderToJson();
-	if (!json_slice_header.empty()) {
-		json_nalu["slice_header"] = json_slice_header;
-	}
-	return json_nalu.toStyledString();
-}
-
-Json::Value HevcNaluSlice::SliceHeaderToJson() {
-	HevcNaluSps* current_sps = (HevcNaluSps*)HevcNaluBase::CurrentSps.get();
-	HevcNaluPps* current_pps = (HevcNaluPps*)HevcNaluBase::CurrentPps.get();
-	if (slice_header_ && current_sps && current_pps) {
-		return hevc_slice_segment_header_to_json(slice_header_.get(), nalu_header_->nal_unit_type_, 
-			current_sps->sps_.get(), current_pps->pps_.get());
-	}
-	return Json::Value();
-}
-
 int8_t HevcNaluSlice::FirstMbInSlice() 
 {
 	if (slice_header_)
@@ -2184,10 +2372,24 @@ int8_t HevcNaluSlice::FirstMbInSlice()
 	return HevcNaluBase::FirstMbInSlice();
 }
 
-std::string HevcNaluSlice::SliceType() 
+int HevcNaluSlice::SliceTypeId() 
+{
+	if (slice_header_)
+		return slice_header_->slice_type;
+	return HevcNaluBase::SliceTypeId();
+}
+
+const char* HevcNaluSlice::SliceTypeName() 
 {
 	if (slice_header_)
 		return hevc_slice_type_string(slice_header_->slice_type);
+	return HevcNaluBase::SliceTypeName();
+}
+
+std::string HevcNaluSlice::SliceType()
+{
+	if (slice_header_ && (slice_header_->slice_type < 0 || slice_header_->slice_type >= 3))
+		return std::string("Unknown_") + std::to_string(slice_header_->slice_type);
 	return HevcNaluBase::SliceType();
 }
 
@@ -2222,13 +2424,15 @@ int HevcNaluSlice::SliceQpDelta()
 	return HevcNaluBase::SliceQpDelta();
 }
 
-std::string HevcNaluSlice::ExtraInfo() 
+bool HevcNaluSlice::VisitExtraInfo(SyntaxVisitor& visitor, const char* key)
 {
-	auto json = SliceHeaderToJson();
-	if (nalu_header_) {
-		json["nuh_temporal_id_plus1"] = nalu_header_->nuh_temporal_id_plus1_;
-	}
-	return json.toStyledString();
+	visitor.BeginObject(key);
+	if (slice_header_)
+		visit_hevc_slice_segment_header(slice_header_.get(), nalu_header_->nal_unit_type_, sps_.get(), pps_.get(), visitor);
+	if (nalu_header_)
+		visitor.Field("nuh_temporal_id_plus1", nalu_header_->nuh_temporal_id_plus1_);
+	visitor.EndObject();
+	return true;
 }
 
 VideoTagBodyHEVCNalu::VideoTagBodyHEVCNalu(ByteReader& data, const std::shared_ptr<DemuxInterface>& demux_output)
@@ -2267,12 +2471,12 @@ VideoTagBodyHEVCNalu::VideoTagBodyHEVCNalu(ByteReader& data, const std::shared_p
 			}
 		}
 
-		std::shared_ptr<HevcNaluBase> nalu = HevcNaluBase::Create(data, nalu_size, demux_output);
+		std::unique_ptr<HevcNaluBase> nalu = HevcNaluBase::Create(data, nalu_size, demux_output);
 		if (!nalu)
 			break;
 		else if (!nalu->IsGood())
 			continue;
-		nalu_list_.push_back(nalu);
+		nalu_list_.push_back(std::move(nalu));
 	}
 	if (nalu_list_.empty())
 		return;
@@ -2287,15 +2491,16 @@ void VideoTagBodyHEVCNalu::SetTagSerial(int tag_serial)
 		item->SetTagSerialBelong(tag_serial);
 }
 
-NaluList VideoTagBodyHEVCNalu::EnumNalus()
+void VideoTagBodyHEVCNalu::SetNaluOffsets(const uint8_t* buffer_start, uint64_t buffer_offset)
 {
-	NaluList list(nalu_list_.begin(), nalu_list_.end());
-	return list;
+	for (const auto& item : nalu_list_)
+		item->SetOffset(buffer_start, buffer_offset);
 }
 
-std::string VideoTagBodyHEVCNalu::GetExtraInfo()
+void VideoTagBodyHEVCNalu::EnumNalus(NaluList& nalus)
 {
-	return "";
+	for (const auto& item : nalu_list_)
+		nalus.push_back(item.get());
 }
 
 HEVCDecoderConfigurationRecord::HEVCDecoderConfigurationRecord(ByteReader& data, const std::shared_ptr<DemuxInterface>& demux_output)
@@ -2332,9 +2537,9 @@ HEVCDecoderConfigurationRecord::HEVCDecoderConfigurationRecord(ByteReader& data,
 		for (int j = 0; j < nalu_count; j++)
 		{
 			uint32_t nalu_size = (uint32_t)BytesToInt(data.ReadBytes(2), 2);
-			std::shared_ptr<HevcNaluBase> nalu = HevcNaluBase::Create(data, nalu_size, demux_output);
+			std::unique_ptr<HevcNaluBase> nalu = HevcNaluBase::Create(data, nalu_size, demux_output);
 			if (nalu)
-				nalu_list_.push_back(nalu);
+				nalu_list_.push_back(std::move(nalu));
 		}
 	}
 	if (nalu_list_.empty())
@@ -2348,7 +2553,7 @@ VideoTagBodyVpsSpsPps::VideoTagBodyVpsSpsPps(ByteReader& data, const std::shared
 	if (data.RemainingSize() < 3)
 		return;
 	cts_ = (uint32_t)BytesToInt(data.ReadBytes(3), 3);
-	hevc_config_ = std::make_shared<HEVCDecoderConfigurationRecord>(data, demux_output);
+	hevc_config_.reset(new HEVCDecoderConfigurationRecord(data, demux_output));
 	if (!hevc_config_ || !hevc_config_->is_good_)
 		return;
 
@@ -2365,9 +2570,20 @@ void VideoTagBodyVpsSpsPps::SetTagSerial(int tag_serial)
 	}
 }
 
-NaluList VideoTagBodyVpsSpsPps::EnumNalus()
+void VideoTagBodyVpsSpsPps::SetNaluOffsets(const uint8_t* buffer_start, uint64_t buffer_offset)
+{
+	if (hevc_config_)
+	{
+		for (const auto& item : hevc_config_->nalu_list_)
+			item->SetOffset(buffer_start, buffer_offset);
+	}
+}
+
+void VideoTagBodyVpsSpsPps::EnumNalus(NaluList& nalus)
 {
 	if (hevc_config_)
-		return NaluList(hevc_config_->nalu_list_.begin(), hevc_config_->nalu_list_.end());
-	return NaluList();
+	{
+		for (const auto& item : hevc_config_->nalu_list_)
+			nalus.push_back(item.get());
+	}
 }
@@ -11,8 +11,51 @@
 #include "json/value.h"
 #include <memory>
 #include <list>
+#include <vector>
 
-typedef std::list<std::shared_ptr<NaluInterface> > NaluList;
+#define FLV_HEADER_SIZE           9
+#define PREVIOUS_TAG_SIZE_SIZE    4
+#define FLV_TAG_HEADER_SIZE       11
+#define FLV_VIDEO_TAG_HEADER_SIZE 5
+#define FLV_AUDIO_TAG_HEADER_SIZE 1
+
+typedef std::vector<NaluInterface*> NaluList; //non-owning, valid as long as the tag owning the nalus is alive
+
+struct AudioSpecificConfig;
+
+//The state the parser keeps across tags: the last timestamps and the active parameter sets.
+//The tags and nalus are decoded with the current state of the thread, which is a state of the thread itself unless
+//a ParserStateScope installs another one, so each FlvReader keeps its own and several of them can be interleaved.
+struct ParserState
+{
+	uint32_t last_tag_timestamp = 0;
+	uint32_t last_video_dts = 0;
+	uint32_t last_audio_dts = 0;
+	std::shared_ptr<AudioSpecificConfig> audio_config;
+	std::shared_ptr<sps_t> sps;
+	std::shared_ptr<pps_t> pps;
+	std::shared_ptr<hevc_vps_t> hevc_vps;
+	std::shared_ptr<hevc_sps_t> hevc_sps;
+	std::shared_ptr<hevc_pps_t> hevc_pps;
+
+	static ParserState& Current();
+};
+
+//Make a state the current one of the thread for its lifetime, the former one is current again after it.
+class ParserStateScope
+{
+public:
+	ParserStateScope(ParserState& state);
+	~ParserStateScope();
+
+private:
+	ParserStateScope(const ParserStateScope&);
+	ParserStateScope& operator=(const ParserStateScope&);
+	ParserState* previous_;
+};
+
+//Reset the current state before a new input.
+void ResetParserState();
 
 //////////////////////////////////////////////////////////////////////////
 // Flv Header
@@ -49,13 +92,12 @@ enum FlvTagType
 	FlvTagTypeScriptData = 18,
 };
 
-std::string GetFlvTagTypeString(FlvTagType type);
+const char* GetFlvTagTypeString(FlvTagType type);
 
 struct FlvTagHeader
 {
 	FlvTagHeader(ByteReader& data);
 	~FlvTagHeader() = default;
-	static uint32_t LastTagTimestamp;
 
 	FlvTagType tag_type_;
 	uint32_t   tag_data_size_; //not including tag header size
@@ -67,15 +109,18 @@ struct FlvTagHeader
 class FlvTagData
 {
 public:
-	static std::shared_ptr<FlvTagData> Create(ByteReader& data, uint32_t tag_data_size, FlvTagType tag_type, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
+	static std::unique_ptr<FlvTagData> Create(ByteReader& data, uint32_t tag_data_size, FlvTagType tag_type, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
 	virtual ~FlvTagData() {}
 	virtual bool IsGood() { return is_good_; }
 	virtual void SetTagSerial(int tag_serial) {}
+	virtual void SetNaluOffsets(const uint8_t* buffer_start, uint64_t buffer_offset) {}
 	virtual uint32_t GetCts() { return 0; }
-	virtual std::string GetSubTypeString() { return ""; }
-	virtual std::string GetFormatString() { return ""; }
-	virtual std::string GetExtraInfo() { return ""; }
-	virtual NaluList EnumNalus() { return NaluList(); }
+	virtual int GetSubTypeId() { return -1; }
+	virtual const char* GetSubTypeName() { return ""; }
+	virtual int GetFormatId() { return -1; }
+	virtual const char* GetFormatName() { return ""; }
+	virtual bool VisitExtraInfo(SyntaxVisitor& visitor, const char* key) { return false; }
+	virtual void EnumNalus(NaluList& nalus) {}
 
 protected:
 	FlvTagData() {}
@@ -87,9 +132,9 @@ protected:
 class FlvTag : public FlvTagInterface
 {
 public:
-	FlvTag(ByteReader& data, int tag_serial, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
+	FlvTag(ByteReader& data, int tag_serial, uint64_t offset, const std::shared_ptr<DemuxInterface>& demux_output = NULL); //offset of data in the input
 	bool IsGood() { return is_good_; }
-	NaluList EnumNalus();
+	void EnumNalus(NaluList& nalus); //append the nalus of this tag
 
 	//implement FlvTagInterface
 	virtual int Serial() override;
@@ -103,16 +148,23 @@ public:
 	virtual std::string SubType() override;
 	virtual std::string Format() override;
 	virtual std::string ExtraInfo() override;
+	virtual uint8_t TagTypeId() override;
+	virtual const char* TagTypeName() override;
+	virtual int SubTypeId() override;
+	virtual const char* SubTypeName() override;
+	virtual int FormatId() override;
+	virtual const char* FormatName() override;
+	virtual uint64_t Offset() override { return offset_; }
+	virtual bool VisitExtraInfo(SyntaxVisitor& visitor, const char* key) override;
 
 private:
 	int tag_serial_ = -1;
+	uint64_t offset_ = 0;
 	uint32_t previous_tag_size_ = 0;
-	std::shared_ptr<FlvTagHeader> tag_header_;
-	std::shared_ptr<FlvTagData> tag_data_;
+	int dts_diff_ = 0; //calculated while parsing, so that every output gets the same value
+	std::unique_ptr<FlvTagHeader> tag_header_;
+	std::unique_ptr<FlvTagData> tag_data_;
 	bool is_good_ = false;
-
-	static uint32_t LastVideoDts;
-	static uint32_t LastAudioDts;
 };
 
 
@@ -125,7 +177,7 @@ class FlvTagDataScript : public FlvTagData
 public:
 	FlvTagDataScript(ByteReader& data);
 	~FlvTagDataScript() {}
-	virtual std::string GetExtraInfo() override;
+	virtual bool VisitExtraInfo(SyntaxVisitor& visitor, const char* key) override;
 
 private:
 	static void DecodeAMF(const AMFObject* amf, Json::Value& json);
@@ -182,11 +234,12 @@ enum AudioTagType
 	AudioTagTypeAACData   = 1
 };
 
-std::string GetAudioFormatString(AudioFormat fmt);
-std::string GetAudioSamplerateString(AudioSamplerate samplerate);
-std::string GetAudioSampleWidthString(AudioSampleWidth sample_width);
-std::string GetAudioChannelNumString(AudioChannelNum channel_num);
-std::string GetAudioTagTypeString(AudioTagType type);
+const char* GetAudioFormatString(AudioFormat fmt);
+const char* GetAudioSamplerateString(AudioSamplerate samplerate);
+const char* GetAudioSampleWidthString(AudioSampleWidth sample_width);
+const char* GetAudioChannelNumString(AudioChannelNum channel_num);
+const char* GetAudioTagTypeString(AudioTagType type);
+const char* GetAudioTagFormatString(uint8_t sound_flags); //"format | samplerate | sample width | channels" of the first audio tag data byte
 
 struct AudioTagHeader
 {
@@ -204,10 +257,10 @@ struct AudioSpecificConfig;
 class AudioTagBody
 {
 public:
-	static std::shared_ptr<AudioTagBody> Create(ByteReader& data, AudioFormat audio_format, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
+	static std::unique_ptr<AudioTagBody> Create(ByteReader& data, AudioFormat audio_format, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
 	virtual ~AudioTagBody() {}
 	virtual bool IsGood() { return is_good_; }
-	virtual std::string GetExtraInfo() { return ""; }
+	virtual bool VisitExtraInfo(SyntaxVisitor& visitor, const char* key) { return false; }
 	AudioTagType GetAudioTagType() { return audio_tag_type_; }
 
 protected:
@@ -216,7 +269,6 @@ protected:
 protected:
 	bool is_good_ = false;
 	AudioTagType audio_tag_type_;
-	static std::shared_ptr<AudioSpecificConfig> CurrentAudioConfig;
 };
 
 enum MPEG4AudioObjectType 
@@ -304,14 +356,14 @@ struct AudioSpecificConfig
 	bool    is_good_;
 
 	AudioSpecificConfig(ByteReader& data);
-	std::string Serialize();
+	void VisitFields(SyntaxVisitor& visitor);
 };
 
 class AudioTagBodyAACConfig : public AudioTagBody
 {
 public:
 	AudioTagBodyAACConfig(ByteReader& data, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
-	virtual std::string GetExtraInfo() override;
+	virtual bool VisitExtraInfo(SyntaxVisitor& visitor, const char* key) override;
 
 private:
 	std::shared_ptr<AudioSpecificConfig> aac_config_;
@@ -334,13 +386,15 @@ class FlvTagDataAudio : public FlvTagData
 public:
 	FlvTagDataAudio(ByteReader& data, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
 
-	virtual std::string GetSubTypeString() override;
-	virtual std::string GetFormatString() override;
-	virtual std::string GetExtraInfo() override;
+	virtual int GetSubTypeId() override;
+	virtual const char* GetSubTypeName() override;
+	virtual int GetFormatId() override;
+	virtual const char* GetFormatName() override;
+	virtual bool VisitExtraInfo(SyntaxVisitor& visitor, const char* key) override;
 
 private:
-	std::shared_ptr<AudioTagHeader> audio_tag_header_;
-	std::shared_ptr<AudioTagBody> audio_tag_body_;
+	std::unique_ptr<AudioTagHeader> audio_tag_header_;
+	std::unique_ptr<AudioTagBody> audio_tag_body_;
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -367,8 +421,9 @@ enum FlvVideoCodecID
 	FlvVideoCodeIDHEVC              = 12, //HEVC
 };
 
-std::string GetFlvVideoFrameTypeString(FlvVideoFrameType type);
-std::string GetFlvVideoCodecIDString(FlvVideoCodecID id);
+const char* GetFlvVideoFrameTypeString(FlvVideoFrameType type);
+const char* GetFlvVideoCodecIDString(FlvVideoCodecID id);
+const char* GetVideoTagFormatString(uint8_t video_flags); //"frame type | codec id" of the first video tag data byte
 
 struct VideoTagHeader
 {
@@ -387,19 +442,20 @@ enum VideoTagType
 	VideoTagTypeAVCSequenceEnd      = 2,  //AVC end of sequence (lower level Nalu sequence ender is not required or supported)
 };
 
-std::string GetVideoTagTypeString(VideoTagType type, FlvVideoCodecID codec_id);
+const char* GetVideoTagTypeString(VideoTagType type, FlvVideoCodecID codec_id);
 
 class VideoTagBody
 {
 public:
-	static std::shared_ptr<VideoTagBody> Create(ByteReader& data, FlvVideoCodecID codec_id, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
+	static std::unique_ptr<VideoTagBody> Create(ByteReader& data, FlvVideoCodecID codec_id, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
 	virtual ~VideoTagBody() {}
 	virtual bool IsGood() { return is_good_; }
 	virtual void SetTagSerial(int tag_serial) {}
+	virtual void SetNaluOffsets(const uint8_t* buffer_start, uint64_t buffer_offset) {}
 	virtual uint32_t GetCts() { return 0; }
 	virtual VideoTagType GetVideoTagType() { return video_tag_type_; }
-	virtual NaluList EnumNalus() { return NaluList(); }
-	virtual std::string GetExtraInfo() { return ""; }
+	virtual void EnumNalus(NaluList& nalus) {}
+	virtual bool VisitExtraInfo(SyntaxVisitor& visitor, const char* key) { return false; }
 
 protected:
 	VideoTagBody() = default;
@@ -409,7 +465,7 @@ protected:
 	VideoTagType video_tag_type_;
 };
 
-std::string GetNaluTypeString(NaluType type);
+const char* GetNaluTypeString(NaluType type);
 
 struct NaluHeader
 {
@@ -422,15 +478,17 @@ struct NaluHeader
 class NaluBase : public NaluInterface
 {
 public:
-	static std::shared_ptr<NaluBase> Create(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
+	static std::unique_ptr<NaluBase> Create(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
 	NaluBase(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
 	virtual ~NaluBase();
 	bool IsGood() { return is_good_; }
 	bool IsNoBother() { return no_bother; }
 	void ReleaseRbsp();
 	void SetTagSerialBelong(int tag_serial_belong) { tag_serial_belong_ = tag_serial_belong; }
-	const std::shared_ptr<NaluHeader>& GetNaluHeader() { return nalu_header_; }
-	virtual std::string CompleteInfo();
+	//the nalu was parsed from a buffer holding the input from buffer_offset, must be called before the buffer is released
+	void SetOffset(const uint8_t* buffer_start, uint64_t buffer_offset) { offset_ = buffer_offset + (data_start_ - buffer_start); }
+	NaluHeader* GetNaluHeader() { return nalu_header_.get(); }
+	virtual void VisitCompleteInfo(SyntaxVisitor& visitor); //the header and the detail of the nalu, as the fields of the current object
 
 	virtual int TagSerialBelong() override;
 	virtual uint32_t NaluSize() override;
@@ -444,15 +502,20 @@ public:
 	virtual int PicOrderCntLsb() override;
 	virtual int SliceQpDelta() override;
 	virtual std::string ExtraInfo() override;
-
-public:
-	static std::shared_ptr<NaluBase> CurrentSps;
-	static std::shared_ptr<NaluBase> CurrentPps;
+	virtual uint8_t CodecId() override;
+	virtual int NalUnitTypeId() override;
+	virtual const char* NalUnitTypeName() override;
+	virtual int SliceTypeId() override;
+	virtual const char* SliceTypeName() override;
+	virtual uint64_t Offset() override { return offset_; }
+	virtual bool VisitExtraInfo(SyntaxVisitor& visitor, const char* key) override;
 
 protected:
 	int tag_serial_belong_ = -1;
 	uint32_t nalu_size_ = 0;
-	std::shared_ptr<NaluHeader> nalu_header_;
+	const uint8_t* data_start_ = NULL; //only used to locate the nalu while its buffer is alive
+	uint64_t offset_ = 0;
+	std::unique_ptr<NaluHeader> nalu_header_;
 	uint8_t *rbsp_ = NULL;
 	uint32_t rbsp_size_ = 0;
 	bool is_good_ = false;
@@ -465,8 +528,8 @@ public:
 	NaluSps(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
 	std::shared_ptr<sps_t> sps_;
 
-	virtual std::string CompleteInfo() override;
-	virtual std::string ExtraInfo() override;
+	virtual void VisitCompleteInfo(SyntaxVisitor& visitor) override;
+	virtual bool VisitExtraInfo(SyntaxVisitor& visitor, const char* key) override;
 };
 
 class NaluPps : public NaluBase
@@ -475,8 +538,8 @@ public:
 	NaluPps(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
 	std::shared_ptr<pps_t> pps_;
 
-	virtual std::string CompleteInfo() override;
-	virtual std::string ExtraInfo() override;
+	virtual void VisitCompleteInfo(SyntaxVisitor& visitor) override;
+	virtual bool VisitExtraInfo(SyntaxVisitor& visitor, const char* key) override;
 };
 
 class NaluSlice : public NaluBase
@@ -484,18 +547,19 @@ class NaluSlice : public NaluBase
 public:
 	NaluSlice(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
 
-	virtual std::string CompleteInfo() override;
+	virtual void VisitCompleteInfo(SyntaxVisitor& visitor) override;
 	virtual int8_t FirstMbInSlice() override;
-	virtual std::string SliceType() override;
 	virtual int PicParameterSetId() override;
 	virtual int FrameNum() override;
 	virtual int FieldPicFlag() override;
 	virtual int PicOrderCntLsb() override;
 	virtual int SliceQpDelta() override;
-	virtual std::string ExtraInfo() override;
+	virtual bool VisitExtraInfo(SyntaxVisitor& visitor, const char* key) override;
+	virtual int SliceTypeId() override;
+	virtual const char* SliceTypeName() override;
 
 private:
-	std::shared_ptr<slice_header_t> slice_header_;
+	std::unique_ptr<slice_header_t> slice_header_;
 };
 
 class NaluSEI : public NaluBase
@@ -504,8 +568,8 @@ public:
 	NaluSEI(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
 	~NaluSEI();
 
-	virtual std::string CompleteInfo() override;
-	virtual std::string ExtraInfo() override;
+	virtual void VisitCompleteInfo(SyntaxVisitor& visitor) override;
+	virtual bool VisitExtraInfo(SyntaxVisitor& visitor, const char* key) override;
 
 private:
 	sei_t**  seis_ = NULL;
@@ -518,13 +582,14 @@ public:
 	VideoTagBodyAVCNalu(ByteReader& data, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
 	~VideoTagBodyAVCNalu() {}
 	virtual void SetTagSerial(int tag_serial) override;
+	virtual void SetNaluOffsets(const uint8_t* buffer_start, uint64_t buffer_offset) override;
 	virtual uint32_t GetCts() override { return cts_; }
-	virtual NaluList EnumNalus() override;
-	virtual std::string GetExtraInfo() override;
+	virtual void EnumNalus(NaluList& nalus) override;
+	virtual bool VisitExtraInfo(SyntaxVisitor& visitor, const char* key) override;
 
 private:
 	uint32_t cts_ = 0;
-	std::list<std::shared_ptr<NaluBase> > nalu_list_;
+	std::vector<std::unique_ptr<NaluBase> > nalu_list_;
 };
 
 struct AVCDecoderConfigurationRecord
@@ -535,9 +600,9 @@ struct AVCDecoderConfigurationRecord
 	uint8_t  AVCLevelIndication;
 	uint8_t  lengthSizeMinusOne;
 	uint8_t  numOfSequenceParameterSets;
-	std::shared_ptr<NaluBase> sps_nal_;
+	std::unique_ptr<NaluBase> sps_nal_;
 	uint8_t  numOfPictureParameterSets;
-	std::shared_ptr<NaluBase> pps_nal_;
+	std::unique_ptr<NaluBase> pps_nal_;
 	bool is_good_;
 
 	AVCDecoderConfigurationRecord(ByteReader& data, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
@@ -549,13 +614,14 @@ public:
 	VideoTagBodySpsPps(ByteReader& data, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
 	~VideoTagBodySpsPps() {}
 	virtual void SetTagSerial(int tag_serial) override;
+	virtual void SetNaluOffsets(const uint8_t* buffer_start, uint64_t buffer_offset) override;
 	virtual uint32_t GetCts() override { return cts_; }
-	virtual NaluList EnumNalus() override;
-	virtual std::string GetExtraInfo() override;
+	virtual void EnumNalus(NaluList& nalus) override;
+	virtual bool VisitExtraInfo(SyntaxVisitor& visitor, const char* key) override;
 
 private:
 	uint32_t cts_ = 0;
-	std::shared_ptr<AVCDecoderConfigurationRecord> avc_config_;
+	std::unique_ptr<AVCDecoderConfigurationRecord> avc_config_;
 };
 
 class VideoTagBodySequenceEnd : public VideoTagBody
@@ -581,15 +647,18 @@ public:
 	~FlvTagDataVideo() {}
 
 	virtual void SetTagSerial(int tag_serial) override;
+	virtual void SetNaluOffsets(const uint8_t* buffer_start, uint64_t buffer_offset) override;
 	virtual uint32_t GetCts() override;
-	virtual std::string GetSubTypeString() override;
-	virtual std::string GetFormatString() override;
-	virtual std::string GetExtraInfo() override;
-	virtual NaluList EnumNalus() override;
+	virtual int GetSubTypeId() override;
+	virtual const char* GetSubTypeName() override;
+	virtual int GetFormatId() override;
+	virtual const char* GetFormatName() override;
+	virtual bool VisitExtraInfo(SyntaxVisitor& visitor, const char* key) override;
+	virtual void EnumNalus(NaluList& nalus) override;
 
 private:
-	std::shared_ptr<VideoTagHeader> video_tag_header_;
-	std::shared_ptr<VideoTagBody> video_tag_body_;
+	std::unique_ptr<VideoTagHeader> video_tag_header_;
+	std::unique_ptr<VideoTagBody> video_tag_body_;
 };
 
 
@@ -597,7 +666,7 @@ private:
 //////////////////////////////////////////////////////////////////////////
 //HEVC
 
-std::string GetHevcNaluTypeString(HevcNaluType type);
+const char* GetHevcNaluTypeString(HevcNaluType type);
 
 struct HevcNaluHeader
 {
@@ -609,14 +678,15 @@ struct HevcNaluHeader
 class HevcNaluBase : public NaluInterface
 {
 public:
-	static std::shared_ptr<HevcNaluBase> Create(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
+	static std::unique_ptr<HevcNaluBase> Create(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
 	HevcNaluBase(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
 	virtual ~HevcNaluBase() {}
 	bool IsGood() { return is_good_; }
 	void ReleaseRbsp();
 	void SetTagSerialBelong(int tag_serial_belong) { tag_serial_belong_ = tag_serial_belong; }
-	const std::shared_ptr<HevcNaluHeader>& GetHevcNaluHeader() { return nalu_header_; }
-	virtual std::string CompleteInfo();
+	//the nalu was parsed from a buffer holding the input from buffer_offset, must be called before the buffer is released
+	void SetOffset(const uint8_t* buffer_start, uint64_t buffer_offset) { offset_ = buffer_offset + (data_start_ - buffer_start); }
+	HevcNaluHeader* GetHevcNaluHeader() { return nalu_header_.get(); }
 
 	virtual int TagSerialBelong() override;
 	virtual uint32_t NaluSize() override;
@@ -630,6 +700,13 @@ public:
 	virtual int PicOrderCntLsb() override;
 	virtual int SliceQpDelta() override;
 	virtual std::string ExtraInfo() override;
+	virtual uint8_t CodecId() override;
+	virtual int NalUnitTypeId() override;
+	virtual const char* NalUnitTypeName() override;
+	virtual int SliceTypeId() override;
+	virtual const char* SliceTypeName() override;
+	virtual uint64_t Offset() override { return offset_; }
+	virtual bool VisitExtraInfo(SyntaxVisitor& visitor, const char* key) override;
 
 private:
 	//don't change ByteReader position, get the nalu type
@@ -638,14 +715,12 @@ private:
 protected:
 	int tag_serial_belong_ = -1;
 	uint32_t nalu_size_ = 0;
-	std::shared_ptr<HevcNaluHeader> nalu_header_;
+	const uint8_t* data_start_ = NULL; //only used to locate the nalu while its buffer is alive
+	uint64_t offset_ = 0;
+	std::unique_ptr<HevcNaluHeader> nalu_header_;
 	bool is_good_ = false;
 	uint8_t *rbsp_ = NULL;
 	uint32_t rbsp_size_ = 0;
-	
-	static std::shared_ptr<HevcNaluBase> CurrentVps;
-	static std::shared_ptr<HevcNaluBase> CurrentSps;
-	static std::shared_ptr<HevcNaluBase> CurrentPps;
 };
 
 class HevcNaluSEI : public HevcNaluBase
@@ -654,8 +729,7 @@ public:
 	HevcNaluSEI(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
 	~HevcNaluSEI();
 
-	virtual std::string CompleteInfo() override;
-	virtual std::string ExtraInfo() override;
+	virtual bool VisitExtraInfo(SyntaxVisitor& visitor, const char* key) override;
 
 private:
 	hevc_sei_t** seis_ = NULL;
@@ -668,8 +742,7 @@ public:
 	HevcNaluVps(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
 	std::shared_ptr<hevc_vps_t> vps_;
 
-	virtual std::string CompleteInfo() override;
-	virtual std::string ExtraInfo() override;
+	virtual bool VisitExtraInfo(SyntaxVisitor& visitor, const char* key) override;
 };
 
 class HevcNaluSps : public HevcNaluBase
@@ -678,8 +751,7 @@ public:
 	HevcNaluSps(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
 	std::shared_ptr<hevc_sps_t> sps_;
 
-	virtual std::string CompleteInfo() override;
-	virtual std::string ExtraInfo() override;
+	virtual bool VisitExtraInfo(SyntaxVisitor& visitor, const char* key) override;
 };
 
 class HevcNaluPps : public HevcNaluBase
@@ -688,8 +760,7 @@ public:
 	HevcNaluPps(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
 	std::shared_ptr<hevc_pps_t> pps_;
 
-	virtual std::string CompleteInfo() override;
-	virtual std::string ExtraInfo() override;
+	virtual bool VisitExtraInfo(SyntaxVisitor& visitor, const char* key) override;
 };
 
 class HevcNaluSlice : public HevcNaluBase
@@ -697,21 +768,21 @@ class HevcNaluSlice : public HevcNaluBase
 public:
 	HevcNaluSlice(ByteReader& data, uint32_t nalu_size, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
 
-	virtual std::string CompleteInfo() override;
 	virtual int8_t FirstMbInSlice() override;
-	virtual std::string SliceType() override;
 	virtual int PicParameterSetId() override;
 	virtual int FrameNum() override;
 	virtual int FieldPicFlag() override;
 	virtual int PicOrderCntLsb() override;
 	virtual int SliceQpDelta() override;
-	virtual std::string ExtraInfo() override;
+	virtual bool VisitExtraInfo(SyntaxVisitor& visitor, const char* key) override;
+	virtual int SliceTypeId() override;
+	virtual const char* SliceTypeName() override;
+	virtual std::string SliceType() override; //an unknown type keeps its value, "Unknown_<n>"
 
 private:
-	Json::Value SliceHeaderToJson();
-
-private:
-	std::shared_ptr<hevc_slice_header_t> slice_header_;
+	std::unique_ptr<hevc_slice_header_t> slice_header_;
+	std::shared_ptr<hevc_sps_t> sps_; //the ones active when it's parsed, the header is visited with them later
+	std::shared_ptr<hevc_pps_t> pps_;
 };
 
 class VideoTagBodyHEVCNalu : public VideoTagBody
@@ -720,13 +791,13 @@ public:
 	VideoTagBodyHEVCNalu(ByteReader& data, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
 	~VideoTagBodyHEVCNalu() {}
 	virtual void SetTagSerial(int tag_serial) override;
+	virtual void SetNaluOffsets(const uint8_t* buffer_start, uint64_t buffer_offset) override;
 	virtual uint32_t GetCts() override { return cts_; }
-	virtual NaluList EnumNalus() override;
-	virtual std::string GetExtraInfo() override;
+	virtual void EnumNalus(NaluList& nalus) override;
 
 private:
 	uint32_t cts_ = 0;
-	std::list<std::shared_ptr<HevcNaluBase> > nalu_list_;
+	std::vector<std::unique_ptr<HevcNaluBase> > nalu_list_;
 };
 
 /** 
@@ -779,7 +850,7 @@ for (j=0; j < numOfArrays; j++) {
 */
 struct HEVCDecoderConfigurationRecord
 {
-	std::list<std::shared_ptr<HevcNaluBase> > nalu_list_;
+	std::vector<std::unique_ptr<HevcNaluBase> > nalu_list_;
 	bool is_good_;
 
 	HEVCDecoderConfigurationRecord(ByteReader& data, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
@@ -791,12 +862,13 @@ public:
 	VideoTagBodyVpsSpsPps(ByteReader& data, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
 	~VideoTagBodyVpsSpsPps() {}
 	virtual void SetTagSerial(int tag_serial) override;
+	virtual void SetNaluOffsets(const uint8_t* buffer_start, uint64_t buffer_offset) override;
 	virtual uint32_t GetCts() override { return cts_; }
-	virtual NaluList EnumNalus() override;
+	virtual void EnumNalus(NaluList& nalus) override;
 
 private:
 	uint32_t cts_ = 0;
-	std::shared_ptr<HEVCDecoderConfigurationRecord> hevc_config_;
+	std::unique_ptr<HEVCDecoderConfigurationRecord> hevc_config_;
 };
 
 
@@ -0,0 +1,144 @@
+#include "flv_reader.h"
+#include "flv_file_internal.h"
+#include "utils.h"
+
+bool NaluIterator::Next(NaluInterface*& nalu)
+{
+	if (pos_ >= nalu_list_.size())
+		return false;
+	nalu = nalu_list_[pos_++];
+	return true;
+}
+
+//FlvTag is incomplete in the header, so these live here
+TagView::TagView() = default;
+TagView::TagView(TagView&& other) = default;
+TagView& TagView::operator=(TagView&& other) = default;
+TagView::~TagView() = default;
+
+FlvTagInterface* TagView::operator->() const
+{
+	return tag_.get();
+}
+
+FlvTagInterface* TagView::Tag() const
+{
+	return tag_.get();
+}
+
+NaluIterator TagView::Nalus() const
+{
+	NaluIterator iter;
+	if (tag_)
+		tag_->EnumNalus(iter.nalu_list_);
+	return iter;
+}
+
+FlvReader::FlvReader(const std::shared_ptr<InputSource>& input, const std::shared_ptr<DemuxInterface>& demux_output)
+	: input_(input), demux_output_(demux_output), state_(new ParserState())
+{
+	if (!input_ || !input_->IsGood())
+		return;
+	is_good_ = ReadHeader();
+}
+
+FlvReader::~FlvReader()
+{
+
+}
+
+bool FlvReader::ReadHeader()
+{
+	buffer_.resize(FLV_HEADER_SIZE);
+	if (input_->Read(buffer_.data(), FLV_HEADER_SIZE) != FLV_HEADER_SIZE)
+	{
+		printf("read flv header failed.\n");
+		return false;
+	}
+
+	//the header may be followed by some extra bytes which are counted in its header size
+	uint32_t header_size = (uint32_t)BytesToInt(buffer_.data() + 5, 4);
+	if (header_size > FLV_HEADER_SIZE)
+	{
+		buffer_.resize(header_size);
+		if (input_->Read(buffer_.data() + FLV_HEADER_SIZE, header_size - FLV_HEADER_SIZE) != header_size - FLV_HEADER_SIZE)
+			return false;
+	}
+
+	ByteReader reader(buffer_.data(), (uint32_t)buffer_.size());
+	flv_header_.reset(new FlvHeader(reader));
+	return flv_header_ && flv_header_->IsGood();
+}
+
+FlvHeaderInterface* FlvReader::Header() const
+{
+	return flv_header_.get();
+}
+
+bool FlvReader::Next(TagView& tag)
+{
+	tag = TagView();
+	if (!is_good_)
+		return false;
+	ParserStateScope scope(*state_);
+
+	while (true)
+	{
+		uint64_t offset = input_->Tell();
+
+		//previous tag size and tag header
+		const uint32_t head_size = PREVIOUS_TAG_SIZE_SIZE + FLV_TAG_HEADER_SIZE;
+		if (buffer_.size() < head_size)
+			buffer_.resize(head_size);
+		if (input_->Read(buffer_.data(), head_size) != head_size)
+			return false;
+
+		//tag data
+		uint32_t tag_data_size = (uint32_t)BytesToInt(buffer_.data() + PREVIOUS_TAG_SIZE_SIZE + 1, 3);
+		if (buffer_.size() < head_size + tag_data_size)
+			buffer_.resize(head_size + tag_data_size);
+		if (input_->Read(buffer_.data() + head_size, tag_data_size) != tag_data_size)
+			return false;
+
+		ByteReader reader(buffer_.data(), head_size + tag_data_size);
+		std::unique_ptr<FlvTag> flv_tag(new FlvTag(reader, tag_count_, offset, demux_output_));
+		if (!flv_tag->IsGood())
+			continue;
+
+		tag_count_++;
+		tag.tag_ = std::move(flv_tag);
+		tag.offset_ = offset + PREVIOUS_TAG_SIZE_SIZE;
+		return true;
+	}
+}
+
+bool FlvReader::Resume(const FlvResumePoint& point)
+{
+	if (!is_good_)
+		return false;
+
+	//the tag before end_offset must still be the last tag read, and the previous tag size after it must point back to it
+	const uint32_t head_size = PREVIOUS_TAG_SIZE_SIZE + FLV_TAG_HEADER_SIZE;
+	uint8_t head[head_size];
+	if (point.last_tag_size <= FLV_TAG_HEADER_SIZE || point.end_offset < point.last_tag_size + PREVIOUS_TAG_SIZE_SIZE)
+		return false;
+	if (!input_->Seek(point.end_offset - point.last_tag_size - PREVIOUS_TAG_SIZE_SIZE) || input_->Read(head, head_size) != head_size)
+		return false;
+	if ((uint32_t)BytesToInt(head + PREVIOUS_TAG_SIZE_SIZE + 1, 3) + FLV_TAG_HEADER_SIZE != point.last_tag_size)
+		return false;
+	if (!input_->Seek(point.end_offset) || input_->Read(head, PREVIOUS_TAG_SIZE_SIZE) != PREVIOUS_TAG_SIZE_SIZE
+		|| (uint32_t)BytesToInt(head, PREVIOUS_TAG_SIZE_SIZE) != point.last_tag_size)
+		return false;
+
+	//decode the tags which the following ones depend on, nothing is demuxed again
+	std::shared_ptr<DemuxInterface> demux_output;
+	demux_output.swap(demux_output_);
+	bool ok = true;
+	TagView tag;
+	for (size_t i = 0; i < point.state_tags.size() && ok; i++)
+		ok = point.state_tags[i] >= PREVIOUS_TAG_SIZE_SIZE && input_->Seek(point.state_tags[i] - PREVIOUS_TAG_SIZE_SIZE) && Next(tag);
+	demux_output.swap(demux_output_);
+
+	tag_count_ = point.last_tag_serial + 1;
+	return ok && input_->Seek(point.end_offset);
+}
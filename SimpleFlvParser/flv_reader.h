@@ -0,0 +1,88 @@
+#ifndef _SFP_FLV_READER_H_
+#define _SFP_FLV_READER_H_
+
+#include "input_interface.h"
+#include "input_source.h"
+#include "demux_interface.h"
+
+#include <memory>
+#include <vector>
+
+class FlvHeader;
+class FlvTag;
+struct ParserState;
+
+//Iterate the nalus of a single tag
+class NaluIterator
+{
+public:
+	NaluIterator() = default;
+	bool Next(NaluInterface*& nalu); //return false when there is no more nalu
+
+private:
+	friend class TagView;
+	std::vector<NaluInterface*> nalu_list_; //borrowed from the tag, so the TagView must outlive the iterator
+	size_t pos_ = 0;
+};
+
+//A decoded tag handed out by FlvReader, it owns the tag and all of its nalus, so it can be moved but not copied.
+class TagView
+{
+public:
+	TagView();
+	TagView(TagView&& other);
+	TagView& operator=(TagView&& other);
+	~TagView();
+	bool IsValid() const { return tag_ != nullptr; }
+	FlvTagInterface* operator->() const;
+	FlvTagInterface* Tag() const;
+	uint64_t Offset() const { return offset_; } //absolute offset of the tag header in the input
+	NaluIterator Nalus() const;
+
+private:
+	friend class FlvReader;
+	std::unique_ptr<FlvTag> tag_;
+	uint64_t offset_ = 0;
+};
+
+//Where a former read of a growing file stopped, so the next read can continue from there.
+//All offsets are absolute offsets of tag headers in the input, except end_offset.
+struct FlvResumePoint
+{
+	uint64_t end_offset = 0; //end of the last tag read, i.e. the previous tag size field of the next tag
+	uint32_t last_tag_size = 0; //size of the last tag read, the previous tag size at end_offset must be the same
+	int last_tag_serial = 0;
+	std::vector<uint64_t> state_tags; //the sequence headers and the last audio/video tags, decoded again to restore the parser state
+};
+
+//Pull-based flv parser, decodes one tag per Next() call, so callers control the pacing and can stop at any time.
+//Each reader keeps the parser state of its own input, so several readers can be used in turns on one thread.
+class FlvReader
+{
+public:
+	FlvReader(const std::shared_ptr<InputSource>& input, const std::shared_ptr<DemuxInterface>& demux_output = NULL);
+	~FlvReader();
+	bool IsGood() { return is_good_; }
+	FlvHeaderInterface* Header() const;
+
+	//decode the next good tag, return false when the input reaches its end or is truncated
+	bool Next(TagView& tag);
+
+	//Skip the tags read before, the following Next() calls return the tags after them.
+	//Return false if the previous tag size chain doesn't lead to the resume point any more, e.g. the file has been rewritten.
+	bool Resume(const FlvResumePoint& point);
+
+private:
+	bool ReadHeader();
+
+private:
+	bool is_good_ = false;
+	std::shared_ptr<InputSource> input_;
+	std::shared_ptr<DemuxInterface> demux_output_;
+	std::unique_ptr<FlvHeader> flv_header_;
+	std::vector<uint8_t> buffer_; //reused by every tag
+	std::unique_ptr<ParserState> state_; //the last timestamps and parameter sets of this input
+	int tag_count_ = 1;
+};
+
+#endif //_SFP_FLV_READER_H_
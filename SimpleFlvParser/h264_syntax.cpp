@@ -1,4 +1,5 @@
 #include "h264_syntax.h"
+#include "syntax_visitor.h"
 #include "utils.h"
 
 /**
@@ -109,30 +110,27 @@ void read_hrd_parameters(sps_t::hrd_t* hrd, BitReader& b)
 	hrd->time_offset_length = b.ReadU(5);
 }
 
-Json::Value hrd_to_json(sps_t::hrd_t* hrd)
+void visit_hrd(sps_t::hrd_t* hrd, SyntaxVisitor& v)
 {
-	Json::Value json_hrd;
 	int SchedSelIdx;
 
-	json_hrd["cpb_cnt_minus1"] = hrd->cpb_cnt_minus1;
-	json_hrd["bit_rate_scale"] = hrd->bit_rate_scale;
-	json_hrd["cpb_size_scale"] = hrd->cpb_size_scale;
-	Json::Value json_cpb_list;
+	v.Field("cpb_cnt_minus1", hrd->cpb_cnt_minus1);
+	v.Field("bit_rate_scale", hrd->bit_rate_scale);
+	v.Field("cpb_size_scale", hrd->cpb_size_scale);
+	v.BeginArray("cpb");
 	for (SchedSelIdx = 0; SchedSelIdx <= hrd->cpb_cnt_minus1; SchedSelIdx++)
 	{
-		Json::Value json_cpb;
-		json_cpb["bit_rate_value_minus1"] = hrd->bit_rate_value_minus1[SchedSelIdx];
-		json_cpb["cpb_size_value_minus1"] = hrd->cpb_size_value_minus1[SchedSelIdx];
-		json_cpb["cbr_flag"] = hrd->cbr_flag[SchedSelIdx];
-		json_cpb_list[SchedSelIdx] = json_cpb;
-	}
-	json_hrd["cpb"] = json_cpb_list;
-	json_hrd["initial_cpb_removal_delay_length_minus1"] = hrd->initial_cpb_removal_delay_length_minus1;
-	json_hrd["cpb_removal_delay_length_minus1"] = hrd->cpb_removal_delay_length_minus1;
-	json_hrd["dpb_output_delay_length_minus1"] = hrd->dpb_output_delay_length_minus1;
-	json_hrd["time_offset_length"] = hrd->time_offset_length;
-
-	return json_hrd;
+		v.BeginObject(NULL);
+		v.Field("bit_rate_value_minus1", hrd->bit_rate_value_minus1[SchedSelIdx]);
+		v.Field("cpb_size_value_minus1", hrd->cpb_size_value_minus1[SchedSelIdx]);
+		v.Field("cbr_flag", hrd->cbr_flag[SchedSelIdx]);
+		v.EndObject();
+	}
+	v.EndArray();
+	v.Field("initial_cpb_removal_delay_length_minus1", hrd->initial_cpb_removal_delay_length_minus1);
+	v.Field("cpb_removal_delay_length_minus1", hrd->cpb_removal_delay_length_minus1);
+	v.Field("dpb_output_delay_length_minus1", hrd->dpb_output_delay_length_minus1);
+	v.Field("time_offset_length", hrd->time_offset_length);
 }
 
 #define SAR_Extended      255        // Extended_SAR
@@ -209,71 +207,75 @@ void read_vui_parameters(sps_t* sps, BitReader& b)
 	}
 }
 
-Json::Value vui_to_json(sps_t* sps)
+void visit_vui(sps_t* sps, SyntaxVisitor& v)
 {
-	Json::Value json_vui;
-
-	json_vui["aspect_ratio_info_present_flag"] = sps->vui.aspect_ratio_info_present_flag;
+	v.Field("aspect_ratio_info_present_flag", sps->vui.aspect_ratio_info_present_flag);
 	if (sps->vui.aspect_ratio_info_present_flag)
 	{
-		json_vui["aspect_ratio_idc"] = sps->vui.aspect_ratio_idc;
+		v.Field("aspect_ratio_idc", sps->vui.aspect_ratio_idc);
 		if (sps->vui.aspect_ratio_idc == SAR_Extended)
 		{
-			json_vui["sar_width"] = sps->vui.sar_width;
-			json_vui["sar_height"] = sps->vui.sar_height;
+			v.Field("sar_width", sps->vui.sar_width);
+			v.Field("sar_height", sps->vui.sar_height);
 		}
 	}
-	json_vui["overscan_info_present_flag"] = sps->vui.overscan_info_present_flag;
+	v.Field("overscan_info_present_flag", sps->vui.overscan_info_present_flag);
 	if (sps->vui.overscan_info_present_flag)
-		json_vui["overscan_appropriate_flag"] = sps->vui.overscan_appropriate_flag;
-	json_vui["video_signal_type_present_flag"] = sps->vui.video_signal_type_present_flag;
+		v.Field("overscan_appropriate_flag", sps->vui.overscan_appropriate_flag);
+	v.Field("video_signal_type_present_flag", sps->vui.video_signal_type_present_flag);
 	if (sps->vui.video_signal_type_present_flag)
 	{
-		json_vui["video_format"] = sps->vui.video_format;
-		json_vui["video_full_range_flag"] = sps->vui.video_full_range_flag;
-		json_vui["colour_description_present_flag"] = sps->vui.colour_description_present_flag;
+		v.Field("video_format", sps->vui.video_format);
+		v.Field("video_full_range_flag", sps->vui.video_full_range_flag);
+		v.Field("colour_description_present_flag", sps->vui.colour_description_present_flag);
 		if (sps->vui.colour_description_present_flag)
 		{
-			json_vui["colour_primaries"] = sps->vui.colour_primaries;
-			json_vui["transfer_characteristics"] = sps->vui.transfer_characteristics;
-			json_vui["matrix_coefficients"] = sps->vui.matrix_coefficients;
+			v.Field("colour_primaries", sps->vui.colour_primaries);
+			v.Field("transfer_characteristics", sps->vui.transfer_characteristics);
+			v.Field("matrix_coefficients", sps->vui.matrix_coefficients);
 		}
 	}
-	json_vui["chroma_loc_info_present_flag"] = sps->vui.chroma_loc_info_present_flag;
+	v.Field("chroma_loc_info_present_flag", sps->vui.chroma_loc_info_present_flag);
 	if (sps->vui.chroma_loc_info_present_flag)
 	{
-		json_vui["chroma_sample_loc_type_top_field"] = sps->vui.chroma_sample_loc_type_top_field;
-		json_vui["chroma_sample_loc_type_bottom_field"] = sps->vui.chroma_sample_loc_type_bottom_field;
+		v.Field("chroma_sample_loc_type_top_field", sps->vui.chroma_sample_loc_type_top_field);
+		v.Field("chroma_sample_loc_type_bottom_field", sps->vui.chroma_sample_loc_type_bottom_field);
 	}
-	json_vui["timing_info_present_flag"] = sps->vui.timing_info_present_flag;
+	v.Field("timing_info_present_flag", sps->vui.timing_info_present_flag);
 	if (sps->vui.timing_info_present_flag)
 	{
-		json_vui["num_units_in_tick"] = sps->vui.num_units_in_tick;
-		json_vui["time_scale"] = sps->vui.time_scale;
-		json_vui["fixed_frame_rate_flag"] = sps->vui.fixed_frame_rate_flag;
+		v.Field("num_units_in_tick", sps->vui.num_units_in_tick);
+		v.Field("time_scale", sps->vui.time_scale);
+		v.Field("fixed_frame_rate_flag", sps->vui.fixed_frame_rate_flag);
 	}
-	json_vui["nal_hrd_parameters_present_flag"] = sps->vui.nal_hrd_parameters_present_flag;
+	v.Field("nal_hrd_parameters_present_flag", sps->vui.nal_hrd_parameters_present_flag);
 	if (sps->vui.nal_hrd_parameters_present_flag)
-		json_vui["nal_hrd"] = hrd_to_json(&sps->nal_hrd);
-	json_vui["vcl_hrd_parameters_present_flag"] = sps->vui.vcl_hrd_parameters_present_flag;
+	{
+		v.BeginObject("nal_hrd");
+		visit_hrd(&sps->nal_hrd, v);
+		v.EndObject();
+	}
+	v.Field("vcl_hrd_parameters_present_flag", sps->vui.vcl_hrd_parameters_present_flag);
 	if (sps->vui.vcl_hrd_parameters_present_flag)
-		json_vui["vcl_hrd"] = hrd_to_json(&sps->vcl_hrd);
+	{
+		v.BeginObject("vcl_hrd");
+		visit_hrd(&sps->vcl_hrd, v);
+		v.EndObject();
+	}
 	if (sps->vui.nal_hrd_parameters_present_flag || sps->vui.vcl_hrd_parameters_present_flag)
-		json_vui["low_delay_hrd_flag"] = sps->vui.low_delay_hrd_flag;
-	json_vui["pic_struct_present_flag"] = sps->vui.pic_struct_present_flag;
-	json_vui["bitstream_restriction_flag"] = sps->vui.bitstream_restriction_flag;
+		v.Field("low_delay_hrd_flag", sps->vui.low_delay_hrd_flag);
+	v.Field("pic_struct_present_flag", sps->vui.pic_struct_present_flag);
+	v.Field("bitstream_restriction_flag", sps->vui.bitstream_restriction_flag);
 	if (sps->vui.bitstream_restriction_flag)
 	{
-		json_vui["motion_vectors_over_pic_boundaries_flag"] = sps->vui.motion_vectors_over_pic_boundaries_flag;
-		json_vui["max_bytes_per_pic_denom"] = sps->vui.max_bytes_per_pic_denom;
-		json_vui["max_bits_per_mb_denom"] = sps->vui.max_bits_per_mb_denom;
-		json_vui["log2_max_mv_length_horizontal"] = sps->vui.log2_max_mv_length_horizontal;
-		json_vui["log2_max_mv_length_vertical"] = sps->vui.log2_max_mv_length_vertical;
-		json_vui["num_reorder_frames"] = sps->vui.num_reorder_frames;
-		json_vui["max_dec_frame_buffering"] = sps->vui.max_dec_frame_buffering;
+		v.Field("motion_vectors_over_pic_boundaries_flag", sps->vui.motion_vectors_over_pic_boundaries_flag);
+		v.Field("max_bytes_per_pic_denom", sps->vui.max_bytes_per_pic_denom);
+		v.Field("max_bits_per_mb_denom", sps->vui.max_bits_per_mb_denom);
+		v.Field("log2_max_mv_length_horizontal", sps->vui.log2_max_mv_length_horizontal);
+		v.Field("log2_max_mv_length_vertical", sps->vui.log2_max_mv_length_vertical);
+		v.Field("num_reorder_frames", sps->vui.num_reorder_frames);
+		v.Field("max_dec_frame_buffering", sps->vui.max_dec_frame_buffering);
 	}
-
-	return json_vui;
 }
 
 void read_scaling_list(BitReader& b, int* scalingList, int sizeOfScalingList, int useDefaultScalingMatrixFlag)
@@ -378,98 +380,97 @@ void read_seq_parameter_set_rbsp(sps_t* sps, BitReader& b)
 	read_rbsp_trailing_bits(b);
 }
 
-Json::Value sps_to_json(sps_t* sps)
+void visit_sps(sps_t* sps, SyntaxVisitor& v)
 {
-	Json::Value json_sps;
-
-	json_sps["profile_idc"] = sps->profile_idc;
-	json_sps["constraint_set0_flag"] = sps->constraint_set0_flag;
-	json_sps["constraint_set1_flag"] = sps->constraint_set1_flag;
-	json_sps["constraint_set2_flag"] = sps->constraint_set2_flag;
-	json_sps["constraint_set3_flag"] = sps->constraint_set3_flag;
-	json_sps["constraint_set4_flag"] = sps->constraint_set4_flag;
-	json_sps["constraint_set5_flag"] = sps->constraint_set5_flag;
-	json_sps["reserved_zero_2bits"] = sps->reserved_zero_2bits;
-	json_sps["level_idc"] = sps->level_idc;
-	json_sps["seq_parameter_set_id"] = sps->seq_parameter_set_id;
-	json_sps["chroma_format_idc"] = sps->chroma_format_idc;
+	v.Field("profile_idc", sps->profile_idc);
+	v.Field("constraint_set0_flag", sps->constraint_set0_flag);
+	v.Field("constraint_set1_flag", sps->constraint_set1_flag);
+	v.Field("constraint_set2_flag", sps->constraint_set2_flag);
+	v.Field("constraint_set3_flag", sps->constraint_set3_flag);
+	v.Field("constraint_set4_flag", sps->constraint_set4_flag);
+	v.Field("constraint_set5_flag", sps->constraint_set5_flag);
+	v.Field("reserved_zero_2bits", sps->reserved_zero_2bits);
+	v.Field("level_idc", sps->level_idc);
+	v.Field("seq_parameter_set_id", sps->seq_parameter_set_id);
+	v.Field("chroma_format_idc", sps->chroma_format_idc);
 	if (sps->profile_idc == 100 || sps->profile_idc == 110 || sps->profile_idc == 122 || sps->profile_idc == 144)
 	{
-		json_sps["chroma_format_idc"] = sps->chroma_format_idc;
 		if (sps->chroma_format_idc == 3)
-			json_sps["residual_colour_transform_flag"] = sps->residual_colour_transform_flag;
-		json_sps["bit_depth_luma_minus8"] = sps->bit_depth_luma_minus8;
-		json_sps["bit_depth_chroma_minus8"] = sps->bit_depth_chroma_minus8;
-		json_sps["qpprime_y_zero_transform_bypass_flag"] = sps->qpprime_y_zero_transform_bypass_flag;
-		json_sps["seq_scaling_matrix_present_flag"] = sps->seq_scaling_matrix_present_flag;
+			v.Field("residual_colour_transform_flag", sps->residual_colour_transform_flag);
+		v.Field("bit_depth_luma_minus8", sps->bit_depth_luma_minus8);
+		v.Field("bit_depth_chroma_minus8", sps->bit_depth_chroma_minus8);
+		v.Field("qpprime_y_zero_transform_bypass_flag", sps->qpprime_y_zero_transform_bypass_flag);
+		v.Field("seq_scaling_matrix_present_flag", sps->seq_scaling_matrix_present_flag);
 		if (sps->seq_scaling_matrix_present_flag)
 		{
-			Json::Value json_seq_scaling_matrix;
+			v.BeginArray("seq_scaling_matrix");
 			for (int i = 0; i < 8; i++)
 			{
-				Json::Value json_seq_scaling_list;
-				json_seq_scaling_list["seq_scaling_list_present_flag"] = sps->seq_scaling_list_present_flag[i];
+				v.BeginObject(NULL);
+				v.Field("seq_scaling_list_present_flag", sps->seq_scaling_list_present_flag[i]);
 				if (sps->seq_scaling_list_present_flag[i])
 				{
 					if (i < 6)
 					{
-						Json::Value jsonScalingList4x4;
+						v.BeginArray("ScalingList4x4");
 						for (int j = 0; j < 16; j++)
-							jsonScalingList4x4.append(sps->ScalingList4x4[i][j]);
-						json_seq_scaling_list["ScalingList4x4"] = jsonScalingList4x4;
-						json_seq_scaling_list["UseDefaultScalingMatrix4x4Flag"] = sps->UseDefaultScalingMatrix4x4Flag[i];
+							v.Field(NULL, sps->ScalingList4x4[i][j]);
+						v.EndArray();
+						v.Field("UseDefaultScalingMatrix4x4Flag", sps->UseDefaultScalingMatrix4x4Flag[i]);
 					}
 					else
 					{
-						Json::Value jsonScalingList8x8;
+						v.BeginArray("ScalingList8x8");
 						for (int j = 0; j < 64; j++)
-							jsonScalingList8x8.append(sps->ScalingList8x8[i - 6][j]);
-						json_seq_scaling_list["ScalingList8x8"] = jsonScalingList8x8;
-						json_seq_scaling_list["UseDefaultScalingMatrix8x8Flag"] = sps->UseDefaultScalingMatrix8x8Flag[i - 6];
+							v.Field(NULL, sps->ScalingList8x8[i - 6][j]);
+						v.EndArray();
+						v.Field("UseDefaultScalingMatrix8x8Flag", sps->UseDefaultScalingMatrix8x8Flag[i - 6]);
 					}
 				}
-				json_seq_scaling_matrix[i] = json_seq_scaling_list;
+				v.EndObject();
 			}
-			json_sps["seq_scaling_matrix"] = json_seq_scaling_matrix;
+			v.EndArray();
 		}
 	}
 
-	json_sps["log2_max_frame_num_minus4"] = sps->log2_max_frame_num_minus4;
-	json_sps["pic_order_cnt_type"] = sps->pic_order_cnt_type;
+	v.Field("log2_max_frame_num_minus4", sps->log2_max_frame_num_minus4);
+	v.Field("pic_order_cnt_type", sps->pic_order_cnt_type);
 	if (sps->pic_order_cnt_type == 0)
-		json_sps["log2_max_pic_order_cnt_lsb_minus4"] = sps->log2_max_pic_order_cnt_lsb_minus4;
+		v.Field("log2_max_pic_order_cnt_lsb_minus4", sps->log2_max_pic_order_cnt_lsb_minus4);
 	else if (sps->pic_order_cnt_type == 1)
 	{
-		json_sps["delta_pic_order_always_zero_flag"] = sps->delta_pic_order_always_zero_flag;
-		json_sps["offset_for_non_ref_pic"] = sps->offset_for_non_ref_pic;
-		json_sps["offset_for_top_to_bottom_field"] = sps->offset_for_top_to_bottom_field;
-		json_sps["num_ref_frames_in_pic_order_cnt_cycle"] = sps->num_ref_frames_in_pic_order_cnt_cycle;
-		Json::Value json_offset_for_ref_frame;
+		v.Field("delta_pic_order_always_zero_flag", sps->delta_pic_order_always_zero_flag);
+		v.Field("offset_for_non_ref_pic", sps->offset_for_non_ref_pic);
+		v.Field("offset_for_top_to_bottom_field", sps->offset_for_top_to_bottom_field);
+		v.Field("num_ref_frames_in_pic_order_cnt_cycle", sps->num_ref_frames_in_pic_order_cnt_cycle);
+		v.BeginArray("offset_for_ref_frame");
 		for (int i = 0; i < sps->num_ref_frames_in_pic_order_cnt_cycle; i++)
-			json_offset_for_ref_frame[i] = sps->offset_for_ref_frame[i];
-		json_sps["offset_for_ref_frame"] = json_offset_for_ref_frame;
-	}
-	json_sps["num_ref_frames"] = sps->num_ref_frames;
-	json_sps["gaps_in_frame_num_value_allowed_flag"] = sps->gaps_in_frame_num_value_allowed_flag;
-	json_sps["pic_width_in_mbs_minus1"] = sps->pic_width_in_mbs_minus1;
-	json_sps["pic_height_in_map_units_minus1"] = sps->pic_height_in_map_units_minus1;
-	json_sps["frame_mbs_only_flag"] = sps->frame_mbs_only_flag;
+			v.Field(NULL, sps->offset_for_ref_frame[i]);
+		v.EndArray();
+	}
+	v.Field("num_ref_frames", sps->num_ref_frames);
+	v.Field("gaps_in_frame_num_value_allowed_flag", sps->gaps_in_frame_num_value_allowed_flag);
+	v.Field("pic_width_in_mbs_minus1", sps->pic_width_in_mbs_minus1);
+	v.Field("pic_height_in_map_units_minus1", sps->pic_height_in_map_units_minus1);
+	v.Field("frame_mbs_only_flag", sps->frame_mbs_only_flag);
 	if (!sps->frame_mbs_only_flag)
-		json_sps["mb_adaptive_frame_field_flag"] = sps->mb_adaptive_frame_field_flag;
-	json_sps["direct_8x8_inference_flag"] = sps->direct_8x8_inference_flag;
-	json_sps["frame_cropping_flag"] = sps->frame_cropping_flag;
+		v.Field("mb_adaptive_frame_field_flag", sps->mb_adaptive_frame_field_flag);
+	v.Field("direct_8x8_inference_flag", sps->direct_8x8_inference_flag);
+	v.Field("frame_cropping_flag", sps->frame_cropping_flag);
 	if (sps->frame_cropping_flag)
 	{
-		json_sps["frame_crop_left_offset"] = sps->frame_crop_left_offset;
-		json_sps["frame_crop_right_offset"] = sps->frame_crop_right_offset;
-		json_sps["frame_crop_top_offset"] = sps->frame_crop_top_offset;
-		json_sps["frame_crop_bottom_offset"] = sps->frame_crop_bottom_offset;
+		v.Field("frame_crop_left_offset", sps->frame_crop_left_offset);
+		v.Field("frame_crop_right_offset", sps->frame_crop_right_offset);
+		v.Field("frame_crop_top_offset", sps->frame_crop_top_offset);
+		v.Field("frame_crop_bottom_offset", sps->frame_crop_bottom_offset);
 	}
-	json_sps["vui_parameters_present_flag"] = sps->vui_parameters_present_flag;
+	v.Field("vui_parameters_present_flag", sps->vui_parameters_present_flag);
 	if (sps->vui_parameters_present_flag)
-		json_sps["vui"] = vui_to_json(sps);
-
-	return json_sps;
+	{
+		v.BeginObject("vui");
+		visit_vui(sps, v);
+		v.EndObject();
+	}
 }
 
 int more_rbsp_data(BitReader& b)
@@ -568,103 +569,99 @@ void read_pic_parameter_set_rbsp(pps_t* pps, BitReader& b)
 	read_rbsp_trailing_bits(b);
 }
 
-Json::Value pps_to_json(pps_t* pps)
+void visit_pps(pps_t* pps, SyntaxVisitor& v)
 {
 	int i, i_group;
-	Json::Value json_pps;
 
-	json_pps["pic_parameter_set_id"] = pps->pic_parameter_set_id;
-	json_pps["seq_parameter_set_id"] = pps->seq_parameter_set_id;
-	json_pps["entropy_coding_mode_flag"] = pps->entropy_coding_mode_flag;
-	json_pps["pic_order_present_flag"] = pps->pic_order_present_flag;
-	json_pps["num_slice_groups_minus1"] = pps->num_slice_groups_minus1;
+	v.Field("pic_parameter_set_id", pps->pic_parameter_set_id);
+	v.Field("seq_parameter_set_id", pps->seq_parameter_set_id);
+	v.Field("entropy_coding_mode_flag", pps->entropy_coding_mode_flag);
+	v.Field("pic_order_present_flag", pps->pic_order_present_flag);
+	v.Field("num_slice_groups_minus1", pps->num_slice_groups_minus1);
 	if (pps->num_slice_groups_minus1 > 0)
 	{
-		json_pps["slice_group_map_type"] = pps->slice_group_map_type;
+		v.Field("slice_group_map_type", pps->slice_group_map_type);
 		if (pps->slice_group_map_type == 0)
 		{
-			Json::Value json_run_length_minus1;
+			v.BeginArray("run_length_minus1");
 			for (i_group = 0; i_group <= pps->num_slice_groups_minus1; i_group++)
-				json_run_length_minus1[i_group] = pps->run_length_minus1[i_group];
-			json_pps["run_length_minus1"] = json_run_length_minus1;
+				v.Field(NULL, pps->run_length_minus1[i_group]);
+			v.EndArray();
 		}
 		else if (pps->slice_group_map_type == 2)
 		{
-			Json::Value json_top_left;
-			Json::Value json_bottom_right;
+			v.BeginArray("top_left");
 			for (i_group = 0; i_group < pps->num_slice_groups_minus1; i_group++)
-			{
-				json_top_left[i_group] = pps->top_left[i_group];
-				json_bottom_right[i_group] = pps->bottom_right[i_group];
-			}
-			json_pps["top_left"] = json_top_left;
-			json_pps["bottom_right"] = json_bottom_right;
+				v.Field(NULL, pps->top_left[i_group]);
+			v.EndArray();
+			v.BeginArray("bottom_right");
+			for (i_group = 0; i_group < pps->num_slice_groups_minus1; i_group++)
+				v.Field(NULL, pps->bottom_right[i_group]);
+			v.EndArray();
 		}
 		else if (pps->slice_group_map_type == 3 ||
 			pps->slice_group_map_type == 4 ||
 			pps->slice_group_map_type == 5)
 		{
-			json_pps["slice_group_change_direction_flag"] = pps->slice_group_change_direction_flag;
-			json_pps["slice_group_change_rate_minus1"] = pps->slice_group_change_rate_minus1;
+			v.Field("slice_group_change_direction_flag", pps->slice_group_change_direction_flag);
+			v.Field("slice_group_change_rate_minus1", pps->slice_group_change_rate_minus1);
 		}
 		else if (pps->slice_group_map_type == 6)
 		{
-			json_pps["pic_size_in_map_units_minus1"] = pps->pic_size_in_map_units_minus1;
-			Json::Value json_slice_group_id;
+			v.Field("pic_size_in_map_units_minus1", pps->pic_size_in_map_units_minus1);
+			v.BeginArray("slice_group_id");
 			for (i = 0; i <= pps->pic_size_in_map_units_minus1; i++)
-				json_slice_group_id[i] = pps->slice_group_id[i];
-			json_pps["slice_group_id"] = json_slice_group_id;
+				v.Field(NULL, pps->slice_group_id[i]);
+			v.EndArray();
 		}
 	}
-	json_pps["num_ref_idx_l0_active_minus1"] = pps->num_ref_idx_l0_active_minus1;
-	json_pps["num_ref_idx_l1_active_minus1"] = pps->num_ref_idx_l1_active_minus1;
-	json_pps["weighted_pred_flag"] = pps->weighted_pred_flag;
-	json_pps["weighted_bipred_idc"] = pps->weighted_bipred_idc;
-	json_pps["pic_init_qp_minus26"] = pps->pic_init_qp_minus26;
-	json_pps["pic_init_qs_minus26"] = pps->pic_init_qs_minus26;
-	json_pps["chroma_qp_index_offset"] = pps->chroma_qp_index_offset;
-	json_pps["deblocking_filter_control_present_flag"] = pps->deblocking_filter_control_present_flag;
-	json_pps["constrained_intra_pred_flag"] = pps->constrained_intra_pred_flag;
-	json_pps["redundant_pic_cnt_present_flag"] = pps->redundant_pic_cnt_present_flag;
-	json_pps["_more_rbsp_data_present"] = pps->_more_rbsp_data_present;
+	v.Field("num_ref_idx_l0_active_minus1", pps->num_ref_idx_l0_active_minus1);
+	v.Field("num_ref_idx_l1_active_minus1", pps->num_ref_idx_l1_active_minus1);
+	v.Field("weighted_pred_flag", pps->weighted_pred_flag);
+	v.Field("weighted_bipred_idc", pps->weighted_bipred_idc);
+	v.Field("pic_init_qp_minus26", pps->pic_init_qp_minus26);
+	v.Field("pic_init_qs_minus26", pps->pic_init_qs_minus26);
+	v.Field("chroma_qp_index_offset", pps->chroma_qp_index_offset);
+	v.Field("deblocking_filter_control_present_flag", pps->deblocking_filter_control_present_flag);
+	v.Field("constrained_intra_pred_flag", pps->constrained_intra_pred_flag);
+	v.Field("redundant_pic_cnt_present_flag", pps->redundant_pic_cnt_present_flag);
+	v.Field("_more_rbsp_data_present", pps->_more_rbsp_data_present);
 	if (pps->_more_rbsp_data_present)
 	{
-		json_pps["transform_8x8_mode_flag"] = pps->transform_8x8_mode_flag;
-		json_pps["pic_scaling_matrix_present_flag"] = pps->pic_scaling_matrix_present_flag;
+		v.Field("transform_8x8_mode_flag", pps->transform_8x8_mode_flag);
+		v.Field("pic_scaling_matrix_present_flag", pps->pic_scaling_matrix_present_flag);
 		if (pps->pic_scaling_matrix_present_flag)
 		{
-			Json::Value json_pic_scaling_matrix;
+			v.BeginArray("pic_scaling_matrix");
 			for (i = 0; i < 6 + 2 * pps->transform_8x8_mode_flag; i++)
 			{
-				Json::Value json_pic_scaling_list;
-				json_pic_scaling_list["pic_scaling_list_present_flag"] = pps->pic_scaling_list_present_flag[i];
+				v.BeginObject(NULL);
+				v.Field("pic_scaling_list_present_flag", pps->pic_scaling_list_present_flag[i]);
 				if (pps->pic_scaling_list_present_flag[i])
 				{
 					if (i < 6)
 					{
-						Json::Value jsonScalingList4x4;
+						v.BeginArray("ScalingList4x4");
 						for (int j = 0; j < 16; j++)
-							jsonScalingList4x4.append(pps->ScalingList4x4[i][j]);
-						json_pic_scaling_list["ScalingList4x4"] = jsonScalingList4x4;
-						json_pic_scaling_list["UseDefaultScalingMatrix4x4Flag"] = pps->UseDefaultScalingMatrix4x4Flag[i];
+							v.Field(NULL, pps->ScalingList4x4[i][j]);
+						v.EndArray();
+						v.Field("UseDefaultScalingMatrix4x4Flag", pps->UseDefaultScalingMatrix4x4Flag[i]);
 					}
 					else
 					{
-						Json::Value jsonScalingList8x8;
+						v.BeginArray("ScalingList8x8");
 						for (int j = 0; j < 64; j++)
-							jsonScalingList8x8.append(pps->ScalingList8x8[i - 6][j]);
-						json_pic_scaling_list["ScalingList8x8"] = jsonScalingList8x8;
-						json_pic_scaling_list["UseDefaultScalingMatrix8x8Flag"] = pps->UseDefaultScalingMatrix8x8Flag[i - 6];
+							v.Field(NULL, pps->ScalingList8x8[i - 6][j]);
+						v.EndArray();
+						v.Field("UseDefaultScalingMatrix8x8Flag", pps->UseDefaultScalingMatrix8x8Flag[i - 6]);
 					}
 				}
-				json_pic_scaling_matrix[i] = json_pic_scaling_list;
+				v.EndObject();
 			}
-			json_pps["pic_scaling_matrix"] = json_pic_scaling_matrix;
+			v.EndArray();
 		}
-		json_pps["second_chroma_qp_index_offset"] = pps->second_chroma_qp_index_offset;
+		v.Field("second_chroma_qp_index_offset", pps->second_chroma_qp_index_offset);
 	}
-
-	return json_pps;
 }
 
 int is_slice_type(int slice_type, int cmp_type)
@@ -732,38 +729,31 @@ void read_ref_pic_list_reordering(slice_header_t* sh, BitReader& b)
 	}
 }
 
-Json::Value rplr_to_json(slice_header_t* sh)
+void visit_rplr(slice_header_t* sh, SyntaxVisitor& v)
 {
-	Json::Value json_rplr;
-
+	//only the last reordering is kept, both lists show the same one
+	bool reordering = false;
 	if (!is_slice_type(sh->slice_type, SLICE_TYPE_I) && !is_slice_type(sh->slice_type, SLICE_TYPE_SI))
 	{
-		json_rplr["ref_pic_list_reordering_flag_l0"] = sh->rplr.ref_pic_list_reordering_flag_l0;
+		v.Field("ref_pic_list_reordering_flag_l0", sh->rplr.ref_pic_list_reordering_flag_l0);
 		if (sh->rplr.ref_pic_list_reordering_flag_l0)
-		{
-			json_rplr["reordering_of_pic_nums_idc"] = sh->rplr.reordering_of_pic_nums_idc;
-			if (sh->rplr.reordering_of_pic_nums_idc == 0 ||
-				sh->rplr.reordering_of_pic_nums_idc == 1)
-				json_rplr["abs_diff_pic_num_minus1"] = sh->rplr.abs_diff_pic_num_minus1;
-			else if (sh->rplr.reordering_of_pic_nums_idc == 2)
-				json_rplr["long_term_pic_num"] = sh->rplr.long_term_pic_num;
-		}
+			reordering = true;
 	}
 	if (is_slice_type(sh->slice_type, SLICE_TYPE_B))
 	{
-		json_rplr["ref_pic_list_reordering_flag_l1"] = sh->rplr.ref_pic_list_reordering_flag_l1;
+		v.Field("ref_pic_list_reordering_flag_l1", sh->rplr.ref_pic_list_reordering_flag_l1);
 		if (sh->rplr.ref_pic_list_reordering_flag_l1)
-		{
-			json_rplr["reordering_of_pic_nums_idc"] = sh->rplr.reordering_of_pic_nums_idc;
-			if (sh->rplr.reordering_of_pic_nums_idc == 0 ||
-				sh->rplr.reordering_of_pic_nums_idc == 1)
-				json_rplr["abs_diff_pic_num_minus1"] = sh->rplr.abs_diff_pic_num_minus1;
-			else if (sh->rplr.reordering_of_pic_nums_idc == 2)
-				json_rplr["long_term_pic_num"] = sh->rplr.long_term_pic_num;
-		}
+			reordering = true;
+	}
+	if (reordering)
+	{
+		v.Field("reordering_of_pic_nums_idc", sh->rplr.reordering_of_pic_nums_idc);
+		if (sh->rplr.reordering_of_pic_nums_idc == 0 ||
+			sh->rplr.reordering_of_pic_nums_idc == 1)
+			v.Field("abs_diff_pic_num_minus1", sh->rplr.abs_diff_pic_num_minus1);
+		else if (sh->rplr.reordering_of_pic_nums_idc == 2)
+			v.Field("long_term_pic_num", sh->rplr.long_term_pic_num);
 	}
-
-	return json_rplr;
 }
 
 //7.3.3.2 Prediction weight table syntax
@@ -823,95 +813,75 @@ void read_pred_weight_table(slice_header_t* sh, BitReader& b, sps_t* sps, pps_t*
 	}
 }
 
-Json::Value pwt_to_json(slice_header_t* sh)
+//the weights are listed until the rest of the flags are all zero
+static int pwt_list_size(int* flags)
 {
-	int i, j;
-	Json::Value json_pwt;
-
-	json_pwt["luma_log2_weight_denom"] = sh->pwt.luma_log2_weight_denom;
-	json_pwt["chroma_log2_weight_denom"] = sh->pwt.chroma_log2_weight_denom;
+	int i;
 	for (i = 0; i <= 64; i++)
 	{
-		if (check_zero(&sh->pwt.luma_weight_l0_flag[i], 64 - i))
+		if (check_zero(&flags[i], 64 - i))
 			break;
-		json_pwt["luma_weight_l0_flag"][i] = sh->pwt.luma_weight_l0_flag[i];
-		if (sh->pwt.luma_weight_l0_flag[i])
-		{
-			json_pwt["luma_weight_l0"][i] = sh->pwt.luma_weight_l0[i];
-			json_pwt["luma_offset_l0"][i] = sh->pwt.luma_offset_l0[i];
-		}
-		else
-		{
-			json_pwt["luma_weight_l0"][i] = 0;
-			json_pwt["luma_offset_l0"][i] = 0;
-		}
 	}
-	for (i = 0; i <= 64; i++)
+	return i;
+}
+
+static void visit_pwt_list(const char* key, int* values, int* flags, int size, SyntaxVisitor& v)
+{
+	v.BeginArray(key);
+	for (int i = 0; i < size; i++)
+		v.Field(NULL, flags[i] ? values[i] : 0);
+	v.EndArray();
+}
+
+static void visit_pwt_chroma_list(const char* key, int (*values)[2], int* flags, int size, SyntaxVisitor& v)
+{
+	v.BeginArray(key);
+	for (int i = 0; i < size; i++)
 	{
-		if (check_zero(&sh->pwt.chroma_weight_l0_flag[i], 64 - i))
-			break;
-		json_pwt["chroma_weight_l0_flag"][i] = sh->pwt.chroma_weight_l0_flag[i];
-		if (sh->pwt.chroma_weight_l0_flag[i])
-		{
-			for (j = 0; j < 2; j++)
-			{
-				json_pwt["chroma_weight_l0"][i][j] = sh->pwt.chroma_weight_l0[i][j];
-				json_pwt["chroma_offset_l0"][i][j] = sh->pwt.chroma_offset_l0[i][j];
-			}
-		}
-		else
-		{
-			for (j = 0; j < 2; j++)
-			{
-				json_pwt["chroma_weight_l0"][i][j] = 0;
-				json_pwt["chroma_offset_l0"][i][j] = 0;
-			}
-		}
+		v.BeginArray(NULL);
+		for (int j = 0; j < 2; j++)
+			v.Field(NULL, flags[i] ? values[i][j] : 0);
+		v.EndArray();
 	}
+	v.EndArray();
+}
 
-	if (is_slice_type(sh->slice_type, SLICE_TYPE_B))
+static void visit_pwt_lists(const char* luma_flag_key, const char* luma_weight_key, const char* luma_offset_key,
+	int* luma_flags, int* luma_weights, int* luma_offsets,
+	const char* chroma_flag_key, const char* chroma_weight_key, const char* chroma_offset_key,
+	int* chroma_flags, int (*chroma_weights)[2], int (*chroma_offsets)[2], SyntaxVisitor& v)
+{
+	int size = pwt_list_size(luma_flags);
+	if (size > 0)
 	{
-		for (i = 0; i <= 64; i++)
-		{
-			if (check_zero(&sh->pwt.luma_weight_l1_flag[i], 64 - i))
-				break;
-			json_pwt["luma_weight_l1_flag"][i] = sh->pwt.luma_weight_l1_flag[i];
-			if (sh->pwt.luma_weight_l1_flag[i])
-			{
-				json_pwt["luma_weight_l1"][i] = sh->pwt.luma_weight_l1[i];
-				json_pwt["luma_offset_l1"][i] = sh->pwt.luma_offset_l1[i];
-			}
-			else
-			{
-				json_pwt["luma_weight_l1"][i] = 0;
-				json_pwt["luma_offset_l1"][i] = 0;
-			}
-		}
-		for (i = 0; i <= 64; i++)
-		{
-			if (check_zero(&sh->pwt.chroma_weight_l1_flag[i], 64 - i))
-				break;
-			json_pwt["chroma_weight_l1_flag"][i] = sh->pwt.chroma_weight_l1_flag[i];
-			if (sh->pwt.chroma_weight_l1_flag[i])
-			{
-				for (j = 0; j < 2; j++)
-				{
-					json_pwt["chroma_weight_l1"][i][j] = sh->pwt.chroma_weight_l1[i][j];
-					json_pwt["chroma_weight_l1"][i][j] = sh->pwt.chroma_weight_l1[i][j];
-				}
-			}
-			else
-			{
-				for (j = 0; j < 2; j++)
-				{
-					json_pwt["chroma_weight_l1"][i][j] = 0;
-					json_pwt["chroma_weight_l1"][i][j] = 0;
-				}
-			}
-		}
+		visit_pwt_list(luma_flag_key, luma_flags, luma_flags, size, v);
+		visit_pwt_list(luma_weight_key, luma_weights, luma_flags, size, v);
+		visit_pwt_list(luma_offset_key, luma_offsets, luma_flags, size, v);
 	}
+	size = pwt_list_size(chroma_flags);
+	if (size > 0)
+	{
+		visit_pwt_list(chroma_flag_key, chroma_flags, chroma_flags, size, v);
+		visit_pwt_chroma_list(chroma_weight_key, chroma_weights, chroma_flags, size, v);
+		visit_pwt_chroma_list(chroma_offset_key, chroma_offsets, chroma_flags, size, v);
+	}
+}
 
-	return json_pwt;
+void visit_pwt(slice_header_t* sh, SyntaxVisitor& v)
+{
+	v.Field("luma_log2_weight_denom", sh->pwt.luma_log2_weight_denom);
+	v.Field("chroma_log2_weight_denom", sh->pwt.chroma_log2_weight_denom);
+	visit_pwt_lists("luma_weight_l0_flag", "luma_weight_l0", "luma_offset_l0",
+		sh->pwt.luma_weight_l0_flag, sh->pwt.luma_weight_l0, sh->pwt.luma_offset_l0,
+		"chroma_weight_l0_flag", "chroma_weight_l0", "chroma_offset_l0",
+		sh->pwt.chroma_weight_l0_flag, sh->pwt.chroma_weight_l0, sh->pwt.chroma_offset_l0, v);
+	if (is_slice_type(sh->slice_type, SLICE_TYPE_B))
+	{
+		visit_pwt_lists("luma_weight_l1_flag", "luma_weight_l1", "luma_offset_l1",
+			sh->pwt.luma_weight_l1_flag, sh->pwt.luma_weight_l1, sh->pwt.luma_offset_l1,
+			"chroma_weight_l1_flag", "chroma_weight_l1", "chroma_offset_l1",
+			sh->pwt.chroma_weight_l1_flag, sh->pwt.chroma_weight_l1, sh->pwt.chroma_offset_l1, v);
+	}
 }
 
 //7.3.3.3 Decoded reference picture marking syntax
@@ -953,35 +923,31 @@ void read_dec_ref_pic_marking(slice_header_t* sh, BitReader& b, uint8_t nal_unit
 	}
 }
 
-Json::Value drpm_to_json(slice_header_t* sh, uint8_t nal_unit_type)
+void visit_drpm(slice_header_t* sh, uint8_t nal_unit_type, SyntaxVisitor& v)
 {
-	Json::Value json_drpm;
-
 	if (nal_unit_type == 5)
 	{
-		json_drpm["no_output_of_prior_pics_flag"] = sh->drpm.no_output_of_prior_pics_flag;
-		json_drpm["long_term_reference_flag"] = sh->drpm.long_term_reference_flag;
+		v.Field("no_output_of_prior_pics_flag", sh->drpm.no_output_of_prior_pics_flag);
+		v.Field("long_term_reference_flag", sh->drpm.long_term_reference_flag);
 	}
 	else
 	{
-		json_drpm["adaptive_ref_pic_marking_mode_flag"] = sh->drpm.adaptive_ref_pic_marking_mode_flag;
+		v.Field("adaptive_ref_pic_marking_mode_flag", sh->drpm.adaptive_ref_pic_marking_mode_flag);
 		if (sh->drpm.adaptive_ref_pic_marking_mode_flag)
 		{
-			json_drpm["memory_management_control_operation"] = sh->drpm.memory_management_control_operation;
+			v.Field("memory_management_control_operation", sh->drpm.memory_management_control_operation);
 			if (sh->drpm.memory_management_control_operation == 1 ||
 				sh->drpm.memory_management_control_operation == 3)
-				json_drpm["difference_of_pic_nums_minus1"] = sh->drpm.difference_of_pic_nums_minus1;
+				v.Field("difference_of_pic_nums_minus1", sh->drpm.difference_of_pic_nums_minus1);
 			if (sh->drpm.memory_management_control_operation == 2)
-				json_drpm["long_term_pic_num"] = sh->drpm.long_term_pic_num;
+				v.Field("long_term_pic_num", sh->drpm.long_term_pic_num);
 			if (sh->drpm.memory_management_control_operation == 3 ||
 				sh->drpm.memory_management_control_operation == 6)
-				json_drpm["long_term_frame_idx"] = sh->drpm.long_term_frame_idx;
+				v.Field("long_term_frame_idx", sh->drpm.long_term_frame_idx);
 			if (sh->drpm.memory_management_control_operation == 4)
-				json_drpm["max_long_term_frame_idx_plus1"] = sh->drpm.max_long_term_frame_idx_plus1;
+				v.Field("max_long_term_frame_idx_plus1", sh->drpm.max_long_term_frame_idx_plus1);
 		}
 	}
-
-	return json_drpm;
 }
 
 //7.3.3 Slice header syntax
@@ -1084,75 +1050,85 @@ void read_slice_header_rbsp(slice_header_t* sh, BitReader& b, uint8_t nal_unit_t
 	}
 }
 
-Json::Value slice_header_to_json(slice_header_t* sh, uint8_t nal_unit_type, uint8_t nal_ref_idc)
+void visit_slice_header(slice_header_t* sh, uint8_t nal_unit_type, uint8_t nal_ref_idc, SyntaxVisitor& v)
 {
-	Json::Value json_slice_header;
-
-	json_slice_header["first_mb_in_slice"] = sh->first_mb_in_slice;
-	json_slice_header["slice_type"] = GetSliceTypeString(sh->slice_type);
-	json_slice_header["pic_parameter_set_id"] = sh->pic_parameter_set_id;
-	json_slice_header["frame_num"] = sh->frame_num;
-	json_slice_header["field_pic_flag"] = sh->field_pic_flag;
+	v.Field("first_mb_in_slice", sh->first_mb_in_slice);
+	v.Field("slice_type", GetSliceTypeString(sh->slice_type));
+	v.Field("pic_parameter_set_id", sh->pic_parameter_set_id);
+	v.Field("frame_num", sh->frame_num);
+	v.Field("field_pic_flag", sh->field_pic_flag);
 	if (sh->field_pic_flag && sh->bottom_field_flag)
-		json_slice_header["bottom_field_flag"] = sh->bottom_field_flag;
+		v.Field("bottom_field_flag", sh->bottom_field_flag);
 	if (nal_unit_type == 5)
-		json_slice_header["idr_pic_id"] = sh->idr_pic_id;
-	json_slice_header["pic_order_cnt_lsb"] = sh->pic_order_cnt_lsb;
+		v.Field("idr_pic_id", sh->idr_pic_id);
+	v.Field("pic_order_cnt_lsb", sh->pic_order_cnt_lsb);
 
 	if (!sh->field_pic_flag && sh->delta_pic_order_cnt_bottom)
-		json_slice_header["delta_pic_order_cnt_bottom"] = sh->delta_pic_order_cnt_bottom;
+		v.Field("delta_pic_order_cnt_bottom", sh->delta_pic_order_cnt_bottom);
 	if (!check_zero(sh->delta_pic_order_cnt, 2))
 	{
-		json_slice_header["delta_pic_order_cnt"].append(sh->delta_pic_order_cnt[0]);
+		v.BeginArray("delta_pic_order_cnt");
+		v.Field(NULL, sh->delta_pic_order_cnt[0]);
 		if (!sh->field_pic_flag)
-			json_slice_header["delta_pic_order_cnt"].append(sh->delta_pic_order_cnt[1]);
+			v.Field(NULL, sh->delta_pic_order_cnt[1]);
+		v.EndArray();
 	}
 	if (sh->redundant_pic_cnt)
-		json_slice_header["redundant_pic_cnt"] = sh->redundant_pic_cnt;
+		v.Field("redundant_pic_cnt", sh->redundant_pic_cnt);
 	if (is_slice_type(sh->slice_type, SLICE_TYPE_B) && sh->direct_spatial_mv_pred_flag)
-		json_slice_header["direct_spatial_mv_pred_flag"] = sh->direct_spatial_mv_pred_flag;
+		v.Field("direct_spatial_mv_pred_flag", sh->direct_spatial_mv_pred_flag);
 	if ((is_slice_type(sh->slice_type, SLICE_TYPE_P) || is_slice_type(sh->slice_type, SLICE_TYPE_SP) || is_slice_type(sh->slice_type, SLICE_TYPE_B))
 		&& sh->num_ref_idx_active_override_flag)
 	{
-		json_slice_header["num_ref_idx_active_override_flag"] = sh->num_ref_idx_active_override_flag;
+		v.Field("num_ref_idx_active_override_flag", sh->num_ref_idx_active_override_flag);
 		if (sh->num_ref_idx_l0_active_minus1)
-			json_slice_header["num_ref_idx_l0_active_minus1"] = sh->num_ref_idx_l0_active_minus1; // FIXME does this modify the pps?
+			v.Field("num_ref_idx_l0_active_minus1", sh->num_ref_idx_l0_active_minus1); // FIXME does this modify the pps?
 		if (is_slice_type(sh->slice_type, SLICE_TYPE_B) && sh->num_ref_idx_l1_active_minus1)
-			json_slice_header["num_ref_idx_l1_active_minus1"] = sh->num_ref_idx_l1_active_minus1;
+			v.Field("num_ref_idx_l1_active_minus1", sh->num_ref_idx_l1_active_minus1);
 	}
 
 	if (!check_zero(&sh->rplr, sizeof(slice_header_t::rplr_t)))
-		json_slice_header["ref_pic_list_reordering"] = rplr_to_json(sh);
+	{
+		v.BeginObject("ref_pic_list_reordering");
+		visit_rplr(sh, v);
+		v.EndObject();
+	}
 	if (!check_zero(&sh->pwt, sizeof(slice_header_t::pwt_t)))
-		json_slice_header["pred_weight_table"] = pwt_to_json(sh);
+	{
+		v.BeginObject("pred_weight_table");
+		visit_pwt(sh, v);
+		v.EndObject();
+	}
 	if (!check_zero(&sh->drpm, sizeof(slice_header_t::drpm_t)))
-		json_slice_header["dec_ref_pic_marking"] = drpm_to_json(sh, nal_unit_type);
+	{
+		v.BeginObject("dec_ref_pic_marking");
+		visit_drpm(sh, nal_unit_type, v);
+		v.EndObject();
+	}
 	
 	if (!is_slice_type(sh->slice_type, SLICE_TYPE_I) && !is_slice_type(sh->slice_type, SLICE_TYPE_SI) && sh->cabac_init_idc)
-		json_slice_header["cabac_init_idc"] = sh->cabac_init_idc;
-	json_slice_header["slice_qp_delta"] = sh->slice_qp_delta;
+		v.Field("cabac_init_idc", sh->cabac_init_idc);
+	v.Field("slice_qp_delta", sh->slice_qp_delta);
 	if (is_slice_type(sh->slice_type, SLICE_TYPE_SP) || is_slice_type(sh->slice_type, SLICE_TYPE_SI))
 	{
 		if (is_slice_type(sh->slice_type, SLICE_TYPE_SP) && sh->sp_for_switch_flag)
-			json_slice_header["sp_for_switch_flag"] = sh->sp_for_switch_flag;
+			v.Field("sp_for_switch_flag", sh->sp_for_switch_flag);
 		if (sh->slice_qs_delta)
-			json_slice_header["slice_qs_delta"] = sh->slice_qs_delta;
+			v.Field("slice_qs_delta", sh->slice_qs_delta);
 	}
 
 	if (sh->disable_deblocking_filter_idc)
-		json_slice_header["disable_deblocking_filter_idc"] = sh->disable_deblocking_filter_idc;
+		v.Field("disable_deblocking_filter_idc", sh->disable_deblocking_filter_idc);
 	if (sh->disable_deblocking_filter_idc != 1 && (sh->slice_alpha_c0_offset_div2 || sh->slice_beta_offset_div2))
 	{
-		json_slice_header["slice_alpha_c0_offset_div2"] = sh->slice_alpha_c0_offset_div2;
-		json_slice_header["slice_beta_offset_div2"] = sh->slice_beta_offset_div2;
+		v.Field("slice_alpha_c0_offset_div2", sh->slice_alpha_c0_offset_div2);
+		v.Field("slice_beta_offset_div2", sh->slice_beta_offset_div2);
 	}
 	if (sh->slice_group_change_cycle)
-		json_slice_header["slice_group_change_cycle"] = sh->slice_group_change_cycle;
-
-	return json_slice_header;
+		v.Field("slice_group_change_cycle", sh->slice_group_change_cycle);
 }
 
-std::string GetSliceTypeString(uint8_t type)
+const char* GetSliceTypeString(uint8_t type)
 {
 	static const char* slice_type_strings[10] = { "P", "B", "I", "SP", "SI", "P_ONLY", "B_ONLY", "I_ONLY", "SP_ONLY", "SI_ONLY"};
 	if (type < 10)
@@ -1272,29 +1248,21 @@ void release_seis(sei_t** seis, uint32_t num_seis)
 	free(seis);
 }
 
-Json::Value seis_to_json(sei_t** seis, uint32_t num_seis)
+void visit_seis(sei_t** seis, uint32_t num_seis, SyntaxVisitor& v)
 {
-	Json::Value json_seis;
-
-	if (!seis || !num_seis)
-		return json_seis;
-
 	for (uint32_t i = 0; i < num_seis; i++)
 	{
-		Json::Value json_sei;
 		sei_t *sei = seis[i];
 		if (!sei)
 			continue;
 
-		json_sei["payloadType"] = sei->payloadType;
+		v.BeginObject(NULL);
+		v.Field("payloadType", sei->payloadType);
 		if ((sei->payloadType == 5 || sei->payloadType == 100) && sei->payload && sei->payloadSize)
 		{
-			std::string sei_content = std::string((char *)sei->payload, sei->payloadSize);
-			json_sei["payload"] = sei_content;
-			json_sei["payloadSize"] = sei->payloadSize;
+			v.String("payload", (const char*)sei->payload, sei->payloadSize);
+			v.Field("payloadSize", sei->payloadSize);
 		}
-		json_seis.append(json_sei);
+		v.EndObject();
 	}
-
-	return json_seis;
 }
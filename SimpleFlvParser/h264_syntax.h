@@ -3,7 +3,6 @@
 
 #include "bytes.h"
 #include <string>
-#include "json/value.h"
 
 #define MAX_ARRAY_SIZE 16
 #define SAFE_ARRAY_SIZE(n) (n < MAX_ARRAY_SIZE ? n : MAX_ARRAY_SIZE)
@@ -264,7 +263,7 @@ typedef struct slice_header_t
 	} drpm; // decoded ref pic marking
 } slice_header_t;
 
-std::string GetSliceTypeString(uint8_t type);
+const char* GetSliceTypeString(uint8_t type);
 
 typedef struct
 {
@@ -274,20 +273,21 @@ typedef struct
 } sei_t;
 
 class BitReader;
+class SyntaxVisitor;
 
 int  nal_to_rbsp(const uint8_t* nal_buf, int* nal_size, uint8_t* rbsp_buf, int* rbsp_size);
 
 void read_seq_parameter_set_rbsp(sps_t* sps, BitReader& b);
 
-Json::Value sps_to_json(sps_t* sps);
+void visit_sps(sps_t* sps, SyntaxVisitor& v);
 
 void read_pic_parameter_set_rbsp(pps_t* pps, BitReader& b);
 
-Json::Value pps_to_json(pps_t* pps);
+void visit_pps(pps_t* pps, SyntaxVisitor& v);
 
 void read_slice_header_rbsp(slice_header_t* sh, BitReader& b, uint8_t nal_unit_type, uint8_t nal_ref_idc, sps_t* sps, pps_t* pps);
 
-Json::Value slice_header_to_json(slice_header_t* sh, uint8_t nal_unit_type, uint8_t nal_ref_idc);
+void visit_slice_header(slice_header_t* sh, uint8_t nal_unit_type, uint8_t nal_ref_idc, SyntaxVisitor& v);
 
 sei_t** read_sei_rbsp(uint32_t *num_seis, BitReader& b);
 
@@ -295,6 +295,7 @@ void read_sei_end_bits(BitReader& b);
 
 void release_seis(sei_t** seis, uint32_t num_seis);
 
-Json::Value seis_to_json(sei_t** seis, uint32_t num_seis);
+//the seis are written as the elements of the current array
+void visit_seis(sei_t** seis, uint32_t num_seis, SyntaxVisitor& v);
 
 #endif
@@ -1,4 +1,5 @@
 #include "hevc_syntax.h"
+#include "syntax_visitor.h"
 #include "utils.h"
 #include <math.h>
 
@@ -489,70 +490,67 @@ std::string hevc_vui_video_format_string(int video_format) {
 	return std::string("Unknown_") + std::to_string(video_format);
 }
 
-Json::Value hevc_vui_to_json(vui_parameters_t* s)
+void visit_hevc_vui(vui_parameters_t* s, SyntaxVisitor& v)
 {
-	Json::Value json_vui;
-	json_vui["aspect_ratio_info_present_flag"] = s->aspect_ratio_info_present_flag;
+	v.Field("aspect_ratio_info_present_flag", s->aspect_ratio_info_present_flag);
 	if (s->aspect_ratio_info_present_flag) {
-		json_vui["aspect_ratio_idc"] = s->aspect_ratio_idc;
+		v.Field("aspect_ratio_idc", s->aspect_ratio_idc);
 		if (s->aspect_ratio_idc == EXTENDED_SAR) {
-			json_vui["sar_width"] = s->sar_width;
-			json_vui["sar_height"] = s->sar_height;
+			v.Field("sar_width", s->sar_width);
+			v.Field("sar_height", s->sar_height);
 		}
 	}
-	json_vui["overscan_info_present_flag"] = s->overscan_info_present_flag;
+	v.Field("overscan_info_present_flag", s->overscan_info_present_flag);
 	if (s->overscan_info_present_flag) 
-		json_vui["overscan_appropriate_flag"] = s->overscan_appropriate_flag;
-	json_vui["video_signal_type_present_flag"] = s->video_signal_type_present_flag;
+		v.Field("overscan_appropriate_flag", s->overscan_appropriate_flag);
+	v.Field("video_signal_type_present_flag", s->video_signal_type_present_flag);
 	if (s->video_signal_type_present_flag) {
-		json_vui["video_format"] = hevc_vui_video_format_string(s->video_format);
-		json_vui["video_full_range_flag"] = s->video_full_range_flag;
-		json_vui["colour_description_present_flag"] = s->colour_description_present_flag;
+		v.Field("video_format", hevc_vui_video_format_string(s->video_format));
+		v.Field("video_full_range_flag", s->video_full_range_flag);
+		v.Field("colour_description_present_flag", s->colour_description_present_flag);
 		if (s->colour_description_present_flag) { 
-			json_vui["colour_primaries"] = s->colour_primaries;
-			json_vui["transfer_characteristics"] = s->transfer_characteristics;
-			json_vui["matrix_coeffs"] = s->matrix_coeffs;
+			v.Field("colour_primaries", s->colour_primaries);
+			v.Field("transfer_characteristics", s->transfer_characteristics);
+			v.Field("matrix_coeffs", s->matrix_coeffs);
 		} 
 	}
-	json_vui["chroma_loc_info_present_flag"] = s->chroma_loc_info_present_flag;
+	v.Field("chroma_loc_info_present_flag", s->chroma_loc_info_present_flag);
 	if (s->chroma_loc_info_present_flag) {
-		json_vui["chroma_sample_loc_type_top_field"] = s->chroma_sample_loc_type_top_field;
-		json_vui["chroma_sample_loc_type_bottom_field"] = s->chroma_sample_loc_type_bottom_field;
+		v.Field("chroma_sample_loc_type_top_field", s->chroma_sample_loc_type_top_field);
+		v.Field("chroma_sample_loc_type_bottom_field", s->chroma_sample_loc_type_bottom_field);
 	}
-	json_vui["neutral_chroma_indication_flag"] = s->neutral_chroma_indication_flag;
-	json_vui["field_seq_flag"] = s->field_seq_flag;
-	json_vui["frame_field_info_present_flag"] = s->frame_field_info_present_flag;
-	json_vui["default_display_window_flag"] = s->default_display_window_flag;
+	v.Field("neutral_chroma_indication_flag", s->neutral_chroma_indication_flag);
+	v.Field("field_seq_flag", s->field_seq_flag);
+	v.Field("frame_field_info_present_flag", s->frame_field_info_present_flag);
+	v.Field("default_display_window_flag", s->default_display_window_flag);
 	if (s->default_display_window_flag) { 
-		json_vui["def_disp_win_left_offset"] = s->def_disp_win_left_offset;
-		json_vui["def_disp_win_right_offset"] = s->def_disp_win_right_offset;
-		json_vui["def_disp_win_top_offset"] = s->def_disp_win_top_offset;
-		json_vui["def_disp_win_bottom_offset"] = s->def_disp_win_bottom_offset;
+		v.Field("def_disp_win_left_offset", s->def_disp_win_left_offset);
+		v.Field("def_disp_win_right_offset", s->def_disp_win_right_offset);
+		v.Field("def_disp_win_top_offset", s->def_disp_win_top_offset);
+		v.Field("def_disp_win_bottom_offset", s->def_disp_win_bottom_offset);
 	} 
-	json_vui["vui_timing_info_present_flag"] = s->vui_timing_info_present_flag;
+	v.Field("vui_timing_info_present_flag", s->vui_timing_info_present_flag);
 	if (s->vui_timing_info_present_flag) { 
-		json_vui["vui_num_units_in_tick"] = s->vui_num_units_in_tick;
-		json_vui["vui_time_scale"] = s->vui_time_scale;
-		json_vui["vui_poc_proportional_to_timing_flag"] = s->vui_poc_proportional_to_timing_flag;
+		v.Field("vui_num_units_in_tick", s->vui_num_units_in_tick);
+		v.Field("vui_time_scale", s->vui_time_scale);
+		v.Field("vui_poc_proportional_to_timing_flag", s->vui_poc_proportional_to_timing_flag);
 		if (s->vui_poc_proportional_to_timing_flag) 
-			json_vui["vui_num_ticks_poc_diff_one_minus1"] = s->vui_num_ticks_poc_diff_one_minus1;
-		json_vui["vui_hrd_parameters_present_flag"] = s->vui_hrd_parameters_present_flag;
+			v.Field("vui_num_ticks_poc_diff_one_minus1", s->vui_num_ticks_poc_diff_one_minus1);
+		v.Field("vui_hrd_parameters_present_flag", s->vui_hrd_parameters_present_flag);
 		// if (s->vui_hrd_parameters_present_flag)
 		// 	parse_hrd_parameters(&s->hrd, b, 1, sps->sps_max_sub_layers_minus1);
 	}
-	json_vui["bitstream_restriction_flag"] = s->bitstream_restriction_flag;
+	v.Field("bitstream_restriction_flag", s->bitstream_restriction_flag);
 	if (s->bitstream_restriction_flag) {
-		json_vui["tiles_fixed_structure_flag"] = s->tiles_fixed_structure_flag;
-		json_vui["motion_vectors_over_pic_boundaries_flag"] = s->motion_vectors_over_pic_boundaries_flag;
-		json_vui["restricted_ref_pic_lists_flag"] = s->restricted_ref_pic_lists_flag;
-		json_vui["min_spatial_segmentation_idc"] = s->min_spatial_segmentation_idc;
-		json_vui["max_bytes_per_pic_denom"] = s->max_bytes_per_pic_denom;
-		json_vui["max_bits_per_min_cu_denom"] = s->max_bits_per_min_cu_denom;
-		json_vui["log2_max_mv_length_horizontal"] = s->log2_max_mv_length_horizontal;
-		json_vui["log2_max_mv_length_vertical"] = s->log2_max_mv_length_vertical;
+		v.Field("tiles_fixed_structure_flag", s->tiles_fixed_structure_flag);
+		v.Field("motion_vectors_over_pic_boundaries_flag", s->motion_vectors_over_pic_boundaries_flag);
+		v.Field("restricted_ref_pic_lists_flag", s->restricted_ref_pic_lists_flag);
+		v.Field("min_spatial_segmentation_idc", s->min_spatial_segmentation_idc);
+		v.Field("max_bytes_per_pic_denom", s->max_bytes_per_pic_denom);
+		v.Field("max_bits_per_min_cu_denom", s->max_bits_per_min_cu_denom);
+		v.Field("log2_max_mv_length_horizontal", s->log2_max_mv_length_horizontal);
+		v.Field("log2_max_mv_length_vertical", s->log2_max_mv_length_vertical);
 	}
-
-	return json_vui;
 }
 
 //7.3.2.1 Video parameter set RBSP syntax
@@ -602,29 +600,27 @@ void read_hevc_video_parameter_set_rbsp(hevc_vps_t* s, BitReader& b)
 	read_hevc_rbsp_trailing_bits(b);
 }
 
-Json::Value hevc_vps_to_json(hevc_vps_t* vps)
+void visit_hevc_vps(hevc_vps_t* vps, SyntaxVisitor& v)
 {
-	Json::Value json_vps;
-	json_vps["vps_video_parameter_set_id"] = vps->vps_video_parameter_set_id;
-	json_vps["vps_base_layer_internal_flag"] = vps->vps_base_layer_internal_flag;
-	json_vps["vps_base_layer_available_flag"] = vps->vps_base_layer_available_flag;
-	json_vps["vps_max_layers_minus1"] = vps->vps_max_layers_minus1;
-	json_vps["vps_max_sub_layers_minus1"] = vps->vps_max_sub_layers_minus1;
-	json_vps["vps_temporal_id_nesting_flag"] = vps->vps_temporal_id_nesting_flag;
+	v.Field("vps_video_parameter_set_id", vps->vps_video_parameter_set_id);
+	v.Field("vps_base_layer_internal_flag", vps->vps_base_layer_internal_flag);
+	v.Field("vps_base_layer_available_flag", vps->vps_base_layer_available_flag);
+	v.Field("vps_max_layers_minus1", vps->vps_max_layers_minus1);
+	v.Field("vps_max_sub_layers_minus1", vps->vps_max_sub_layers_minus1);
+	v.Field("vps_temporal_id_nesting_flag", vps->vps_temporal_id_nesting_flag);
 	//parse_profile_tier_level(&s->profile_tier_level, b, s->vps_max_sub_layers_minus1);
-	json_vps["vps_sub_layer_ordering_info_present_flag"] = vps->vps_sub_layer_ordering_info_present_flag;
-	json_vps["vps_max_layer_id"] = vps->vps_max_layer_id;
-	json_vps["vps_num_layer_sets_minus1"] = vps->vps_num_layer_sets_minus1;
-	json_vps["vps_timing_info_present_flag"] = vps->vps_timing_info_present_flag;
+	v.Field("vps_sub_layer_ordering_info_present_flag", vps->vps_sub_layer_ordering_info_present_flag);
+	v.Field("vps_max_layer_id", vps->vps_max_layer_id);
+	v.Field("vps_num_layer_sets_minus1", vps->vps_num_layer_sets_minus1);
+	v.Field("vps_timing_info_present_flag", vps->vps_timing_info_present_flag);
 	if (vps->vps_timing_info_present_flag) {
-		json_vps["vps_num_units_in_tick"] = vps->vps_num_units_in_tick;
-		json_vps["vps_time_scale"] = vps->vps_time_scale;
-		json_vps["vps_poc_proportional_to_timing_flag"] = vps->vps_poc_proportional_to_timing_flag;
-		json_vps["vps_num_ticks_poc_diff_one_minus1"] = vps->vps_num_ticks_poc_diff_one_minus1;
-		json_vps["vps_num_hrd_parameters"] = vps->vps_num_hrd_parameters;
+		v.Field("vps_num_units_in_tick", vps->vps_num_units_in_tick);
+		v.Field("vps_time_scale", vps->vps_time_scale);
+		v.Field("vps_poc_proportional_to_timing_flag", vps->vps_poc_proportional_to_timing_flag);
+		v.Field("vps_num_ticks_poc_diff_one_minus1", vps->vps_num_ticks_poc_diff_one_minus1);
+		v.Field("vps_num_hrd_parameters", vps->vps_num_hrd_parameters);
 		//parse_hrd_parameters(&s->hrd[i], b, s->cprms_present_flag[i], s->vps_max_sub_layers_minus1);
 	}
-	return json_vps;
 }
 
 //7.4.3.2 Sequence parameter set RBSP semantics
@@ -721,56 +717,57 @@ void read_hevc_seq_parameter_set_rbsp(hevc_sps_t* s, BitReader& b)
 	read_hevc_rbsp_trailing_bits(b);
 }
 
-Json::Value hevc_sps_to_json(hevc_sps_t* sps)
+void visit_hevc_sps(hevc_sps_t* sps, SyntaxVisitor& v)
 {
-	Json::Value json_sps;
-	json_sps["sps_video_parameter_set_id"] = sps->sps_video_parameter_set_id;
-	json_sps["sps_max_sub_layers_minus1"] = sps->sps_max_sub_layers_minus1;
-	json_sps["sps_temporal_id_nesting_flag"] = sps->sps_temporal_id_nesting_flag;
+	v.Field("sps_video_parameter_set_id", sps->sps_video_parameter_set_id);
+	v.Field("sps_max_sub_layers_minus1", sps->sps_max_sub_layers_minus1);
+	v.Field("sps_temporal_id_nesting_flag", sps->sps_temporal_id_nesting_flag);
 	//parse_profile_tier_level(&s->profile_tier_level, b, s->sps_max_sub_layers_minus1);
-	json_sps["sps_seq_parameter_set_id"] = sps->sps_seq_parameter_set_id;
-	json_sps["chroma_format_idc"] = sps->chroma_format_idc;
-	json_sps["separate_colour_plane_flag"] = sps->separate_colour_plane_flag;
-	json_sps["pic_width_in_luma_samples"] = sps->pic_width_in_luma_samples;
-	json_sps["pic_height_in_luma_samples"] = sps->pic_height_in_luma_samples;
+	v.Field("sps_seq_parameter_set_id", sps->sps_seq_parameter_set_id);
+	v.Field("chroma_format_idc", sps->chroma_format_idc);
+	v.Field("separate_colour_plane_flag", sps->separate_colour_plane_flag);
+	v.Field("pic_width_in_luma_samples", sps->pic_width_in_luma_samples);
+	v.Field("pic_height_in_luma_samples", sps->pic_height_in_luma_samples);
 	if (sps->conformance_window_flag) { 
-		json_sps["conf_win_left_offset"] = sps->conf_win_left_offset;
-		json_sps["conf_win_right_offset"] = sps->conf_win_right_offset;
-		json_sps["conf_win_top_offset"] = sps->conf_win_top_offset;
-		json_sps["conf_win_bottom_offset"] = sps->conf_win_bottom_offset;
+		v.Field("conf_win_left_offset", sps->conf_win_left_offset);
+		v.Field("conf_win_right_offset", sps->conf_win_right_offset);
+		v.Field("conf_win_top_offset", sps->conf_win_top_offset);
+		v.Field("conf_win_bottom_offset", sps->conf_win_bottom_offset);
 	}
-	json_sps["bit_depth_luma_minus8"] = sps->bit_depth_luma_minus8;
-	json_sps["bit_depth_chroma_minus8"] = sps->bit_depth_chroma_minus8;
+	v.Field("bit_depth_luma_minus8", sps->bit_depth_luma_minus8);
+	v.Field("bit_depth_chroma_minus8", sps->bit_depth_chroma_minus8);
 	//s->log2_max_pic_order_cnt_lsb_minus4 = b.ReadUE(); 
-	json_sps["sps_sub_layer_ordering_info_present_flag"] = sps->sps_sub_layer_ordering_info_present_flag;
+	v.Field("sps_sub_layer_ordering_info_present_flag", sps->sps_sub_layer_ordering_info_present_flag);
 	// s->log2_min_luma_coding_block_size_minus3 = b.ReadUE(); 
 	// s->log2_diff_max_min_luma_coding_block_size = b.ReadUE(); 
 	// s->log2_min_transform_block_size_minus2 = b.ReadUE(); 
 	// s->log2_diff_max_min_transform_block_size = b.ReadUE(); 
-	json_sps["max_transform_hierarchy_depth_inter"] = sps->max_transform_hierarchy_depth_inter;
-	json_sps["max_transform_hierarchy_depth_intra"] = sps->max_transform_hierarchy_depth_intra;
-	json_sps["scaling_list_enabled_flag"] = sps->scaling_list_enabled_flag;
-	json_sps["sps_scaling_list_data_present_flag"] = sps->sps_scaling_list_data_present_flag;
-	json_sps["amp_enabled_flag"] = sps->amp_enabled_flag;
-	json_sps["sample_adaptive_offset_enabled_flag"] = sps->sample_adaptive_offset_enabled_flag;
-	json_sps["pcm_enabled_flag"] = sps->pcm_enabled_flag;
+	v.Field("max_transform_hierarchy_depth_inter", sps->max_transform_hierarchy_depth_inter);
+	v.Field("max_transform_hierarchy_depth_intra", sps->max_transform_hierarchy_depth_intra);
+	v.Field("scaling_list_enabled_flag", sps->scaling_list_enabled_flag);
+	v.Field("sps_scaling_list_data_present_flag", sps->sps_scaling_list_data_present_flag);
+	v.Field("amp_enabled_flag", sps->amp_enabled_flag);
+	v.Field("sample_adaptive_offset_enabled_flag", sps->sample_adaptive_offset_enabled_flag);
+	v.Field("pcm_enabled_flag", sps->pcm_enabled_flag);
 	if (sps->pcm_enabled_flag) { 
-		json_sps["pcm_sample_bit_depth_luma_minus1"] = sps->pcm_sample_bit_depth_luma_minus1;
-		json_sps["pcm_sample_bit_depth_chroma_minus1"] = sps->pcm_sample_bit_depth_chroma_minus1;
+		v.Field("pcm_sample_bit_depth_luma_minus1", sps->pcm_sample_bit_depth_luma_minus1);
+		v.Field("pcm_sample_bit_depth_chroma_minus1", sps->pcm_sample_bit_depth_chroma_minus1);
 		// s->log2_min_pcm_luma_coding_block_size_minus3 = b.ReadUE(); 
 		// s->log2_diff_max_min_pcm_luma_coding_block_size = b.ReadUE(); 
-		json_sps["pcm_loop_filter_disabled_flag"] = sps->pcm_loop_filter_disabled_flag;
+		v.Field("pcm_loop_filter_disabled_flag", sps->pcm_loop_filter_disabled_flag);
 	} 
-	json_sps["num_short_term_ref_pic_sets"] = sps->num_short_term_ref_pic_sets;
-	json_sps["long_term_ref_pics_present_flag"] = sps->long_term_ref_pics_present_flag;
-	json_sps["num_long_term_ref_pics_sps"] = sps->num_long_term_ref_pics_sps;
-	json_sps["sps_temporal_mvp_enabled_flag"] = sps->sps_temporal_mvp_enabled_flag;
-	json_sps["strong_intra_smoothing_enabled_flag"] = sps->strong_intra_smoothing_enabled_flag;
-	json_sps["vui_parameters_present_flag"] = sps->vui_parameters_present_flag;
+	v.Field("num_short_term_ref_pic_sets", sps->num_short_term_ref_pic_sets);
+	v.Field("long_term_ref_pics_present_flag", sps->long_term_ref_pics_present_flag);
+	v.Field("num_long_term_ref_pics_sps", sps->num_long_term_ref_pics_sps);
+	v.Field("sps_temporal_mvp_enabled_flag", sps->sps_temporal_mvp_enabled_flag);
+	v.Field("strong_intra_smoothing_enabled_flag", sps->strong_intra_smoothing_enabled_flag);
+	v.Field("vui_parameters_present_flag", sps->vui_parameters_present_flag);
 	if (sps->vui_parameters_present_flag) 
-		json_sps["vui"] = hevc_vui_to_json(&sps->vui);
-
-	return json_sps;
+	{
+		v.BeginObject("vui");
+		visit_hevc_vui(&sps->vui, v);
+		v.EndObject();
+	}
 }
 
 void read_hevc_pic_parameter_set_rbsp(hevc_pps_t* s, BitReader& b)
@@ -835,65 +832,63 @@ void read_hevc_pic_parameter_set_rbsp(hevc_pps_t* s, BitReader& b)
 	read_hevc_rbsp_trailing_bits(b);
 }
 
-Json::Value hevc_pps_to_json(hevc_pps_t* s)
+void visit_hevc_pps(hevc_pps_t* s, SyntaxVisitor& v)
 {
-	Json::Value json_pps;
-	json_pps["pps_pic_parameter_set_id"] = s->pps_pic_parameter_set_id;
-	json_pps["pps_seq_parameter_set_id"] = s->pps_seq_parameter_set_id;
-	json_pps["dependent_slice_segments_enabled_flag"] = s->dependent_slice_segments_enabled_flag;
-	json_pps["output_flag_present_flag"] = s->output_flag_present_flag;
-	json_pps["num_extra_slice_header_bits"] = s->num_extra_slice_header_bits;
-	json_pps["sign_data_hiding_enabled_flag"] = s->sign_data_hiding_enabled_flag;
-	json_pps["cabac_init_present_flag"] = s->cabac_init_present_flag;
-	json_pps["num_ref_idx_l0_default_active_minus1"] = s->num_ref_idx_l0_default_active_minus1;
-	json_pps["num_ref_idx_l1_default_active_minus1"] = s->num_ref_idx_l1_default_active_minus1;
-	json_pps["init_qp_minus26"] = s->init_qp_minus26;
-	json_pps["constrained_intra_pred_flag"] = s->constrained_intra_pred_flag;
-	json_pps["transform_skip_enabled_flag"] = s->transform_skip_enabled_flag;
-	json_pps["cu_qp_delta_enabled_flag"] = s->cu_qp_delta_enabled_flag;
+	v.Field("pps_pic_parameter_set_id", s->pps_pic_parameter_set_id);
+	v.Field("pps_seq_parameter_set_id", s->pps_seq_parameter_set_id);
+	v.Field("dependent_slice_segments_enabled_flag", s->dependent_slice_segments_enabled_flag);
+	v.Field("output_flag_present_flag", s->output_flag_present_flag);
+	v.Field("num_extra_slice_header_bits", s->num_extra_slice_header_bits);
+	v.Field("sign_data_hiding_enabled_flag", s->sign_data_hiding_enabled_flag);
+	v.Field("cabac_init_present_flag", s->cabac_init_present_flag);
+	v.Field("num_ref_idx_l0_default_active_minus1", s->num_ref_idx_l0_default_active_minus1);
+	v.Field("num_ref_idx_l1_default_active_minus1", s->num_ref_idx_l1_default_active_minus1);
+	v.Field("init_qp_minus26", s->init_qp_minus26);
+	v.Field("constrained_intra_pred_flag", s->constrained_intra_pred_flag);
+	v.Field("transform_skip_enabled_flag", s->transform_skip_enabled_flag);
+	v.Field("cu_qp_delta_enabled_flag", s->cu_qp_delta_enabled_flag);
 	if (s->cu_qp_delta_enabled_flag)
-		json_pps["diff_cu_qp_delta_depth"] = s->diff_cu_qp_delta_depth;
-	json_pps["pps_cb_qp_offset"] = s->pps_cb_qp_offset;
-	json_pps["pps_cr_qp_offset"] = s->pps_cr_qp_offset;
-	json_pps["pps_slice_chroma_qp_offsets_present_flag"] = s->pps_slice_chroma_qp_offsets_present_flag;
-	json_pps["weighted_pred_flag"] = s->weighted_pred_flag;
-	json_pps["weighted_bipred_flag"] = s->weighted_bipred_flag;
-	json_pps["transquant_bypass_enabled_flag"] = s->transquant_bypass_enabled_flag;
-	json_pps["tiles_enabled_flag"] = s->tiles_enabled_flag;
-	json_pps["entropy_coding_sync_enabled_flag"] = s->entropy_coding_sync_enabled_flag;
+		v.Field("diff_cu_qp_delta_depth", s->diff_cu_qp_delta_depth);
+	v.Field("pps_cb_qp_offset", s->pps_cb_qp_offset);
+	v.Field("pps_cr_qp_offset", s->pps_cr_qp_offset);
+	v.Field("pps_slice_chroma_qp_offsets_present_flag", s->pps_slice_chroma_qp_offsets_present_flag);
+	v.Field("weighted_pred_flag", s->weighted_pred_flag);
+	v.Field("weighted_bipred_flag", s->weighted_bipred_flag);
+	v.Field("transquant_bypass_enabled_flag", s->transquant_bypass_enabled_flag);
+	v.Field("tiles_enabled_flag", s->tiles_enabled_flag);
+	v.Field("entropy_coding_sync_enabled_flag", s->entropy_coding_sync_enabled_flag);
 	if (s->tiles_enabled_flag) {
-		json_pps["num_tile_columns_minus1"] = s->num_tile_columns_minus1;
-		json_pps["num_tile_rows_minus1"] = s->num_tile_rows_minus1;
-		json_pps["uniform_spacing_flag"] = s->uniform_spacing_flag;
+		v.Field("num_tile_columns_minus1", s->num_tile_columns_minus1);
+		v.Field("num_tile_rows_minus1", s->num_tile_rows_minus1);
+		v.Field("uniform_spacing_flag", s->uniform_spacing_flag);
 		if (!s->uniform_spacing_flag) {
-			Json::Value column_width_minus1, row_height_minus1;
+			v.BeginArray("column_width_minus1");
 			for (int i = 0; i < s->num_tile_columns_minus1; i++)
-				column_width_minus1.append(s->column_width_minus1[i]);
+				v.Field(NULL, s->column_width_minus1[i]);
+			v.EndArray();
+			v.BeginArray("row_height_minus1");
 			for (int i = 0; i < s->num_tile_rows_minus1; i++)
-				row_height_minus1.append(s->row_height_minus1[i]);
-			json_pps["column_width_minus1"] = column_width_minus1;
-			json_pps["row_height_minus1"] = row_height_minus1;
+				v.Field(NULL, s->row_height_minus1[i]);
+			v.EndArray();
 		}
-		json_pps["loop_filter_across_tiles_enabled_flag"] = s->loop_filter_across_tiles_enabled_flag;
+		v.Field("loop_filter_across_tiles_enabled_flag", s->loop_filter_across_tiles_enabled_flag);
 	} 
-	json_pps["pps_loop_filter_across_slices_enabled_flag"] = s->pps_loop_filter_across_slices_enabled_flag;
-	json_pps["deblocking_filter_control_present_flag"] = s->deblocking_filter_control_present_flag;
+	v.Field("pps_loop_filter_across_slices_enabled_flag", s->pps_loop_filter_across_slices_enabled_flag);
+	v.Field("deblocking_filter_control_present_flag", s->deblocking_filter_control_present_flag);
 	if (s->deblocking_filter_control_present_flag) { 
-		json_pps["deblocking_filter_override_enabled_flag"] = s->deblocking_filter_override_enabled_flag;
-		json_pps["pps_deblocking_filter_disabled_flag"] = s->pps_deblocking_filter_disabled_flag;
+		v.Field("deblocking_filter_override_enabled_flag", s->deblocking_filter_override_enabled_flag);
+		v.Field("pps_deblocking_filter_disabled_flag", s->pps_deblocking_filter_disabled_flag);
 		if (!s->pps_deblocking_filter_disabled_flag) { 
-			json_pps["pps_beta_offset_div2"] = s->pps_beta_offset_div2;
-			json_pps["pps_tc_offset_div2"] = s->pps_tc_offset_div2;
+			v.Field("pps_beta_offset_div2", s->pps_beta_offset_div2);
+			v.Field("pps_tc_offset_div2", s->pps_tc_offset_div2);
 		} 
 	}
-	json_pps["pps_scaling_list_data_present_flag"] = s->pps_scaling_list_data_present_flag;
+	v.Field("pps_scaling_list_data_present_flag", s->pps_scaling_list_data_present_flag);
 	// if (s->pps_scaling_list_data_present_flag) 
 	// 	parse_scaling_list_data(&s->scaling_list_data, b); 
-	json_pps["lists_modification_present_flag"] = s->lists_modification_present_flag;
-	json_pps["log2_parallel_merge_level_minus2"] = s->log2_parallel_merge_level_minus2;
-	json_pps["slice_segment_header_extension_present_flag"] = s->slice_segment_header_extension_present_flag;
-
-	return json_pps;
+	v.Field("lists_modification_present_flag", s->lists_modification_present_flag);
+	v.Field("log2_parallel_merge_level_minus2", s->log2_parallel_merge_level_minus2);
+	v.Field("slice_segment_header_extension_present_flag", s->slice_segment_header_extension_present_flag);
 }
 
 hevc_sei_t* hevc_sei_new()
@@ -1019,31 +1014,23 @@ void release_hevc_seis(hevc_sei_t** seis, uint32_t num_seis)
 	free(seis);
 }
 
-Json::Value hevc_seis_to_json(hevc_sei_t** seis, uint32_t num_seis)
+void visit_hevc_seis(hevc_sei_t** seis, uint32_t num_seis, SyntaxVisitor& v)
 {
-	Json::Value json_seis;
-
-	if (!seis || !num_seis)
-		return json_seis;
-
 	for (uint32_t i = 0; i < num_seis; i++)
 	{
-		Json::Value json_sei;
 		hevc_sei_t *sei = seis[i];
 		if (!sei)
 			continue;
 
-		json_sei["payloadType"] = sei->payloadType;
+		v.BeginObject(NULL);
+		v.Field("payloadType", sei->payloadType);
 		if ((sei->payloadType == 5 || sei->payloadType == 100) && sei->payload && sei->payloadSize)
 		{
-			std::string sei_content = std::string((char *)sei->payload, sei->payloadSize);
-			json_sei["payload"] = sei_content;
-			json_sei["payloadSize"] = sei->payloadSize;
+			v.String("payload", (const char*)sei->payload, sei->payloadSize);
+			v.Field("payloadSize", sei->payloadSize);
 		}
-		json_seis.append(json_sei);
+		v.EndObject();
 	}
-
-	return json_seis;
 }
 
 //see 7.3.2.9 Slice segment layer RBSP syntax
@@ -1164,108 +1151,108 @@ void hevc_slice_segment_header(hevc_slice_header_t* s, BitReader& b, uint8_t nal
 	read_hevc_rbsp_trailing_bits(b);
 }
 
-std::string hevc_slice_type_string(int type)
+const char* hevc_slice_type_string(int type)
 {
 	static const char* hevc_slice_type_strings[3] = { "B", "P", "I" };
 	if (type >= 0 && type < 3)
 		return hevc_slice_type_strings[type];
-	return std::string("Unknown_") + std::to_string(type);
+	return "Unknown";
 }
 
-Json::Value hevc_slice_segment_header_to_json(hevc_slice_header_t* s, int nal_unit_type, hevc_sps_t* sps, hevc_pps_t* pps)
+void visit_hevc_slice_segment_header(hevc_slice_header_t* s, int nal_unit_type, hevc_sps_t* sps, hevc_pps_t* pps, SyntaxVisitor& v)
 {
 	int i;
-	Json::Value json_slice_header;
-	json_slice_header["first_slice_segment_in_pic_flag"] = s->first_slice_segment_in_pic_flag;
+	v.Field("first_slice_segment_in_pic_flag", s->first_slice_segment_in_pic_flag);
 	if (nal_unit_type >= HevcNaluTypeCodedSliceBLA && nal_unit_type <= HevcNaluTypeReserved23) 
-		json_slice_header["no_output_of_prior_pics_flag"] = s->no_output_of_prior_pics_flag;
-	json_slice_header["slice_pic_parameter_set_id"] = s->slice_pic_parameter_set_id;
+		v.Field("no_output_of_prior_pics_flag", s->no_output_of_prior_pics_flag);
+	v.Field("slice_pic_parameter_set_id", s->slice_pic_parameter_set_id);
 	if (!s->first_slice_segment_in_pic_flag) { 
 		if (pps->dependent_slice_segments_enabled_flag) 
-			json_slice_header["dependent_slice_segment_flag"] = s->dependent_slice_segment_flag;
-		json_slice_header["slice_segment_address"] = s->slice_segment_address;
+			v.Field("dependent_slice_segment_flag", s->dependent_slice_segment_flag);
+		v.Field("slice_segment_address", s->slice_segment_address);
 	} 
 	if (!s->dependent_slice_segment_flag) {
-		json_slice_header["slice_type"] = hevc_slice_type_string(s->slice_type);
+		if (s->slice_type >= 0 && s->slice_type < 3)
+			v.Field("slice_type", hevc_slice_type_string(s->slice_type));
+		else //an unknown type keeps its value
+			v.Field("slice_type", std::string("Unknown_") + std::to_string(s->slice_type));
 		if (pps->output_flag_present_flag) 
-			json_slice_header["pic_output_flag"] = s->pic_output_flag;
+			v.Field("pic_output_flag", s->pic_output_flag);
 		if (sps->separate_colour_plane_flag == 1) 
-			json_slice_header["colour_plane_id"] = s->colour_plane_id;
+			v.Field("colour_plane_id", s->colour_plane_id);
 		if (nal_unit_type != HevcNaluTypeCodedSliceIDR && nal_unit_type != HevcNaluTypeCodedSliceIDRNLP) { 
-			json_slice_header["slice_pic_order_cnt_lsb"] = s->slice_pic_order_cnt_lsb;
-			json_slice_header["short_term_ref_pic_set_sps_flag"] = s->short_term_ref_pic_set_sps_flag;
+			v.Field("slice_pic_order_cnt_lsb", s->slice_pic_order_cnt_lsb);
+			v.Field("short_term_ref_pic_set_sps_flag", s->short_term_ref_pic_set_sps_flag);
 			if (!s->short_term_ref_pic_set_sps_flag) 
 				{}//parse_short_term_ref_pic_set(&s->short_term_ref_pic_set, b, sps->num_short_term_ref_pic_sets, sps);
 			else if (sps->num_short_term_ref_pic_sets > 1) 
-				json_slice_header["short_term_ref_pic_set_idx"] = s->short_term_ref_pic_set_idx;
+				v.Field("short_term_ref_pic_set_idx", s->short_term_ref_pic_set_idx);
 			if (sps->long_term_ref_pics_present_flag) { 
 				if (sps->num_long_term_ref_pics_sps > 0) 
-					json_slice_header["num_long_term_sps"] = s->num_long_term_sps;
-				json_slice_header["num_long_term_pics"] = s->num_long_term_pics;
+					v.Field("num_long_term_sps", s->num_long_term_sps);
+				v.Field("num_long_term_pics", s->num_long_term_pics);
 			} 
 			if (sps->sps_temporal_mvp_enabled_flag) 
-				json_slice_header["slice_temporal_mvp_enabled_flag"] = s->slice_temporal_mvp_enabled_flag;
+				v.Field("slice_temporal_mvp_enabled_flag", s->slice_temporal_mvp_enabled_flag);
 		}
 		if (sps->sample_adaptive_offset_enabled_flag) { 
-			json_slice_header["slice_sao_luma_flag"] = s->slice_sao_luma_flag;
-			json_slice_header["slice_sao_chroma_flag"] = s->slice_sao_chroma_flag;
+			v.Field("slice_sao_luma_flag", s->slice_sao_luma_flag);
+			v.Field("slice_sao_chroma_flag", s->slice_sao_chroma_flag);
 		} 
 		if (s->slice_type == HEVC_SLICE_TYPE_P || s->slice_type == HEVC_SLICE_TYPE_B) { 
-			json_slice_header["num_ref_idx_active_override_flag"] = s->num_ref_idx_active_override_flag;
+			v.Field("num_ref_idx_active_override_flag", s->num_ref_idx_active_override_flag);
 			if (s->num_ref_idx_active_override_flag) { 
-				json_slice_header["num_ref_idx_l0_active_minus1"] = s->num_ref_idx_l0_active_minus1;
+				v.Field("num_ref_idx_l0_active_minus1", s->num_ref_idx_l0_active_minus1);
 				if (s->slice_type == HEVC_SLICE_TYPE_B) 
-					json_slice_header["num_ref_idx_l1_active_minus1"] = s->num_ref_idx_l1_active_minus1;
+					v.Field("num_ref_idx_l1_active_minus1", s->num_ref_idx_l1_active_minus1);
 			} 
 			// if (pps->lists_modification_present_flag && derive_NumPocTotalCurr(sps, s) > 1) 
 			// 	parse_ref_pic_lists_modification(&s->ref_pic_lists_modification, b, sps, s); 
 			if (s->slice_type == HEVC_SLICE_TYPE_B) 
-				json_slice_header["mvd_l1_zero_flag"] = s->mvd_l1_zero_flag;
+				v.Field("mvd_l1_zero_flag", s->mvd_l1_zero_flag);
 			if (pps->cabac_init_present_flag) 
-				json_slice_header["cabac_init_flag"] = s->cabac_init_flag;
+				v.Field("cabac_init_flag", s->cabac_init_flag);
 			if (s->slice_temporal_mvp_enabled_flag) { 
 				if (s->slice_type == HEVC_SLICE_TYPE_B) 
-					json_slice_header["collocated_from_l0_flag"] = s->collocated_from_l0_flag;
+					v.Field("collocated_from_l0_flag", s->collocated_from_l0_flag);
 				if ((s->collocated_from_l0_flag && s->num_ref_idx_l0_active_minus1 > 0) || 
 						(!s->collocated_from_l0_flag && s->num_ref_idx_l1_active_minus1 > 0)) 
-					json_slice_header["collocated_ref_idx"] = s->collocated_ref_idx;
+					v.Field("collocated_ref_idx", s->collocated_ref_idx);
 			} 
 			// if ((pps->weighted_pred_flag && s->slice_type == HEVC_SLICE_TYPE_P) || 
 			// 		(pps->weighted_bipred_flag && s->slice_type == HEVC_SLICE_TYPE_B)) 
 			// 	parse_pred_weight_table(&s->pred_weight_table, b, sps, s); 
-			json_slice_header["five_minus_max_num_merge_cand"] = s->five_minus_max_num_merge_cand;
+			v.Field("five_minus_max_num_merge_cand", s->five_minus_max_num_merge_cand);
 		} 
-		json_slice_header["slice_qp_delta"] = s->slice_qp_delta;
+		v.Field("slice_qp_delta", s->slice_qp_delta);
 		if (pps->pps_slice_chroma_qp_offsets_present_flag) { 
-			json_slice_header["slice_cb_qp_offset"] = s->slice_cb_qp_offset;
-			json_slice_header["slice_cr_qp_offset"] = s->slice_cr_qp_offset;
+			v.Field("slice_cb_qp_offset", s->slice_cb_qp_offset);
+			v.Field("slice_cr_qp_offset", s->slice_cr_qp_offset);
 		} 
 		if (pps->deblocking_filter_override_enabled_flag) 
-			json_slice_header["deblocking_filter_override_flag"] = s->deblocking_filter_override_flag;
+			v.Field("deblocking_filter_override_flag", s->deblocking_filter_override_flag);
 		if (s->deblocking_filter_override_flag) { 
-			json_slice_header["slice_deblocking_filter_disabled_flag"] = s->slice_deblocking_filter_disabled_flag;
+			v.Field("slice_deblocking_filter_disabled_flag", s->slice_deblocking_filter_disabled_flag);
 			if (!s->slice_deblocking_filter_disabled_flag) { 
-				json_slice_header["slice_beta_offset_div2"] = s->slice_beta_offset_div2;
-				json_slice_header["slice_tc_offset_div2"] = s->slice_tc_offset_div2;
+				v.Field("slice_beta_offset_div2", s->slice_beta_offset_div2);
+				v.Field("slice_tc_offset_div2", s->slice_tc_offset_div2);
 			} 
 		} 
 		if (pps->pps_loop_filter_across_slices_enabled_flag && (s->slice_sao_luma_flag || 
 				s->slice_sao_chroma_flag || !s->slice_deblocking_filter_disabled_flag)) 
-			json_slice_header["slice_loop_filter_across_slices_enabled_flag"] = s->slice_loop_filter_across_slices_enabled_flag;
+			v.Field("slice_loop_filter_across_slices_enabled_flag", s->slice_loop_filter_across_slices_enabled_flag);
 	} 
 	if (pps->tiles_enabled_flag || pps->entropy_coding_sync_enabled_flag) { 
-		json_slice_header["num_entry_point_offsets"] = s->num_entry_point_offsets;
+		v.Field("num_entry_point_offsets", s->num_entry_point_offsets);
 		if (s->num_entry_point_offsets > 0) { 
-			json_slice_header["offset_len_minus1"] = s->offset_len_minus1;
+			v.Field("offset_len_minus1", s->offset_len_minus1);
 			// for (i = 0; i < s->num_entry_point_offsets; i++) 
 			// 	s->entry_point_offset_minus1[i] = b.ReadU(s->offset_len_minus1 + 1); //u(v) 
 		} 
 	} 
 	if (pps->slice_segment_header_extension_present_flag) { 
-		json_slice_header["slice_segment_header_extension_length"] = s->slice_segment_header_extension_length;
+		v.Field("slice_segment_header_extension_length", s->slice_segment_header_extension_length);
 		// for(i = 0; i < s->slice_segment_header_extension_length; i++) 
 		// 	s->slice_segment_header_extension_data_byte[i] = b.ReadU(8); 
 	} 
-
-	return json_slice_header;
 }
@@ -3,7 +3,6 @@
 
 #include "bytes.h"
 #include <string>
-#include "json/value.h"
 
 #define HEVC_MAX_ARRAY_SIZE  64
 #define HEVC_MAX_ARRAY_SIZE_LARGE 256
@@ -578,31 +577,33 @@ typedef struct hevc_sei_t
 } hevc_sei_t;
 
 class BitReader;
+class SyntaxVisitor;
 
 int  hevc_nal_to_rbsp(const uint8_t* nal_buf, int* nal_size, uint8_t* rbsp_buf, int* rbsp_size);
 
 void read_hevc_video_parameter_set_rbsp(hevc_vps_t* vps, BitReader& b);
 
-Json::Value hevc_vps_to_json(hevc_vps_t* vps);
+void visit_hevc_vps(hevc_vps_t* vps, SyntaxVisitor& v);
 
 void read_hevc_seq_parameter_set_rbsp(hevc_sps_t* sps, BitReader& b);
 
-Json::Value hevc_sps_to_json(hevc_sps_t* sps);
+void visit_hevc_sps(hevc_sps_t* sps, SyntaxVisitor& v);
 
 void read_hevc_pic_parameter_set_rbsp(hevc_pps_t* pps, BitReader& b);
 
-Json::Value hevc_pps_to_json(hevc_pps_t* pps);
+void visit_hevc_pps(hevc_pps_t* pps, SyntaxVisitor& v);
 
 void hevc_slice_segment_header(hevc_slice_header_t* sh, BitReader& b, uint8_t nal_unit_type, hevc_sps_t* sps, hevc_pps_t* pps);
 
-Json::Value hevc_slice_segment_header_to_json(hevc_slice_header_t* sh, int nal_unit_type, hevc_sps_t* sps, hevc_pps_t* pps);
+void visit_hevc_slice_segment_header(hevc_slice_header_t* sh, int nal_unit_type, hevc_sps_t* sps, hevc_pps_t* pps, SyntaxVisitor& v);
 
-std::string hevc_slice_type_string(int type);
+const char* hevc_slice_type_string(int type); //"Unknown" for the invalid values
 
 hevc_sei_t** read_hevc_sei_rbsp(uint32_t *num_seis, BitReader& b, int nal_unit_type);
 
 void release_hevc_seis(hevc_sei_t** seis, uint32_t num_seis);
 
-Json::Value hevc_seis_to_json(hevc_sei_t** seis, uint32_t num_seis);
+//the seis are written as the elements of the current array
+void visit_hevc_seis(hevc_sei_t** seis, uint32_t num_seis, SyntaxVisitor& v);
 
 #endif
@@ -4,6 +4,8 @@
 #include "bytes.h"
 #include <string>
 
+class SyntaxVisitor;
+
 class FlvHeaderInterface
 {
 public:
@@ -29,6 +31,19 @@ public:
 	virtual std::string SubType() = 0;
 	virtual std::string Format() = 0;
 	virtual std::string ExtraInfo() = 0;
+
+	//typed accessors, the names point to static tables so nothing is allocated
+	virtual uint8_t     TagTypeId() = 0;   //8 audio, 9 video, 18 script data
+	virtual const char* TagTypeName() = 0;
+	virtual int         SubTypeId() = 0;   //AACPacketType or AVCPacketType, -1 if none
+	virtual const char* SubTypeName() = 0;
+	virtual int         FormatId() = 0;    //the first byte of the audio/video tag data, -1 if none
+	virtual const char* FormatName() = 0;
+
+	virtual uint64_t    Offset() = 0;      //absolute offset of the tag header in the input, the tag takes TagSize() bytes
+
+	//write the same detail as ExtraInfo() as one value under the key, without building a json string, false if there is none
+	virtual bool        VisitExtraInfo(SyntaxVisitor& visitor, const char* key) = 0;
 };
 
 class NaluInterface
@@ -47,6 +62,18 @@ public:
 	virtual int         PicOrderCntLsb() = 0;
 	virtual int         SliceQpDelta() = 0;
 	virtual std::string ExtraInfo() = 0;
+
+	//typed accessors, the names point to static tables so nothing is allocated
+	virtual uint8_t     CodecId() = 0;        //same as flv video codec id, 7 AVC, 12 HEVC
+	virtual int         NalUnitTypeId() = 0;  //-1 if unknown
+	virtual const char* NalUnitTypeName() = 0;
+	virtual int         SliceTypeId() = 0;    //-1 if not a slice
+	virtual const char* SliceTypeName() = 0;
+
+	virtual uint64_t    Offset() = 0;         //absolute offset of the nalu in the input, after its length or start code, it takes NaluSize() bytes
+
+	//write the same detail as ExtraInfo() as one value under the key, without building a json string, false if there is none
+	virtual bool        VisitExtraInfo(SyntaxVisitor& visitor, const char* key) = 0;
 };
 
 
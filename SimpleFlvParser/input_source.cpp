@@ -0,0 +1,69 @@
+#include "input_source.h"
+#include <string.h>
+
+#ifdef _WIN32
+#pragma warning(disable: 4996)
+#define fseeko _fseeki64
+#define ftello _ftelli64
+#endif
+
+FileInputSource::FileInputSource(const std::string& file_path)
+{
+	file_ = fopen(file_path.c_str(), "rb");
+	if (!file_)
+		printf("Open input file %s error.\n", file_path.c_str());
+}
+
+FileInputSource::~FileInputSource()
+{
+	if (file_)
+	{
+		fclose(file_);
+		file_ = NULL;
+	}
+}
+
+uint32_t FileInputSource::Read(uint8_t* buffer, uint32_t size)
+{
+	if (!file_ || !buffer || !size)
+		return 0;
+	return (uint32_t)fread(buffer, 1, size, file_);
+}
+
+bool FileInputSource::Seek(uint64_t offset)
+{
+	if (!file_)
+		return false;
+	return fseeko(file_, offset, SEEK_SET) == 0;
+}
+
+uint64_t FileInputSource::Tell()
+{
+	if (!file_)
+		return 0;
+	return (uint64_t)ftello(file_);
+}
+
+MemoryInputSource::MemoryInputSource(const uint8_t* data, uint64_t size)
+{
+	data_ = data;
+	size_ = data ? size : 0;
+}
+
+uint32_t MemoryInputSource::Read(uint8_t* buffer, uint32_t size)
+{
+	if (!buffer || pos_ >= size_)
+		return 0;
+	uint32_t read_size = (size_ - pos_ < size) ? (uint32_t)(size_ - pos_) : size;
+	memcpy(buffer, data_ + pos_, read_size);
+	pos_ += read_size;
+	return read_size;
+}
+
+bool MemoryInputSource::Seek(uint64_t offset)
+{
+	if (offset > size_)
+		return false;
+	pos_ = offset;
+	return true;
+}
@@ -0,0 +1,50 @@
+#ifndef _SFP_INPUT_SOURCE_H_
+#define _SFP_INPUT_SOURCE_H_
+
+#include "bytes.h"
+#include <stdio.h>
+#include <string>
+
+//Where the parser pulls its bytes from
+class InputSource
+{
+public:
+	virtual ~InputSource() {}
+	virtual bool IsGood() { return true; }
+	virtual uint32_t Read(uint8_t* buffer, uint32_t size) = 0; //return the bytes actually read, less than size means eof
+	virtual bool Seek(uint64_t offset) = 0; //absolute offset from the beginning
+	virtual uint64_t Tell() = 0;
+};
+
+class FileInputSource : public InputSource
+{
+public:
+	FileInputSource(const std::string& file_path);
+	~FileInputSource();
+
+	virtual bool IsGood() override { return file_ != NULL; }
+	virtual uint32_t Read(uint8_t* buffer, uint32_t size) override;
+	virtual bool Seek(uint64_t offset) override;
+	virtual uint64_t Tell() override;
+
+private:
+	FILE* file_ = NULL;
+};
+
+//The memory is not copied, it must outlive the source
+class MemoryInputSource : public InputSource
+{
+public:
+	MemoryInputSource(const uint8_t* data, uint64_t size);
+
+	virtual uint32_t Read(uint8_t* buffer, uint32_t size) override;
+	virtual bool Seek(uint64_t offset) override;
+	virtual uint64_t Tell() override { return pos_; }
+
+private:
+	const uint8_t* data_ = NULL;
+	uint64_t size_ = 0;
+	uint64_t pos_ = 0;
+};
+
+#endif //_SFP_INPUT_SOURCE_H_
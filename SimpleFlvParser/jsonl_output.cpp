@@ -0,0 +1,158 @@
+#include "jsonl_output.h"
+#include "flv_file_internal.h"
+#include "syntax_visitor.h"
+
+#ifdef _WIN32
+#pragma warning(disable: 4996)
+#endif
+
+enum JsonlRowKind { JsonlHeader, JsonlTag, JsonlNalu };
+
+JsonlOutput::JsonlOutput(const std::string& jsonl_path, int jobs)
+	: json_(out_)
+{
+	//binary, so the lines end with \n on every platform
+	jsonl_file_ = fopen(jsonl_path.c_str(), "wb");
+	if (!jsonl_file_)
+	{
+		printf("Create jsonl file %s error.\n", jsonl_path.c_str());
+		return;
+	}
+	out_.SetFile(jsonl_file_);
+
+	if (jobs > 1)
+		serializer_.reset(new ParallelSerializer(jsonl_file_, jobs, [](const ParallelSerializer::Row& row, BufferedWriter& out)
+		{
+			CompactJsonWriter json(out);
+			if (row.kind == JsonlHeader)
+				WriteHeader(json, (FlvHeaderInterface*)row.object);
+			else if (row.kind == JsonlTag)
+				WriteTag(json, (FlvTagInterface*)row.object);
+			else
+				WriteNalu(json, (NaluInterface*)row.object, row.serial);
+		}));
+}
+
+JsonlOutput::~JsonlOutput()
+{
+	if (jsonl_file_)
+	{
+		serializer_.reset();
+		out_.Flush();
+		fclose(jsonl_file_);
+		jsonl_file_ = NULL;
+	}
+}
+
+void JsonlOutput::FlvHeaderOutput(FlvHeaderInterface* header)
+{
+	if (header == NULL)
+		return;
+
+	nalu_serial_ = 0; //a new file begins
+	if (serializer_)
+	{
+		ParallelSerializer::Row row = { JsonlHeader, header, 0 };
+		serializer_->Add(row);
+	}
+	else
+		WriteHeader(json_, header);
+}
+
+void JsonlOutput::FlvTagOutput(FlvTagInterface* tag)
+{
+	if (tag == NULL)
+		return;
+
+	if (serializer_)
+	{
+		ParallelSerializer::Row row = { JsonlTag, tag, 0 };
+		serializer_->Add(row);
+	}
+	else
+		WriteTag(json_, tag);
+}
+
+void JsonlOutput::NaluOutput(NaluInterface* nalu)
+{
+	if (nalu == NULL)
+		return;
+
+	nalu_serial_++;
+	if (serializer_)
+	{
+		ParallelSerializer::Row row = { JsonlNalu, nalu, nalu_serial_ };
+		serializer_->Add(row);
+	}
+	else
+		WriteNalu(json_, nalu, nalu_serial_);
+}
+
+void JsonlOutput::EndInput()
+{
+	if (serializer_)
+		serializer_->Flush();
+}
+
+void JsonlOutput::WriteHeader(CompactJsonWriter& json, FlvHeaderInterface* header)
+{
+	json.StartObject();
+	json.Key("type"); json.String("header");
+	json.Key("have_video"); json.Bool(header->HaveVideo());
+	json.Key("have_audio"); json.Bool(header->HaveAudio());
+	json.Key("version"); json.Int(header->Version());
+	json.Key("header_size"); json.Int(header->HeaderSize());
+	json.EndObject();
+	json.EndLine();
+}
+
+void JsonlOutput::WriteTag(CompactJsonWriter& json, FlvTagInterface* tag)
+{
+	json.StartObject();
+	json.Key("type"); json.String("tag");
+	json.Key("serial"); json.Int(tag->Serial());
+	json.Key("previous_tag_size"); json.Int(tag->PreviousTagSize());
+	json.Key("tag_type"); json.String(tag->TagTypeName());
+	json.Key("stream_id"); json.Int(tag->StreamId());
+	json.Key("tag_size"); json.Int(tag->TagSize());
+	json.Key("offset"); json.Int((int64_t)tag->Offset());
+	json.Key("pts"); json.Int(tag->Pts());
+	json.Key("dts"); json.Int(tag->Dts());
+	json.Key("dts_diff"); json.Int(tag->DtsDiff());
+	json.Key("sub_type"); json.String(tag->SubTypeName());
+	json.Key("format"); json.String(tag->FormatName());
+	//the nalus of a coded frame have lines of their own, a sequence header is only here
+	if (tag->TagTypeId() != FlvTagTypeVideo || tag->SubTypeId() != VideoTagTypeAVCNalu)
+	{
+		CompactJsonVisitor visitor(json);
+		tag->VisitExtraInfo(visitor, "info");
+	}
+	json.EndObject();
+	json.EndLine();
+}
+
+void JsonlOutput::WriteNalu(CompactJsonWriter& json, NaluInterface* nalu, int serial)
+{
+	json.StartObject();
+	json.Key("type"); json.String("nalu");
+	json.Key("serial"); json.Int(serial);
+	json.Key("tag_serial"); json.Int(nalu->TagSerialBelong());
+	json.Key("nalu_size"); json.Int(nalu->NaluSize());
+	json.Key("offset"); json.Int((int64_t)nalu->Offset());
+	json.Key("nal_ref_idc"); json.Int(nalu->NalRefIdc());
+	json.Key("nal_unit_type"); json.String(nalu->NalUnitTypeName());
+	if (nalu->SliceTypeId() >= 0)
+	{
+		json.Key("slice_type"); json.String(nalu->SliceTypeName());
+		json.Key("first_mb_in_slice"); json.Int(nalu->FirstMbInSlice());
+		json.Key("pic_parameter_set_id"); json.Int(nalu->PicParameterSetId());
+		json.Key("frame_num"); json.Int(nalu->FrameNum());
+		json.Key("field_pic_flag"); json.Int(nalu->FieldPicFlag());
+		json.Key("pic_order_cnt_lsb"); json.Int(nalu->PicOrderCntLsb());
+		json.Key("slice_qp_delta"); json.Int(nalu->SliceQpDelta());
+	}
+	CompactJsonVisitor visitor(json);
+	nalu->VisitExtraInfo(visitor, "info");
+	json.EndObject();
+	json.EndLine();
+}
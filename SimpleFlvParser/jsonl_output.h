@@ -0,0 +1,41 @@
+#ifndef _SFP_JSONL_OUTPUT_H_
+#define _SFP_JSONL_OUTPUT_H_
+
+#include "output_interface.h"
+#include "input_interface.h"
+#include "buffered_writer.h"
+#include "compact_json_writer.h"
+#include "parallel_serializer.h"
+#include <string>
+#include <memory>
+
+//Newline delimited json, one compact object per header/tag/nalu in the order they are parsed,
+//so it can be fed into log pipelines line by line. The details of parameter sets, sei, slice headers,
+//audio configs and metadata are nested in "info". The video tags have no info, it's all in their nalus.
+//With more than one job the lines are serialized by a pool of threads, the file is the same.
+class JsonlOutput : public FlvOutputInterface
+{
+public:
+	JsonlOutput(const std::string& jsonl_path, int jobs = 1);
+	~JsonlOutput();
+
+	virtual void FlvHeaderOutput(FlvHeaderInterface* header) override;
+	virtual void FlvTagOutput(FlvTagInterface* tag) override;
+	virtual void NaluOutput(NaluInterface* nalu) override;
+	virtual void EndInput() override;
+	virtual bool IsGood() override { return jsonl_file_ != NULL; }
+
+private:
+	static void WriteHeader(CompactJsonWriter& json, FlvHeaderInterface* header);
+	static void WriteTag(CompactJsonWriter& json, FlvTagInterface* tag);
+	static void WriteNalu(CompactJsonWriter& json, NaluInterface* nalu, int serial);
+
+private:
+	FILE* jsonl_file_ = NULL;
+	BufferedWriter out_;
+	CompactJsonWriter json_;
+	int nalu_serial_ = 0;
+	std::unique_ptr<ParallelSerializer> serializer_; //NULL if the lines are written by the parsing thread
+};
+
+#endif //_SFP_JSONL_OUTPUT_H_
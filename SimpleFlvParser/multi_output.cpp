@@ -0,0 +1,56 @@
+#include "multi_output.h"
+#include "input_interface.h"
+
+void MultiOutput::AddOutput(const std::shared_ptr<FlvOutputInterface>& output)
+{
+	if (output && output->IsGood())
+		outputs_.push_back(output);
+}
+
+void MultiOutput::FlvHeaderOutput(FlvHeaderInterface* header)
+{
+	for (const auto& output : outputs_)
+		output->FlvHeaderOutput(header);
+}
+
+void MultiOutput::FlvTagOutput(FlvTagInterface* tag)
+{
+	for (const auto& output : outputs_)
+		output->FlvTagOutput(tag);
+}
+
+void MultiOutput::NaluOutput(NaluInterface* nalu)
+{
+	for (const auto& output : outputs_)
+		output->NaluOutput(nalu);
+}
+
+void MultiOutput::EndInput()
+{
+	for (const auto& output : outputs_)
+		output->EndInput();
+}
+
+void TailOutput::FlvHeaderOutput(FlvHeaderInterface* header)
+{
+	if (after_serial_ == 0)
+		output_->FlvHeaderOutput(header);
+}
+
+void TailOutput::FlvTagOutput(FlvTagInterface* tag)
+{
+	if (tag && Passes(tag->Serial()))
+		output_->FlvTagOutput(tag);
+}
+
+void TailOutput::NaluOutput(NaluInterface* nalu)
+{
+	if (nalu && Passes(nalu->TagSerialBelong()))
+		output_->NaluOutput(nalu);
+}
+
+void TailOutput::EndInput()
+{
+	if (after_serial_ >= 0)
+		output_->EndInput();
+}
@@ -0,0 +1,55 @@
+#ifndef _SFP_MULTI_OUTPUT_H_
+#define _SFP_MULTI_OUTPUT_H_
+
+#include "output_interface.h"
+#include <memory>
+#include <vector>
+
+//Deliver every header/tag/nalu to all the registered outputs, 
+//so the parsed data only need to be walked once no matter how many outputs there are.
+class MultiOutput : public FlvOutputInterface
+{
+public:
+	MultiOutput() = default;
+	~MultiOutput() = default;
+
+	void AddOutput(const std::shared_ptr<FlvOutputInterface>& output);
+	size_t OutputCount() { return outputs_.size(); }
+
+	virtual void FlvHeaderOutput(FlvHeaderInterface* header) override;
+	virtual void FlvTagOutput(FlvTagInterface* tag) override;
+	virtual void NaluOutput(NaluInterface* nalu) override;
+	virtual void EndInput() override;
+	virtual bool IsGood() override { return !outputs_.empty(); }
+
+private:
+	std::vector<std::shared_ptr<FlvOutputInterface> > outputs_;
+};
+
+//Deliver only a part of each input to another output, e.g. the db which already has a file, or the head of it,
+//while the other outputs get the whole file.
+class TailOutput : public FlvOutputInterface
+{
+public:
+	TailOutput(const std::shared_ptr<FlvOutputInterface>& output) : output_(output) {}
+	~TailOutput() = default;
+
+	void PassAll() { after_serial_ = 0; }
+	void PassNone() { after_serial_ = -1; }
+	void PassAfter(int tag_serial) { after_serial_ = tag_serial; } //the tags after it and their nalus, without the header
+
+	virtual void FlvHeaderOutput(FlvHeaderInterface* header) override;
+	virtual void FlvTagOutput(FlvTagInterface* tag) override;
+	virtual void NaluOutput(NaluInterface* nalu) override;
+	virtual void EndInput() override;
+	virtual bool IsGood() override { return output_ && output_->IsGood(); }
+
+private:
+	bool Passes(int tag_serial) { return after_serial_ == 0 || (after_serial_ > 0 && tag_serial > after_serial_); }
+
+private:
+	std::shared_ptr<FlvOutputInterface> output_;
+	int after_serial_ = 0; //0 for all, -1 for nothing
+};
+
+#endif //_SFP_MULTI_OUTPUT_H_
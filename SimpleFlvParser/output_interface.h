@@ -7,13 +7,16 @@ class FlvHeaderInterface;
 class FlvTagInterface;
 class NaluInterface;
 
+//The parsed objects are only borrowed during each call, copy anything which is needed later,
+//or hold on to them no longer than EndInput(), all of them stay alive until then.
 class FlvOutputInterface
 {
 public:
 	virtual ~FlvOutputInterface() {}
-	virtual void FlvHeaderOutput(const std::shared_ptr<FlvHeaderInterface>& header) = 0;
-	virtual void FlvTagOutput(const std::shared_ptr<FlvTagInterface>& tag) = 0;
-	virtual void NaluOutput(const std::shared_ptr<NaluInterface>& nalu) = 0;
+	virtual void FlvHeaderOutput(FlvHeaderInterface* header) = 0;
+	virtual void FlvTagOutput(FlvTagInterface* tag) = 0;
+	virtual void NaluOutput(NaluInterface* nalu) = 0;
+	virtual void EndInput() {} //the objects of the current input are released after this, outputs which kept them finish with them here
 	virtual bool IsGood() { return true; }
 };
 
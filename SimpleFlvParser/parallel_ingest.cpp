@@ -0,0 +1,97 @@
+#include "parallel_ingest.h"
+#include "flv_file.h"
+
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include <functional>
+
+#define MAX_SHARDS 10 //every shard is attached to the db when merging
+
+struct IngestFile
+{
+	std::string path;
+	int64_t file_id; //the id in the main db, the shards use the same one
+};
+
+static void IngestWorker(const std::vector<IngestFile>& files, std::atomic<size_t>& next_file,
+	const std::string& input_type, const std::string& shard_path, const DBOutputOptions& shard_options)
+{
+	DBOutput shard(shard_path, shard_options);
+	if (!shard.IsGood())
+		return;
+
+	FlvHeaderCallback header_cb = std::bind(&DBOutput::FlvHeaderOutput, &shard, std::placeholders::_1);
+	FlvTagCallback tag_cb = std::bind(&DBOutput::FlvTagOutput, &shard, std::placeholders::_1);
+	NaluCallback nalu_cb = std::bind(&DBOutput::NaluOutput, &shard, std::placeholders::_1);
+
+	//the files are taken one by one, so a big file doesn't hold up the others
+	for (size_t i = next_file++; i < files.size(); i = next_file++)
+	{
+		shard.BeginFile(files[i].path, files[i].file_id);
+		if (input_type == "flv") {
+			FlvFile flv(files[i].path, NULL);
+			flv.Output(header_cb, tag_cb, nalu_cb);
+		} else if (input_type == "h264") {
+			H264File h264(files[i].path);
+			h264.Output(nalu_cb);
+		} else if (input_type == "h265") {
+			H265File h265(files[i].path);
+			h265.Output(nalu_cb);
+		}
+	}
+}
+
+bool ParallelIngest(const std::vector<std::string>& input_files, const std::string& input_type,
+	const std::string& db_path, const DBOutputOptions& options, int jobs)
+{
+	DBOutput db(db_path, options);
+	if (!db.IsGood())
+		return false;
+
+	//decide the file ids in the main db first, the unchanged files are skipped
+	std::vector<IngestFile> files;
+	for (const std::string& path : input_files)
+	{
+		int64_t file_id = db.RegisterFile(path);
+		if (file_id == 0)
+			printf("%s is unchanged since it was stored in %s, skipped.\n", path.c_str(), db_path.c_str());
+		else
+			files.push_back({ path, file_id });
+	}
+	if (files.empty())
+		return true;
+
+	if (jobs > MAX_SHARDS)
+	{
+		printf("Warning: -db-jobs %d is more than %d, only %d threads are used.\n", jobs, MAX_SHARDS, MAX_SHARDS);
+		jobs = MAX_SHARDS;
+	}
+	if (jobs > (int)files.size())
+		jobs = (int)files.size();
+
+	//the shards are temporary, so they are written in the fastest way
+	DBOutputOptions shard_options = options;
+	shard_options.bulk = true;
+	shard_options.async = false;
+	shard_options.append = false;
+	shard_options.resume = false;
+	shard_options.build_indexes = false;
+
+	std::vector<std::string> shard_paths;
+	for (int i = 0; i < jobs; i++)
+		shard_paths.push_back(db_path + ".shard" + std::to_string(i));
+
+	std::vector<std::thread> workers;
+	std::atomic<size_t> next_file(0);
+	for (int i = 0; i < jobs; i++)
+		workers.emplace_back(IngestWorker, std::cref(files), std::ref(next_file),
+			std::cref(input_type), std::cref(shard_paths[i]), std::cref(shard_options));
+	for (std::thread& worker : workers)
+		worker.join();
+
+	bool ok = db.MergeShards(shard_paths);
+	for (const std::string& shard_path : shard_paths)
+		remove(shard_path.c_str());
+	return ok;
+}
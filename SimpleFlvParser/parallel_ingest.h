@@ -0,0 +1,13 @@
+#ifndef _SFP_PARALLEL_INGEST_H_
+#define _SFP_PARALLEL_INGEST_H_
+
+#include "db_output.h"
+#include <string>
+#include <vector>
+
+//Parse the input files with several worker threads, every worker stores the files it parsed into its own shard db,
+//then the shards are merged into the db in one transaction, so a batch ingest isn't limited by a single db writer.
+bool ParallelIngest(const std::vector<std::string>& input_files, const std::string& input_type,
+	const std::string& db_path, const DBOutputOptions& options, int jobs);
+
+#endif //_SFP_PARALLEL_INGEST_H_
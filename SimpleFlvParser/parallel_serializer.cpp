@@ -0,0 +1,105 @@
+#include "parallel_serializer.h"
+
+ParallelSerializer::ParallelSerializer(FILE* file, int jobs, const SerializeFunc& serialize, size_t batch_rows)
+	: file_(file), serialize_(serialize), batch_rows_(batch_rows > 0 ? batch_rows : 1)
+{
+	if (jobs < 1)
+		jobs = 1;
+	max_batches_ = jobs * 4; //enough to keep the workers busy while the writer catches up
+	current_.reset(new Batch);
+	for (int i = 0; i < jobs; i++)
+		workers_.push_back(std::thread(&ParallelSerializer::WorkerThread, this));
+	writer_ = std::thread(&ParallelSerializer::WriterThread, this);
+}
+
+ParallelSerializer::~ParallelSerializer()
+{
+	Flush();
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stopping_ = true;
+	}
+	work_.notify_all();
+	done_.notify_all();
+	for (std::thread& worker : workers_)
+		worker.join();
+	writer_.join();
+}
+
+void ParallelSerializer::Add(const Row& row)
+{
+	current_->rows.push_back(row);
+	if (current_->rows.size() >= batch_rows_)
+		Submit();
+}
+
+void ParallelSerializer::Submit()
+{
+	if (current_->rows.empty())
+		return;
+	std::unique_lock<std::mutex> lock(mutex_);
+	written_.wait(lock, [this] { return pending_.size() < max_batches_; }); //backpressure
+	todo_.push_back(current_.get());
+	pending_.push_back(std::move(current_));
+	lock.unlock();
+	work_.notify_one();
+	current_.reset(new Batch);
+}
+
+void ParallelSerializer::Flush()
+{
+	Submit();
+	std::unique_lock<std::mutex> lock(mutex_);
+	written_.wait(lock, [this] { return pending_.empty(); });
+}
+
+void ParallelSerializer::WorkerThread()
+{
+	while (true)
+	{
+		Batch* batch = NULL;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			work_.wait(lock, [this] { return !todo_.empty() || stopping_; });
+			if (todo_.empty()) //stopping and nothing left
+				break;
+			batch = todo_.front();
+			todo_.pop_front();
+		}
+
+		for (const Row& row : batch->rows)
+			serialize_(row, batch->out);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			batch->done = true;
+		}
+		done_.notify_all();
+	}
+}
+
+void ParallelSerializer::WriterThread()
+{
+	while (true)
+	{
+		Batch* batch = NULL;
+		{
+			//only the oldest batch can be written, the later ones wait even if they are done first
+			std::unique_lock<std::mutex> lock(mutex_);
+			done_.wait(lock, [this] { return (!pending_.empty() && pending_.front()->done) || (stopping_ && pending_.empty()); });
+			if (pending_.empty())
+				break;
+			batch = pending_.front().get();
+		}
+
+		size_t size = batch->out.Size();
+		bool error = size > 0 && fwrite(batch->out.Data(), 1, size, file_) != size;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			error_ = error_ || error;
+			pending_.pop_front();
+		}
+		written_.notify_all();
+	}
+}
@@ -0,0 +1,68 @@
+#ifndef _SFP_PARALLEL_SERIALIZER_H_
+#define _SFP_PARALLEL_SERIALIZER_H_
+
+#include "buffered_writer.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+//Serializes the rows of an output on a pool of worker threads, a batch of rows into a buffer of its own,
+//and a single writer thread writes the buffers into the file in the order the batches were added,
+//so the file is the same as serializing the rows one by one.
+//The rows point to the parsed objects, which must stay alive until Flush() returns.
+class ParallelSerializer
+{
+public:
+	struct Row
+	{
+		int   kind;   //what the object is, up to the serialize function
+		void* object;
+		int   serial; //anything which has to be numbered in the order of the rows
+	};
+	typedef std::function<void(const Row& row, BufferedWriter& out)> SerializeFunc;
+
+	ParallelSerializer(FILE* file, int jobs, const SerializeFunc& serialize, size_t batch_rows = 256);
+	~ParallelSerializer(); //flush and stop the threads
+
+	void Add(const Row& row); //the batch is handed to the workers when it's full
+	void Flush(); //serialize and write everything added, return after the file is written
+	bool IsGood() const { return !error_; }
+
+private:
+	struct Batch
+	{
+		std::vector<Row> rows;
+		BufferedWriter   out;
+		bool             done = false;
+		Batch() : out(NULL, 64 * 1024) { out.KeepInMemory(); }
+	};
+	void Submit(); //hand the current batch to the workers
+	void WorkerThread();
+	void WriterThread();
+
+private:
+	FILE* file_;
+	SerializeFunc serialize_;
+	size_t batch_rows_;
+	size_t max_batches_; //serialized or not, but not written yet
+	std::unique_ptr<Batch> current_;
+
+	std::vector<std::thread> workers_;
+	std::thread writer_;
+	std::mutex mutex_;
+	std::condition_variable work_; //a batch to serialize, or stopping
+	std::condition_variable done_; //a batch is serialized, or stopping
+	std::condition_variable written_; //a batch is written
+	std::deque<Batch*> todo_; //not taken by a worker yet
+	std::deque<std::unique_ptr<Batch> > pending_; //all the batches not written yet, in order
+	bool stopping_ = false;
+	bool error_ = false;
+};
+
+#endif //_SFP_PARALLEL_SERIALIZER_H_
@@ -0,0 +1,161 @@
+#include "plugin_output.h"
+#include "syntax_visitor.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+static_assert(sizeof(SfpEvent) == 56, "the event layout is part of the plugin abi");
+
+PluginOutput::PluginOutput(const std::string& path, const std::string& args)
+	: path_(path), info_buffer_(NULL, 64 * 1024), info_json_(info_buffer_)
+{
+	info_buffer_.KeepInMemory();
+
+	SfpPluginEntryFunc entry = NULL;
+#ifdef _WIN32
+	HMODULE library = LoadLibraryA(path.c_str());
+	if (library != NULL)
+		entry = (SfpPluginEntryFunc)GetProcAddress(library, SFP_PLUGIN_ENTRY);
+#else
+	void* library = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+	if (library != NULL)
+		entry = (SfpPluginEntryFunc)dlsym(library, SFP_PLUGIN_ENTRY);
+	else
+		printf("%s\n", dlerror());
+#endif
+	library_ = (void*)library;
+	if (library_ == NULL || entry == NULL)
+	{
+		printf("Load plugin %s error, it should export %s.\n", path.c_str(), SFP_PLUGIN_ENTRY);
+		Unload();
+		return;
+	}
+
+	const SfpPlugin* plugin = entry();
+	if (plugin == NULL || plugin->abi_version != SFP_PLUGIN_ABI_VERSION || plugin->record_size != sizeof(SfpRecord)
+		|| plugin->open == NULL || plugin->records == NULL || plugin->close == NULL)
+	{
+		printf("Plugin %s is not built for abi version %d.\n", path.c_str(), SFP_PLUGIN_ABI_VERSION);
+		Unload();
+		return;
+	}
+	plugin_ = plugin;
+	extra_info_ = (plugin->flags & SFP_PLUGIN_EXTRA_INFO) != 0;
+	batch_records_ = plugin->batch_records > 0 ? plugin->batch_records : 1024;
+	records_.reserve(batch_records_);
+	if (extra_info_)
+		info_offsets_.reserve(batch_records_);
+
+	context_ = plugin_->open(args.c_str());
+	if (context_ == NULL)
+	{
+		printf("Plugin %s refused to open.\n", path.c_str());
+		Unload();
+	}
+}
+
+PluginOutput::~PluginOutput()
+{
+	if (context_ != NULL)
+	{
+		Flush();
+		plugin_->close(context_);
+		context_ = NULL;
+	}
+	Unload();
+}
+
+void PluginOutput::Unload()
+{
+	if (library_ != NULL)
+	{
+#ifdef _WIN32
+		FreeLibrary((HMODULE)library_);
+#else
+		dlclose(library_);
+#endif
+		library_ = NULL;
+	}
+	plugin_ = NULL;
+}
+
+SfpRecord& PluginOutput::Add()
+{
+	if (records_.size() >= batch_records_)
+		Flush();
+	records_.resize(records_.size() + 1);
+	SfpRecord& record = records_.back();
+	memset(&record, 0, sizeof(record));
+	return record;
+}
+
+void PluginOutput::ExtraInfo(FlvTagInterface* tag, NaluInterface* nalu)
+{
+	//the size of the json is kept in the record, its offset aside until the buffer stops growing
+	size_t offset = info_buffer_.Size();
+	CompactJsonVisitor visitor(info_json_);
+	bool have = tag ? tag->VisitExtraInfo(visitor, NULL) : nalu->VisitExtraInfo(visitor, NULL);
+	info_offsets_.push_back(offset);
+	records_.back().extra_info_size = have ? (uint32_t)(info_buffer_.Size() - offset) : 0;
+}
+
+void PluginOutput::Flush()
+{
+	if (records_.empty())
+		return;
+	if (extra_info_)
+	{
+		for (size_t i = 0; i < records_.size(); i++)
+			if (records_[i].extra_info_size > 0)
+				records_[i].extra_info = info_buffer_.Data() + info_offsets_[i];
+	}
+	plugin_->records(context_, &records_[0], (uint32_t)records_.size());
+	records_.clear();
+	info_offsets_.clear();
+	info_buffer_.Clear();
+}
+
+void PluginOutput::FlvHeaderOutput(FlvHeaderInterface* header)
+{
+	if (header == NULL || context_ == NULL)
+		return;
+	SfpRecord& record = Add();
+	MakeHeaderEvent(header, state_, record.event);
+	if (extra_info_)
+		info_offsets_.push_back(0);
+}
+
+void PluginOutput::FlvTagOutput(FlvTagInterface* tag)
+{
+	if (tag == NULL || context_ == NULL)
+		return;
+	SfpRecord& record = Add();
+	MakeTagEvent(tag, state_, record.event);
+	if (extra_info_)
+		ExtraInfo(tag, NULL);
+}
+
+void PluginOutput::NaluOutput(NaluInterface* nalu)
+{
+	if (nalu == NULL || context_ == NULL)
+		return;
+	SfpRecord& record = Add();
+	MakeNaluEvent(nalu, state_, record.event);
+	if (extra_info_)
+		ExtraInfo(NULL, nalu);
+}
+
+void PluginOutput::EndInput()
+{
+	if (context_ == NULL)
+		return;
+	Flush();
+	if (plugin_->end_input != NULL)
+		plugin_->end_input(context_);
+}
@@ -0,0 +1,47 @@
+#ifndef _SFP_PLUGIN_OUTPUT_H_
+#define _SFP_PLUGIN_OUTPUT_H_
+
+#include "output_interface.h"
+#include "input_interface.h"
+#include "shm_output.h"
+#include "sfp_plugin.h"
+#include "compact_json_writer.h"
+#include <string>
+#include <vector>
+
+//Hands the headers/tags/nalus to an output plugin loaded from a shared library, see sfp_plugin.h.
+//The records are collected into a batch which is delivered with one call when it's full and at the end of every input,
+//so a plugin costs one indirect call per batch instead of a virtual call per object.
+class PluginOutput : public FlvOutputInterface
+{
+public:
+	PluginOutput(const std::string& path, const std::string& args);
+	~PluginOutput(); //deliver the records left, close the plugin and unload it
+
+	virtual void FlvHeaderOutput(FlvHeaderInterface* header) override;
+	virtual void FlvTagOutput(FlvTagInterface* tag) override;
+	virtual void NaluOutput(NaluInterface* nalu) override;
+	virtual void EndInput() override;
+	virtual bool IsGood() override { return context_ != NULL; }
+
+private:
+	SfpRecord& Add(); //the next record of the batch, zeroed
+	void ExtraInfo(FlvTagInterface* tag, NaluInterface* nalu);
+	void Flush();
+	void Unload();
+
+private:
+	std::string path_;
+	void* library_ = NULL;
+	const SfpPlugin* plugin_ = NULL;
+	void* context_ = NULL;
+	bool extra_info_ = false;
+	size_t batch_records_ = 0;
+	std::vector<SfpRecord> records_;
+	std::vector<size_t> info_offsets_; //of the extra_info of each record in info_buffer_, the pointers are set when the batch is delivered
+	BufferedWriter info_buffer_;
+	CompactJsonWriter info_json_;
+	ShmEventState state_;
+};
+
+#endif //_SFP_PLUGIN_OUTPUT_H_
@@ -0,0 +1,89 @@
+//A sample output plugin, it counts the tags and nalus of each input and prints them when the input ends.
+//Build it with the sample_plugin target of the Makefile, then:
+//	SimpleFlvParser -i a.flv -plugin ./sample_plugin.so -plugin-args "a.flv"
+//The args are only printed as the name of the input.
+
+#include "sfp_plugin.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct SampleContext
+{
+	char     name[256];
+	uint64_t batches;
+	uint64_t tags[3];   //audio, video, script data
+	uint64_t nalus;
+	uint64_t nalu_bytes;
+	uint64_t idr_nalus;
+} SampleContext;
+
+static void* sample_open(const char* args)
+{
+	SampleContext* context = (SampleContext*)calloc(1, sizeof(SampleContext));
+	if (context != NULL)
+		snprintf(context->name, sizeof(context->name), "%s", args[0] ? args : "input");
+	return context;
+}
+
+static void sample_records(void* context, const SfpRecord* records, uint32_t count)
+{
+	SampleContext* sample = (SampleContext*)context;
+	uint32_t i;
+	sample->batches++;
+	for (i = 0; i < count; i++)
+	{
+		const SfpEvent* event = &records[i].event;
+		if (event->kind == SFP_EVENT_TAG)
+		{
+			if (event->tag_type == 8)
+				sample->tags[0]++;
+			else if (event->tag_type == 9)
+				sample->tags[1]++;
+			else if (event->tag_type == 18)
+				sample->tags[2]++;
+		}
+		else if (event->kind == SFP_EVENT_NALU)
+		{
+			sample->nalus++;
+			sample->nalu_bytes += event->size;
+			//5 is an IDR slice of AVC, 19 and 20 of HEVC
+			if ((event->codec_id == 7 && event->nal_unit_type == 5) || (event->codec_id == 12 && (event->nal_unit_type == 19 || event->nal_unit_type == 20)))
+				sample->idr_nalus++;
+		}
+	}
+}
+
+static void sample_end_input(void* context)
+{
+	SampleContext* sample = (SampleContext*)context;
+	printf("%s: audio tags %llu, video tags %llu, script tags %llu, nalus %llu (%llu bytes, %llu idr), in %llu batches\n", sample->name,
+		(unsigned long long)sample->tags[0], (unsigned long long)sample->tags[1], (unsigned long long)sample->tags[2],
+		(unsigned long long)sample->nalus, (unsigned long long)sample->nalu_bytes, (unsigned long long)sample->idr_nalus,
+		(unsigned long long)sample->batches);
+	memset(sample->tags, 0, sizeof(sample->tags));
+	sample->batches = sample->nalus = sample->nalu_bytes = sample->idr_nalus = 0;
+}
+
+static void sample_close(void* context)
+{
+	free(context);
+}
+
+static const SfpPlugin sample_plugin =
+{
+	SFP_PLUGIN_ABI_VERSION,
+	sizeof(SfpRecord),
+	0, //no extra_info, the counts don't need it
+	4096,
+	sample_open,
+	sample_records,
+	sample_end_input,
+	sample_close,
+};
+
+SFP_PLUGIN_EXPORT const SfpPlugin* sfp_plugin_entry(void)
+{
+	return &sample_plugin;
+}
@@ -0,0 +1,89 @@
+#ifndef _SFP_PLUGIN_H_
+#define _SFP_PLUGIN_H_
+
+//The C ABI of the output plugins loaded with -plugin <path>, a plugin only needs this header.
+//A plugin exports SFP_PLUGIN_ENTRY, which returns a static SfpPlugin describing its callbacks:
+//	static const SfpPlugin plugin = { SFP_PLUGIN_ABI_VERSION, sizeof(SfpRecord), 0, 0, my_open, my_records, NULL, my_close };
+//	SFP_PLUGIN_EXPORT const SfpPlugin* sfp_plugin_entry(void) { return &plugin; }
+//The records come in batches, in the order they are parsed, all from the parser thread.
+//A plugin built against another SFP_PLUGIN_ABI_VERSION is refused, the version changes with any change of the structs.
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SFP_PLUGIN_ABI_VERSION 1
+#define SFP_PLUGIN_ENTRY       "sfp_plugin_entry"
+
+#ifdef _WIN32
+#define SFP_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define SFP_PLUGIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+enum SfpEventKind
+{
+	SFP_EVENT_HEADER = 1, //a new input begins, size is the header size, tag_type the flags (4 audio, 1 video), format the version
+	SFP_EVENT_TAG,
+	SFP_EVENT_NALU,
+};
+
+//one parsed header/tag/nalu, plain data, also the event of the shared memory ring and the socket stream
+typedef struct SfpEvent
+{
+	uint32_t kind;             //SfpEventKind
+	int32_t  serial;           //of the tag, or of the nalu in its input
+	int32_t  tag_serial;       //the tag of a nalu
+	uint32_t size;             //tag_size or nalu_size
+	uint64_t offset;           //in the input
+	uint32_t dts;              //the tag's, for a nalu the tag it belongs to
+	uint32_t pts;
+	int32_t  dts_diff;
+	uint8_t  tag_type;         //8 audio, 9 video, 18 script data
+	int8_t   sub_type;         //AACPacketType or AVCPacketType, -1 if none
+	int16_t  format;           //the first byte of the tag data, -1 if none
+	uint8_t  codec_id;         //of a nalu, 7 AVC, 12 HEVC
+	uint8_t  nal_ref_idc;
+	int8_t   nal_unit_type;    //-1 if unknown
+	int8_t   slice_type;       //-1 if not a slice
+	int32_t  frame_num;
+	int32_t  pic_order_cnt_lsb;
+	int8_t   slice_qp_delta;
+	uint8_t  reserved[3];
+} SfpEvent;
+
+typedef struct SfpRecord
+{
+	SfpEvent    event;
+	const char* extra_info;      //compact json of the detail (parameter sets, SEI, slice header), NULL if there is none
+	uint32_t    extra_info_size; //or if the plugin didn't ask for it with SFP_PLUGIN_EXTRA_INFO
+	uint32_t    reserved;
+} SfpRecord;
+
+#define SFP_PLUGIN_EXTRA_INFO 0x1 //fill extra_info, it costs a json serialization per record
+
+typedef struct SfpPlugin
+{
+	uint32_t abi_version;   //SFP_PLUGIN_ABI_VERSION the plugin is built against
+	uint32_t record_size;   //sizeof(SfpRecord) the plugin is built against
+	uint32_t flags;         //SFP_PLUGIN_*
+	uint32_t batch_records; //the most records in a batch, 0 for the default
+
+	//args is what follows -plugin-args, or "", returns the context passed to the other callbacks, NULL to refuse
+	void* (*open)(const char* args);
+	//the records and their extra_info are only valid during the call
+	void (*records)(void* context, const SfpRecord* records, uint32_t count);
+	//an input is finished and its records are all delivered, may be NULL
+	void (*end_input)(void* context);
+	void (*close)(void* context);
+} SfpPlugin;
+
+typedef const SfpPlugin* (*SfpPluginEntryFunc)(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //_SFP_PLUGIN_H_
@@ -0,0 +1,161 @@
+#include "shm_output.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+ShmRingOutput::ShmRingOutput(const std::string& name, uint64_t capacity)
+	: name_(name)
+{
+#ifdef _WIN32
+	printf("Shared memory ring %s is not supported on Windows.\n", name.c_str());
+#else
+	uint64_t slots = 1;
+	while (slots < capacity)
+		slots <<= 1;
+	size_ = sizeof(ShmRingHeader) + slots * sizeof(ShmSlot);
+
+	//a new ring every time, the consumers of an old one keep their mappings
+	shm_unlink(name.c_str());
+	int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if (fd < 0 || ftruncate(fd, (off_t)size_) != 0)
+	{
+		printf("Create shared memory ring %s error.\n", name.c_str());
+		if (fd >= 0)
+		{
+			close(fd);
+			shm_unlink(name.c_str());
+		}
+		return;
+	}
+	void* data = mmap(NULL, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		printf("Map shared memory ring %s error.\n", name.c_str());
+		shm_unlink(name.c_str());
+		return;
+	}
+
+	//the memory is zeroed by ftruncate, so every slot is empty
+	ShmRingHeader* header = (ShmRingHeader*)data;
+	header->version = SHM_RING_VERSION;
+	header->slot_size = sizeof(ShmSlot);
+	header->capacity = slots;
+	header->events_offset = sizeof(ShmRingHeader);
+	slots_ = (ShmSlot*)((char*)data + header->events_offset);
+	//the magic goes last, the consumers check it first
+	std::atomic_thread_fence(std::memory_order_release);
+	memcpy(header->magic, SHM_RING_MAGIC, sizeof(header->magic));
+	header_ = header;
+#endif
+}
+
+ShmRingOutput::~ShmRingOutput()
+{
+#ifndef _WIN32
+	if (header_)
+	{
+		header_->closed.store(1, std::memory_order_release);
+		munmap(header_, size_);
+		shm_unlink(name_.c_str());
+		header_ = NULL;
+	}
+#endif
+}
+
+void MakeHeaderEvent(FlvHeaderInterface* header, ShmEventState& state, ShmEvent& event)
+{
+	state.nalu_serial = 0; //a new file begins
+	memset(&event, 0, sizeof(event));
+	event.kind = ShmEventHeader;
+	event.format = (int16_t)header->Version();
+	event.size = header->HeaderSize();
+	event.tag_type = (uint8_t)((header->HaveAudio() ? 4 : 0) | (header->HaveVideo() ? 1 : 0)); //the flags of the flv header
+}
+
+void MakeTagEvent(FlvTagInterface* tag, ShmEventState& state, ShmEvent& event)
+{
+	state.tag_dts = tag->Dts();
+	state.tag_pts = tag->Pts();
+	memset(&event, 0, sizeof(event));
+	event.kind = ShmEventTag;
+	event.serial = tag->Serial();
+	event.tag_serial = tag->Serial();
+	event.size = tag->TagSize();
+	event.offset = tag->Offset();
+	event.dts = state.tag_dts;
+	event.pts = state.tag_pts;
+	event.dts_diff = tag->DtsDiff();
+	event.tag_type = tag->TagTypeId();
+	event.sub_type = (int8_t)tag->SubTypeId();
+	event.format = (int16_t)tag->FormatId();
+	event.nal_unit_type = -1;
+	event.slice_type = -1;
+}
+
+void MakeNaluEvent(NaluInterface* nalu, ShmEventState& state, ShmEvent& event)
+{
+	memset(&event, 0, sizeof(event));
+	event.kind = ShmEventNalu;
+	event.serial = ++state.nalu_serial;
+	event.tag_serial = nalu->TagSerialBelong();
+	event.size = nalu->NaluSize();
+	event.offset = nalu->Offset();
+	event.dts = state.tag_dts;
+	event.pts = state.tag_pts;
+	event.sub_type = -1;
+	event.format = -1;
+	event.codec_id = nalu->CodecId();
+	event.nal_ref_idc = nalu->NalRefIdc();
+	event.nal_unit_type = (int8_t)nalu->NalUnitTypeId();
+	event.slice_type = (int8_t)nalu->SliceTypeId();
+	event.frame_num = nalu->FrameNum();
+	event.pic_order_cnt_lsb = nalu->PicOrderCntLsb();
+	event.slice_qp_delta = (int8_t)nalu->SliceQpDelta();
+}
+
+ShmEvent& ShmRingOutput::Begin()
+{
+	ShmSlot& slot = slots_[(seq_ + 1) & (header_->capacity - 1)];
+	slot.seq.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release); //a consumer which sees the new content sees the 0 as well
+	return slot.event;
+}
+
+void ShmRingOutput::Publish()
+{
+	seq_++;
+	slots_[seq_ & (header_->capacity - 1)].seq.store(seq_, std::memory_order_release);
+	header_->write_seq.store(seq_, std::memory_order_release);
+}
+
+void ShmRingOutput::FlvHeaderOutput(FlvHeaderInterface* header)
+{
+	if (header == NULL || !header_)
+		return;
+	MakeHeaderEvent(header, state_, Begin());
+	Publish();
+}
+
+void ShmRingOutput::FlvTagOutput(FlvTagInterface* tag)
+{
+	if (tag == NULL || !header_)
+		return;
+	MakeTagEvent(tag, state_, Begin());
+	Publish();
+}
+
+void ShmRingOutput::NaluOutput(NaluInterface* nalu)
+{
+	if (nalu == NULL || !header_)
+		return;
+	MakeNaluEvent(nalu, state_, Begin());
+	Publish();
+}
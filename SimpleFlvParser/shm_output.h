@@ -0,0 +1,48 @@
+#ifndef _SFP_SHM_OUTPUT_H_
+#define _SFP_SHM_OUTPUT_H_
+
+#include "output_interface.h"
+#include "input_interface.h"
+#include "shm_ring.h"
+#include <string>
+
+//Fill the events of the parsed objects, for the outputs which pass them on as they are.
+//The state numbers the nalus of each input and gives them the timestamps of their tag.
+struct ShmEventState
+{
+	int nalu_serial = 0;
+	uint32_t tag_dts = 0;
+	uint32_t tag_pts = 0;
+};
+void MakeHeaderEvent(FlvHeaderInterface* header, ShmEventState& state, ShmEvent& event);
+void MakeTagEvent(FlvTagInterface* tag, ShmEventState& state, ShmEvent& event);
+void MakeNaluEvent(NaluInterface* nalu, ShmEventState& state, ShmEvent& event);
+
+//Publishes every header/tag/nalu as a fixed layout event into a POSIX shared memory ring, see shm_ring.h,
+//so the processes on the same host get them as they are parsed with ShmRingConsumer, nothing is serialized.
+//The producer never waits for the consumers, the ones which fall behind lose the oldest events.
+class ShmRingOutput : public FlvOutputInterface
+{
+public:
+	ShmRingOutput(const std::string& name, uint64_t capacity = 64 * 1024); //the name is like "/sfp", capacity is rounded up to a power of 2
+	~ShmRingOutput(); //mark the ring closed and remove the name, the consumers keep their mappings
+
+	virtual void FlvHeaderOutput(FlvHeaderInterface* header) override;
+	virtual void FlvTagOutput(FlvTagInterface* tag) override;
+	virtual void NaluOutput(NaluInterface* nalu) override;
+	virtual bool IsGood() override { return header_ != NULL; }
+
+private:
+	ShmEvent& Begin(); //the slot of the next event, marked as being written
+	void Publish();
+
+private:
+	std::string name_;
+	ShmRingHeader* header_ = NULL;
+	ShmSlot* slots_ = NULL;
+	size_t size_ = 0;
+	uint64_t seq_ = 0; //the last event published
+	ShmEventState state_;
+};
+
+#endif //_SFP_SHM_OUTPUT_H_
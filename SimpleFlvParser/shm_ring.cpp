@@ -0,0 +1,99 @@
+#include "shm_ring.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+ShmRingConsumer::ShmRingConsumer(const std::string& name, bool from_oldest)
+{
+#ifdef _WIN32
+	printf("Shared memory ring %s is not supported on Windows.\n", name.c_str());
+#else
+	int fd = shm_open(name.c_str(), O_RDWR, 0);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ShmRingHeader))
+	{
+		printf("Open shared memory ring %s error.\n", name.c_str());
+		if (fd >= 0)
+			close(fd);
+		return;
+	}
+	//writable only because the atomics are read through the mapping, nothing is written
+	void* data = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		printf("Map shared memory ring %s error.\n", name.c_str());
+		return;
+	}
+
+	ShmRingHeader* header = (ShmRingHeader*)data;
+	if (memcmp(header->magic, SHM_RING_MAGIC, sizeof(header->magic)) != 0 || header->version != SHM_RING_VERSION
+		|| header->slot_size != sizeof(ShmSlot) || header->capacity == 0
+		|| header->events_offset + header->capacity * sizeof(ShmSlot) > (uint64_t)st.st_size)
+	{
+		printf("%s is not a shared memory ring of this version.\n", name.c_str());
+		munmap(data, (size_t)st.st_size);
+		return;
+	}
+	header_ = header;
+	size_ = (size_t)st.st_size;
+
+	uint64_t last = header_->write_seq.load(std::memory_order_acquire);
+	next_ = last + 1;
+	if (from_oldest)
+		next_ = last > header_->capacity ? last - header_->capacity + 1 : 1;
+#endif
+}
+
+ShmRingConsumer::~ShmRingConsumer()
+{
+#ifndef _WIN32
+	if (header_)
+		munmap(header_, size_);
+#endif
+	header_ = NULL;
+}
+
+bool ShmRingConsumer::Poll(ShmEvent& event)
+{
+	if (!header_)
+		return false;
+	uint64_t capacity = header_->capacity;
+	ShmSlot* slots = (ShmSlot*)((char*)header_ + header_->events_offset);
+	while (true)
+	{
+		uint64_t last = header_->write_seq.load(std::memory_order_acquire);
+		if (next_ > last)
+			return false;
+		if (last - next_ >= capacity)
+		{
+			//lapped, the oldest events are gone
+			lost_ += last - capacity + 1 - next_;
+			next_ = last - capacity + 1;
+		}
+
+		ShmSlot& slot = slots[next_ & (capacity - 1)];
+		if (slot.seq.load(std::memory_order_acquire) != next_)
+			continue; //overwritten since write_seq was read
+		memcpy(&event, &slot.event, sizeof(event));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (slot.seq.load(std::memory_order_relaxed) != next_)
+			continue; //overwritten while it was copied
+		next_++;
+		return true;
+	}
+}
+
+bool ShmRingConsumer::IsClosed() const
+{
+	if (!header_)
+		return true;
+	return header_->closed.load(std::memory_order_acquire) && next_ > header_->write_seq.load(std::memory_order_acquire);
+}
@@ -0,0 +1,73 @@
+#ifndef _SFP_SHM_RING_H_
+#define _SFP_SHM_RING_H_
+
+#include "sfp_plugin.h"
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+//The layout of the shared memory ring written by ShmRingOutput, a single producer and any number of consumers.
+//Every event takes a slot of fixed size, event n (from 1) goes into slot n % capacity. The producer marks the slot
+//as being written, fills it, then stores n into its seq and publishes n as write_seq. Nothing is locked, a consumer
+//which falls more than capacity events behind loses the oldest ones, and knows how many.
+//Only POSIX shared memory is supported.
+
+#define SHM_RING_MAGIC   "SFPRING\n"
+#define SHM_RING_VERSION 1
+
+enum ShmEventKind
+{
+	ShmEventHeader = SFP_EVENT_HEADER,
+	ShmEventTag = SFP_EVENT_TAG,
+	ShmEventNalu = SFP_EVENT_NALU,
+};
+
+//what a consumer gets, plain data, the same as the records of the plugins
+typedef SfpEvent ShmEvent;
+
+//64 bytes, one cache line
+struct ShmSlot
+{
+	std::atomic<uint64_t> seq; //the event number, 0 while it's being written
+	ShmEvent event;
+};
+static_assert(sizeof(ShmSlot) == 64, "a slot should take a cache line");
+
+struct ShmRingHeader
+{
+	char     magic[8];
+	uint32_t version;
+	uint32_t slot_size;    //sizeof(ShmSlot)
+	uint64_t capacity;     //of slots, a power of 2
+	uint64_t events_offset; //of the first slot
+	std::atomic<uint32_t> closed; //the producer has finished
+	uint32_t reserved[7];
+	std::atomic<uint64_t> write_seq; //the last event published, on a cache line of its own
+	char     padding[56];
+};
+static_assert(sizeof(ShmRingHeader) == 128, "write_seq should be at 64");
+
+//Reads the events of a ring from another process, each consumer keeps its own position.
+//	ShmRingConsumer consumer("/sfp");
+//	ShmEvent event;
+//	while (consumer.IsGood())
+//		if (!consumer.Poll(event)) { if (consumer.IsClosed()) break; usleep(100); }
+class ShmRingConsumer
+{
+public:
+	ShmRingConsumer(const std::string& name, bool from_oldest = false); //the events already in the ring are skipped unless from_oldest
+	~ShmRingConsumer();
+
+	bool IsGood() const { return header_ != NULL; }
+	bool Poll(ShmEvent& event); //copy the next event, false if there is none yet
+	bool IsClosed() const; //the producer has finished and every event is read
+	uint64_t Lost() const { return lost_; } //the events overwritten before they were read
+
+private:
+	ShmRingHeader* header_ = NULL;
+	size_t size_ = 0;
+	uint64_t next_ = 1; //the event to read next
+	uint64_t lost_ = 0;
+};
+
+#endif //_SFP_SHM_RING_H_
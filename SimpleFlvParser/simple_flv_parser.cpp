@@ -5,82 +5,216 @@
 #include "flv_file.h"
 #include "db_output.h"
 #include "text_output.h"
+#include "jsonl_output.h"
+#include "columnar_output.h"
+#include "csv_output.h"
+#include "shm_output.h"
+#include "socket_output.h"
+#include "plugin_output.h"
+#include "trace_output.h"
+#include "trace_reader.h"
+#include "multi_output.h"
 #include "demux_to_file.h"
+#include "parallel_ingest.h"
+#include "db_extract.h"
 #include "utils.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <string>
+#include <vector>
 #include <functional>
 
-std::string iuput_file;
+std::vector<std::string> input_files;
 std::string input_type = "flv";
 std::string db_file;
+bool db_bulk = false;
+bool db_async = false;
+bool db_normalized = false;
+bool db_append = false;
+bool db_resume = false;
+int db_jobs = 1;
 std::string txt_file;
+std::string jsonl_file;
+int jsonl_jobs = 1;
+std::string col_file;
+std::string csv_file;
+std::vector<int> csv_columns; //empty for the default ones
+std::string shm_name;
+std::string socket_path;
+std::string trace_file;
+std::vector<std::pair<std::string, std::string> > plugins; //the path and the args of each
 std::string h26x_file;
 std::string aac_file;
+bool copy_async = false;
 bool print_sei = false;
 bool print_metadata = false;
+std::string extract_type; //tag or nalu
+int extract_serial = 0;
+std::string extract_file;
 
 int main(int argc, char* argv[])
 {
 	if (parse_args(argc, argv) < 0)
 		return -1;
 
-	std::shared_ptr<FlvFile> flv;
-	std::shared_ptr<H264File> h264;
-	std::shared_ptr<H265File> h265;
-	std::shared_ptr<DemuxToFile> demux_to_file;
+	//read a single tag or nalu from the input using the db, nothing is parsed
+	if (!extract_type.empty())
+	{
+		std::string input_file = input_files.empty() ? "" : input_files[0];
+		return ExtractFromDB(db_file, input_file, extract_type == "tag", extract_serial, extract_file) ? 0 : -3;
+	}
+
+	DBOutputOptions db_options;
+	db_options.bulk = db_bulk;
+	db_options.async = db_async;
+	db_options.normalized = db_normalized;
+	db_options.append = db_append;
+	db_options.resume = db_resume;
 
+	//only the db is written, the files are parsed by several threads
+	if (db_jobs > 1)
+		return ParallelIngest(input_files, input_type, db_file, db_options, db_jobs) ? 0 : -3;
+
+	std::shared_ptr<DemuxToFile> demux_to_file;
 	if (!h26x_file.empty() || !aac_file.empty())
-		demux_to_file = std::make_shared<DemuxToFile>(h26x_file, aac_file);
-
-	if (input_type == "flv") {
-		flv = std::make_shared<FlvFile>(iuput_file, demux_to_file);
-	} else if (input_type == "h264") {
-		h264 = std::make_shared<H264File>(iuput_file);
-	} else if (input_type == "h265") {
-		h265 = std::make_shared<H265File>(iuput_file);
-	}
+		demux_to_file = std::make_shared<DemuxToFile>(h26x_file, aac_file, copy_async);
 
-	//open an output
+	//open the outputs, all of them are fed in one pass
+	std::shared_ptr<MultiOutput> output = std::make_shared<MultiOutput>();
+	std::shared_ptr<DBOutput> db;
+	std::shared_ptr<TailOutput> db_part; //the db skips the files it has already
 	if (!db_file.empty())
 	{
-		std::shared_ptr<FlvOutputInterface> output = std::make_shared<DBOutput>(db_file);
-		if (output && output->IsGood())
-		{
-			//get the output callbacks
-			FlvHeaderCallback header_cb = std::bind(&FlvOutputInterface::FlvHeaderOutput, output, std::placeholders::_1);
-			FlvTagCallback tag_cb = std::bind(&FlvOutputInterface::FlvTagOutput, output, std::placeholders::_1);
-			NaluCallback nalu_cb = std::bind(&FlvOutputInterface::NaluOutput, output, std::placeholders::_1);
-
-			//do output
-			if (flv)
-				flv->Output(header_cb, tag_cb, nalu_cb);
-			if (h264)
-				h264->Output(nalu_cb);
-			if (h265)
-				h265->Output(nalu_cb);
-		}
+		db = std::make_shared<DBOutput>(db_file, db_options);
+		db_part = std::make_shared<TailOutput>(db);
+		output->AddOutput(db_part);
 	}
-
 	if (!txt_file.empty())
+		output->AddOutput(std::make_shared<TextOutput>(txt_file));
+	if (!jsonl_file.empty())
+		output->AddOutput(std::make_shared<JsonlOutput>(jsonl_file, jsonl_jobs));
+	if (!col_file.empty())
+		output->AddOutput(std::make_shared<ColumnarOutput>(col_file));
+	if (!csv_file.empty())
+		output->AddOutput(std::make_shared<CsvOutput>(csv_file, csv_columns));
+	if (!shm_name.empty())
+		output->AddOutput(std::make_shared<ShmRingOutput>(shm_name));
+	if (!socket_path.empty())
+		output->AddOutput(std::make_shared<SocketStreamOutput>(socket_path));
+	for (const auto& plugin : plugins)
+		output->AddOutput(std::make_shared<PluginOutput>(plugin.first, plugin.second));
+	std::shared_ptr<TraceOutput> trace;
+	if (!trace_file.empty())
 	{
-		std::shared_ptr<FlvOutputInterface> output = std::make_shared<TextOutput>(txt_file);
-		if (output && output->IsGood())
+		trace = std::make_shared<TraceOutput>(trace_file);
+		output->AddOutput(trace);
+	}
+	//a file the db has already is not parsed at all unless something else needs it
+	bool db_only = db && output->OutputCount() == 1 && !demux_to_file && !print_sei && !print_metadata;
+
+	//get the output callbacks
+	FlvHeaderCallback header_cb = std::bind(&FlvOutputInterface::FlvHeaderOutput, output, std::placeholders::_1);
+	FlvTagCallback tag_cb = std::bind(&FlvOutputInterface::FlvTagOutput, output, std::placeholders::_1);
+	NaluCallback nalu_cb = std::bind(&FlvOutputInterface::NaluOutput, output, std::placeholders::_1);
+
+	int input_count = 0;
+	for (const std::string& input_file : input_files)
+	{
+		//the inputs recorded in the trace are fed to the outputs again, nothing is parsed
+		if (input_type == "trace")
+		{
+			TraceReader reader(input_file);
+			std::string source;
+			DBFileVersion version; //of the source when it was traced, it may be gone or changed now
+			while (reader.NextInput(source, version.size, version.mtime))
+			{
+				if (++input_count > 1 && single_input_output())
+				{
+					printf("%s has more than one input, only -db and -trace can take several inputs.\n", input_file.c_str());
+					return -3;
+				}
+				//an input without a path is stored as the trace itself
+				bool traced_file = !source.empty();
+				if (!traced_file)
+					source = input_file;
+				if (db)
+				{
+					db_part->PassAll();
+					if (!db->BeginFile(source, 0, NULL, traced_file ? &version : NULL))
+					{
+						if (db_only)
+						{
+							printf("%s is unchanged since it was stored in %s, skipped.\n", source.c_str(), db_file.c_str());
+							continue;
+						}
+						printf("%s is unchanged since it was stored in %s, only the other outputs get it.\n", source.c_str(), db_file.c_str());
+						db_part->PassNone();
+					}
+				}
+				if (trace)
+					trace->BeginInput(source, version.size, version.mtime);
+				if (output->IsGood())
+					reader.Replay(output.get());
+				output->EndInput();
+			}
+			continue;
+		}
+
+		FlvResumePoint resume;
+		if (db)
 		{
-			//get the output callbacks
-			FlvHeaderCallback header_cb = std::bind(&FlvOutputInterface::FlvHeaderOutput, output, std::placeholders::_1);
-			FlvTagCallback tag_cb = std::bind(&FlvOutputInterface::FlvTagOutput, output, std::placeholders::_1);
-			NaluCallback nalu_cb = std::bind(&FlvOutputInterface::NaluOutput, output, std::placeholders::_1);
+			db_part->PassAll();
+			if (!db->BeginFile(input_file, 0, &resume))
+			{
+				if (db_only)
+				{
+					printf("%s is unchanged since it was stored in %s, skipped.\n", input_file.c_str(), db_file.c_str());
+					continue;
+				}
+				printf("%s is unchanged since it was stored in %s, only the other outputs get it.\n", input_file.c_str(), db_file.c_str());
+				db_part->PassNone();
+			}
+		}
+		if (trace)
+		{
+			uint64_t size = 0;
+			int64_t mtime = 0;
+			GetFileSizeAndMtime(input_file, size, mtime);
+			trace->BeginInput(input_file, size, mtime);
+		}
 
-			//do output
-			if (flv)
+		if (input_type == "flv") {
+			//only the db resumes, the file is still read from the start when the other outputs want all of it
+			bool read_tail = resume.end_offset && db_only;
+			std::unique_ptr<FlvFile> flv(new FlvFile(input_file, demux_to_file, read_tail ? &resume : NULL));
+			bool resumed = read_tail ? flv->IsGood() : (resume.end_offset && flv->EndsAt(resume));
+			if (resume.end_offset && !resumed)
+			{
+				printf("%s is changed before the end of what was stored in %s, store it again.\n", input_file.c_str(), db_file.c_str());
+				db->RestartFile();
+				if (read_tail)
+					flv.reset(new FlvFile(input_file, demux_to_file));
+			}
+			else if (resume.end_offset)
+			{
+				printf("%s is resumed after tag %d.\n", input_file.c_str(), resume.last_tag_serial);
+				db_part->PassAfter(resume.last_tag_serial);
+			}
+			if (output->IsGood())
 				flv->Output(header_cb, tag_cb, nalu_cb);
-			if (h264)
-				h264->Output(nalu_cb);
-			if (h265)
-				h265->Output(nalu_cb);
+			output->EndInput();
+		} else if (input_type == "h264") {
+			H264File h264(input_file);
+			if (output->IsGood())
+				h264.Output(nalu_cb);
+			output->EndInput();
+		} else if (input_type == "h265") {
+			H265File h265(input_file);
+			if (output->IsGood())
+				h265.Output(nalu_cb);
+			output->EndInput();
 		}
 	}
 
@@ -105,11 +239,11 @@ int parse_args(int argc, char* argv[])
 			if (i + 1 >= argc || argv[i + 1][0] == '-')
 				goto help;
 			else
-				iuput_file = argv[++i];
+				input_files.push_back(argv[++i]);
 		}
 		else if (strcmp(argv[i], "-type") == 0) 
 		{
-			if (i + 1 >= argc || (strcmp(argv[i + 1], "flv") && strcmp(argv[i + 1], "h264") && strcmp(argv[i + 1], "h265")))
+			if (i + 1 >= argc || (strcmp(argv[i + 1], "flv") && strcmp(argv[i + 1], "h264") && strcmp(argv[i + 1], "h265") && strcmp(argv[i + 1], "trace")))
 				goto help;
 			else
 				input_type = argv[++i];
@@ -121,6 +255,33 @@ int parse_args(int argc, char* argv[])
 			else
 				db_file = argv[++i];
 		}
+		else if (strcmp(argv[i], "-db-bulk") == 0)
+		{
+			db_bulk = true;
+		}
+		else if (strcmp(argv[i], "-db-async") == 0)
+		{
+			db_async = true;
+		}
+		else if (strcmp(argv[i], "-db-normalized") == 0)
+		{
+			db_normalized = true;
+		}
+		else if (strcmp(argv[i], "-db-append") == 0)
+		{
+			db_append = true;
+		}
+		else if (strcmp(argv[i], "-db-resume") == 0)
+		{
+			db_resume = true;
+		}
+		else if (strcmp(argv[i], "-db-jobs") == 0)
+		{
+			if (i + 1 >= argc || atoi(argv[i + 1]) <= 0)
+				goto help;
+			else
+				db_jobs = atoi(argv[++i]);
+		}
 		else if (strcmp(argv[i], "-txt") == 0)
 		{
 			if (i + 1 >= argc || argv[i + 1][0] == '-')
@@ -128,6 +289,76 @@ int parse_args(int argc, char* argv[])
 			else
 				txt_file = argv[++i];
 		}
+		else if (strcmp(argv[i], "-jsonl") == 0)
+		{
+			if (i + 1 >= argc || argv[i + 1][0] == '-')
+				goto help;
+			else
+				jsonl_file = argv[++i];
+		}
+		else if (strcmp(argv[i], "-jsonl-jobs") == 0)
+		{
+			if (i + 1 >= argc || atoi(argv[i + 1]) <= 0)
+				goto help;
+			else
+				jsonl_jobs = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-col") == 0)
+		{
+			if (i + 1 >= argc || argv[i + 1][0] == '-')
+				goto help;
+			else
+				col_file = argv[++i];
+		}
+		else if (strcmp(argv[i], "-csv") == 0)
+		{
+			if (i + 1 >= argc || argv[i + 1][0] == '-')
+				goto help;
+			else
+				csv_file = argv[++i];
+		}
+		else if (strcmp(argv[i], "-csv-columns") == 0)
+		{
+			if (i + 1 >= argc || argv[i + 1][0] == '-' || !CsvOutput::ParseColumns(argv[i + 1], csv_columns))
+				goto help;
+			i++;
+		}
+		else if (strcmp(argv[i], "-shm") == 0)
+		{
+			if (i + 1 >= argc || argv[i + 1][0] != '/')
+				goto help;
+			else
+				shm_name = argv[++i];
+		}
+		else if (strcmp(argv[i], "-socket") == 0)
+		{
+			if (i + 1 >= argc || argv[i + 1][0] == '-')
+				goto help;
+			else
+				socket_path = argv[++i];
+		}
+		else if (strcmp(argv[i], "-trace") == 0)
+		{
+			if (i + 1 >= argc || argv[i + 1][0] == '-')
+				goto help;
+			else
+				trace_file = argv[++i];
+		}
+		else if (strcmp(argv[i], "-plugin") == 0)
+		{
+			if (i + 1 >= argc || argv[i + 1][0] == '-')
+				goto help;
+			else
+				plugins.push_back(std::make_pair(std::string(argv[++i]), std::string()));
+		}
+		else if (strcmp(argv[i], "-plugin-args") == 0)
+		{
+			//for the -plugin before it, the args may start with '-'
+			if (i + 1 >= argc || plugins.empty())
+				goto help;
+			else
+				plugins.back().second = argv[++i];
+		}
 		else if (strcmp(argv[i], "-print_sei") == 0)
 		{
 			print_sei = true;
@@ -136,6 +367,23 @@ int parse_args(int argc, char* argv[])
 		{
 			print_metadata = true;
 		}
+		else if (strcmp(argv[i], "-extract-tag") == 0 || strcmp(argv[i], "-extract-nalu") == 0)
+		{
+			if (i + 1 >= argc || atoi(argv[i + 1]) <= 0)
+				goto help;
+			else
+			{
+				extract_type = strcmp(argv[i], "-extract-tag") == 0 ? "tag" : "nalu";
+				extract_serial = atoi(argv[++i]);
+			}
+		}
+		else if (strcmp(argv[i], "-o") == 0)
+		{
+			if (i + 1 >= argc || argv[i + 1][0] == '-')
+				goto help;
+			else
+				extract_file = argv[++i];
+		}
 		else if (strcmp(argv[i], "-vcopy") == 0)
 		{
 			if (i + 1 >= argc || argv[i + 1][0] == '-')
@@ -150,6 +398,10 @@ int parse_args(int argc, char* argv[])
 			else
 				aac_file = argv[++i];
 		}
+		else if (strcmp(argv[i], "-copy-async") == 0)
+		{
+			copy_async = true;
+		}
 		else
 		{
 			if (argv[i][0] == '-')
@@ -160,13 +412,43 @@ int parse_args(int argc, char* argv[])
 		}
 	}
 
-	if (iuput_file.empty() || (db_file.empty() && txt_file.empty() && h26x_file.empty() && aac_file.empty() && !print_sei && !print_metadata))
+	if (!extract_type.empty())
+	{
+		if (db_file.empty() || extract_file.empty() || input_files.size() > 1)
+			goto help;
+		return 0;
+	}
+
+	if (input_files.empty() || (db_file.empty() && txt_file.empty() && jsonl_file.empty() && col_file.empty() && csv_file.empty() && shm_name.empty() && socket_path.empty() && plugins.empty() && trace_file.empty() && h26x_file.empty() && aac_file.empty() && !print_sei && !print_metadata))
+		goto help;
+	if (input_files.size() > 1 && single_input_output())
+	{
+		printf("Only -db and -trace can take more than one -i, the other outputs don't tell the input files apart.\n");
+		goto help;
+	}
+	if (db_jobs > 1 && (db_file.empty() || !txt_file.empty() || !jsonl_file.empty() || !col_file.empty() || !csv_file.empty() || !shm_name.empty() || !socket_path.empty() || !plugins.empty() || !trace_file.empty() || !h26x_file.empty() || !aac_file.empty()))
+	{
+		printf("-db-jobs only works when the input files are parsed into a db only.\n");
+		goto help;
+	}
+	if (db_jobs > 1 && db_resume)
+	{
+		printf("-db-resume can't be used with -db-jobs, the shards always store whole files.\n");
+		goto help;
+	}
+	if (input_type == "trace" && (db_jobs > 1 || !h26x_file.empty() || !aac_file.empty() || print_sei || print_metadata))
+	{
+		printf("A trace has no bitstream, -db-jobs, -vcopy, -acopy, -print_sei and -print_metadata need the input files.\n");
 		goto help;
+	}
 
-	if (!FilePathIsExist(iuput_file, false))
+	for (const std::string& input_file : input_files)
 	{
-		printf("Flv file %s doesn't exist.\n", iuput_file.c_str());
-		return -2;
+		if (!FilePathIsExist(input_file, false))
+		{
+			printf("Flv file %s doesn't exist.\n", input_file.c_str());
+			return -2;
+		}
 	}
 
 	return 0;
@@ -176,19 +458,45 @@ help:
 	return -1;
 }
 
+bool single_input_output()
+{
+	return !txt_file.empty() || !jsonl_file.empty() || !col_file.empty() || !csv_file.empty() || !shm_name.empty() || !socket_path.empty() || !plugins.empty() || !h26x_file.empty() || !aac_file.empty();
+}
+
 void print_help()
 {
 	printf("SimpleFlvParser usage: \n");
-	printf("\tSimpleFlvParser -i <input flv file> [-type flv|h264|h265] "\
-		"[-db <output db file>] [-txt <output text file>] "\
+	printf("\tSimpleFlvParser -i <input flv file> [-i <input flv file> ...] [-type flv|h264|h265|trace] "\
+		"[-db <output db file>] [-db-bulk] [-db-async] [-db-normalized] [-db-append] [-db-resume] [-db-jobs <n>] [-txt <output text file>] [-jsonl <output jsonl file>] [-jsonl-jobs <n>] [-col <output columnar file>] [-csv <output csv file>] [-csv-columns <columns>] [-shm </name>] [-socket <path>] [-plugin <path> [-plugin-args <args>] ...] [-trace <output trace file>] "\
 		"[-print_sei] [-print_metadata] "
-		"[-vcopy <output h264/h265 file>] [-acopy <output aac file>]\n");
-	printf("\t-i <input flv file>: 输入的被解析文件路径\n");
-	printf("\t-type flv|h264|h265: 输入的文件类型，支持flv文件和annex-b格式的H264/H265文件\n");
+		"[-vcopy <output h264/h265 file>] [-acopy <output aac file>] [-copy-async]\n");
+	printf("\tSimpleFlvParser -db <db file> -extract-tag|-extract-nalu <serial> -o <output file> [-i <input flv file>]\n");
+	printf("\t-i <input flv file>: 输入的被解析文件路径，可以指定多个，依次解析，但多个输入文件只能输出到-db和-trace\n");
+	printf("\t-type flv|h264|h265|trace: 输入的文件类型，支持flv文件和annex-b格式的H264/H265文件，trace为-trace输出的文件，不再解析，直接重放给各输出\n");
 	printf("\t-db <output db file>: 输出db文件路径\n");
+	printf("\t-db-bulk: 以批量导入模式写db，关闭journal和磁盘同步，速度更快，但进程中途退出会导致db文件损坏\n");
+	printf("\t-db-async: 在单独的线程中写db，与解析并行\n");
+	printf("\t-db-normalized: 参数集、SEI和slice header分表存储，只存一份紧凑的json，db文件更小\n");
+	printf("\t-db-append: 保留已有的db文件，把输入文件追加进去，已完整入库且未修改过的文件不再写入db，没有其他输出时不解析\n");
+	printf("\t-db-resume: 同-db-append，但对于入库后又增长了的文件（如正在录制的文件），从上次入库的最后一个tag之后继续解析，db只追加新的tag和nalu，其他输出仍得到整个文件，之前的部分有变化时整个文件重新入库\n");
+	printf("\t-db-jobs <n>: 用n个线程并行解析输入文件，各自写入单独的分片db，最后在一个事务中合并到输出db，最多10个，不能与-db-resume、-txt、-jsonl、-col、-csv、-shm、-socket、-plugin、-trace、-vcopy、-acopy同时使用\n");
 	printf("\t-txt <output text file>: 输出文本文件路径\n");
+	printf("\t-jsonl <output jsonl file>: 输出NDJSON文件路径，每个header、tag、nalu一行紧凑的json，参数集、SEI、slice header等详细信息嵌在info中\n");
+	printf("\t-jsonl-jobs <n>: 用n个线程并行序列化jsonl的行，每批行写入各自的缓冲，再由一个线程按顺序写入文件，输出与单线程相同\n");
+	printf("\t-col <output columnar file>: 输出列存二进制文件路径，tag和nalu的每个字段存成一个定长数组，字符串字段字典编码，文件末尾是schema，用ColumnarReader以mmap方式读取\n");
+	printf("\t-csv <output csv file>: 输出CSV文件路径，tag和nalu按解析顺序各一行，type列区分，不适用的列留空\n");
+	printf("\t-csv-columns <columns>: CSV输出的列，逗号分隔，默认是除extra_info外的所有列，只有选中的列才会计算，extra_info为紧凑json，可选的列：\n\t\t%s\n", CsvOutput::ColumnNames().c_str());
+	printf("\t-shm </name>: 把header、tag、nalu作为定长事件发布到POSIX共享内存环形缓冲中，本机其他进程用ShmRingConsumer无锁读取，跟不上的消费者会丢掉最旧的事件，不支持Windows\n");
+	printf("\t-socket <path>: 在Unix domain socket上监听，把header、tag、nalu作为定长二进制帧推送给所有连接的订阅者，订阅者可随时连接和断开，每个订阅者有单独的队列，队列满时丢掉最旧的帧，帧序号不连续即表示有丢失，不支持Windows\n");
+	printf("\t-plugin <path>: 加载输出插件（.so/.dll），插件实现sfp_plugin.h中的C接口，header、tag、nalu按解析顺序成批回调给插件，可以指定多个\n");
+	printf("\t-plugin-args <args>: 传给前一个-plugin的open回调的参数字符串\n");
+	printf("\t-trace <output trace file>: 输出紧凑的二进制trace，记录tag、nalu的各字段和详细信息，以后用-type trace重放生成db、文本、CSV等，无需原文件也不再解析\n");
 	printf("\t-print_sei: 打印SEI内容\n");
 	printf("\t-print_metadata: 打印metadata内容\n");
 	printf("\t-vcopy <output h264/h265 file>: 从flv中demux输出h264或h265文件的路径\n");
 	printf("\t-acopy <output aac file>: 从flv中demux输出aac文件的路径\n");
+	printf("\t-copy-async: -vcopy、-acopy的输出由单独的线程写入文件，与解析并行\n");
+	printf("\t-extract-tag <serial>: 根据db中记录的偏移和大小，从输入文件中直接读出指定序号的tag，不需要重新解析，文件入库后被修改过（大小或修改时间不同）时不读出\n");
+	printf("\t-extract-nalu <serial>: 根据db中记录的偏移和大小，从输入文件中直接读出指定序号的nalu\n");
+	printf("\t-o <output file>: 读出的tag或nalu的输出文件路径，db中有多个文件时用-i指定其中一个\n");
 }
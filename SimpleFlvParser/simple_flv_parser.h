@@ -3,6 +3,9 @@
 
 int parse_args(int argc, char* argv[]);
 
+//an output which takes a single input is wanted, only the db and the trace keep several input files apart
+bool single_input_output();
+
 void print_help();
 
 #endif
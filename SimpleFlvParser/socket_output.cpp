@@ -0,0 +1,316 @@
+#include "socket_output.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 //macOS, SO_NOSIGPIPE is set on the socket instead
+#endif
+
+SocketStreamOutput::SocketStreamOutput(const std::string& socket_path, size_t queue_frames)
+	: socket_path_(socket_path), queue_frames_(queue_frames > 0 ? queue_frames : 1), wake_pending_(false)
+{
+#ifdef _WIN32
+	printf("Unix domain socket %s is not supported on Windows.\n", socket_path.c_str());
+#else
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (socket_path.size() >= sizeof(addr.sun_path))
+	{
+		printf("Socket path %s is too long.\n", socket_path.c_str());
+		return;
+	}
+	memcpy(addr.sun_path, socket_path.c_str(), socket_path.size());
+
+	//a socket left by an earlier run would fail the bind
+	unlink(socket_path.c_str());
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 16) != 0)
+	{
+		printf("Listen on socket %s error.\n", socket_path.c_str());
+		if (fd >= 0)
+			close(fd);
+		return;
+	}
+	if (pipe(wake_fds_) != 0)
+	{
+		printf("Create pipe for socket %s error.\n", socket_path.c_str());
+		close(fd);
+		unlink(socket_path.c_str());
+		return;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	fcntl(wake_fds_[0], F_SETFL, fcntl(wake_fds_[0], F_GETFL) | O_NONBLOCK);
+	fcntl(wake_fds_[1], F_SETFL, fcntl(wake_fds_[1], F_GETFL) | O_NONBLOCK);
+	listen_fd_ = fd;
+	thread_ = std::thread(&SocketStreamOutput::SocketThread, this);
+#endif
+}
+
+SocketStreamOutput::~SocketStreamOutput()
+{
+#ifndef _WIN32
+	if (thread_.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+		Wake();
+		thread_.join();
+	}
+	if (wake_fds_[0] >= 0)
+	{
+		close(wake_fds_[0]);
+		close(wake_fds_[1]);
+	}
+	if (listen_fd_ >= 0)
+	{
+		close(listen_fd_);
+		unlink(socket_path_.c_str());
+		listen_fd_ = -1;
+	}
+#endif
+}
+
+void SocketStreamOutput::FlvHeaderOutput(FlvHeaderInterface* header)
+{
+	if (header == NULL || listen_fd_ < 0)
+		return;
+	ShmEvent event;
+	MakeHeaderEvent(header, state_, event);
+	Push(event);
+}
+
+void SocketStreamOutput::FlvTagOutput(FlvTagInterface* tag)
+{
+	if (tag == NULL || listen_fd_ < 0)
+		return;
+	ShmEvent event;
+	MakeTagEvent(tag, state_, event);
+	Push(event);
+}
+
+void SocketStreamOutput::NaluOutput(NaluInterface* nalu)
+{
+	if (nalu == NULL || listen_fd_ < 0)
+		return;
+	ShmEvent event;
+	MakeNaluEvent(nalu, state_, event);
+	Push(event);
+}
+
+void SocketStreamOutput::Push(const ShmEvent& event)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		seq_++; //counted even if nobody listens, so the seq tells how far the parser is
+		if (subscribers_.empty())
+			return;
+		StreamFrame frame;
+		frame.seq = seq_;
+		frame.event = event;
+		for (auto& subscriber : subscribers_)
+		{
+			if (subscriber->queue.size() >= queue_frames_)
+			{
+				subscriber->queue.pop_front();
+				subscriber->dropped++;
+			}
+			subscriber->queue.push_back(frame);
+		}
+	}
+	Wake();
+}
+
+void SocketStreamOutput::Wake()
+{
+#ifndef _WIN32
+	//one byte in the pipe is enough, the thread takes everything queued when it wakes up
+	if (!wake_pending_.exchange(true))
+	{
+		char c = 0;
+		if (write(wake_fds_[1], &c, 1) < 0)
+			wake_pending_ = false;
+	}
+#endif
+}
+
+bool SocketStreamOutput::Send(Subscriber& subscriber)
+{
+#ifndef _WIN32
+	while (true)
+	{
+		if (subscriber.sent == subscriber.sending.size())
+		{
+			subscriber.sending.clear();
+			subscriber.sent = 0;
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (subscriber.queue.empty())
+				return true;
+			//take a batch at a time, so the parser is not held up by a long copy
+			size_t count = subscriber.queue.size() < 1024 ? subscriber.queue.size() : 1024;
+			subscriber.sending.resize(count * sizeof(StreamFrame));
+			for (size_t i = 0; i < count; i++)
+			{
+				memcpy(&subscriber.sending[i * sizeof(StreamFrame)], &subscriber.queue.front(), sizeof(StreamFrame));
+				subscriber.queue.pop_front();
+			}
+		}
+
+		ssize_t n = send(subscriber.fd, &subscriber.sending[subscriber.sent], subscriber.sending.size() - subscriber.sent, MSG_NOSIGNAL);
+		if (n > 0)
+			subscriber.sent += (size_t)n;
+		else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+			return true; //the socket buffer is full, wait for POLLOUT
+		else if (n < 0 && errno == EINTR)
+			continue;
+		else
+			return false;
+	}
+#else
+	return false;
+#endif
+}
+
+void SocketStreamOutput::SocketThread()
+{
+#ifndef _WIN32
+	std::vector<struct pollfd> fds;
+	std::chrono::steady_clock::time_point deadline;
+	bool stopping = false;
+	while (true)
+	{
+		if (!stopping)
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (stopping_)
+			{
+				stopping = true;
+				deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+			}
+		}
+		if (stopping)
+		{
+			//leave when every subscriber has its frames, or the slow ones are given up on
+			bool pending = false;
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				for (auto& subscriber : subscribers_)
+					if (!subscriber->queue.empty() || subscriber->sent < subscriber->sending.size())
+						pending = true;
+			}
+			if (!pending || std::chrono::steady_clock::now() >= deadline)
+				break;
+		}
+
+		fds.clear();
+		struct pollfd pfd;
+		pfd.fd = listen_fd_;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		fds.push_back(pfd);
+		pfd.fd = wake_fds_[0];
+		fds.push_back(pfd);
+		for (auto& subscriber : subscribers_)
+		{
+			//the subscribers only send to hang up, POLLIN tells about that
+			pfd.fd = subscriber->fd;
+			pfd.events = POLLIN;
+			if (subscriber->sent < subscriber->sending.size())
+				pfd.events |= POLLOUT;
+			fds.push_back(pfd);
+		}
+		if (poll(&fds[0], (nfds_t)fds.size(), stopping ? 10 : 1000) < 0 && errno != EINTR)
+			break;
+
+		if (fds[1].revents & POLLIN)
+		{
+			wake_pending_ = false;
+			char buffer[64];
+			while (read(wake_fds_[0], buffer, sizeof(buffer)) > 0)
+				;
+		}
+
+		//the subscribers polled are the first fds.size() - 2, the new ones come after them
+		std::vector<size_t> gone;
+		for (size_t i = 0; i + 2 < fds.size(); i++)
+		{
+			Subscriber& subscriber = *subscribers_[i];
+			bool alive = true;
+			if (fds[i + 2].revents & (POLLERR | POLLHUP | POLLNVAL))
+				alive = false;
+			else if (fds[i + 2].revents & POLLIN)
+			{
+				char buffer[256];
+				ssize_t n = recv(subscriber.fd, buffer, sizeof(buffer), 0);
+				if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+					alive = false;
+			}
+			if (alive)
+				alive = Send(subscriber);
+			if (!alive)
+				gone.push_back(i);
+		}
+		if (!gone.empty())
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			for (size_t i = gone.size(); i-- > 0;)
+			{
+				close(subscribers_[gone[i]]->fd);
+				subscribers_.erase(subscribers_.begin() + gone[i]);
+			}
+		}
+
+		if (fds[0].revents & POLLIN)
+		{
+			while (true)
+			{
+				int fd = accept(listen_fd_, NULL, NULL);
+				if (fd < 0)
+					break;
+				fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+				int on = 1;
+				setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+				std::unique_ptr<Subscriber> subscriber(new Subscriber);
+				subscriber->fd = fd;
+				StreamHello hello;
+				memcpy(hello.magic, STREAM_MAGIC, sizeof(hello.magic));
+				hello.version = STREAM_VERSION;
+				hello.frame_size = sizeof(StreamFrame);
+				subscriber->sending.assign((char*)&hello, (char*)&hello + sizeof(hello));
+				if (!Send(*subscriber))
+				{
+					close(fd);
+					continue;
+				}
+				//it gets the events from now on
+				std::lock_guard<std::mutex> lock(mutex_);
+				subscribers_.push_back(std::move(subscriber));
+			}
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (auto& subscriber : subscribers_)
+	{
+		if (subscriber->dropped > 0)
+			printf("A subscriber of socket %s dropped %llu frames.\n", socket_path_.c_str(), (unsigned long long)subscriber->dropped);
+		close(subscriber->fd);
+	}
+	subscribers_.clear();
+#endif
+}
@@ -0,0 +1,75 @@
+#ifndef _SFP_SOCKET_OUTPUT_H_
+#define _SFP_SOCKET_OUTPUT_H_
+
+#include "output_interface.h"
+#include "shm_output.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+//What a subscriber reads from the socket: a StreamHello once, then one StreamFrame per header/tag/nalu.
+//The seq of the frames goes up by one for every event, a gap means the subscriber was too slow and lost them.
+#define STREAM_MAGIC   "SFPSTRM\n"
+#define STREAM_VERSION 1
+
+struct StreamHello
+{
+	char     magic[8];
+	uint32_t version;
+	uint32_t frame_size; //sizeof(StreamFrame)
+};
+
+struct StreamFrame
+{
+	uint64_t seq;
+	ShmEvent event; //the same layout as the shared memory ring
+};
+static_assert(sizeof(StreamFrame) == 64, "a frame should be 64 bytes");
+
+//Streams the events over a Unix domain socket to every process connected to it, they can come and go at any time.
+//The sockets are served by a thread of its own, each subscriber has a queue of its own, when a queue is full
+//the oldest frames are dropped, so a slow subscriber never holds up the parser or the other subscribers.
+class SocketStreamOutput : public FlvOutputInterface
+{
+public:
+	SocketStreamOutput(const std::string& socket_path, size_t queue_frames = 64 * 1024);
+	~SocketStreamOutput(); //give the subscribers a moment to take the queued frames, then close and remove the socket
+
+	virtual void FlvHeaderOutput(FlvHeaderInterface* header) override;
+	virtual void FlvTagOutput(FlvTagInterface* tag) override;
+	virtual void NaluOutput(NaluInterface* nalu) override;
+	virtual bool IsGood() override { return listen_fd_ >= 0; }
+
+private:
+	struct Subscriber
+	{
+		int fd = -1;
+		std::deque<StreamFrame> queue; //guarded by the mutex
+		uint64_t dropped = 0;
+		std::vector<char> sending; //only used by the socket thread, the frames taken from the queue
+		size_t sent = 0;
+	};
+	void Push(const ShmEvent& event);
+	void Wake();
+	void SocketThread();
+	bool Send(Subscriber& subscriber); //false if the subscriber is gone
+
+private:
+	std::string socket_path_;
+	size_t queue_frames_;
+	int listen_fd_ = -1;
+	int wake_fds_[2] = { -1, -1 }; //a pipe to wake up the socket thread
+	std::atomic<bool> wake_pending_;
+	std::thread thread_;
+	std::mutex mutex_;
+	std::vector<std::unique_ptr<Subscriber> > subscribers_;
+	bool stopping_ = false; //guarded by the mutex
+	uint64_t seq_ = 0; //the last event pushed
+	ShmEventState state_;
+};
+
+#endif //_SFP_SOCKET_OUTPUT_H_
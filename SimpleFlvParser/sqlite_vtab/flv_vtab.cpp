@@ -0,0 +1,528 @@
+//A SQLite virtual table module over a flv file, so a few queries don't need the whole file ingested first:
+//	.load ./flv_vtab
+//	CREATE VIRTUAL TABLE t USING flv('file.flv');
+//	SELECT serial, dts, format FROM t WHERE tag_type = 'VideoTag' AND dts BETWEEN 1000 AND 2000;
+//Only the tag headers are scanned when the table is created, a tag is decoded when one of its decoded
+//columns (pts, sub_type, extra_info) is read. Constraints on dts and tag_type are pushed down via xBestIndex,
+//so the other tags are never touched. The tags the parser skips by their headers get no row and no serial.
+
+#include "sqlite3ext.h"
+SQLITE_EXTENSION_INIT1
+
+#include "flv_file_internal.h"
+#include "input_source.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <memory>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+//used by the parser, the virtual table never prints
+bool print_sei = false;
+bool print_metadata = false;
+
+static const char *SQL_STAT_DECLARE_FLV_TABLE = \
+	"CREATE TABLE x(\
+		serial INTEGER, \
+		previous_tag_size INTEGER, \
+		tag_type TEXT, \
+		stream_id INTEGER, \
+		tag_size INTEGER, \
+		file_offset INTEGER, \
+		pts INTEGER, \
+		dts INTEGER, \
+		dts_diff INTEGER, \
+		sub_type TEXT, \
+		format TEXT, \
+		extra_info TEXT)";
+
+enum FlvColumn
+{
+	FlvColumnSerial,
+	FlvColumnPreviousTagSize,
+	FlvColumnTagType,
+	FlvColumnStreamId,
+	FlvColumnTagSize,
+	FlvColumnFileOffset,
+	FlvColumnPts,
+	FlvColumnDts,
+	FlvColumnDtsDiff,
+	FlvColumnSubType,
+	FlvColumnFormat,
+	FlvColumnExtraInfo,
+};
+
+//idxNum bits, the arguments of xFilter come in the same order
+#define FLV_INDEX_DTS_MIN  0x01
+#define FLV_INDEX_DTS_MAX  0x02
+#define FLV_INDEX_TAG_TYPE 0x04
+#define FLV_INDEX_DTS_EQ   0x10 //dts = x, the argument of FLV_INDEX_DTS_MIN is also the max
+
+//what the scan keeps of a tag, enough to filter and to locate it for decoding
+struct FlvTagIndex
+{
+	int      serial = 0; //the serial the parser gives it, the tags it skips have none
+	uint64_t offset = 0; //of the previous tag size before the tag header
+	uint32_t previous_tag_size = 0;
+	uint8_t  tag_type = 0;
+	uint32_t tag_data_size = 0;
+	uint32_t dts = 0;
+	uint32_t stream_id = 0;
+	int      dts_diff = 0;
+	uint8_t  format = 0; //the first byte of the tag data
+	int      config = -1; //the last sequence header / audio config before this tag, decoded first so the tag can be parsed
+};
+
+struct FlvVtab
+{
+	sqlite3_vtab base; //must be the first member
+	std::shared_ptr<InputSource> input;
+	std::vector<FlvTagIndex> tags;
+	bool dts_sorted = true; //then dts ranges are found by binary search
+};
+
+struct FlvCursor
+{
+	sqlite3_vtab_cursor base; //must be the first member
+	size_t pos = 0;
+	size_t end = 0;
+	bool has_dts_max = false;
+	int64_t dts_max = 0;
+	int tag_type = -1;
+	std::unique_ptr<FlvTag> tag; //decoded lazily
+	std::vector<uint8_t> buffer;
+};
+
+//what the parser checks before it decodes the tag body, a tag it skips gets no serial
+static bool TagHeaderIsGood(uint8_t* header, uint32_t got)
+{
+	uint8_t tag_type = header[0];
+	uint32_t tag_data_size = (uint32_t)BytesToInt(header + 1, 3);
+	if (BytesToInt(header + 8, 3) != 0 || tag_data_size == 0)
+		return false;
+
+	uint8_t* data = header + FLV_TAG_HEADER_SIZE;
+	bool have_packet_type = tag_data_size > 1 && got > FLV_TAG_HEADER_SIZE + 1;
+	switch (tag_type)
+	{
+	case FlvTagTypeAudio:
+	{
+		ByteReader reader(data, 1);
+		AudioTagHeader audio(reader);
+		if (!audio.is_good_)
+			return false;
+		return audio.audio_format_ != AudioFormatAAC || (have_packet_type && data[1] <= AudioTagTypeAACData);
+	}
+	case FlvTagTypeVideo:
+	{
+		ByteReader reader(data, 1);
+		VideoTagHeader video(reader);
+		if (!video.is_good_)
+			return false;
+		if (video.codec_id_ != FlvVideoCodeIDAVC && video.codec_id_ != FlvVideoCodeIDHEVC)
+			return true;
+		return have_packet_type && data[1] <= VideoTagTypeAVCSequenceEnd;
+	}
+	case FlvTagTypeScriptData:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool BuildIndex(FlvVtab* vtab, uint64_t file_size)
+{
+	InputSource* input = vtab->input.get();
+	uint8_t buf[PREVIOUS_TAG_SIZE_SIZE + FLV_TAG_HEADER_SIZE + 2];
+	if (input->Read(buf, FLV_HEADER_SIZE) != FLV_HEADER_SIZE || memcmp(buf, "FLV", 3) != 0)
+		return false;
+
+	uint64_t offset = (uint32_t)BytesToInt(buf + 5, 4);
+	uint32_t last_dts[2] = { 0 }; //audio, video
+	int last_config[2] = { -1, -1 }; //audio, video
+	int serial = 0;
+	while (input->Seek(offset))
+	{
+		uint32_t got = input->Read(buf, sizeof(buf));
+		if (got < PREVIOUS_TAG_SIZE_SIZE + FLV_TAG_HEADER_SIZE)
+			break;
+
+		uint8_t* header = buf + PREVIOUS_TAG_SIZE_SIZE;
+		uint32_t tag_data_size = (uint32_t)BytesToInt(header + 1, 3);
+		uint64_t tag_offset = offset;
+		offset += PREVIOUS_TAG_SIZE_SIZE + FLV_TAG_HEADER_SIZE + tag_data_size;
+		if (offset > file_size) //the parser stops at a tag which is cut off
+			break;
+		if (!TagHeaderIsGood(header, got - PREVIOUS_TAG_SIZE_SIZE))
+			continue;
+
+		//the tag body is not checked, one the parser fails to decode still gets a row, its decoded columns are null
+		FlvTagIndex tag;
+		tag.serial = ++serial;
+		tag.offset = tag_offset;
+		tag.previous_tag_size = (uint32_t)BytesToInt(buf, PREVIOUS_TAG_SIZE_SIZE);
+		tag.tag_type = header[0];
+		tag.tag_data_size = tag_data_size;
+		tag.dts = ((uint32_t)header[7] << 24) | (uint32_t)BytesToInt(header + 4, 3);
+		tag.stream_id = 0;
+		tag.format = header[FLV_TAG_HEADER_SIZE];
+
+		if (tag.tag_type == FlvTagTypeAudio || tag.tag_type == FlvTagTypeVideo)
+		{
+			int i = tag.tag_type == FlvTagTypeAudio ? 0 : 1;
+			tag.dts_diff = (int)(tag.dts - last_dts[i]);
+			last_dts[i] = tag.dts;
+
+			//AAC config or AVC/HEVC sequence header
+			bool is_config = got == sizeof(buf) && header[FLV_TAG_HEADER_SIZE + 1] == 0
+				&& (i == 0 ? (tag.format >> 4) == AudioFormatAAC
+					: ((tag.format & 0x0F) == FlvVideoCodeIDAVC || (tag.format & 0x0F) == FlvVideoCodeIDHEVC));
+			if (is_config)
+				last_config[i] = (int)vtab->tags.size();
+			tag.config = last_config[i];
+		}
+
+		if (!vtab->tags.empty() && tag.dts < vtab->tags.back().dts)
+			vtab->dts_sorted = false;
+		vtab->tags.push_back(tag);
+	}
+	return true;
+}
+
+static std::unique_ptr<FlvTag> DecodeTag(FlvVtab* vtab, size_t pos, std::vector<uint8_t>& buffer)
+{
+	const FlvTagIndex& index = vtab->tags[pos];
+	uint32_t size = PREVIOUS_TAG_SIZE_SIZE + FLV_TAG_HEADER_SIZE + index.tag_data_size;
+	buffer.resize(size);
+	if (!vtab->input->Seek(index.offset) || vtab->input->Read(buffer.data(), size) != size)
+		return nullptr;
+	ByteReader reader(buffer.data(), size);
+	return std::unique_ptr<FlvTag>(new FlvTag(reader, index.serial, index.offset));
+}
+
+static int FlvConnect(sqlite3* db, void* aux, int argc, const char* const* argv, sqlite3_vtab** vtab_out, char** err)
+{
+	if (argc < 4)
+	{
+		*err = sqlite3_mprintf("usage: CREATE VIRTUAL TABLE t USING flv('file.flv')");
+		return SQLITE_ERROR;
+	}
+
+	//the argument is passed as it's written, strip the quotes
+	std::string path = argv[3];
+	if (path.size() >= 2 && (path[0] == '\'' || path[0] == '"') && path.back() == path[0])
+		path = path.substr(1, path.size() - 2);
+
+	int ret = sqlite3_declare_vtab(db, SQL_STAT_DECLARE_FLV_TABLE);
+	if (ret != SQLITE_OK)
+		return ret;
+
+	std::unique_ptr<FlvVtab> vtab(new FlvVtab());
+	memset(&vtab->base, 0, sizeof(vtab->base));
+	vtab->input = std::make_shared<FileInputSource>(path);
+	uint64_t file_size = 0;
+	int64_t mtime = 0;
+	if (!vtab->input->IsGood() || !GetFileSizeAndMtime(path, file_size, mtime) || !BuildIndex(vtab.get(), file_size))
+	{
+		*err = sqlite3_mprintf("%s is not a readable flv file", path.c_str());
+		return SQLITE_ERROR;
+	}
+	*vtab_out = &vtab.release()->base;
+	return SQLITE_OK;
+}
+
+static int FlvDisconnect(sqlite3_vtab* vtab)
+{
+	delete (FlvVtab*)vtab;
+	return SQLITE_OK;
+}
+
+static int FlvBestIndex(sqlite3_vtab* tab, sqlite3_index_info* info)
+{
+	FlvVtab* vtab = (FlvVtab*)tab;
+	int dts_min = -1, dts_max = -1, tag_type = -1;
+	for (int i = 0; i < info->nConstraint; i++)
+	{
+		const sqlite3_index_info::sqlite3_index_constraint& c = info->aConstraint[i];
+		if (!c.usable)
+			continue;
+		if (c.iColumn == FlvColumnDts)
+		{
+			if ((c.op == SQLITE_INDEX_CONSTRAINT_GE || c.op == SQLITE_INDEX_CONSTRAINT_GT || c.op == SQLITE_INDEX_CONSTRAINT_EQ) && dts_min < 0)
+				dts_min = i;
+			if ((c.op == SQLITE_INDEX_CONSTRAINT_LE || c.op == SQLITE_INDEX_CONSTRAINT_LT || c.op == SQLITE_INDEX_CONSTRAINT_EQ) && dts_max < 0)
+				dts_max = i;
+		}
+		else if (c.iColumn == FlvColumnTagType && c.op == SQLITE_INDEX_CONSTRAINT_EQ && tag_type < 0)
+			tag_type = i;
+	}
+
+	//the bounds are inclusive, sqlite still checks the constraints for the exact comparison
+	int argc = 0;
+	double cost = (double)vtab->tags.size();
+	info->idxNum = 0;
+	if (dts_min >= 0)
+	{
+		info->idxNum |= FLV_INDEX_DTS_MIN;
+		info->aConstraintUsage[dts_min].argvIndex = ++argc;
+		cost /= 4;
+	}
+	if (dts_max >= 0 && dts_max == dts_min)
+	{
+		info->idxNum |= FLV_INDEX_DTS_EQ;
+	}
+	else if (dts_max >= 0)
+	{
+		info->idxNum |= FLV_INDEX_DTS_MAX;
+		info->aConstraintUsage[dts_max].argvIndex = ++argc;
+		cost /= 4;
+	}
+	if (tag_type >= 0)
+	{
+		info->idxNum |= FLV_INDEX_TAG_TYPE;
+		info->aConstraintUsage[tag_type].argvIndex = ++argc;
+		info->aConstraintUsage[tag_type].omit = 1;
+		cost /= 2;
+	}
+	info->estimatedCost = cost;
+
+	//the tags come in file order, which is also dts order for most files
+	if (info->nOrderBy == 1 && !info->aOrderBy[0].desc
+		&& (info->aOrderBy[0].iColumn == FlvColumnSerial || (info->aOrderBy[0].iColumn == FlvColumnDts && vtab->dts_sorted)))
+		info->orderByConsumed = 1;
+	return SQLITE_OK;
+}
+
+static int FlvOpen(sqlite3_vtab* vtab, sqlite3_vtab_cursor** cursor_out)
+{
+	FlvCursor* cursor = new FlvCursor();
+	memset(&cursor->base, 0, sizeof(cursor->base));
+	*cursor_out = &cursor->base;
+	return SQLITE_OK;
+}
+
+static int FlvClose(sqlite3_vtab_cursor* cursor)
+{
+	delete (FlvCursor*)cursor;
+	return SQLITE_OK;
+}
+
+//skip the tags which don't match the pushed down constraints
+static void FlvSkip(FlvCursor* cursor)
+{
+	FlvVtab* vtab = (FlvVtab*)cursor->base.pVtab;
+	cursor->tag.reset();
+	for (; cursor->pos < cursor->end; cursor->pos++)
+	{
+		const FlvTagIndex& index = vtab->tags[cursor->pos];
+		if (cursor->has_dts_max && index.dts > cursor->dts_max)
+		{
+			if (!vtab->dts_sorted)
+				continue;
+			cursor->pos = cursor->end; //nothing after it can match
+			break;
+		}
+		if (cursor->tag_type >= 0 && index.tag_type != cursor->tag_type)
+			continue;
+		break;
+	}
+}
+
+//an inclusive bound of the dts for a value compared with it, false if it's not a number
+static bool DtsBound(sqlite3_value* value, bool is_max, int64_t& bound)
+{
+	switch (sqlite3_value_numeric_type(value))
+	{
+	case SQLITE_INTEGER:
+		bound = sqlite3_value_int64(value);
+		return true;
+	case SQLITE_FLOAT:
+	{
+		double d = is_max ? ceil(sqlite3_value_double(value)) : floor(sqlite3_value_double(value));
+		if (d != d) //nan
+			return false;
+		bound = d < -1 ? -1 : d > 4294967296.0 ? 4294967296LL : (int64_t)d; //the dts has 32 bits
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+static int FlvFilter(sqlite3_vtab_cursor* cur, int idx_num, const char* idx_str, int argc, sqlite3_value** argv)
+{
+	FlvCursor* cursor = (FlvCursor*)cur;
+	FlvVtab* vtab = (FlvVtab*)cur->pVtab;
+	cursor->pos = 0;
+	cursor->end = vtab->tags.size();
+	cursor->tag_type = -1;
+	cursor->has_dts_max = false;
+
+	//a bound which is not a number is dropped, sqlite compares it with the dts by its own rules
+	int arg = 0;
+	int64_t dts_min = 0;
+	bool has_dts_min = false;
+	if (idx_num & FLV_INDEX_DTS_MIN)
+		has_dts_min = DtsBound(argv[arg++], false, dts_min);
+	if (idx_num & FLV_INDEX_DTS_EQ)
+		cursor->has_dts_max = has_dts_min && DtsBound(argv[0], true, cursor->dts_max);
+	else if (idx_num & FLV_INDEX_DTS_MAX)
+		cursor->has_dts_max = DtsBound(argv[arg++], true, cursor->dts_max);
+	if (idx_num & FLV_INDEX_TAG_TYPE)
+	{
+		const char* name = (const char*)sqlite3_value_text(argv[arg++]);
+		for (uint8_t type : { FlvTagTypeAudio, FlvTagTypeVideo, FlvTagTypeScriptData })
+		{
+			if (name && strcmp(name, GetFlvTagTypeString((FlvTagType)type)) == 0)
+				cursor->tag_type = type;
+		}
+		if (cursor->tag_type < 0) //no tag has the type
+			cursor->end = 0;
+	}
+
+	if (has_dts_min)
+	{
+		if (vtab->dts_sorted)
+		{
+			auto it = std::lower_bound(vtab->tags.begin(), vtab->tags.end(), dts_min,
+				[](const FlvTagIndex& tag, int64_t dts) { return (int64_t)tag.dts < dts; });
+			cursor->pos = it - vtab->tags.begin();
+		}
+		else
+		{
+			//find the first one, the rest are checked by sqlite
+			while (cursor->pos < cursor->end && (int64_t)vtab->tags[cursor->pos].dts < dts_min)
+				cursor->pos++;
+		}
+	}
+	FlvSkip(cursor);
+	return SQLITE_OK;
+}
+
+static int FlvNext(sqlite3_vtab_cursor* cur)
+{
+	FlvCursor* cursor = (FlvCursor*)cur;
+	cursor->pos++;
+	FlvSkip(cursor);
+	return SQLITE_OK;
+}
+
+static int FlvEof(sqlite3_vtab_cursor* cur)
+{
+	FlvCursor* cursor = (FlvCursor*)cur;
+	return cursor->pos >= cursor->end;
+}
+
+static int FlvColumnValue(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int column)
+{
+	FlvCursor* cursor = (FlvCursor*)cur;
+	FlvVtab* vtab = (FlvVtab*)cur->pVtab;
+	const FlvTagIndex& index = vtab->tags[cursor->pos];
+	switch (column)
+	{
+	case FlvColumnSerial:
+		sqlite3_result_int64(ctx, index.serial);
+		return SQLITE_OK;
+	case FlvColumnPreviousTagSize:
+		sqlite3_result_int64(ctx, index.previous_tag_size);
+		return SQLITE_OK;
+	case FlvColumnTagType:
+		sqlite3_result_text(ctx, GetFlvTagTypeString((FlvTagType)index.tag_type), -1, SQLITE_STATIC);
+		return SQLITE_OK;
+	case FlvColumnStreamId:
+		sqlite3_result_int64(ctx, index.stream_id);
+		return SQLITE_OK;
+	case FlvColumnTagSize:
+		sqlite3_result_int64(ctx, FLV_TAG_HEADER_SIZE + index.tag_data_size);
+		return SQLITE_OK;
+	case FlvColumnFileOffset:
+		sqlite3_result_int64(ctx, (sqlite3_int64)(index.offset + PREVIOUS_TAG_SIZE_SIZE));
+		return SQLITE_OK;
+	case FlvColumnDts:
+		sqlite3_result_int64(ctx, index.dts);
+		return SQLITE_OK;
+	case FlvColumnDtsDiff:
+		sqlite3_result_int(ctx, index.dts_diff);
+		return SQLITE_OK;
+	case FlvColumnFormat:
+		if (index.tag_type == FlvTagTypeAudio && index.tag_data_size > 0)
+			sqlite3_result_text(ctx, GetAudioTagFormatString(index.format), -1, SQLITE_STATIC);
+		else if (index.tag_type == FlvTagTypeVideo && index.tag_data_size > 0)
+			sqlite3_result_text(ctx, GetVideoTagFormatString(index.format), -1, SQLITE_STATIC);
+		else
+			sqlite3_result_text(ctx, "", 0, SQLITE_STATIC);
+		return SQLITE_OK;
+	default:
+		break;
+	}
+
+	//the other columns need the tag decoded, the parser state it depends on is rebuilt from the last config tag
+	if (!cursor->tag)
+	{
+		ResetParserState();
+		if (index.config >= 0 && index.config != (int)cursor->pos)
+			DecodeTag(vtab, index.config, cursor->buffer);
+		cursor->tag = DecodeTag(vtab, cursor->pos, cursor->buffer);
+		if (!cursor->tag)
+			return SQLITE_IOERR;
+	}
+
+	FlvTag* tag = cursor->tag.get();
+	switch (column)
+	{
+	case FlvColumnPts:
+		sqlite3_result_int64(ctx, tag->Pts());
+		break;
+	case FlvColumnSubType:
+		sqlite3_result_text(ctx, tag->SubTypeName(), -1, SQLITE_STATIC);
+		break;
+	case FlvColumnExtraInfo:
+	{
+		std::string extra_info = tag->ExtraInfo();
+		sqlite3_result_text(ctx, extra_info.c_str(), (int)extra_info.size(), SQLITE_TRANSIENT);
+		break;
+	}
+	default:
+		sqlite3_result_null(ctx);
+		break;
+	}
+	return SQLITE_OK;
+}
+
+static int FlvRowid(sqlite3_vtab_cursor* cur, sqlite3_int64* rowid)
+{
+	*rowid = (sqlite3_int64)((FlvCursor*)cur)->pos + 1;
+	return SQLITE_OK;
+}
+
+static sqlite3_module FlvModule = {
+	0,              //iVersion
+	FlvConnect,     //xCreate
+	FlvConnect,     //xConnect
+	FlvBestIndex,
+	FlvDisconnect,
+	FlvDisconnect,  //xDestroy
+	FlvOpen,
+	FlvClose,
+	FlvFilter,
+	FlvNext,
+	FlvEof,
+	FlvColumnValue,
+	FlvRowid,
+	NULL,           //xUpdate, read only
+};
+
+//the entry point sqlite looks for when loading flv_vtab.so / flv_vtab.dll
+extern "C"
+#ifdef _WIN32
+__declspec(dllexport)
+#endif
+int sqlite3_flvvtab_init(sqlite3* db, char** err, const sqlite3_api_routines* api)
+{
+	SQLITE_EXTENSION_INIT2(api);
+	return sqlite3_create_module(db, "flv", &FlvModule, NULL);
+}
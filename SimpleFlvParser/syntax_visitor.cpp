@@ -0,0 +1,172 @@
+#include "syntax_visitor.h"
+#include "compact_json_writer.h"
+
+#include <limits.h>
+
+Json::Value& JsonValueVisitor::Add(const char* key, const Json::Value& value)
+{
+	if (stack_.empty())
+	{
+		//the first value is the root itself
+		root_ = value;
+		return root_;
+	}
+	Json::Value& parent = *stack_.back();
+	if (key)
+		return parent[key] = value;
+	return parent.append(value);
+}
+
+void JsonValueVisitor::BeginObject(const char* key)
+{
+	stack_.push_back(&Add(key, Json::Value(Json::objectValue)));
+}
+
+void JsonValueVisitor::EndObject()
+{
+	if (!stack_.empty())
+		stack_.pop_back();
+}
+
+void JsonValueVisitor::BeginArray(const char* key)
+{
+	stack_.push_back(&Add(key, Json::Value(Json::arrayValue)));
+}
+
+void JsonValueVisitor::EndArray()
+{
+	if (!stack_.empty())
+		stack_.pop_back();
+}
+
+void JsonValueVisitor::Int(const char* key, int64_t value)
+{
+	//no 64 bits integers in this jsoncpp
+	if (value >= INT_MIN && value <= INT_MAX)
+		Add(key, Json::Value((int)value));
+	else if (value > 0 && value <= UINT_MAX)
+		Add(key, Json::Value((unsigned int)value));
+	else
+		Add(key, Json::Value((double)value));
+}
+
+void JsonValueVisitor::Double(const char* key, double value)
+{
+	Add(key, Json::Value(value));
+}
+
+void JsonValueVisitor::Bool(const char* key, bool value)
+{
+	Add(key, Json::Value(value));
+}
+
+void JsonValueVisitor::String(const char* key, const char* value, size_t size)
+{
+	Add(key, Json::Value(std::string(value, size)));
+}
+
+void JsonValueVisitor::Null(const char* key)
+{
+	Add(key, Json::Value());
+}
+
+void CompactJsonVisitor::Key(const char* key)
+{
+	if (key)
+		writer_.Key(key);
+}
+
+void CompactJsonVisitor::BeginObject(const char* key)
+{
+	Key(key);
+	writer_.StartObject();
+}
+
+void CompactJsonVisitor::EndObject()
+{
+	writer_.EndObject();
+}
+
+void CompactJsonVisitor::BeginArray(const char* key)
+{
+	Key(key);
+	writer_.StartArray();
+}
+
+void CompactJsonVisitor::EndArray()
+{
+	writer_.EndArray();
+}
+
+void CompactJsonVisitor::Int(const char* key, int64_t value)
+{
+	Key(key);
+	writer_.Int(value);
+}
+
+void CompactJsonVisitor::Double(const char* key, double value)
+{
+	Key(key);
+	writer_.Double(value);
+}
+
+void CompactJsonVisitor::Bool(const char* key, bool value)
+{
+	Key(key);
+	writer_.Bool(value);
+}
+
+void CompactJsonVisitor::String(const char* key, const char* value, size_t size)
+{
+	Key(key);
+	writer_.String(value, size);
+}
+
+void CompactJsonVisitor::Null(const char* key)
+{
+	Key(key);
+	writer_.Null();
+}
+
+void VisitJsonValue(const Json::Value& value, const char* key, SyntaxVisitor& visitor)
+{
+	switch (value.type())
+	{
+	case Json::intValue:
+		visitor.Int(key, value.asInt());
+		break;
+	case Json::uintValue:
+		visitor.Int(key, value.asUInt());
+		break;
+	case Json::realValue:
+		visitor.Double(key, value.asDouble());
+		break;
+	case Json::stringValue:
+	{
+		std::string str = value.asString();
+		visitor.String(key, str.data(), str.size());
+		break;
+	}
+	case Json::booleanValue:
+		visitor.Bool(key, value.asBool());
+		break;
+	case Json::arrayValue:
+		visitor.BeginArray(key);
+		for (Json::Value::UInt i = 0; i < value.size(); i++)
+			VisitJsonValue(value[i], NULL, visitor);
+		visitor.EndArray();
+		break;
+	case Json::objectValue:
+	{
+		visitor.BeginObject(key);
+		Json::Value::Members members = value.getMemberNames();
+		for (size_t i = 0; i < members.size(); i++)
+			VisitJsonValue(value[members[i]], members[i].c_str(), visitor);
+		visitor.EndObject();
+		break;
+	}
+	default:
+		visitor.Null(key);
+		break;
+	}
+}
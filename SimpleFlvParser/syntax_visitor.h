@@ -0,0 +1,93 @@
+#ifndef _SFP_SYNTAX_VISITOR_H_
+#define _SFP_SYNTAX_VISITOR_H_
+
+#include "json/value.h"
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+class CompactJsonWriter;
+
+//Receives the syntax fields of the parameter sets, slice headers, SEIs etc. in syntax order,
+//so every output format is written in one pass without building and parsing a json first.
+//The key is NULL for the elements of an array.
+class SyntaxVisitor
+{
+public:
+	virtual ~SyntaxVisitor() {}
+
+	virtual void BeginObject(const char* key) = 0;
+	virtual void EndObject() = 0;
+	virtual void BeginArray(const char* key) = 0;
+	virtual void EndArray() = 0;
+	virtual void Int(const char* key, int64_t value) = 0;
+	virtual void Double(const char* key, double value) = 0;
+	virtual void Bool(const char* key, bool value) = 0;
+	virtual void String(const char* key, const char* value, size_t size) = 0;
+	virtual void Null(const char* key) = 0;
+
+	//the syntax structs mix all kinds of integer types
+	void Field(const char* key, int value) { Int(key, value); }
+	void Field(const char* key, unsigned int value) { Int(key, value); }
+	void Field(const char* key, long value) { Int(key, value); }
+	void Field(const char* key, unsigned long value) { Int(key, (int64_t)value); }
+	void Field(const char* key, long long value) { Int(key, value); }
+	void Field(const char* key, unsigned long long value) { Int(key, (int64_t)value); }
+	void Field(const char* key, bool value) { Bool(key, value); }
+	void Field(const char* key, double value) { Double(key, value); }
+	void Field(const char* key, const char* value) { String(key, value, strlen(value)); }
+	void Field(const char* key, const std::string& value) { String(key, value.data(), value.size()); }
+};
+
+//Builds the same Json::Value tree the syntax used to be converted to, for the styled extra_info.
+class JsonValueVisitor : public SyntaxVisitor
+{
+public:
+	const Json::Value& Root() const { return root_; }
+
+	void BeginObject(const char* key) override;
+	void EndObject() override;
+	void BeginArray(const char* key) override;
+	void EndArray() override;
+	void Int(const char* key, int64_t value) override;
+	void Double(const char* key, double value) override;
+	void Bool(const char* key, bool value) override;
+	void String(const char* key, const char* value, size_t size) override;
+	void Null(const char* key) override;
+
+private:
+	Json::Value& Add(const char* key, const Json::Value& value);
+
+private:
+	Json::Value root_;
+	std::vector<Json::Value*> stack_; //the open objects and arrays
+};
+
+//Writes compact json straight into a CompactJsonWriter.
+class CompactJsonVisitor : public SyntaxVisitor
+{
+public:
+	explicit CompactJsonVisitor(CompactJsonWriter& writer) : writer_(writer) {}
+
+	void BeginObject(const char* key) override;
+	void EndObject() override;
+	void BeginArray(const char* key) override;
+	void EndArray() override;
+	void Int(const char* key, int64_t value) override;
+	void Double(const char* key, double value) override;
+	void Bool(const char* key, bool value) override;
+	void String(const char* key, const char* value, size_t size) override;
+	void Null(const char* key) override;
+
+private:
+	void Key(const char* key);
+
+private:
+	CompactJsonWriter& writer_;
+};
+
+//Replay a json value into a visitor, e.g. the decoded script data.
+void VisitJsonValue(const Json::Value& value, const char* key, SyntaxVisitor& visitor);
+
+#endif //_SFP_SYNTAX_VISITOR_H_
@@ -23,63 +23,116 @@ TextOutput::TextOutput(const std::string& txt_path)
 	txt_file_ = fopen(txt_path.c_str(), "w");
 	if (!txt_file_)
 		printf("Create txt file %s error.\n", txt_path.c_str());
+	txt_writer_.SetFile(txt_file_);
 }
 
 TextOutput::~TextOutput()
 {
+	if (nalu_file_)
+	{
+		nalu_writer_.Flush();
+		if (txt_file_)
+		{
+			char buff[64 * 1024];
+			size_t read_size = 0;
+			rewind(nalu_file_);
+			while ((read_size = fread(buff, 1, sizeof(buff), nalu_file_)) > 0)
+				txt_writer_.Write(buff, read_size);
+		}
+		fclose(nalu_file_);
+		nalu_file_ = NULL;
+	}
 	if (txt_file_)
 	{
+		txt_writer_.Flush();
 		fclose(txt_file_);
 		txt_file_ = NULL;
 	}
 }
 
-void TextOutput::FlvHeaderOutput(const std::shared_ptr<FlvHeaderInterface>& header)
+//the rows are formatted the same as "%*d %*s ...", a space before every column but the first
+void TextOutput::FlvHeaderOutput(FlvHeaderInterface* header)
 {
+	BufferedWriter& out = txt_writer_;
 	if (!header_title_printed_)
 	{
-		std::string splitter(15 + 1 + 15 + 1 + 15 + 1 + 15, '-');
-		fprintf(txt_file_, "%s\n", splitter.c_str());
-		fprintf(txt_file_, "%15s %15s %15s %15s\n", "have_video", "have_audio", "version", "header_size");
+		out.Fill('-', 15 + 1 + 15 + 1 + 15 + 1 + 15);
+		out.Char('\n');
+		out.Str("have_video", 15);
+		out.Char(' '); out.Str("have_audio", 15);
+		out.Char(' '); out.Str("version", 15);
+		out.Char(' '); out.Str("header_size", 15);
+		out.Char('\n');
 		header_title_printed_ = true;
 	}
-	fprintf(txt_file_, "%15d %15d %15d %15d\n", header->HaveVideo(), header->HaveAudio(), header->Version(), header->HeaderSize());
+	out.Int(header->HaveVideo(), 15);
+	out.Char(' '); out.Int(header->HaveAudio(), 15);
+	out.Char(' '); out.Int(header->Version(), 15);
+	out.Char(' '); out.Int(header->HeaderSize(), 15);
+	out.Char('\n');
 }
 
-void TextOutput::FlvTagOutput(const std::shared_ptr<FlvTagInterface>& tag)
+void TextOutput::FlvTagOutput(FlvTagInterface* tag)
 {
+	BufferedWriter& out = txt_writer_;
 	if (!tags_title_printed_)
 	{
-		std::string splitter(10 + 1 + 15 + 1 + 12 + 1 + 10 + 1 + 10 + 1 + 10 + 1 + 20, '-');
-		fprintf(txt_file_, "%s\n", splitter.c_str());
-		fprintf(txt_file_, "%10s %15s %12s %10s %10s %10s %20s\n", "serial", "tag_type", "tag_size", "pts", "dts", "dts_diff", "sub_type");
+		out.Fill('-', 10 + 1 + 15 + 1 + 12 + 1 + 10 + 1 + 10 + 1 + 10 + 1 + 20);
+		out.Char('\n');
+		out.Str("serial", 10);
+		out.Char(' '); out.Str("tag_type", 15);
+		out.Char(' '); out.Str("tag_size", 12);
+		out.Char(' '); out.Str("pts", 10);
+		out.Char(' '); out.Str("dts", 10);
+		out.Char(' '); out.Str("dts_diff", 10);
+		out.Char(' '); out.Str("sub_type", 20);
+		out.Char('\n');
 		tags_title_printed_ = true;
 	}
-	fprintf(txt_file_, "%10d %15s %12d %10d %10d %10d %20s\n",
-		tag->Serial(), 
-		tag->TagType().c_str(), 
-		tag->TagSize(), 
-		tag->Pts(), 
-		tag->Dts(), 
-		tag->DtsDiff(), 
-		tag->SubType().c_str());
+	//the unsigned values are printed as int, the same as they always were
+	out.Int(tag->Serial(), 10);
+	out.Char(' '); out.Str(tag->TagTypeName(), 15);
+	out.Char(' '); out.Int((int)tag->TagSize(), 12);
+	out.Char(' '); out.Int((int)tag->Pts(), 10);
+	out.Char(' '); out.Int((int)tag->Dts(), 10);
+	out.Char(' '); out.Int(tag->DtsDiff(), 10);
+	out.Char(' '); out.Str(tag->SubTypeName(), 20);
+	out.Char('\n');
 }
 
-void TextOutput::NaluOutput(const std::shared_ptr<NaluInterface>& nalu)
+void TextOutput::NaluOutput(NaluInterface* nalu)
 {
+	if (!nalu_file_)
+	{
+		nalu_file_ = tmpfile();
+		if (!nalu_file_)
+		{
+			printf("Create temporary file for nalu rows error.\n");
+			return;
+		}
+		nalu_writer_.SetFile(nalu_file_);
+	}
+
+	BufferedWriter& out = nalu_writer_;
 	if (!nalu_title_printed_)
 	{
-		std::string splitter(10 + 1 + 10 + 1 + 10 + 1 + 11 + 1 + 13 + 1 + 10, '-');
-		fprintf(txt_file_, "%s\n", splitter.c_str());
-		fprintf(txt_file_, "%10s %10s %10s %11s %13s %10s\n", "nalu_serial", "tag_belong", "nalu_size", "nal_ref_idc", "nal_unit_type", "slice_type");
+		out.Fill('-', 10 + 1 + 10 + 1 + 10 + 1 + 11 + 1 + 13 + 1 + 10);
+		out.Char('\n');
+		out.Str("nalu_serial", 10);
+		out.Char(' '); out.Str("tag_belong", 10);
+		out.Char(' '); out.Str("nalu_size", 10);
+		out.Char(' '); out.Str("nal_ref_idc", 11);
+		out.Char(' '); out.Str("nal_unit_type", 13);
+		out.Char(' '); out.Str("slice_type", 10);
+		out.Char('\n');
 		nalu_title_printed_ = true;
 	}
 
-	fprintf(txt_file_, "%10d %10d %10d %11d %13s %10s\n",
-		++nalu_serial_,
-		nalu->TagSerialBelong(),
-		nalu->NaluSize(),
-		nalu->NalRefIdc(),
-		nalu->NalUnitType().c_str(),
-		nalu->SliceType().c_str());
+	out.Int(++nalu_serial_, 10);
+	out.Char(' '); out.Int(nalu->TagSerialBelong(), 10);
+	out.Char(' '); out.Int((int)nalu->NaluSize(), 10);
+	out.Char(' '); out.Int(nalu->NalRefIdc(), 11);
+	out.Char(' '); out.Str(nalu->NalUnitTypeName(), 13);
+	out.Char(' '); out.Str(nalu->SliceTypeName(), 10);
+	out.Char('\n');
 }
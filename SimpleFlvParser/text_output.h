@@ -3,6 +3,7 @@
 
 #include "output_interface.h"
 #include "input_interface.h"
+#include "buffered_writer.h"
 #include <string>
 
 struct sqlite3;
@@ -13,13 +14,16 @@ public:
 	TextOutput(const std::string& txt_path);
 	~TextOutput();
 
-	virtual void FlvHeaderOutput(const std::shared_ptr<FlvHeaderInterface>& header) override;
-	virtual void FlvTagOutput(const std::shared_ptr<FlvTagInterface>& tag) override;
-	virtual void NaluOutput(const std::shared_ptr<NaluInterface>& nalu) override;
+	virtual void FlvHeaderOutput(FlvHeaderInterface* header) override;
+	virtual void FlvTagOutput(FlvTagInterface* tag) override;
+	virtual void NaluOutput(NaluInterface* nalu) override;
 	virtual bool IsGood() override { return txt_file_ != NULL; }
 
 private:
 	FILE* txt_file_ = NULL;
+	FILE* nalu_file_ = NULL; //nalu rows arrive interleaved with tag rows, stage them here and append them after the tags table
+	BufferedWriter txt_writer_;
+	BufferedWriter nalu_writer_;
 	int  nalu_serial_ = 0;
 	bool header_title_printed_ = false;
 	bool tags_title_printed_ = false;
@@ -0,0 +1,58 @@
+#ifndef _SFP_TRACE_FORMAT_H_
+#define _SFP_TRACE_FORMAT_H_
+
+#include <stdint.h>
+
+//The trace written by TraceOutput (-trace) and replayed by TraceReader (-type trace), it keeps everything the outputs get
+//from the parser, so a db/text/csv... can be written again without the inputs and without parsing a single byte of them.
+//
+//	"SFPTRACE" varint(version) then records, each one starts with a TraceRecord byte, till the end of the file.
+//
+//The numbers are LEB128 varints, the signed ones zigzag encoded first. Most fields are written as the difference from
+//what is expected (the serial after the last one, the offset after the last tag...), so they usually take a byte.
+//The strings (names, syntax keys, short syntax values) are stored once in a TraceString record and then referred to
+//by their index, in the order they are defined from 0.
+//The detail of a tag or nalu (what VisitExtraInfo gives) is a blob: varint(size) then u8(what VisitExtraInfo returned)
+//and the TraceSyntax ops it was visited with, size 0 means false and nothing visited.
+
+#define TRACE_MAGIC   "SFPTRACE"
+#define TRACE_VERSION 2
+#define TRACE_MAX_SHORT_STRING 32    //the longer syntax values are written inline
+#define TRACE_MAX_STRINGS (1 << 16)  //beyond this the syntax values are written inline, names and keys still get an index
+
+enum TraceRecord
+{
+	TraceString = 'S', //varint(size) bytes
+	TraceInput = 'I',  //string(source path) varint(size) zz(mtime) of the source when it was parsed, an input begins
+	TraceHeader = 'H', //u8(flags, 1 video 4 audio) u8(version) u8(header_size)
+	TraceTag = 'T',    //zz(serial - last - 1) zz(previous_tag_size - last tag_size) varint(stream_id) varint(tag_size)
+	                   //zz(offset - end of the last tag) zz(dts - last dts) zz(pts - dts) zz(dts_diff)
+	                   //u8(tag_type) zz(sub_type) zz(format) string(tag_type name) string(sub_type name) string(format name) blob
+	TraceNalu = 'N',   //zz(tag_serial - last tag serial) varint(size) zz(offset - end of the last nalu or the last tag's offset)
+	                   //u8(nal_ref_idc) u8(codec_id) zz(nal_unit_type) string(its name) zz(first_mb_in_slice)
+	                   //zz(slice_type) string(its name) zz(pps_id) zz(frame_num) zz(field_pic_flag) zz(pic_order_cnt_lsb)
+	                   //zz(slice_qp_delta) blob
+	TraceEndInput = 'E',
+};
+
+//the ops of a syntax blob, each one starts with varint(key << 4 | op), the key is the string index + 1, 0 for none,
+//so a field with one of the first keys and a small value takes 2 bytes
+enum TraceSyntax
+{
+	TraceSyntaxBeginObject = 1,
+	TraceSyntaxEndObject,
+	TraceSyntaxBeginArray,
+	TraceSyntaxEndArray,
+	TraceSyntaxInt,             //zz(value)
+	TraceSyntaxDouble,          //8 bytes
+	TraceSyntaxTrue,
+	TraceSyntaxFalse,
+	TraceSyntaxString,          //varint(size) bytes
+	TraceSyntaxStringRef,       //string index
+	TraceSyntaxNull,
+};
+
+inline uint64_t TraceZigzag(int64_t value) { return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63); }
+inline int64_t TraceUnzigzag(uint64_t value) { return (int64_t)(value >> 1) ^ -(int64_t)(value & 1); }
+
+#endif //_SFP_TRACE_FORMAT_H_
@@ -0,0 +1,242 @@
+#include "trace_output.h"
+#include "syntax_visitor.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#pragma warning(disable: 4996)
+#endif
+
+//Writes the syntax the detail is visited with as TraceSyntax ops.
+class TraceSyntaxRecorder : public SyntaxVisitor
+{
+public:
+	TraceSyntaxRecorder(TraceOutput& trace, BufferedWriter& out) : trace_(trace), out_(out) {}
+
+	void BeginObject(const char* key) override { Op(TraceSyntaxBeginObject, key); }
+	void EndObject() override { out_.Char((char)TraceSyntaxEndObject); }
+	void BeginArray(const char* key) override { Op(TraceSyntaxBeginArray, key); }
+	void EndArray() override { out_.Char((char)TraceSyntaxEndArray); }
+	void Int(const char* key, int64_t value) override
+	{
+		Op(TraceSyntaxInt, key);
+		TraceOutput::Signed(out_, value);
+	}
+	void Double(const char* key, double value) override
+	{
+		Op(TraceSyntaxDouble, key);
+		out_.Write((const char*)&value, sizeof(value));
+	}
+	void Bool(const char* key, bool value) override { Op(value ? TraceSyntaxTrue : TraceSyntaxFalse, key); }
+	void String(const char* key, const char* value, size_t size) override
+	{
+		//the short values are mostly names which repeat, such as the nal unit types
+		if (size <= TRACE_MAX_SHORT_STRING && trace_.strings_.size() < TRACE_MAX_STRINGS)
+		{
+			uint32_t index = trace_.Intern(value, size);
+			Op(TraceSyntaxStringRef, key);
+			TraceOutput::Varint(out_, index);
+			return;
+		}
+		Op(TraceSyntaxString, key);
+		TraceOutput::Varint(out_, size);
+		out_.Write(value, size);
+	}
+	void Null(const char* key) override { Op(TraceSyntaxNull, key); }
+
+private:
+	void Op(TraceSyntax op, const char* key)
+	{
+		uint64_t index = key ? trace_.Intern(key, strlen(key)) + 1 : 0;
+		TraceOutput::Varint(out_, index << 4 | op);
+	}
+
+private:
+	TraceOutput& trace_;
+	BufferedWriter& out_;
+};
+
+TraceOutput::TraceOutput(const std::string& trace_path)
+	: blob_(NULL, 64 * 1024)
+{
+	blob_.KeepInMemory();
+	trace_file_ = fopen(trace_path.c_str(), "wb");
+	if (!trace_file_)
+	{
+		printf("Create trace file %s error.\n", trace_path.c_str());
+		return;
+	}
+	out_.SetFile(trace_file_);
+	out_.Write(TRACE_MAGIC, 8);
+	Varint(out_, TRACE_VERSION);
+}
+
+TraceOutput::~TraceOutput()
+{
+	if (trace_file_)
+	{
+		EndInput();
+		out_.Flush();
+		fclose(trace_file_);
+		trace_file_ = NULL;
+	}
+}
+
+void TraceOutput::Varint(BufferedWriter& out, uint64_t value)
+{
+	char bytes[10];
+	int size = 0;
+	while (value >= 0x80)
+	{
+		bytes[size++] = (char)(value | 0x80);
+		value >>= 7;
+	}
+	bytes[size++] = (char)value;
+	out.Write(bytes, size);
+}
+
+uint32_t TraceOutput::Intern(const char* str, size_t size)
+{
+	std::string key(str, size);
+	auto it = strings_.find(key);
+	if (it != strings_.end())
+		return it->second;
+
+	//defined before the record which refers to it
+	uint32_t index = (uint32_t)strings_.size();
+	strings_.emplace(std::move(key), index);
+	out_.Char(TraceString);
+	Varint(out_, size);
+	out_.Write(str, size);
+	return index;
+}
+
+void TraceOutput::BeginInput(const std::string& source, uint64_t size, int64_t mtime)
+{
+	if (!trace_file_)
+		return;
+	EndInput();
+	uint32_t index = Intern(source.data(), source.size());
+	out_.Char(TraceInput);
+	Varint(out_, index);
+	Varint(out_, size);
+	Signed(out_, mtime);
+	in_input_ = true;
+	last_tag_serial_ = 0;
+	last_tag_size_ = 0;
+	tag_end_ = 0;
+	last_dts_ = 0;
+	nalu_end_ = 0;
+}
+
+void TraceOutput::EndInput()
+{
+	if (!in_input_)
+		return;
+	out_.Char(TraceEndInput);
+	in_input_ = false;
+}
+
+bool TraceOutput::Detail(FlvTagInterface* tag, NaluInterface* nalu)
+{
+	//the strings are defined while recording, so before the record of the object
+	blob_.Clear();
+	TraceSyntaxRecorder recorder(*this, blob_);
+	return tag ? tag->VisitExtraInfo(recorder, NULL) : nalu->VisitExtraInfo(recorder, NULL);
+}
+
+void TraceOutput::WriteBlob(bool have)
+{
+	if (!have && blob_.Size() == 0)
+	{
+		Varint(out_, 0);
+		return;
+	}
+	Varint(out_, blob_.Size() + 1);
+	out_.Char(have ? 1 : 0);
+	out_.Write(blob_.Data(), blob_.Size());
+}
+
+void TraceOutput::FlvHeaderOutput(FlvHeaderInterface* header)
+{
+	if (header == NULL || !trace_file_)
+		return;
+	if (!in_input_)
+		BeginInput("");
+	out_.Char(TraceHeader);
+	out_.Char((char)((header->HaveVideo() ? 1 : 0) | (header->HaveAudio() ? 4 : 0)));
+	out_.Char((char)header->Version());
+	out_.Char((char)header->HeaderSize());
+}
+
+void TraceOutput::FlvTagOutput(FlvTagInterface* tag)
+{
+	if (tag == NULL || !trace_file_)
+		return;
+	if (!in_input_)
+		BeginInput("");
+	uint32_t tag_type_name = Intern(tag->TagTypeName(), strlen(tag->TagTypeName()));
+	uint32_t sub_type_name = Intern(tag->SubTypeName(), strlen(tag->SubTypeName()));
+	uint32_t format_name = Intern(tag->FormatName(), strlen(tag->FormatName()));
+	bool have = Detail(tag, NULL);
+
+	int serial = tag->Serial();
+	uint32_t tag_size = tag->TagSize();
+	uint64_t offset = tag->Offset();
+	uint32_t dts = tag->Dts();
+	out_.Char(TraceTag);
+	Signed(out_, (int64_t)serial - last_tag_serial_ - 1);
+	Signed(out_, (int64_t)tag->PreviousTagSize() - last_tag_size_);
+	Varint(out_, tag->StreamId());
+	Varint(out_, tag_size);
+	Signed(out_, (int64_t)(offset - tag_end_));
+	Signed(out_, (int64_t)dts - last_dts_);
+	Signed(out_, (int64_t)tag->Pts() - dts);
+	Signed(out_, tag->DtsDiff());
+	out_.Char((char)tag->TagTypeId());
+	Signed(out_, tag->SubTypeId());
+	Signed(out_, tag->FormatId());
+	Varint(out_, tag_type_name);
+	Varint(out_, sub_type_name);
+	Varint(out_, format_name);
+	WriteBlob(have);
+
+	last_tag_serial_ = serial;
+	last_tag_size_ = tag_size;
+	tag_end_ = offset + tag_size;
+	last_dts_ = dts;
+	nalu_end_ = offset;
+}
+
+void TraceOutput::NaluOutput(NaluInterface* nalu)
+{
+	if (nalu == NULL || !trace_file_)
+		return;
+	if (!in_input_)
+		BeginInput("");
+	uint32_t nal_unit_type_name = Intern(nalu->NalUnitTypeName(), strlen(nalu->NalUnitTypeName()));
+	uint32_t slice_type_name = Intern(nalu->SliceTypeName(), strlen(nalu->SliceTypeName()));
+	bool have = Detail(NULL, nalu);
+
+	uint32_t size = nalu->NaluSize();
+	uint64_t offset = nalu->Offset();
+	out_.Char(TraceNalu);
+	Signed(out_, (int64_t)nalu->TagSerialBelong() - last_tag_serial_);
+	Varint(out_, size);
+	Signed(out_, (int64_t)(offset - nalu_end_));
+	out_.Char((char)nalu->NalRefIdc());
+	out_.Char((char)nalu->CodecId());
+	Signed(out_, nalu->NalUnitTypeId());
+	Varint(out_, nal_unit_type_name);
+	Signed(out_, nalu->FirstMbInSlice());
+	Signed(out_, nalu->SliceTypeId());
+	Varint(out_, slice_type_name);
+	Signed(out_, nalu->PicParameterSetId());
+	Signed(out_, nalu->FrameNum());
+	Signed(out_, nalu->FieldPicFlag());
+	Signed(out_, nalu->PicOrderCntLsb());
+	Signed(out_, nalu->SliceQpDelta());
+	WriteBlob(have);
+
+	nalu_end_ = offset + size;
+}
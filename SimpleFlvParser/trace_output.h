@@ -0,0 +1,54 @@
+#ifndef _SFP_TRACE_OUTPUT_H_
+#define _SFP_TRACE_OUTPUT_H_
+
+#include "output_interface.h"
+#include "input_interface.h"
+#include "buffered_writer.h"
+#include "trace_format.h"
+#include <string>
+#include <unordered_map>
+
+class TraceSyntaxRecorder;
+
+//Records every header/tag/nalu with its detail into a compact binary trace, see trace_format.h,
+//which is replayed by TraceReader into any output instead of parsing the inputs again.
+class TraceOutput : public FlvOutputInterface
+{
+public:
+	TraceOutput(const std::string& trace_path);
+	~TraceOutput();
+
+	//the objects from now on belong to this input, by default the inputs have no path
+	//size and mtime are the ones of the source, so a db written from the trace can tell if it's changed
+	void BeginInput(const std::string& source, uint64_t size = 0, int64_t mtime = 0);
+
+	virtual void FlvHeaderOutput(FlvHeaderInterface* header) override;
+	virtual void FlvTagOutput(FlvTagInterface* tag) override;
+	virtual void NaluOutput(NaluInterface* nalu) override;
+	virtual void EndInput() override;
+	virtual bool IsGood() override { return trace_file_ != NULL; }
+
+private:
+	friend class TraceSyntaxRecorder;
+	static void Varint(BufferedWriter& out, uint64_t value);
+	static void Signed(BufferedWriter& out, int64_t value) { Varint(out, TraceZigzag(value)); }
+	uint32_t Intern(const char* str, size_t size); //the index of the string, defined in the trace the first time
+	bool Detail(FlvTagInterface* tag, NaluInterface* nalu); //record the detail into blob_, what VisitExtraInfo returns
+	void WriteBlob(bool have);
+
+private:
+	FILE* trace_file_ = NULL;
+	BufferedWriter out_;
+	BufferedWriter blob_; //the detail of the current object, written after its fields
+	std::unordered_map<std::string, uint32_t> strings_;
+	bool in_input_ = false;
+
+	//what the next values are expected to be, reset with every input
+	int last_tag_serial_ = 0;
+	uint32_t last_tag_size_ = 0;
+	uint64_t tag_end_ = 0;
+	uint32_t last_dts_ = 0;
+	uint64_t nalu_end_ = 0;
+};
+
+#endif //_SFP_TRACE_OUTPUT_H_
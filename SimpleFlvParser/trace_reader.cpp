@@ -0,0 +1,392 @@
+#include "trace_reader.h"
+#include "syntax_visitor.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#pragma warning(disable: 4996)
+#endif
+
+std::string ReplayedTag::ExtraInfo()
+{
+	JsonValueVisitor visitor;
+	if (!VisitExtraInfo(visitor, NULL))
+		return "";
+	return visitor.Root().toStyledString();
+}
+
+bool ReplayedTag::VisitExtraInfo(SyntaxVisitor& visitor, const char* key)
+{
+	reader->VisitDetail(detail_offset, detail_size, visitor, key);
+	return have_detail;
+}
+
+std::string ReplayedNalu::ExtraInfo()
+{
+	JsonValueVisitor visitor;
+	if (!VisitExtraInfo(visitor, NULL))
+		return "";
+	return visitor.Root().toStyledString();
+}
+
+bool ReplayedNalu::VisitExtraInfo(SyntaxVisitor& visitor, const char* key)
+{
+	reader->VisitDetail(detail_offset, detail_size, visitor, key);
+	return have_detail;
+}
+
+TraceReader::TraceReader(const std::string& trace_path)
+	: buffer_(1024 * 1024)
+{
+	file_ = fopen(trace_path.c_str(), "rb");
+	if (!file_)
+	{
+		printf("Open trace file %s error.\n", trace_path.c_str());
+		return;
+	}
+	char magic[8];
+	if (!Bytes(magic, sizeof(magic)) || memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0 || Varint() != TRACE_VERSION)
+	{
+		printf("%s is not a trace of this version.\n", trace_path.c_str());
+		fclose(file_);
+		file_ = NULL;
+	}
+}
+
+TraceReader::~TraceReader()
+{
+	if (file_)
+		fclose(file_);
+	file_ = NULL;
+}
+
+int TraceReader::Byte()
+{
+	if (pos_ == end_)
+	{
+		pos_ = 0;
+		end_ = fread(&buffer_[0], 1, buffer_.size(), file_);
+		if (end_ == 0)
+			return -1;
+	}
+	return buffer_[pos_++];
+}
+
+uint64_t TraceReader::Varint()
+{
+	uint64_t value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		int byte = Byte();
+		if (byte < 0)
+			break;
+		value |= (uint64_t)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0)
+			return value;
+	}
+	error_ = true;
+	return 0;
+}
+
+bool TraceReader::Bytes(void* data, size_t size)
+{
+	uint8_t* dest = (uint8_t*)data;
+	while (size > 0)
+	{
+		if (pos_ == end_)
+		{
+			pos_ = 0;
+			end_ = fread(&buffer_[0], 1, buffer_.size(), file_);
+			if (end_ == 0)
+			{
+				error_ = true;
+				return false;
+			}
+		}
+		size_t n = end_ - pos_ < size ? end_ - pos_ : size;
+		memcpy(dest, &buffer_[pos_], n);
+		pos_ += n;
+		dest += n;
+		size -= n;
+	}
+	return true;
+}
+
+const char* TraceReader::Name(uint64_t index) const
+{
+	return index < strings_.size() ? strings_[(size_t)index].c_str() : "";
+}
+
+bool TraceReader::Blob(bool& have, size_t& offset, size_t& size)
+{
+	uint64_t blob_size = Varint();
+	have = false;
+	offset = detail_.size();
+	size = 0;
+	if (blob_size == 0)
+		return !error_;
+	int result = Byte();
+	if (result < 0)
+		return false;
+	have = result != 0;
+	size = (size_t)(blob_size - 1);
+	detail_.resize(offset + size);
+	return size == 0 || Bytes(&detail_[offset], size);
+}
+
+bool TraceReader::ReadString()
+{
+	uint64_t size = Varint();
+	if (error_)
+		return false;
+	std::string str((size_t)size, '\0');
+	if (size > 0 && !Bytes(&str[0], (size_t)size))
+		return false;
+	strings_.push_back(std::move(str));
+	return true;
+}
+
+bool TraceReader::ReadHeader()
+{
+	uint8_t bytes[3];
+	if (!Bytes(bytes, sizeof(bytes)))
+		return false;
+	headers_.emplace_back();
+	ReplayedHeader& header = headers_.back();
+	header.flags = bytes[0];
+	header.version = bytes[1];
+	header.header_size = bytes[2];
+	order_.push_back(TraceHeader);
+	return true;
+}
+
+bool TraceReader::ReadTag()
+{
+	tags_.emplace_back();
+	ReplayedTag& tag = tags_.back();
+	tag.reader = this;
+	tag.serial = (int)(last_tag_serial_ + 1 + Signed());
+	tag.previous_tag_size = (uint32_t)(last_tag_size_ + Signed());
+	tag.stream_id = (uint32_t)Varint();
+	tag.tag_size = (uint32_t)Varint();
+	tag.offset = tag_end_ + Signed();
+	tag.dts = (uint32_t)(last_dts_ + Signed());
+	tag.pts = (uint32_t)(tag.dts + Signed());
+	tag.dts_diff = (int)Signed();
+	tag.tag_type = (uint8_t)Byte();
+	tag.sub_type = (int)Signed();
+	tag.format = (int)Signed();
+	tag.tag_type_name = Name(Varint());
+	tag.sub_type_name = Name(Varint());
+	tag.format_name = Name(Varint());
+	if (!Blob(tag.have_detail, tag.detail_offset, tag.detail_size) || error_)
+		return false;
+
+	last_tag_serial_ = tag.serial;
+	last_tag_size_ = tag.tag_size;
+	tag_end_ = tag.offset + tag.tag_size;
+	last_dts_ = tag.dts;
+	nalu_end_ = tag.offset;
+	order_.push_back(TraceTag);
+	return true;
+}
+
+bool TraceReader::ReadNalu()
+{
+	nalus_.emplace_back();
+	ReplayedNalu& nalu = nalus_.back();
+	nalu.reader = this;
+	nalu.tag_serial = (int)(last_tag_serial_ + Signed());
+	nalu.size = (uint32_t)Varint();
+	nalu.offset = nalu_end_ + Signed();
+	nalu.nal_ref_idc = (uint8_t)Byte();
+	nalu.codec_id = (uint8_t)Byte();
+	nalu.nal_unit_type = (int)Signed();
+	nalu.nal_unit_type_name = Name(Varint());
+	nalu.first_mb_in_slice = (int8_t)Signed();
+	nalu.slice_type = (int)Signed();
+	nalu.slice_type_name = Name(Varint());
+	nalu.pps_id = (int)Signed();
+	nalu.frame_num = (int)Signed();
+	nalu.field_pic_flag = (int)Signed();
+	nalu.pic_order_cnt_lsb = (int)Signed();
+	nalu.slice_qp_delta = (int)Signed();
+	if (!Blob(nalu.have_detail, nalu.detail_offset, nalu.detail_size) || error_)
+		return false;
+
+	nalu_end_ = nalu.offset + nalu.size;
+	order_.push_back(TraceNalu);
+	return true;
+}
+
+void TraceReader::Clear()
+{
+	headers_.clear();
+	tags_.clear();
+	nalus_.clear();
+	order_.clear();
+	detail_.clear();
+	last_tag_serial_ = 0;
+	last_tag_size_ = 0;
+	tag_end_ = 0;
+	last_dts_ = 0;
+	nalu_end_ = 0;
+}
+
+bool TraceReader::NextInput(std::string& source, uint64_t& size, int64_t& mtime)
+{
+	Clear();
+	if (!IsGood())
+		return false;
+
+	bool in_input = false;
+	int record;
+	while ((record = Byte()) >= 0)
+	{
+		bool ok = true;
+		switch (record)
+		{
+		case TraceString:
+			ok = ReadString();
+			break;
+		case TraceInput:
+			source = Name(Varint());
+			size = Varint();
+			mtime = Signed();
+			ok = !in_input && !error_;
+			in_input = true;
+			break;
+		case TraceHeader:
+			ok = in_input && ReadHeader();
+			break;
+		case TraceTag:
+			ok = in_input && ReadTag();
+			break;
+		case TraceNalu:
+			ok = in_input && ReadNalu();
+			break;
+		case TraceEndInput:
+			if (in_input)
+				return true;
+			ok = false;
+			break;
+		default:
+			ok = false;
+			break;
+		}
+		if (!ok)
+		{
+			printf("The trace is broken at record '%c', replayed till there.\n", record);
+			error_ = true;
+			break;
+		}
+	}
+
+	//a trace which was not finished still has the objects till the end
+	return in_input;
+}
+
+void TraceReader::Replay(FlvOutputInterface* output)
+{
+	size_t header = 0, tag = 0, nalu = 0;
+	for (uint8_t record : order_)
+	{
+		if (record == TraceHeader)
+			output->FlvHeaderOutput(&headers_[header++]);
+		else if (record == TraceTag)
+			output->FlvTagOutput(&tags_[tag++]);
+		else
+			output->NaluOutput(&nalus_[nalu++]);
+	}
+}
+
+static uint64_t DecodeVarint(const uint8_t*& p, const uint8_t* end)
+{
+	uint64_t value = 0;
+	for (int shift = 0; shift < 64 && p < end; shift += 7)
+	{
+		uint8_t byte = *p++;
+		value |= (uint64_t)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0)
+			break;
+	}
+	return value;
+}
+
+void TraceReader::VisitDetail(size_t offset, size_t size, SyntaxVisitor& visitor, const char* key) const
+{
+	if (size == 0)
+		return;
+	const uint8_t* p = &detail_[offset];
+	const uint8_t* end = p + size;
+	int depth = 0;
+	while (p < end)
+	{
+		uint64_t token = DecodeVarint(p, end);
+		uint64_t op = token & 0xf;
+		uint64_t index = token >> 4;
+		if (op == TraceSyntaxEndObject || op == TraceSyntaxEndArray)
+		{
+			if (op == TraceSyntaxEndObject)
+				visitor.EndObject();
+			else
+				visitor.EndArray();
+			depth--;
+			continue;
+		}
+
+		//the value visited at the top gets the key asked for now, the rest the keys recorded
+		const char* op_key = depth == 0 ? key : (index == 0 ? NULL : Name(index - 1));
+		switch (op)
+		{
+		case TraceSyntaxBeginObject:
+			visitor.BeginObject(op_key);
+			depth++;
+			break;
+		case TraceSyntaxBeginArray:
+			visitor.BeginArray(op_key);
+			depth++;
+			break;
+		case TraceSyntaxInt:
+			visitor.Int(op_key, TraceUnzigzag(DecodeVarint(p, end)));
+			break;
+		case TraceSyntaxDouble:
+		{
+			double value = 0;
+			if (end - p < (ptrdiff_t)sizeof(value))
+				return;
+			memcpy(&value, p, sizeof(value));
+			p += sizeof(value);
+			visitor.Double(op_key, value);
+			break;
+		}
+		case TraceSyntaxTrue:
+		case TraceSyntaxFalse:
+			visitor.Bool(op_key, op == TraceSyntaxTrue);
+			break;
+		case TraceSyntaxString:
+		{
+			uint64_t length = DecodeVarint(p, end);
+			if (length > (uint64_t)(end - p))
+				return;
+			visitor.String(op_key, (const char*)p, (size_t)length);
+			p += length;
+			break;
+		}
+		case TraceSyntaxStringRef:
+		{
+			uint64_t string = DecodeVarint(p, end);
+			if (string < strings_.size())
+				visitor.String(op_key, strings_[(size_t)string].data(), strings_[(size_t)string].size());
+			else
+				visitor.String(op_key, "", 0);
+			break;
+		}
+		case TraceSyntaxNull:
+			visitor.Null(op_key);
+			break;
+		default:
+			return;
+		}
+	}
+}
@@ -0,0 +1,172 @@
+#ifndef _SFP_TRACE_READER_H_
+#define _SFP_TRACE_READER_H_
+
+#include "output_interface.h"
+#include "input_interface.h"
+#include "trace_format.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+
+class SyntaxVisitor;
+class TraceReader;
+
+//The objects given to the outputs, filled from the trace.
+class ReplayedHeader : public FlvHeaderInterface
+{
+public:
+	virtual bool    HaveVideo() override { return (flags & 1) != 0; }
+	virtual bool    HaveAudio() override { return (flags & 4) != 0; }
+	virtual uint8_t Version() override { return version; }
+	virtual uint8_t HeaderSize() override { return header_size; }
+
+	uint8_t flags = 0;
+	uint8_t version = 0;
+	uint8_t header_size = 0;
+};
+
+class ReplayedTag : public FlvTagInterface
+{
+public:
+	virtual int         Serial() override { return serial; }
+	virtual uint32_t    PreviousTagSize() override { return previous_tag_size; }
+	virtual std::string TagType() override { return tag_type_name; }
+	virtual uint32_t    StreamId() override { return stream_id; }
+	virtual uint32_t    TagSize() override { return tag_size; }
+	virtual uint32_t    Pts() override { return pts; }
+	virtual uint32_t    Dts() override { return dts; }
+	virtual int         DtsDiff() override { return dts_diff; }
+	virtual std::string SubType() override { return sub_type_name; }
+	virtual std::string Format() override { return format_name; }
+	virtual std::string ExtraInfo() override;
+	virtual uint8_t     TagTypeId() override { return tag_type; }
+	virtual const char* TagTypeName() override { return tag_type_name; }
+	virtual int         SubTypeId() override { return sub_type; }
+	virtual const char* SubTypeName() override { return sub_type_name; }
+	virtual int         FormatId() override { return format; }
+	virtual const char* FormatName() override { return format_name; }
+	virtual uint64_t    Offset() override { return offset; }
+	virtual bool        VisitExtraInfo(SyntaxVisitor& visitor, const char* key) override;
+
+	const TraceReader* reader = NULL;
+	int serial = 0;
+	uint32_t previous_tag_size = 0;
+	uint32_t stream_id = 0;
+	uint32_t tag_size = 0;
+	uint32_t pts = 0;
+	uint32_t dts = 0;
+	int dts_diff = 0;
+	uint8_t tag_type = 0;
+	int sub_type = -1;
+	int format = -1;
+	const char* tag_type_name = "";
+	const char* sub_type_name = "";
+	const char* format_name = "";
+	uint64_t offset = 0;
+	bool have_detail = false;
+	size_t detail_offset = 0;
+	size_t detail_size = 0;
+};
+
+class ReplayedNalu : public NaluInterface
+{
+public:
+	virtual int         TagSerialBelong() override { return tag_serial; }
+	virtual uint32_t    NaluSize() override { return size; }
+	virtual uint8_t     NalRefIdc() override { return nal_ref_idc; }
+	virtual std::string NalUnitType() override { return nal_unit_type_name; }
+	virtual int8_t      FirstMbInSlice() override { return first_mb_in_slice; }
+	virtual std::string SliceType() override { return slice_type_name; }
+	virtual int         PicParameterSetId() override { return pps_id; }
+	virtual int         FrameNum() override { return frame_num; }
+	virtual int         FieldPicFlag() override { return field_pic_flag; }
+	virtual int         PicOrderCntLsb() override { return pic_order_cnt_lsb; }
+	virtual int         SliceQpDelta() override { return slice_qp_delta; }
+	virtual std::string ExtraInfo() override;
+	virtual uint8_t     CodecId() override { return codec_id; }
+	virtual int         NalUnitTypeId() override { return nal_unit_type; }
+	virtual const char* NalUnitTypeName() override { return nal_unit_type_name; }
+	virtual int         SliceTypeId() override { return slice_type; }
+	virtual const char* SliceTypeName() override { return slice_type_name; }
+	virtual uint64_t    Offset() override { return offset; }
+	virtual bool        VisitExtraInfo(SyntaxVisitor& visitor, const char* key) override;
+
+	const TraceReader* reader = NULL;
+	int tag_serial = 0;
+	uint32_t size = 0;
+	uint8_t nal_ref_idc = 0;
+	uint8_t codec_id = 0;
+	int nal_unit_type = -1;
+	const char* nal_unit_type_name = "";
+	int8_t first_mb_in_slice = 0;
+	int slice_type = -1;
+	const char* slice_type_name = "";
+	int pps_id = 0;
+	int frame_num = 0;
+	int field_pic_flag = 0;
+	int pic_order_cnt_lsb = 0;
+	int slice_qp_delta = 0;
+	uint64_t offset = 0;
+	bool have_detail = false;
+	size_t detail_offset = 0;
+	size_t detail_size = 0;
+};
+
+//Reads a trace written by TraceOutput, see trace_format.h, and feeds it into any output as if the inputs were parsed again.
+//The inputs are read one at a time, their objects live until the next one is read:
+//	TraceReader trace("a.trace");
+//	std::string source;
+//	uint64_t size;
+//	int64_t mtime;
+//	while (trace.NextInput(source, size, mtime)) { trace.Replay(output); output->EndInput(); }
+class TraceReader
+{
+public:
+	TraceReader(const std::string& trace_path);
+	~TraceReader();
+
+	bool IsGood() const { return file_ != NULL && !error_; }
+	//read the next input, source is the path it was parsed from, size and mtime are the ones it had then, false at the end
+	bool NextInput(std::string& source, uint64_t& size, int64_t& mtime);
+	void Replay(FlvOutputInterface* output); //all the objects of the input in the order they were parsed
+
+	//for the replayed objects
+	const char* Name(uint64_t index) const; //"" if there is no such string
+	void VisitDetail(size_t offset, size_t size, SyntaxVisitor& visitor, const char* key) const;
+
+private:
+	int Byte(); //-1 at the end of the file
+	uint64_t Varint();
+	int64_t Signed() { return TraceUnzigzag(Varint()); }
+	bool Bytes(void* data, size_t size);
+	bool Blob(bool& have, size_t& offset, size_t& size); //into detail_
+	bool ReadString();
+	bool ReadHeader();
+	bool ReadTag();
+	bool ReadNalu();
+	void Clear();
+
+private:
+	FILE* file_ = NULL;
+	bool error_ = false;
+	std::vector<uint8_t> buffer_;
+	size_t pos_ = 0;
+	size_t end_ = 0;
+	std::deque<std::string> strings_; //a deque, so the names handed out stay where they are
+
+	//the current input
+	std::deque<ReplayedHeader> headers_;
+	std::deque<ReplayedTag> tags_;
+	std::deque<ReplayedNalu> nalus_;
+	std::vector<uint8_t> order_; //TraceRecord of every object
+	std::vector<uint8_t> detail_; //the syntax ops of the objects
+	int last_tag_serial_ = 0;
+	uint32_t last_tag_size_ = 0;
+	uint64_t tag_end_ = 0;
+	uint32_t last_dts_ = 0;
+	uint64_t nalu_end_ = 0;
+};
+
+#endif //_SFP_TRACE_READER_H_
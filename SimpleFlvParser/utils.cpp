@@ -30,6 +30,7 @@ inline T ToLowerString(T& str)
 
 #include <shlobj.h> 
 #include <shlwapi.h>
+#include <stdlib.h>
 #pragma  comment(lib, "Version.lib")
 #pragma  comment(lib, "Shlwapi.lib")
 
@@ -84,6 +85,27 @@ bool FilePathIsExist(const std::string & filepath_in, bool is_directory)
 	return false;
 }
 
+bool GetFileSizeAndMtime(const std::string& path, uint64_t& size, int64_t& mtime)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!::GetFileAttributesExW(GBKToUnicode(path).c_str(), GetFileExInfoStandard, &data))
+		return false;
+	size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+	uint64_t file_time = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+	mtime = (int64_t)((file_time - 116444736000000000ULL) / 10000000); //100ns since 1601 to seconds since 1970
+	return true;
+}
+
+std::string FullFilePath(const std::string& path)
+{
+	wchar_t* full = _wfullpath(NULL, GBKToUnicode(path).c_str(), 0);
+	if (!full)
+		return path;
+	std::string result = UnicodeToGBK(full);
+	free(full);
+	return result;
+}
+
 bool CreateDirectoryRecursively(const std::string& full_dir)
 {
 	HRESULT result = ::SHCreateDirectory(NULL, GBKToUnicode(full_dir).c_str());
@@ -122,6 +144,26 @@ bool FilePathIsExist(const std::string & filepath_in, bool is_directory)
 	return false;
 }
 
+bool GetFileSizeAndMtime(const std::string& path, uint64_t& size, int64_t& mtime)
+{
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+		return false;
+	size = (uint64_t)info.st_size;
+	mtime = (int64_t)info.st_mtime;
+	return true;
+}
+
+std::string FullFilePath(const std::string& path)
+{
+	char* full = realpath(path.c_str(), NULL);
+	if (!full)
+		return path;
+	std::string result = full;
+	free(full);
+	return result;
+}
+
 bool CreateDirectoryRecursively(const std::string& full_dir)
 {
 	if (FilePathIsExist(full_dir, true))
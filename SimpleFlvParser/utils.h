@@ -18,6 +18,8 @@ bool         FilePathIsExist(const std::string& filepath_in, bool is_directory);
 bool         CreateDirectoryRecursively(const std::string& full_dir);
 std::string  DirectoryFromFilePath(const std::string& path);
 std::string  FileNameFromFilePath(const std::string& path);
+bool         GetFileSizeAndMtime(const std::string& path, uint64_t& size, int64_t& mtime); //mtime in seconds since 1970
+std::string  FullFilePath(const std::string& path); //absolute and canonical, so one file has one path, the path itself if it can't be resolved
 
 int BytesToInt(uint8_t* pData, int iCount);
 std::string BytesToStr(uint8_t * pData, int iCount);
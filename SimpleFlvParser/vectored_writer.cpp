@@ -0,0 +1,244 @@
+#include "vectored_writer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <new>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <malloc.h>
+#else
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#define STAGING_ALIGN 4096 //a page, the kernel copies whole pages out of it
+
+VectoredWriter::VectoredWriter(const std::string& path, bool background, size_t buffer_size)
+	: path_(path), buffer_size_(buffer_size < STAGING_ALIGN ? STAGING_ALIGN : buffer_size), background_(background), error_(false)
+{
+#ifdef _WIN32
+	fd_ = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+	fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+	if (fd_ < 0)
+	{
+		printf("Create file %s error.\n", path.c_str());
+		return;
+	}
+	staging_ = Allocate();
+	if (background_)
+		thread_ = std::thread(&VectoredWriter::FlushThread, this);
+}
+
+VectoredWriter::~VectoredWriter()
+{
+	if (fd_ < 0)
+		return;
+	Flush();
+	if (thread_.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stopping_ = true;
+		}
+		work_.notify_all();
+		thread_.join();
+	}
+	if (error_)
+		printf("Write file %s error.\n", path_.c_str());
+	for (uint8_t* buffer : buffers_)
+	{
+#ifdef _WIN32
+		_aligned_free(buffer);
+#else
+		free(buffer);
+#endif
+	}
+#ifdef _WIN32
+	_close(fd_);
+#else
+	close(fd_);
+#endif
+	fd_ = -1;
+}
+
+uint8_t* VectoredWriter::Allocate()
+{
+	void* buffer = NULL;
+#ifdef _WIN32
+	buffer = _aligned_malloc(buffer_size_, STAGING_ALIGN);
+#else
+	if (posix_memalign(&buffer, STAGING_ALIGN, buffer_size_) != 0)
+		buffer = NULL;
+#endif
+	if (buffer == NULL)
+		throw std::bad_alloc();
+	buffers_.push_back((uint8_t*)buffer);
+	return (uint8_t*)buffer;
+}
+
+bool VectoredWriter::WriteSegments(Segment* segments, size_t count)
+{
+#ifdef _WIN32
+	for (size_t i = 0; i < count; i++)
+	{
+		const uint8_t* data = segments[i].data;
+		size_t size = segments[i].size;
+		while (size > 0)
+		{
+			int n = _write(fd_, data, (unsigned int)(size < 0x40000000 ? size : 0x40000000));
+			if (n <= 0)
+				return false;
+			data += n;
+			size -= n;
+		}
+	}
+	return true;
+#else
+	struct iovec iov[MAX_BUFFERS + 3];
+	while (count > 0)
+	{
+		size_t n = count < sizeof(iov) / sizeof(iov[0]) ? count : sizeof(iov) / sizeof(iov[0]);
+		for (size_t i = 0; i < n; i++)
+		{
+			iov[i].iov_base = (void*)segments[i].data;
+			iov[i].iov_len = segments[i].size;
+		}
+		ssize_t written = writev(fd_, iov, (int)n);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			return false;
+
+		//skip what is written, a partial write goes on from the middle of a segment
+		while (count > 0 && (size_t)written >= segments->size)
+		{
+			written -= segments->size;
+			segments++;
+			count--;
+		}
+		if (count > 0)
+		{
+			segments->data += written;
+			segments->size -= written;
+		}
+	}
+	return true;
+#endif
+}
+
+void VectoredWriter::Append(const uint8_t* data, size_t size)
+{
+	while (size > 0)
+	{
+		size_t n = buffer_size_ - staged_ < size ? buffer_size_ - staged_ : size;
+		memcpy(staging_ + staged_, data, n);
+		staged_ += n;
+		data += n;
+		size -= n;
+		if (staged_ == buffer_size_)
+			Submit();
+	}
+}
+
+void VectoredWriter::Submit()
+{
+	if (staged_ == 0)
+		return;
+	if (!background_)
+	{
+		Segment segment = { staging_, staged_ };
+		if (!WriteSegments(&segment, 1))
+			error_ = true;
+		staged_ = 0;
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(mutex_);
+	Segment segment = { staging_, staged_ };
+	queue_.push_back(segment);
+	work_.notify_one();
+	staged_ = 0;
+	if (free_.empty() && buffers_.size() < MAX_BUFFERS)
+	{
+		staging_ = Allocate();
+		return;
+	}
+	written_.wait(lock, [this] { return !free_.empty(); });
+	staging_ = free_.back();
+	free_.pop_back();
+}
+
+void VectoredWriter::Write(const uint8_t* data, size_t size)
+{
+	Write(NULL, 0, data, size);
+}
+
+void VectoredWriter::Write(const uint8_t* header, size_t header_size, const uint8_t* data, size_t size)
+{
+	if (fd_ < 0)
+		return;
+
+	//the payload is only valid during the call, so it can't wait in the queue of the thread without a copy
+	if (!background_ && size >= buffer_size_ / 2)
+	{
+		Segment segments[3] = { { staging_, staged_ }, { header, header_size }, { data, size } };
+		if (!WriteSegments(segments, 3))
+			error_ = true;
+		staged_ = 0;
+		return;
+	}
+	if (header_size > 0)
+		Append(header, header_size);
+	Append(data, size);
+}
+
+void VectoredWriter::Flush()
+{
+	if (fd_ < 0)
+		return;
+	Submit();
+	if (background_)
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		written_.wait(lock, [this] { return queue_.empty() && !writing_; });
+	}
+}
+
+void VectoredWriter::FlushThread()
+{
+	std::vector<Segment> batch;
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			work_.wait(lock, [this] { return !queue_.empty() || stopping_; });
+			if (queue_.empty())
+				break;
+			batch.assign(queue_.begin(), queue_.end());
+			queue_.clear();
+			writing_ = true;
+		}
+
+		//the buffers keep their pointers, the segments are advanced on partial writes
+		std::vector<uint8_t*> done;
+		for (const Segment& segment : batch)
+			done.push_back((uint8_t*)segment.data);
+		if (!WriteSegments(&batch[0], batch.size()))
+			error_ = true;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			free_.insert(free_.end(), done.begin(), done.end());
+			writing_ = false;
+		}
+		written_.notify_all();
+	}
+}
@@ -0,0 +1,63 @@
+#ifndef _SFP_VECTORED_WRITER_H_
+#define _SFP_VECTORED_WRITER_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//Gathers many small writes, like a start code and a nalu at a time, into page aligned staging buffers and writes
+//them with writev, so a demux costs a system call per buffer instead of a call per piece. A payload as big as half
+//a buffer is not copied, it goes out in the same writev as the buffer before it.
+//In background mode the full buffers are written by a thread of its own, all of those waiting in one writev,
+//the caller only copies into the next free buffer, and waits only when every buffer is still being written.
+class VectoredWriter
+{
+public:
+	VectoredWriter(const std::string& path, bool background = false, size_t buffer_size = 1024 * 1024);
+	~VectoredWriter(); //write everything and close the file
+
+	bool IsGood() const { return fd_ >= 0 && !error_; }
+	void Write(const uint8_t* data, size_t size);
+	void Write(const uint8_t* header, size_t header_size, const uint8_t* data, size_t size);
+	void Flush(); //everything written so far is in the file when it returns
+
+private:
+	struct Segment
+	{
+		const uint8_t* data;
+		size_t size;
+	};
+	void Append(const uint8_t* data, size_t size); //copy into the staging buffer, submit the full ones
+	void Submit(); //hand the staging buffer over, and take a free one
+	bool WriteSegments(Segment* segments, size_t count); //all of them in order, false on error
+	void FlushThread();
+	uint8_t* Allocate();
+
+private:
+	std::string path_;
+	int fd_ = -1;
+	size_t buffer_size_;
+	bool background_;
+	std::atomic<bool> error_;
+	uint8_t* staging_ = NULL;
+	size_t staged_ = 0;
+
+	//background mode
+	static const size_t MAX_BUFFERS = 4;
+	std::thread thread_;
+	std::mutex mutex_;
+	std::condition_variable work_; //a buffer to write, or stopping
+	std::condition_variable written_; //buffers are written and free again
+	std::deque<Segment> queue_; //the full buffers to write, in order
+	std::vector<uint8_t*> free_;
+	std::vector<uint8_t*> buffers_; //all of them, freed at the end
+	bool writing_ = false;
+	bool stopping_ = false;
+};
+
+#endif //_SFP_VECTORED_WRITER_H_